@@ -0,0 +1,24 @@
+#!/bin/bash
+# Throughput of assembly output for one very large function: N rounds of three
+# statements (100000 by default), written to a file and through a pipe. The
+# --emit=obj run does everything but the printing, for comparison.
+N=${1:-100000}
+
+awk -v n="$N" 'BEGIN {
+    print "int main()\n{\n    int a = 1;\n    int b = 2;\n    int c = 3;"
+    for (i = 0; i < n; i++)
+        printf "    a = a * %d + b;\n    b ^= a >> %d;\n    c += a - b;\n", i % 97 + 2, i % 31
+    print "    return c;\n}"
+}' > bench_emit.c
+
+TIMEFORMAT='%R s'
+
+echo "assembly to a file:"
+time ./ccomp -o bench_emit.s bench_emit.c
+echo "assembly through a pipe:"
+time (./ccomp bench_emit.c | cat > /dev/null)
+echo "object file:"
+time ./ccomp --emit=obj -o bench_emit.o bench_emit.c
+
+wc -lc bench_emit.s
+rm -f bench_emit.c bench_emit.s bench_emit.o
@@ -1,2 +1 @@
-./ccomp test.c > test.s
-gcc -g -m32 -nostdlib test.s
+./ccomp --emit=exe -o a.out test.c
@@ -9,30 +9,15 @@ _start:
 
 .globl main
 main:
-    pushl %ebx
+    pushl %ebp
     movl %esp, %ebp
-    
+    subl $8, %esp
     movl $0, %eax
-    pushl %eax
-    movl $8, %eax
-    movl %eax, %ebx
-    movl -4(%ebp), %eax
-    addl %ebx, %eax
-    movl %eax, -4(%ebp)
-    movl $2, %eax
-    movl %eax, %ebx
-    movl -4(%ebp), %eax
-    imul %ebx
-    movl %eax, -4(%ebp)
-    movl -4(%ebp), %eax
-    movl -4(%ebp), %eax
+    addl $8, %eax
+    sall $1, %eax
     incl %eax
-    movl %eax, -4(%ebp)
-    
     movl %ebp, %esp
-    popl %ebx
-    ret
-    
+    popl %ebp
     ret
 
 # End of compiling.
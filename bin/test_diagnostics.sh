@@ -0,0 +1,43 @@
+#!/bin/bash
+# Parser error recovery: each broken program must give exactly the diagnostics
+# listed, without errors that only follow from an earlier one.
+fail=0
+
+check()
+{
+    printf "$2" > test_diagnostics.c
+    got=$(./ccomp -o test_diagnostics.s test_diagnostics.c 2>&1)
+
+    if [ "$got" != "$(printf "$3")" ]; then
+        echo "FAIL $1"
+        echo "  expected: $(printf "$3")"
+        echo "  got:      $got"
+        fail=$((fail + 1))
+    fi
+}
+
+# The statement after the bad character still ends at the block's '}'.
+check "bad character" 'int main() { @@@ return 0; }\n' \
+    'test_diagnostics.c:1:14: error: unrecognized character.'
+
+# Truncated input: the missing '}' follows from the missing operand.
+check "truncated expression" 'int main() { int a = 1 +\n' \
+    'test_diagnostics.c:2:1: error: expected expression.'
+
+check "missing brace" 'int main() { return 0;\n' \
+    "test_diagnostics.c:2:1: error: expected '}'."
+
+check "stray tokens at top level" '}\nreturn 1;\nint main() { return 0; }\n' \
+    'test_diagnostics.c:1:1: error: expected type.'
+
+check "one error per statement" 'int main() { return return 2; }\nint f() { int int a; return 1; }\n' \
+    'test_diagnostics.c:1:21: error: expected expression.\ntest_diagnostics.c:2:15: error: expected variable name.'
+
+rm -f test_diagnostics.c test_diagnostics.s
+
+if [ $fail -ne 0 ]; then
+    echo "$fail case(s) failed"
+    exit 1
+fi
+
+echo "all cases passed"
@@ -0,0 +1,186 @@
+#!/bin/bash
+# Differential test of multiplication, division and remainder by constants
+# against gcc. A generator built with gcc writes one program per divisor that
+# checks n * d, n / d, n % d, n /= d and n %= d for edge-case and random
+# dividends, with the results gcc computed as the expected values. Each program
+# is compiled with ./ccomp in every configuration and must exit with 0.
+#
+# usage: test_divide.sh [random divisors (200)] [seed (1)]
+RANDOM_DIVISORS=${1:-200}
+SEED=${2:-1}
+
+CONFIGS=(
+    "-O0"
+    "-O0 --backend=ir"
+    "-O2"
+    "--target=x86-64 -O0"
+    "--target=x86-64 -O2"
+)
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/generate.c" << 'EOF'
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint32_t g_State;
+
+static uint32_t NextRandom(void)
+{
+    g_State ^= g_State << 13;
+    g_State ^= g_State >> 17;
+    g_State ^= g_State << 5;
+    return g_State;
+}
+
+/* INT_MIN has no literal of its own. */
+static void PrintLiteral(FILE* out, int32_t value)
+{
+    if (value == INT32_MIN)
+        fprintf(out, "(-2147483647 - 1)");
+    else
+        fprintf(out, "%d", value);
+}
+
+static void PrintCheck(FILE* out, const char* expr, int32_t divisor, int32_t expected)
+{
+    fprintf(out, "    bad |= %s", expr);
+    PrintLiteral(out, divisor);
+    fprintf(out, " != ");
+    PrintLiteral(out, expected);
+    fprintf(out, ";\n");
+}
+
+static void PrintProgram(const char* dir, int32_t divisor)
+{
+    int32_t dividends[64];
+    int count = 0;
+
+    int32_t edges[] = { 0, 1, -1, 2, -2, 3, -3, INT32_MAX, INT32_MAX - 1, INT32_MIN, INT32_MIN + 1 };
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+        dividends[count++] = edges[i];
+
+    /* Around multiples of the divisor, where a wrong quotient is off by one. */
+    int64_t multiples[] = { 1, -1, 2, -2, 7, -7, INT32_MAX / divisor, (int64_t)INT32_MIN / divisor };
+    for (size_t i = 0; i < sizeof(multiples) / sizeof(multiples[0]); i++)
+    {
+        for (int64_t delta = -1; delta <= 1; delta++)
+        {
+            int64_t value = multiples[i] * divisor + delta;
+            if (value >= INT32_MIN && value <= INT32_MAX)
+                dividends[count++] = (int32_t)value;
+        }
+    }
+
+    while (count < 64)
+        dividends[count++] = (int32_t)NextRandom() >> (NextRandom() % 32);
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/divide_%u.c", dir, (uint32_t)divisor);
+
+    FILE* out = fopen(path, "w");
+    if (out == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    fprintf(out, "int main()\n{\n    int bad = 0;\n    int n = 0;\n    int q = 0;\n");
+
+    for (int i = 0; i < count; i++)
+    {
+        int32_t n = dividends[i];
+
+        fprintf(out, "    n = ");
+        PrintLiteral(out, n);
+        fprintf(out, ";\n");
+
+        PrintCheck(out, "n * ", divisor, (int32_t)((uint32_t)n * (uint32_t)divisor));
+
+        /* The quotient overflows, and idivl traps on it. */
+        if (n == INT32_MIN && divisor == -1)
+            continue;
+
+        PrintCheck(out, "n / ", divisor, n / divisor);
+        PrintCheck(out, "n % ", divisor, n % divisor);
+
+        fprintf(out, "    q = n;\n    q /= ");
+        PrintLiteral(out, divisor);
+        fprintf(out, ";\n    bad |= q != ");
+        PrintLiteral(out, n / divisor);
+        fprintf(out, ";\n    q = n;\n    q %%= ");
+        PrintLiteral(out, divisor);
+        fprintf(out, ";\n    bad |= q != ");
+        PrintLiteral(out, n % divisor);
+        fprintf(out, ";\n");
+    }
+
+    fprintf(out, "    return bad;\n}\n");
+    fclose(out);
+}
+
+int main(int argc, char** argv)
+{
+    const char* dir = argv[1];
+    int randomCount = atoi(argv[2]);
+    g_State = (uint32_t)atoi(argv[3]) * 2654435761u + 1;
+
+    /* Small divisors, powers of two and their neighbours, and divisors whose
+       magic number needs the add-back fixup (7, 641, 6700417, ...). */
+    for (int32_t d = -64; d <= 64; d++)
+        if (d != 0)
+            PrintProgram(dir, d);
+
+    for (int k = 7; k < 31; k++)
+    {
+        int32_t power = (int32_t)1 << k;
+        int32_t near[] = { power, power - 1, power + 1, -power, -power + 1, -power - 1 };
+        for (size_t i = 0; i < sizeof(near) / sizeof(near[0]); i++)
+            PrintProgram(dir, near[i]);
+    }
+
+    int32_t special[] = { INT32_MIN, INT32_MIN + 1, INT32_MAX, 100, 125, 365, 641, -641, 1000, 6700417,
+                          -6700417, 1000000007, -1000000007 };
+    for (size_t i = 0; i < sizeof(special) / sizeof(special[0]); i++)
+        PrintProgram(dir, special[i]);
+
+    for (int i = 0; i < randomCount; i++)
+    {
+        int32_t d = (int32_t)NextRandom() >> (NextRandom() % 31);
+        if (d != 0)
+            PrintProgram(dir, d);
+    }
+
+    return 0;
+}
+EOF
+
+gcc -O2 -o "$DIR/generate" "$DIR/generate.c" || exit 1
+"$DIR/generate" "$DIR" "$RANDOM_DIVISORS" "$SEED" || exit 1
+
+total=0
+fail=0
+
+for source in "$DIR"/divide_*.c; do
+    divisor=$(basename "$source" .c)
+    divisor=${divisor#divide_}
+    divisor=$(( divisor >= 2147483648 ? divisor - 4294967296 : divisor ))
+
+    for config in "${CONFIGS[@]}"; do
+        total=$((total + 1))
+
+        if ! ./ccomp $config --emit=exe -o "$DIR/divide" "$source" 2> "$DIR/errors"; then
+            echo "COMPILE FAIL d=$divisor ($config)"
+            head -3 "$DIR/errors"
+            fail=$((fail + 1))
+        elif ! timeout 10 "$DIR/divide"; then
+            echo "MISMATCH d=$divisor ($config)"
+            fail=$((fail + 1))
+        fi
+    done
+done
+
+echo "$total runs, $fail failures"
+[ $fail -eq 0 ]
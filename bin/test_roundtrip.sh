@@ -0,0 +1,79 @@
+#!/bin/bash
+# Round trip of the built-in encoder and ELF writer against GNU as: for every
+# source, target and optimization level, the --emit=asm output is assembled with
+# as --32 / as --64 and compared with --emit=obj, by the disassembled .text
+# (which shows the bytes) and by the relocations and symbols readelf lists.
+# Section indices and the order of the symbol table are left out, since as
+# adds sections of its own.
+#
+# usage: test_roundtrip.sh [source.c...] (test.c by default)
+SOURCES=("$@")
+if [ ${#SOURCES[@]} -eq 0 ]; then
+    SOURCES=(test.c)
+fi
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# Everything but the header naming the file.
+disassemble()
+{
+    objdump -d -j .text "$1" | sed '1,/file format/d'
+}
+
+relocations()
+{
+    readelf -rW "$1" | awk '/^[0-9a-f]+ / { print $1, $3, $5, $6, $7 }'
+}
+
+symbols()
+{
+    readelf -sW "$1" | awk 'NR > 3 && $4 != "SECTION" && $4 != "FILE" { print $2, $5, $7, $8 }' | sort
+}
+
+total=0
+fail=0
+
+for source in "${SOURCES[@]}"; do
+    for target in i386 x86-64; do
+        if [ $target = i386 ]; then
+            AS="as --32"
+        else
+            AS="as --64"
+        fi
+
+        for level in -O0 -O2; do
+            total=$((total + 1))
+            flags="--target=$target $level"
+
+            if ! ./ccomp $flags --emit=asm -o "$DIR/out.s" "$source" 2> "$DIR/errors" \
+                || ! ./ccomp $flags --emit=obj -o "$DIR/ccomp.o" "$source" 2>> "$DIR/errors"; then
+                echo "COMPILE FAIL $source ($flags)"
+                head -3 "$DIR/errors"
+                fail=$((fail + 1))
+                continue
+            fi
+
+            if ! $AS "$DIR/out.s" -o "$DIR/as.o"; then
+                echo "AS FAIL $source ($flags)"
+                fail=$((fail + 1))
+                continue
+            fi
+
+            for part in disassemble relocations symbols; do
+                $part "$DIR/as.o" > "$DIR/as.txt"
+                $part "$DIR/ccomp.o" > "$DIR/ccomp.txt"
+
+                if ! diff -u "$DIR/as.txt" "$DIR/ccomp.txt" > "$DIR/diff"; then
+                    echo "DIFF $source ($flags): $part"
+                    head -20 "$DIR/diff"
+                    fail=$((fail + 1))
+                    break
+                fi
+            done
+        done
+    done
+done
+
+echo "$total runs, $fail failures"
+[ $fail -eq 0 ]
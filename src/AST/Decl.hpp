@@ -63,6 +63,7 @@ namespace CComp
             std::string name;
             std::vector<std::unique_ptr<Parameter>> parameters;
             std::unique_ptr<BlockStmt> body;
+            size_t slotCount = 0; // Set by SemanticVisitor.
         };
 
     } // namespace AST
@@ -1,6 +1,9 @@
 #ifndef CCOMP_AST_EXPR_HPP
 #define CCOMP_AST_EXPR_HPP
 
+#include <cstdint>
+#include <string>
+
 #include "Node.hpp"
 #include "Visitor.hpp"
 
@@ -29,6 +32,21 @@ namespace CComp
                 visitor.VisitIntegerNumberExpr(*this);
             }
 
+            // Value of the literal wrapped to 32 bits, the way the generated code sees it.
+            int32_t GetValue() const
+            {
+                uint32_t value = 0;
+                size_t i = 0;
+                bool negative = !number.empty() && number[0] == '-';
+
+                for (i = negative ? 1 : 0; i < number.size(); i++)
+                {
+                    value = value * 10 + static_cast<uint32_t>(number[i] - '0');
+                }
+
+                return static_cast<int32_t>(negative ? 0u - value : value);
+            }
+
             std::string number;
         }; // class IntegerNumber
 
@@ -152,6 +170,7 @@ namespace CComp
             }
 
             std::string name;
+            int slot = -1; // Set by SemanticVisitor.
         }; // class VarExpr
 
     } // namespace AST
@@ -80,6 +80,7 @@ namespace CComp
             std::unique_ptr<Type> type;
             std::string name;
             std::unique_ptr<Expr> init;
+            int slot = -1; // Set by SemanticVisitor.
         }; // class VarDecl
 
     } // namespace AST
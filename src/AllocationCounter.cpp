@@ -0,0 +1,415 @@
+#include "AllocationCounter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace CComp
+{
+    namespace
+    {
+        constexpr size_t gc_CategoryCount = static_cast<size_t>(MemoryCategory::COUNT);
+
+        const char* const gc_CategoryNames[gc_CategoryCount] =
+        {
+            "other",
+            "source files",
+            "tokens",
+            "scanner states",
+            "macro buffers",
+            "AST nodes",
+            "codegen",
+        };
+
+        struct MemoryCounters
+        {
+            size_t allocations = 0;
+            size_t bytes = 0;
+            size_t live = 0;
+            size_t peak = 0;
+
+            void Allocate(size_t size)
+            {
+                allocations++;
+                bytes += size;
+                live += size;
+                peak = std::max(peak, live);
+            }
+
+            void Free(size_t size)
+            {
+                live -= size;
+            }
+
+            // Counts of another thread that ran alongside, as if their peaks coincided.
+            void AddConcurrent(const MemoryCounters& other)
+            {
+                allocations += other.allocations;
+                bytes += other.bytes;
+                live += other.live;
+                peak += other.peak;
+            }
+
+            // Counts of work that ran after what this thread counted so far.
+            void AddSequential(const MemoryCounters& other)
+            {
+                allocations += other.allocations;
+                bytes += other.bytes;
+                peak = std::max(peak, live + other.peak);
+                live += other.live;
+            }
+
+            MemoryUsage Get() const
+            {
+                return { allocations, bytes, live, peak };
+            }
+
+            void Reset()
+            {
+                allocations = 0;
+                bytes = 0;
+                peak = live;
+            }
+        }; // struct MemoryCounters
+
+        // For the block table itself, which must not allocate through the operator new
+        // it serves.
+        template <typename T>
+        struct MallocAllocator
+        {
+            using value_type = T;
+
+            MallocAllocator() = default;
+
+            template <typename U>
+            MallocAllocator(const MallocAllocator<U>&)
+            {}
+
+            T* allocate(size_t count)
+            {
+                void* res = std::malloc(count * sizeof(T));
+                if (res == nullptr)
+                {
+                    throw std::bad_alloc();
+                }
+
+                return static_cast<T*>(res);
+            }
+
+            void deallocate(T* ptr, size_t)
+            {
+                std::free(ptr);
+            }
+
+            template <typename U>
+            bool operator==(const MallocAllocator<U>&) const
+            { return true; }
+
+            template <typename U>
+            bool operator!=(const MallocAllocator<U>&) const
+            { return false; }
+        }; // struct MallocAllocator
+
+        struct CountedBlock
+        {
+            size_t size;
+            MemoryCategory category;
+        }; // struct CountedBlock
+
+        // What one thread counted: the blocks it allocated while the report was on and that
+        // are not freed yet, so that freeing one counts toward the category it was allocated
+        // in, and the tallies. Blocks themselves carry nothing extra. A worker also keeps the
+        // blocks it frees but did not allocate, to be matched by the thread that adopts it.
+        struct ThreadMemory
+        {
+            std::unordered_map<void*, CountedBlock, std::hash<void*>, std::equal_to<void*>,
+                               MallocAllocator<std::pair<void* const, CountedBlock>>> blocks;
+            std::vector<void*, MallocAllocator<void*>> foreignFrees;
+
+            MemoryCounters categories[gc_CategoryCount];
+            MemoryCounters total;
+
+            ThreadMemory* nextReleased = nullptr;
+        }; // struct ThreadMemory
+
+        thread_local size_t g_ThreadAllocationCount = 0;
+        std::atomic<bool> g_MemoryReportEnabled{ false };
+
+        // The thread that turned the report on, where all usage ends up.
+        thread_local bool g_OwnsMemoryReport = false;
+
+        thread_local MemoryCategory g_CurrentCategory = MemoryCategory::OTHER;
+
+        // Made on the first counted allocation or free, and never destroyed on the thread
+        // that owns the report: static objects destroyed after it still free memory.
+        thread_local ThreadMemory* g_ThreadMemory = nullptr;
+
+        // Workers that have exited, until a thread adopts them. Locked once per worker,
+        // not per allocation.
+        std::mutex g_ReleasedMutex;
+        ThreadMemory* g_Released = nullptr;
+
+        ThreadMemory& GetThreadMemory()
+        {
+            if (g_ThreadMemory == nullptr)
+            {
+                void* storage = std::malloc(sizeof(ThreadMemory));
+                if (storage == nullptr)
+                {
+                    throw std::bad_alloc();
+                }
+
+                g_ThreadMemory = new (storage) ThreadMemory();
+            }
+
+            return *g_ThreadMemory;
+        }
+
+        void DestroyThreadMemory(ThreadMemory* memory)
+        {
+            memory->~ThreadMemory();
+            std::free(memory);
+        }
+
+        void CountAllocation(void* ptr, size_t size)
+        {
+            ThreadMemory& memory = GetThreadMemory();
+
+            memory.blocks[ptr] = { size, g_CurrentCategory };
+            memory.categories[static_cast<size_t>(g_CurrentCategory)].Allocate(size);
+            memory.total.Allocate(size);
+        }
+
+        bool FreeBlock(ThreadMemory& memory, void* ptr)
+        {
+            auto found = memory.blocks.find(ptr);
+            if (found == memory.blocks.end())
+            {
+                return false;
+            }
+
+            memory.categories[static_cast<size_t>(found->second.category)].Free(found->second.size);
+            memory.total.Free(found->second.size);
+
+            memory.blocks.erase(found);
+            return true;
+        }
+
+        void CountFree(void* ptr)
+        {
+            ThreadMemory& memory = GetThreadMemory();
+
+            // On the owner, a block it does not know was allocated before the report was on.
+            if (!FreeBlock(memory, ptr) && !g_OwnsMemoryReport
+                && g_MemoryReportEnabled.load(std::memory_order_relaxed))
+            {
+                memory.foreignFrees.push_back(ptr);
+            }
+        }
+
+        void* AllocateCounted(size_t size)
+        {
+            g_ThreadAllocationCount++;
+
+            void* res = std::malloc(size == 0 ? 1 : size);
+            if (res != nullptr && g_MemoryReportEnabled.load(std::memory_order_relaxed))
+            {
+                CountAllocation(res, size);
+            }
+
+            return res;
+        }
+
+        void FreeCounted(void* ptr)
+        {
+            if (ptr != nullptr
+                && (g_ThreadMemory != nullptr || g_MemoryReportEnabled.load(std::memory_order_relaxed)))
+            {
+                CountFree(ptr);
+            }
+
+            std::free(ptr);
+        }
+    } // namespace
+
+    size_t GetAllocationCount()
+    {
+        return g_ThreadAllocationCount;
+    }
+
+    void AddAllocationCount(size_t count)
+    {
+        g_ThreadAllocationCount += count;
+    }
+
+    void EnableMemoryReport(bool enable)
+    {
+        g_OwnsMemoryReport = enable;
+        g_MemoryReportEnabled.store(enable, std::memory_order_relaxed);
+    }
+
+    bool IsMemoryReportEnabled()
+    {
+        return g_MemoryReportEnabled.load(std::memory_order_relaxed);
+    }
+
+    void ReleaseThreadMemoryUsage()
+    {
+        if (g_ThreadMemory == nullptr || g_OwnsMemoryReport)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(g_ReleasedMutex);
+
+        g_ThreadMemory->nextReleased = g_Released;
+        g_Released = g_ThreadMemory;
+        g_ThreadMemory = nullptr;
+    }
+
+    void AdoptReleasedMemoryUsage()
+    {
+        ThreadMemory* released = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(g_ReleasedMutex);
+            std::swap(released, g_Released);
+        }
+
+        if (released == nullptr)
+        {
+            return;
+        }
+
+        ThreadMemory& memory = GetThreadMemory();
+
+        MemoryCounters categories[gc_CategoryCount];
+        MemoryCounters total;
+
+        // All the blocks first, as a worker may free what another one allocated.
+        for (ThreadMemory* worker = released; worker != nullptr; worker = worker->nextReleased)
+        {
+            memory.blocks.insert(worker->blocks.begin(), worker->blocks.end());
+
+            for (size_t i = 0; i < gc_CategoryCount; i++)
+            {
+                categories[i].AddConcurrent(worker->categories[i]);
+            }
+
+            total.AddConcurrent(worker->total);
+        }
+
+        for (size_t i = 0; i < gc_CategoryCount; i++)
+        {
+            memory.categories[i].AddSequential(categories[i]);
+        }
+
+        memory.total.AddSequential(total);
+
+        while (released != nullptr)
+        {
+            for (void* ptr : released->foreignFrees)
+            {
+                if (!FreeBlock(memory, ptr) && !g_OwnsMemoryReport)
+                {
+                    memory.foreignFrees.push_back(ptr);
+                }
+            }
+
+            DestroyThreadMemory(std::exchange(released, released->nextReleased));
+        }
+    }
+
+    MemoryUsage GetMemoryUsage(MemoryCategory category)
+    {
+        return GetThreadMemory().categories[static_cast<size_t>(category)].Get();
+    }
+
+    MemoryUsage GetTotalMemoryUsage()
+    {
+        return GetThreadMemory().total.Get();
+    }
+
+    void ResetMemoryUsage()
+    {
+        ThreadMemory& memory = GetThreadMemory();
+
+        for (MemoryCounters& counters : memory.categories)
+        {
+            counters.Reset();
+        }
+
+        memory.total.Reset();
+    }
+
+    void PrintMemoryReport(std::ostream& out)
+    {
+        auto printLine = [&out](const MemoryUsage& usage, const char* name)
+        {
+            out << std::setw(14) << usage.allocations << std::setw(14) << usage.bytes / 1024.0
+                << std::setw(14) << usage.peak / 1024.0 << std::setw(14) << usage.live / 1024.0
+                << "  " << name << std::endl;
+        };
+
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << "=== Memory report ===" << std::endl;
+        out << std::setw(14) << "Allocations" << std::setw(14) << "Total (KiB)" << std::setw(14) << "Peak (KiB)"
+            << std::setw(14) << "Live (KiB)" << "  Category" << std::endl;
+
+        out << std::fixed << std::setprecision(1);
+
+        for (size_t i = 0; i < gc_CategoryCount; i++)
+        {
+            printLine(GetMemoryUsage(static_cast<MemoryCategory>(i)), gc_CategoryNames[i]);
+        }
+
+        printLine(GetTotalMemoryUsage(), "Total");
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    ScopedMemoryCategory::ScopedMemoryCategory(MemoryCategory category)
+        : m_Enclosing(g_CurrentCategory)
+    {
+        g_CurrentCategory = category;
+    }
+
+    ScopedMemoryCategory::~ScopedMemoryCategory()
+    {
+        g_CurrentCategory = m_Enclosing;
+    }
+} // namespace CComp
+
+// The library's operator new[] and nothrow operator new call this one, and its
+// operator delete[] and nothrow operator delete call the plain operator delete.
+void* operator new(std::size_t size)
+{
+    void* res = CComp::AllocateCounted(size);
+    if (res == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return res;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    CComp::FreeCounted(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    CComp::FreeCounted(ptr);
+}
@@ -0,0 +1,80 @@
+#ifndef CCOMP_ALLOCATION_COUNTER_HPP
+#define CCOMP_ALLOCATION_COUNTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace CComp
+{
+    // What the memory an allocation holds is for, as far as --mem-report tells apart.
+    enum class MemoryCategory : uint8_t
+    {
+        OTHER,
+        SOURCE,         // Contents of source files and includes.
+        TOKENS,         // Text of tokens the scanner makes.
+        SCANNER_STATES, // The scanner's stack of files being scanned.
+        MACROS,         // Macro definitions and the buffers expanded from them.
+        AST,            // Nodes the parser creates.
+        CODEGEN,        // Instructions and maps of the code generators.
+
+        COUNT
+    }; // enum class MemoryCategory
+
+    // Allocations made through the global operator new by the calling thread since it
+    // started, and by ParallelFor workers on its behalf. The array and nothrow forms
+    // are counted too.
+    size_t GetAllocationCount();
+
+    // Counts allocations another thread made for the calling one toward its own.
+    void AddAllocationCount(size_t count);
+
+    // Usage by category is only counted while enabled, as it costs every allocation.
+    // Memory allocated before is left out, also when it is freed after.
+    void EnableMemoryReport(bool enable);
+    bool IsMemoryReportEnabled();
+
+    struct MemoryUsage
+    {
+        size_t allocations;
+        size_t bytes;       // Allocated in all, freed or not.
+        size_t live;        // Allocated and not yet freed.
+        size_t peak;        // The most live at any one time.
+    }; // struct MemoryUsage
+
+    // Each thread counts usage by itself. A worker hands its counts over as it exits,
+    // and a thread that waited for its workers takes them over, with their peaks
+    // summed as they ran together. The thread that enabled the report ends up with all.
+    void ReleaseThreadMemoryUsage();
+    void AdoptReleasedMemoryUsage();
+
+    // What the calling thread counted, with what it adopted.
+    MemoryUsage GetMemoryUsage(MemoryCategory category);
+
+    // Over all categories together, which may peak lower than their peaks summed.
+    MemoryUsage GetTotalMemoryUsage();
+
+    // Starts counting allocations and bytes afresh, and peaks from what is live now.
+    void ResetMemoryUsage();
+
+    // The --mem-report table: one line per category, then the total.
+    void PrintMemoryReport(std::ostream& out);
+
+    // Allocations made on this thread while the object lives count toward category,
+    // and return to the enclosing category after. Freeing counts toward the category
+    // the memory was allocated in, whichever thread or scope frees it.
+    class ScopedMemoryCategory
+    {
+    public:
+        explicit ScopedMemoryCategory(MemoryCategory category);
+        ~ScopedMemoryCategory();
+
+        ScopedMemoryCategory(const ScopedMemoryCategory&) = delete;
+        ScopedMemoryCategory& operator=(const ScopedMemoryCategory&) = delete;
+
+    private:
+        MemoryCategory m_Enclosing;
+    }; // class ScopedMemoryCategory
+} // namespace CComp
+
+#endif // CCOMP_ALLOCATION_COUNTER_HPP
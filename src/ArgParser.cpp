@@ -1,26 +1,426 @@
 #include "ArgParser.hpp"
 
+#include <optional>
+
+#include "Asm/Jit.hpp"
+#include "PassManager.hpp"
+#include "Server.hpp"
+
 namespace CComp
 {
     
     ArgParser::ArgParser(int argc, char* argv[])
-        : m_Args(argv, argv + argc)
+        : ArgParser(std::vector<std::string>(argv, argv + argc))
     {}
 
+    ArgParser::ArgParser(std::vector<std::string> args)
+        : m_Args(std::move(args))
+    {
+        ParseArgs();
+    }
+
     ScannerConfiguration ArgParser::GenerateScannerConfiguration() const
     {
         return ScannerConfiguration();
     }
 
-    std::filesystem::path ArgParser::GetSourceFilePath() const
+    std::filesystem::path ArgParser::GetSocketPath() const
+    {
+        if (!m_SocketPath.empty())
+        {
+            return m_SocketPath;
+        }
+
+        return GetDefaultSocketPath();
+    }
+
+    std::filesystem::path ArgParser::GetOutputPath(const std::filesystem::path& source) const
+    {
+        if (!m_OutputPath.empty())
+        {
+            return m_OutputPath;
+        }
+
+        switch (m_OutputKind)
+        {
+        case OutputKind::ASSEMBLY:
+            if (m_SourceFilePaths.size() > 1)
+            {
+                return source.filename().replace_extension(".s");
+            }
+
+            return std::filesystem::path();
+        case OutputKind::OBJECT:
+            return source.filename().replace_extension(".o");
+        case OutputKind::EXECUTABLE:
+            return "a.out";
+        default:
+            return std::filesystem::path();
+        }
+    }
+
+    void ArgParser::ParseArgs()
     {
-        if (m_Args.size() > 0)
+        // Set by the options themselves; the optimization level decides the rest.
+        std::optional<Backend> backend;
+        std::optional<bool> foldConstants;
+        std::optional<bool> promoteLocals;
+        std::optional<bool> numberValues;
+        std::optional<bool> peephole;
+
+        for (size_t i = 0; i < m_Args.size(); i++)
+        {
+            const std::string& arg = m_Args[i];
+            std::string value;
+
+            if (arg.empty() || arg[0] != '-')
+            {
+                m_SourceFilePaths.push_back(arg);
+            }
+            else if (arg == "-O0" || arg == "-O1" || arg == "-O2")
+            {
+                m_OptimizationLevel = arg[2] - '0';
+            }
+            else if (arg == "-O")
+            {
+                m_OptimizationLevel = 1;
+            }
+            else if (MatchOption(arg, "-O", value))
+            {
+                m_Errors.push_back("unknown optimization level '" + arg + "'");
+            }
+            else if (MatchOption(arg, "-print-after=", value))
+            {
+                if (value != "all" && !IsPassName(value))
+                {
+                    m_Errors.push_back("unknown pass '" + value + "' for '-print-after='");
+                }
+
+                m_PrintAfter.push_back(value);
+            }
+            else if (arg == "-time-passes")
+            {
+                m_TimePasses = true;
+            }
+            else if (arg == "-ftime-report" || arg == "-ftime-report=text")
+            {
+                m_TimeReportFormat = TimeReportFormat::TEXT;
+            }
+            else if (arg == "-ftime-report=json")
+            {
+                m_TimeReportFormat = TimeReportFormat::JSON;
+            }
+            else if (MatchOption(arg, "-ftime-report=", value))
+            {
+                m_Errors.push_back("unknown time report format '" + value + "'");
+            }
+            else if (MatchOption(arg, "--trace=", value))
+            {
+                if (value.empty())
+                {
+                    m_Errors.push_back("missing file name after '--trace='");
+                }
+
+                m_TracePath = value;
+            }
+            else if (MatchOption(arg, "-ferror-limit=", value))
+            {
+                ParseSize("-ferror-limit=", value, m_ErrorLimit);
+            }
+            else if (MatchOption(arg, "-fdiagnostics-format=", value))
+            {
+                if (value == "text")
+                {
+                    m_DiagnosticsFormat = DiagnosticsFormat::TEXT;
+                }
+                else if (value == "json")
+                {
+                    m_DiagnosticsFormat = DiagnosticsFormat::JSON;
+                }
+                else
+                {
+                    m_Errors.push_back("unknown diagnostics format '" + value + "'");
+                }
+            }
+            else if (MatchOption(arg, "--backend=", value))
+            {
+                if (value == "ast")
+                {
+                    backend = Backend::AST;
+                }
+                else if (value == "ir")
+                {
+                    backend = Backend::IR;
+                }
+                else
+                {
+                    m_Errors.push_back("unknown backend '" + value + "'");
+                }
+            }
+            else if (arg == "-o")
+            {
+                if (i + 1 == m_Args.size())
+                {
+                    m_Errors.push_back("missing file name after '-o'");
+                }
+                else
+                {
+                    m_OutputPath = m_Args[++i];
+                }
+            }
+            else if (arg == "--server" || MatchOption(arg, "--server=", value))
+            {
+                m_Serve = true;
+                m_SocketPath = value;
+            }
+            else if (arg == "--client" || MatchOption(arg, "--client=", value))
+            {
+                m_Forward = true;
+                m_SocketPath = value;
+            }
+            else if (arg == "-c")
+            {
+                m_OutputKind = OutputKind::OBJECT;
+            }
+            else if (arg == "-j")
+            {
+                if (i + 1 == m_Args.size())
+                {
+                    m_Errors.push_back("missing job count after '-j'");
+                }
+                else
+                {
+                    ParseSize("-j", m_Args[++i], m_Jobs);
+                }
+            }
+            else if (MatchOption(arg, "-j", value))
+            {
+                ParseSize("-j", value, m_Jobs);
+            }
+            else if (MatchOption(arg, "--emit=", value))
+            {
+                if (value == "asm")
+                {
+                    m_OutputKind = OutputKind::ASSEMBLY;
+                }
+                else if (value == "obj")
+                {
+                    m_OutputKind = OutputKind::OBJECT;
+                }
+                else if (value == "exe")
+                {
+                    m_OutputKind = OutputKind::EXECUTABLE;
+                }
+                else
+                {
+                    m_Errors.push_back("unknown output kind '" + value + "'");
+                }
+            }
+            else if (arg == "--run")
+            {
+                m_Run = true;
+            }
+            else if (arg == "--interpret" || arg == "--interpret=bytecode")
+            {
+                m_Engine = Engine::BYTECODE;
+            }
+            else if (arg == "--interpret=tree")
+            {
+                m_Engine = Engine::TREE;
+            }
+            else if (MatchOption(arg, "--interpret=", value))
+            {
+                m_Errors.push_back("unknown interpreter '" + value + "'");
+            }
+            else if (MatchOption(arg, "--repeat=", value))
+            {
+                if (ParseSize("--repeat=", value, m_RepeatCount) && m_RepeatCount == 0)
+                {
+                    m_Errors.push_back("'--repeat=' needs at least one run");
+                }
+            }
+            else if (MatchOption(arg, "--target=", value))
+            {
+                m_TargetGiven = true;
+
+                if (value == "i386")
+                {
+                    m_Target = Asm::Target::I386;
+                }
+                else if (value == "x86-64" || value == "x86_64")
+                {
+                    m_Target = Asm::Target::X86_64;
+                }
+                else
+                {
+                    m_Errors.push_back("unknown target '" + value + "'");
+                }
+            }
+            else if (arg == "-mred-zone" || arg == "-mno-red-zone")
+            {
+                m_RedZone = arg == "-mred-zone";
+            }
+            else if (arg == "--emit-ir")
+            {
+                m_EmitIR = true;
+            }
+            else if (arg == "--emit-bytecode")
+            {
+                m_EmitBytecode = true;
+            }
+            else if (arg == "-fconstant-folding" || arg == "-fno-constant-folding")
+            {
+                foldConstants = arg == "-fconstant-folding";
+            }
+            else if (arg == "-fmem2reg" || arg == "-fno-mem2reg")
+            {
+                promoteLocals = arg == "-fmem2reg";
+            }
+            else if (arg == "-fvalue-numbering" || arg == "-fno-value-numbering")
+            {
+                numberValues = arg == "-fvalue-numbering";
+            }
+            else if (MatchOption(arg, "-fcodegen-threads=", value))
+            {
+                ParseSize("-fcodegen-threads=", value, m_CodegenThreads);
+            }
+            else if (arg == "-fpeephole" || arg == "-fno-peephole")
+            {
+                peephole = arg == "-fpeephole";
+            }
+            else if (MatchOption(arg, "-fpeephole-window=", value))
+            {
+                ParseSize("-fpeephole-window=", value, m_PeepholeWindow);
+            }
+            else if (arg == "--stats")
+            {
+                m_PrintStatistics = true;
+            }
+            else if (arg == "--mem-report")
+            {
+                m_ReportMemory = true;
+            }
+            else
+            {
+                m_Errors.push_back("unknown option '" + arg + "'");
+            }
+        }
+
+        if (m_Serve && m_Forward)
         {
-            return m_Args[0];
+            m_Errors.push_back("'--server' cannot be combined with '--client'");
         }
-        else
+
+        if (m_Serve && !m_SourceFilePaths.empty())
         {
-            return "";
+            m_Errors.push_back("'--server' compiles what clients send, not source files of its own");
         }
+
+        if (m_Forward)
+        {
+            // The program would run inside the server, where a crash takes the server down.
+            if (m_Run)
+            {
+                m_Errors.push_back("'--run' cannot be combined with '--client'");
+            }
+
+            std::string value;
+
+            for (const std::string& arg : m_Args)
+            {
+                if (arg != "--client" && !MatchOption(arg, "--client=", value))
+                {
+                    m_ForwardedArgs.push_back(arg);
+                }
+            }
+        }
+
+        if (m_Run && m_Engine != Engine::NATIVE)
+        {
+            m_Errors.push_back("'--run' cannot be combined with '--interpret'");
+        }
+
+        if (m_Run)
+        {
+            // Code for another target cannot run in this process, so --run defaults to the host's.
+            Asm::Target host;
+            if (!Asm::GetHostTarget(host))
+            {
+                m_Errors.push_back("'--run' is not supported on this host");
+            }
+            else if (m_TargetGiven && m_Target != host)
+            {
+                m_Errors.push_back("'--run' needs the target of the host");
+            }
+            else
+            {
+                m_Target = host;
+            }
+
+            if (m_EmitIR)
+            {
+                m_Errors.push_back("'--run' cannot be combined with '--emit-ir'");
+            }
+        }
+
+        if (m_SourceFilePaths.size() > 1)
+        {
+            // Each of these writes or runs a single program.
+            if (!m_OutputPath.empty())
+            {
+                m_Errors.push_back("'-o' cannot be used with more than one source file");
+            }
+
+            if (m_OutputKind == OutputKind::EXECUTABLE)
+            {
+                m_Errors.push_back("'--emit=exe' needs exactly one source file");
+            }
+
+            if (m_Run || m_Engine != Engine::NATIVE)
+            {
+                m_Errors.push_back("running a program needs exactly one source file");
+            }
+
+            if (m_EmitIR || m_EmitBytecode)
+            {
+                m_Errors.push_back("'--emit-ir' and '--emit-bytecode' need exactly one source file");
+            }
+        }
+
+        if (backend == Backend::IR && m_Target != Asm::Target::I386)
+        {
+            m_Errors.push_back("the IR backend only supports the i386 target");
+        }
+
+        // -O2 prefers the IR backend, but falls back to the AST one on targets without it.
+        m_Backend = backend.value_or(m_OptimizationLevel >= 2 && m_Target == Asm::Target::I386 ? Backend::IR : Backend::AST);
+        m_FoldConstants = foldConstants.value_or(m_OptimizationLevel >= 1);
+        m_PromoteLocals = promoteLocals.value_or(m_OptimizationLevel >= 1);
+        m_NumberValues = numberValues.value_or(m_OptimizationLevel >= 1);
+        m_Peephole = peephole.value_or(m_OptimizationLevel >= 1);
+    }
+
+    bool ArgParser::MatchOption(const std::string& arg, const std::string& option, std::string& value) const
+    {
+        if (arg.compare(0, option.size(), option) != 0)
+        {
+            return false;
+        }
+
+        value = arg.substr(option.size());
+        return true;
+    }
+
+    bool ArgParser::ParseSize(const std::string& option, const std::string& value, size_t& res)
+    {
+        if (value.empty() || value.size() > 18
+            || value.find_first_not_of("0123456789") != std::string::npos)
+        {
+            m_Errors.push_back("invalid value '" + value + "' for '" + option + "'");
+            return false;
+        }
+
+        res = std::stoul(value);
+        return true;
     }
 }
@@ -6,20 +6,199 @@
 #include <filesystem>
 
 #include "ScannerConfiguration.hpp"
+#include "Reporter.hpp"
+#include "TimeReport.hpp"
+#include "Asm/Peephole.hpp"
 
 namespace CComp
 {
+    enum class Backend
+    {
+        AST, // CodeGenVisitor straight from the AST.
+        IR,  // Lowered to IR, then X86Backend.
+    }; // enum class Backend
+
+    enum class OutputKind
+    {
+        ASSEMBLY,   // AT&T text.
+        OBJECT,     // ELF relocatable object.
+        EXECUTABLE, // Static ELF executable, for programs without a C library.
+    }; // enum class OutputKind
+
+    enum class Engine
+    {
+        NATIVE,   // Machine code, written out or run in-process with --run.
+        BYTECODE, // BytecodeGenVisitor, then Bytecode::Interpreter.
+        TREE,     // EvalVisitor walking the AST.
+    }; // enum class Engine
+
     class ArgParser
     {
     public:
         ArgParser(int argc, char* argv[]);
+        explicit ArgParser(std::vector<std::string> args);
 
         ScannerConfiguration GenerateScannerConfiguration() const;
 
-        std::filesystem::path GetSourceFilePath() const;
+        // Each is compiled on its own, in parallel with up to GetJobCount() others.
+        const std::vector<std::filesystem::path>& GetSourceFilePaths() const
+        { return m_SourceFilePaths; }
+
+        // Whether to stay resident and compile what clients send, see Server.hpp.
+        bool ShouldServe() const
+        { return m_Serve; }
+
+        // Whether to have a compile server compile with GetForwardedArgs() instead.
+        bool ShouldForwardToServer() const
+        { return m_Forward; }
+
+        // The socket --server listens on and --client connects to.
+        std::filesystem::path GetSocketPath() const;
+
+        // The command line without --client, for the server to parse again.
+        const std::vector<std::string>& GetForwardedArgs() const
+        { return m_ForwardedArgs; }
+
+        // How many source files are compiled at once; 0 means one per hardware thread.
+        size_t GetJobCount() const
+        { return m_Jobs; }
+
+        // -O0 runs no optimizations, -O1 (the default) folds constants and runs the peephole
+        // pass, and -O2 adds the IR backend with mem2reg and value numbering where the target
+        // has it. Options such as -fno-peephole or --backend= override the level.
+        int GetOptimizationLevel() const
+        { return m_OptimizationLevel; }
+
+        // Passes to dump the program after, to the standard error; "all" means every one.
+        const std::vector<std::string>& GetPrintAfter() const
+        { return m_PrintAfter; }
+
+        // Whether to report each pass's wall time and allocation count.
+        bool ShouldTimePasses() const
+        { return m_TimePasses; }
+
+        // -ftime-report: time spent reading, scanning, parsing and generating code, as a
+        // table or as JSON for tools.
+        TimeReportFormat GetTimeReportFormat() const
+        { return m_TimeReportFormat; }
+
+        // Where --trace writes Chrome trace events; empty when not tracing.
+        const std::filesystem::path& GetTracePath() const
+        { return m_TracePath; }
+
+        OutputKind GetOutputKind() const
+        { return m_OutputKind; }
+
+        // Where the output for source goes. With a single source, assembly goes to the
+        // standard output unless -o names a file; with several, each gets a file of its own.
+        std::filesystem::path GetOutputPath(const std::filesystem::path& source) const;
+
+        // Whether to call main in this process instead of writing any output.
+        bool ShouldRun() const
+        { return m_Run; }
+
+        // Interpreted engines always run the program, like --run.
+        Engine GetEngine() const
+        { return m_Engine; }
+
+        // How many times --run and --interpret call main, to time short programs.
+        size_t GetRepeatCount() const
+        { return m_RepeatCount; }
+
+        size_t GetErrorLimit() const
+        { return m_ErrorLimit; }
+
+        DiagnosticsFormat GetDiagnosticsFormat() const
+        { return m_DiagnosticsFormat; }
+
+        Backend GetBackend() const
+        { return m_Backend; }
+
+        Asm::Target GetTarget() const
+        { return m_Target; }
+
+        // Whether x86-64 leaf functions may keep their locals below %rsp.
+        bool ShouldUseRedZone() const
+        { return m_RedZone; }
+
+        bool ShouldEmitIR() const
+        { return m_EmitIR; }
+
+        bool ShouldEmitBytecode() const
+        { return m_EmitBytecode; }
+
+        bool ShouldFoldConstants() const
+        { return m_FoldConstants; }
+
+        bool ShouldPromoteLocals() const
+        { return m_PromoteLocals; }
+
+        bool ShouldNumberValues() const
+        { return m_NumberValues; }
+
+        // How many functions are generated at once; 0 means one per hardware thread.
+        size_t GetCodegenThreadCount() const
+        { return m_CodegenThreads; }
+
+        bool ShouldRunPeephole() const
+        { return m_Peephole; }
+
+        // How many instructions a peephole pattern may look ahead.
+        size_t GetPeepholeWindow() const
+        { return m_PeepholeWindow; }
+
+        bool ShouldPrintStatistics() const
+        { return m_PrintStatistics; }
+
+        // Whether to report heap use, allocations and peak, by what the memory held.
+        bool ShouldReportMemory() const
+        { return m_ReportMemory; }
+
+        // Problems with the command line itself, e.g. unknown options.
+        const std::vector<std::string>& GetErrors() const
+        { return m_Errors; }
         
     private:
         std::vector<std::string> m_Args;
+        std::vector<std::string> m_Errors;
+
+        std::vector<std::filesystem::path> m_SourceFilePaths;
+        size_t m_Jobs = 1;
+        bool m_Serve = false;
+        bool m_Forward = false;
+        std::filesystem::path m_SocketPath;
+        std::vector<std::string> m_ForwardedArgs;
+        int m_OptimizationLevel = 1;
+        std::vector<std::string> m_PrintAfter;
+        bool m_TimePasses = false;
+        TimeReportFormat m_TimeReportFormat = TimeReportFormat::NONE;
+        std::filesystem::path m_TracePath;
+        std::filesystem::path m_OutputPath;
+        OutputKind m_OutputKind = OutputKind::ASSEMBLY;
+        bool m_Run = false;
+        Engine m_Engine = Engine::NATIVE;
+        size_t m_RepeatCount = 1;
+        size_t m_ErrorLimit = 20;
+        DiagnosticsFormat m_DiagnosticsFormat = DiagnosticsFormat::TEXT;
+        Backend m_Backend = Backend::AST;
+        Asm::Target m_Target = Asm::Target::I386;
+        bool m_TargetGiven = false;
+        bool m_RedZone = true;
+        bool m_EmitIR = false;
+        bool m_EmitBytecode = false;
+        bool m_FoldConstants = true;
+        bool m_PromoteLocals = true;
+        bool m_NumberValues = true;
+        size_t m_CodegenThreads = 1;
+        bool m_Peephole = true;
+        size_t m_PeepholeWindow = Asm::gc_DefaultPeepholeWindow;
+        bool m_PrintStatistics = false;
+        bool m_ReportMemory = false;
+
+        void ParseArgs();
+
+        bool MatchOption(const std::string& arg, const std::string& option, std::string& value) const;
+        bool ParseSize(const std::string& option, const std::string& value, size_t& res);
     }; // class ArgParser
 
 } // namespace CComp
@@ -0,0 +1,282 @@
+#include "Asm.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        Operand Reg(Register reg)
+        {
+            Operand res;
+            res.kind = OperandKind::REG;
+            res.reg = reg;
+            return res;
+        }
+
+        Operand ByteReg(Register reg)
+        {
+            Operand res = Reg(reg);
+            res.size = 1;
+            return res;
+        }
+
+        Operand QuadReg(Register reg)
+        {
+            Operand res = Reg(reg);
+            res.size = 8;
+            return res;
+        }
+
+        Operand Imm(int32_t value)
+        {
+            Operand res;
+            res.kind = OperandKind::IMM;
+            res.value = value;
+            return res;
+        }
+
+        Operand Mem(Register base, int32_t disp)
+        {
+            Operand res;
+            res.kind = OperandKind::MEM;
+            res.reg = base;
+            res.value = disp;
+            return res;
+        }
+
+        Operand Mem(Register base, Register index, uint8_t scale, int32_t disp)
+        {
+            Operand res = Mem(base, disp);
+            res.index = index;
+            res.scale = scale;
+            return res;
+        }
+
+        namespace
+        {
+            void Read(Effects& effects, const Operand& operand)
+            {
+                if (operand.kind == OperandKind::REG)
+                {
+                    effects.reads |= MaskOf(operand.reg);
+                }
+                else if (operand.kind == OperandKind::MEM)
+                {
+                    effects.reads |= MaskOf(operand.reg) | MaskOf(operand.index);
+                    effects.readsMemory = true;
+                }
+            }
+
+            void Write(Effects& effects, const Operand& operand)
+            {
+                if (operand.kind == OperandKind::REG)
+                {
+                    // Writing a byte register keeps the rest of the register.
+                    if (operand.size < 4)
+                    {
+                        effects.reads |= MaskOf(operand.reg);
+                    }
+
+                    effects.writes |= MaskOf(operand.reg);
+                }
+                else if (operand.kind == OperandKind::MEM)
+                {
+                    effects.reads |= MaskOf(operand.reg) | MaskOf(operand.index);
+                    effects.writesMemory = true;
+                }
+            }
+        } // namespace
+
+        Effects GetEffects(const Instruction& inst)
+        {
+            Effects effects;
+
+            const Operand& first = inst.operands[0];
+            const Operand& second = inst.operands[1];
+
+            switch (inst.op)
+            {
+            case Opcode::LABEL:
+            case Opcode::GLOBL:
+            case Opcode::COMMENT:
+            case Opcode::BLANK:
+            case Opcode::JMP:
+            case Opcode::JCC:
+                break;
+
+            case Opcode::MOV:
+            case Opcode::MOVZB:
+                Read(effects, first);
+                Write(effects, second);
+                break;
+
+            case Opcode::LEA:
+                effects.reads |= MaskOf(first.reg) | MaskOf(first.index);
+                Write(effects, second);
+                break;
+
+            case Opcode::IMUL:
+                if (inst.GetOperandCount() == 1)
+                {
+                    Read(effects, first);
+                    effects.reads |= MaskOf(Register::EAX);
+                    effects.writes |= MaskOf(Register::EAX) | MaskOf(Register::EDX);
+                    break;
+                }
+                // fallthrough
+            case Opcode::ADD:
+            case Opcode::SUB:
+            case Opcode::AND:
+            case Opcode::OR:
+            case Opcode::XOR:
+            case Opcode::SAL:
+            case Opcode::SAR:
+            case Opcode::SHR:
+                Read(effects, first);
+                Read(effects, second);
+                Write(effects, second);
+                break;
+
+            case Opcode::CMP:
+            case Opcode::TEST:
+                Read(effects, first);
+                Read(effects, second);
+                break;
+
+            case Opcode::NEG:
+            case Opcode::NOT:
+            case Opcode::INC:
+            case Opcode::DEC:
+                Read(effects, first);
+                Write(effects, first);
+                break;
+
+            case Opcode::SETCC:
+            case Opcode::POP:
+                Write(effects, first);
+                break;
+
+            case Opcode::IDIV:
+                Read(effects, first);
+                effects.reads |= MaskOf(Register::EAX) | MaskOf(Register::EDX);
+                effects.writes |= MaskOf(Register::EAX) | MaskOf(Register::EDX);
+                break;
+
+            case Opcode::CDQ:
+                effects.reads |= MaskOf(Register::EAX);
+                effects.writes |= MaskOf(Register::EDX);
+                break;
+
+            case Opcode::PUSH:
+                Read(effects, first);
+                break;
+
+            case Opcode::CALL:
+                // Caller-saved on either target; %esi and %edi are only so on x86-64.
+                effects.reads |= MaskOf(Register::ESP);
+                effects.writes |= MaskOf(Register::EAX) | MaskOf(Register::ECX) | MaskOf(Register::EDX)
+                    | MaskOf(Register::ESI) | MaskOf(Register::EDI) | MaskOf(Register::R8) | MaskOf(Register::R9)
+                    | MaskOf(Register::R10) | MaskOf(Register::R11);
+                effects.readsMemory = true;
+                effects.writesMemory = true;
+                break;
+
+            case Opcode::RET:
+                effects.reads |= MaskOf(Register::EAX);
+                break;
+
+            case Opcode::INT:
+                effects.reads |= MaskOf(Register::EAX) | MaskOf(Register::EBX)
+                    | MaskOf(Register::ECX) | MaskOf(Register::EDX);
+                effects.writes |= MaskOf(Register::EAX);
+                effects.readsMemory = true;
+                effects.writesMemory = true;
+                break;
+
+            case Opcode::SYSCALL:
+                effects.reads |= MaskOf(Register::EAX) | MaskOf(Register::EDI) | MaskOf(Register::ESI)
+                    | MaskOf(Register::EDX) | MaskOf(Register::R10) | MaskOf(Register::R8) | MaskOf(Register::R9);
+                effects.writes |= MaskOf(Register::EAX) | MaskOf(Register::ECX) | MaskOf(Register::R11);
+                effects.readsMemory = true;
+                effects.writesMemory = true;
+                break;
+            }
+
+            // The stack pointer moves and the stack top is accessed.
+            if (inst.op == Opcode::PUSH || inst.op == Opcode::POP || inst.op == Opcode::CALL || inst.op == Opcode::RET)
+            {
+                effects.reads |= MaskOf(Register::ESP);
+                effects.writes |= MaskOf(Register::ESP);
+                effects.readsMemory |= inst.op != Opcode::PUSH;
+                effects.writesMemory |= inst.op == Opcode::PUSH || inst.op == Opcode::CALL;
+            }
+
+            return effects;
+        }
+
+        bool IsPseudo(Opcode op)
+        {
+            return op == Opcode::LABEL || op == Opcode::GLOBL || op == Opcode::COMMENT || op == Opcode::BLANK;
+        }
+
+        bool IsUnconditionalJump(Opcode op)
+        {
+            return op == Opcode::JMP || op == Opcode::RET;
+        }
+
+        Cond InvertCond(Cond cond)
+        {
+            switch (cond)
+            {
+            case Cond::E:  return Cond::NE;
+            case Cond::NE: return Cond::E;
+            case Cond::L:  return Cond::GE;
+            case Cond::LE: return Cond::G;
+            case Cond::G:  return Cond::LE;
+            case Cond::GE: return Cond::L;
+            }
+
+            return cond;
+        }
+
+        const char* RegisterToString(Register reg, uint8_t size)
+        {
+            static const char* const names[] = {
+                "%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
+                "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d" };
+            static const char* const quadNames[] = {
+                "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+                "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15" };
+            // Past %bl only with a REX prefix, so only on x86-64.
+            static const char* const byteNames[] = {
+                "%al", "%cl", "%dl", "%bl", "%spl", "%bpl", "%sil", "%dil",
+                "%r8b", "%r9b", "%r10b", "%r11b", "%r12b", "%r13b", "%r14b", "%r15b" };
+
+            if (reg == Register::NONE)
+            {
+                return "<none>";
+            }
+
+            if (size == 1)
+            {
+                return byteNames[static_cast<int>(reg)];
+            }
+
+            return size == 8 ? quadNames[static_cast<int>(reg)] : names[static_cast<int>(reg)];
+        }
+
+        const char* CondToString(Cond cond)
+        {
+            switch (cond)
+            {
+            case Cond::E:  return "e";
+            case Cond::NE: return "ne";
+            case Cond::L:  return "l";
+            case Cond::LE: return "le";
+            case Cond::G:  return "g";
+            case Cond::GE: return "ge";
+            }
+
+            return "<unknown>";
+        }
+    } // namespace Asm
+} // namespace CComp
@@ -0,0 +1,194 @@
+#ifndef CCOMP_ASM_HPP
+#define CCOMP_ASM_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CComp
+{
+    namespace Asm
+    {
+        // Numbered as in the x86 instruction encoding.
+        enum class Register : uint8_t
+        {
+            EAX,
+            ECX,
+            EDX,
+            EBX,
+            ESP,
+            EBP,
+            ESI,
+            EDI,
+            R8,         // R8 to R15 exist only on x86-64.
+            R9,
+            R10,
+            R11,
+            R12,
+            R13,
+            R14,
+            R15,
+            NONE,
+        }; // enum class Register
+
+        constexpr size_t gc_RegisterCount = 16;
+
+        enum class Target : uint8_t
+        {
+            I386,       // 32-bit code, exits through int $0x80.
+            X86_64,     // 64-bit System V code, exits through syscall.
+        }; // enum class Target
+
+        // Bytes moved by push, pop, call and ret.
+        constexpr uint8_t GetWordSize(Target target)
+        {
+            return target == Target::X86_64 ? 8 : 4;
+        }
+
+        enum class Cond : uint8_t
+        {
+            E,
+            NE,
+            L,
+            LE,
+            G,
+            GE,
+        }; // enum class Cond
+
+        enum class Opcode : uint8_t
+        {
+            LABEL,      // label:
+            GLOBL,      // .globl label
+            COMMENT,    // # label
+            BLANK,      // Empty line.
+
+            MOV,
+            MOVZB,      // Byte register to 32-bit register.
+            LEA,        // Address of a memory operand; memory is not accessed.
+            ADD,
+            SUB,
+            IMUL,       // Two operands, or one operand multiplying %eax into %edx:%eax.
+            IDIV,
+            CDQ,
+            AND,
+            OR,
+            XOR,
+            SAL,
+            SAR,
+            SHR,
+            NEG,
+            NOT,
+            INC,
+            DEC,
+            CMP,
+            TEST,
+            SETCC,
+            PUSH,
+            POP,
+
+            JMP,        // To label.
+            JCC,        // To label if cond.
+            CALL,       // label.
+            RET,
+            INT,
+            SYSCALL,
+        }; // enum class Opcode
+
+        enum class OperandKind : uint8_t
+        {
+            NONE,
+            REG,        // reg, size bytes wide.
+            IMM,        // $value.
+            MEM,        // value(reg, index, scale), size bytes wide.
+        }; // enum class OperandKind
+
+        struct Operand
+        {
+            OperandKind kind = OperandKind::NONE;
+            Register reg = Register::NONE;
+            uint8_t size = 4;
+            int32_t value = 0;
+            Register index = Register::NONE;
+            uint8_t scale = 1;
+
+            bool operator==(const Operand& other) const
+            {
+                return kind == other.kind && reg == other.reg && size == other.size && value == other.value
+                    && index == other.index && scale == other.scale;
+            }
+
+            bool operator!=(const Operand& other) const
+            { return !(*this == other); }
+        }; // struct Operand
+
+        Operand Reg(Register reg);
+        Operand ByteReg(Register reg);
+        Operand QuadReg(Register reg);
+        Operand Imm(int32_t value);
+        Operand Mem(Register base, int32_t disp);
+        Operand Mem(Register base, Register index, uint8_t scale, int32_t disp = 0);
+
+        // Operands are in AT&T order: source first, destination last.
+        struct Instruction
+        {
+            Opcode op;
+            Cond cond = Cond::E;
+            Operand operands[2];
+            std::string label;
+
+            Instruction(Opcode op, Operand a = Operand(), Operand b = Operand())
+                : op(op), operands{ a, b }
+            {}
+
+            Instruction(Opcode op, const std::string& label)
+                : op(op), label(label)
+            {}
+
+            Instruction(Opcode op, Cond cond, const std::string& label)
+                : op(op), cond(cond), label(label)
+            {}
+
+            size_t GetOperandCount() const
+            {
+                return operands[0].kind == OperandKind::NONE ? 0 : operands[1].kind == OperandKind::NONE ? 1 : 2;
+            }
+        }; // struct Instruction
+
+        using RegisterMask = uint32_t;
+
+        constexpr RegisterMask MaskOf(Register reg)
+        {
+            return reg == Register::NONE ? 0 : RegisterMask(1) << static_cast<int>(reg);
+        }
+
+        // Registers a function preserves for its caller, besides %ebp and %esp.
+        constexpr RegisterMask gc_CalleeSaved = MaskOf(Register::EBX) | MaskOf(Register::ESI) | MaskOf(Register::EDI);
+        constexpr RegisterMask gc_CalleeSaved64 = MaskOf(Register::EBX) | MaskOf(Register::R12) | MaskOf(Register::R13)
+            | MaskOf(Register::R14) | MaskOf(Register::R15);
+
+        // What an instruction reads and writes, including implicit registers.
+        // Memory accesses are listed as operands; push and pop access the stack top.
+        struct Effects
+        {
+            RegisterMask reads = 0;
+            RegisterMask writes = 0;
+            bool readsMemory = false;
+            bool writesMemory = false;
+        }; // struct Effects
+
+        Effects GetEffects(const Instruction& inst);
+
+        // Labels, comments and blank lines emit no machine code.
+        bool IsPseudo(Opcode op);
+
+        // Instructions after which the next one is not executed in sequence.
+        bool IsUnconditionalJump(Opcode op);
+
+        Cond InvertCond(Cond cond);
+
+        const char* RegisterToString(Register reg, uint8_t size = 4);
+        const char* CondToString(Cond cond);
+    } // namespace Asm
+} // namespace CComp
+
+#endif // CCOMP_ASM_HPP
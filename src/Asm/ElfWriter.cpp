@@ -0,0 +1,381 @@
+#include "ElfWriter.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace CComp
+{
+    namespace Asm
+    {
+        namespace
+        {
+            // Values from the System V gABI and the i386 and x86-64 psABIs.
+            constexpr uint16_t gc_EtRel = 1;
+            constexpr uint16_t gc_EtExec = 2;
+            constexpr uint16_t gc_Em386 = 3;
+            constexpr uint16_t gc_EmX86_64 = 62;
+
+            constexpr uint32_t gc_ShtProgbits = 1;
+            constexpr uint32_t gc_ShtSymtab = 2;
+            constexpr uint32_t gc_ShtStrtab = 3;
+            constexpr uint32_t gc_ShtRela = 4;
+            constexpr uint32_t gc_ShtRel = 9;
+
+            constexpr uint64_t gc_ShfAlloc = 0x2;
+            constexpr uint64_t gc_ShfExecInstr = 0x4;
+            constexpr uint64_t gc_ShfInfoLink = 0x40;
+
+            constexpr uint8_t gc_StbLocal = 0;
+            constexpr uint8_t gc_StbGlobal = 1;
+
+            constexpr uint32_t gc_R386Pc32 = 2;
+            constexpr uint32_t gc_RX86_64Plt32 = 4;
+
+            constexpr uint32_t gc_PtLoad = 1;
+            constexpr uint32_t gc_PtGnuStack = 0x6474E551;
+            constexpr uint32_t gc_PfExecute = 0x1;
+            constexpr uint32_t gc_PfWrite = 0x2;
+            constexpr uint32_t gc_PfRead = 0x4;
+
+            constexpr uint64_t gc_BaseAddress32 = 0x08048000;
+            constexpr uint64_t gc_BaseAddress64 = 0x400000;
+            constexpr uint64_t gc_PageSize = 0x1000;
+
+            // The displacement is measured from the end of the 4-byte field.
+            constexpr int32_t gc_RelocationAddend = -4;
+
+            // Little-endian fields, with addresses and offsets as wide as the ELF class.
+            class ElfBuffer
+            {
+            public:
+                explicit ElfBuffer(Target target)
+                    : m_Is64(target == Target::X86_64)
+                {}
+
+                bool Is64() const
+                { return m_Is64; }
+
+                size_t GetSize() const
+                { return m_Data.size(); }
+
+                const std::vector<uint8_t>& GetData() const
+                { return m_Data; }
+
+                void U8(uint8_t value)
+                { m_Data.push_back(value); }
+
+                void U16(uint16_t value)
+                { Put(value, 2); }
+
+                void U32(uint32_t value)
+                { Put(value, 4); }
+
+                void U64(uint64_t value)
+                { Put(value, 8); }
+
+                void Word(uint64_t value)
+                { Put(value, m_Is64 ? 8 : 4); }
+
+                void Bytes(const std::vector<uint8_t>& bytes)
+                { m_Data.insert(m_Data.end(), bytes.begin(), bytes.end()); }
+
+                void Align(size_t alignment)
+                { m_Data.resize((m_Data.size() + alignment - 1) / alignment * alignment, 0); }
+
+            private:
+                bool m_Is64;
+                std::vector<uint8_t> m_Data;
+
+                void Put(uint64_t value, int size)
+                {
+                    for (int i = 0; i < size; i++)
+                    {
+                        m_Data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+                    }
+                }
+            }; // class ElfBuffer
+
+            class StringTable
+            {
+            public:
+                StringTable()
+                    : m_Data(1, 0)
+                {}
+
+                uint32_t Add(const std::string& str)
+                {
+                    uint32_t offset = static_cast<uint32_t>(m_Data.size());
+                    m_Data.insert(m_Data.end(), str.begin(), str.end());
+                    m_Data.push_back(0);
+                    return offset;
+                }
+
+                const std::vector<uint8_t>& GetData() const
+                { return m_Data; }
+
+            private:
+                std::vector<uint8_t> m_Data;
+            }; // class StringTable
+
+            struct Layout
+            {
+                uint16_t ehSize;
+                uint16_t phEntSize;
+                uint16_t shEntSize;
+                uint16_t symEntSize;
+                uint16_t relEntSize;
+            }; // struct Layout
+
+            Layout GetLayout(const ElfBuffer& buf)
+            {
+                return buf.Is64() ? Layout{ 64, 56, 64, 24, 24 } : Layout{ 52, 32, 40, 16, 8 };
+            }
+
+            void WriteHeader(ElfBuffer& buf, Target target, uint16_t type, uint64_t entry, uint64_t phOffset,
+                             uint16_t phCount, uint64_t shOffset, uint16_t shCount, uint16_t shStrIndex)
+            {
+                Layout layout = GetLayout(buf);
+
+                const uint8_t ident[] = { 0x7F, 'E', 'L', 'F', static_cast<uint8_t>(buf.Is64() ? 2 : 1), 1, 1 };
+                for (uint8_t byte : ident)
+                {
+                    buf.U8(byte);
+                }
+                buf.Align(16);
+
+                buf.U16(type);
+                buf.U16(target == Target::X86_64 ? gc_EmX86_64 : gc_Em386);
+                buf.U32(1);
+                buf.Word(entry);
+                buf.Word(phOffset);
+                buf.Word(shOffset);
+                buf.U32(0);
+                buf.U16(layout.ehSize);
+                buf.U16(phCount == 0 ? 0 : layout.phEntSize);
+                buf.U16(phCount);
+                buf.U16(shCount == 0 ? 0 : layout.shEntSize);
+                buf.U16(shCount);
+                buf.U16(shStrIndex);
+            }
+
+            void WriteSectionHeader(ElfBuffer& buf, uint32_t name, uint32_t type, uint64_t flags, uint64_t offset,
+                                    uint64_t size, uint32_t link, uint32_t info, uint64_t alignment, uint64_t entrySize)
+            {
+                buf.U32(name);
+                buf.U32(type);
+                buf.Word(flags);
+                buf.Word(0);
+                buf.Word(offset);
+                buf.Word(size);
+                buf.U32(link);
+                buf.U32(info);
+                buf.Word(alignment);
+                buf.Word(entrySize);
+            }
+
+            // The 64-bit layout moves the flags up, next to the type.
+            void WriteProgramHeader(ElfBuffer& buf, uint32_t type, uint32_t flags, uint64_t offset, uint64_t address,
+                                    uint64_t size, uint64_t alignment)
+            {
+                buf.U32(type);
+                if (buf.Is64())
+                {
+                    buf.U32(flags);
+                }
+                buf.Word(offset);
+                buf.Word(address);
+                buf.Word(address);
+                buf.Word(size);
+                buf.Word(size);
+                if (!buf.Is64())
+                {
+                    buf.U32(flags);
+                }
+                buf.Word(alignment);
+            }
+
+            void WriteSymbol(ElfBuffer& buf, uint32_t name, uint64_t value, uint8_t bind, uint16_t section)
+            {
+                uint8_t info = static_cast<uint8_t>(bind << 4);
+
+                buf.U32(name);
+                if (buf.Is64())
+                {
+                    buf.U8(info);
+                    buf.U8(0);
+                    buf.U16(section);
+                    buf.U64(value);
+                    buf.U64(0);
+                }
+                else
+                {
+                    buf.U32(static_cast<uint32_t>(value));
+                    buf.U32(0);
+                    buf.U8(info);
+                    buf.U8(0);
+                    buf.U16(section);
+                }
+            }
+
+            void Patch32(std::vector<uint8_t>& text, uint32_t offset, int32_t value)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    text[offset + i] = static_cast<uint8_t>(static_cast<uint32_t>(value) >> (i * 8));
+                }
+            }
+
+            void Flush(std::ostream& out, const ElfBuffer& buf)
+            {
+                out.write(reinterpret_cast<const char*>(buf.GetData().data()), static_cast<std::streamsize>(buf.GetSize()));
+            }
+        } // namespace
+
+        void WriteObjectFile(std::ostream& out, const ObjectCode& code, Target target)
+        {
+            ElfBuffer buf(target);
+            Layout layout = GetLayout(buf);
+            size_t wordSize = buf.Is64() ? 8 : 4;
+
+            // Sections: null, .text, the relocations if there are any, .symtab, .strtab, .shstrtab.
+            bool hasRelocations = !code.relocations.empty();
+            const uint16_t textIndex = 1;
+            const uint16_t symtabIndex = hasRelocations ? 3 : 2;
+            const uint16_t strtabIndex = symtabIndex + 1;
+            const uint16_t shstrtabIndex = symtabIndex + 2;
+
+            StringTable sectionNames;
+            uint32_t textName = sectionNames.Add(".text");
+            uint32_t relName = sectionNames.Add(buf.Is64() ? ".rela.text" : ".rel.text");
+            uint32_t symtabName = sectionNames.Add(".symtab");
+            uint32_t strtabName = sectionNames.Add(".strtab");
+            uint32_t shstrtabName = sectionNames.Add(".shstrtab");
+
+            // Local symbols must come before global ones.
+            StringTable names;
+            ElfBuffer symtab(target);
+            std::unordered_map<std::string, uint32_t> symbolIndices;
+            uint32_t symbolCount = 1;
+
+            WriteSymbol(symtab, 0, 0, gc_StbLocal, 0);
+
+            for (bool global : { false, true })
+            {
+                for (const Symbol& symbol : code.symbols)
+                {
+                    if (symbol.global == global)
+                    {
+                        WriteSymbol(symtab, names.Add(symbol.name), symbol.offset, global ? gc_StbGlobal : gc_StbLocal,
+                                    symbol.defined ? textIndex : 0);
+                        symbolIndices[symbol.name] = symbolCount++;
+                    }
+                }
+            }
+
+            uint32_t firstGlobal = 1;
+            for (const Symbol& symbol : code.symbols)
+            {
+                firstGlobal += symbol.global ? 0 : 1;
+            }
+
+            // i386 keeps the addend in the field being relocated, x86-64 in the entry.
+            std::vector<uint8_t> text = code.text;
+            ElfBuffer relocations(target);
+
+            for (const Relocation& relocation : code.relocations)
+            {
+                uint32_t symbol = symbolIndices[relocation.symbol];
+
+                if (buf.Is64())
+                {
+                    relocations.U64(relocation.offset);
+                    relocations.U64(static_cast<uint64_t>(symbol) << 32 | gc_RX86_64Plt32);
+                    relocations.U64(static_cast<uint64_t>(static_cast<int64_t>(gc_RelocationAddend)));
+                }
+                else
+                {
+                    Patch32(text, relocation.offset, gc_RelocationAddend);
+                    relocations.U32(relocation.offset);
+                    relocations.U32(symbol << 8 | gc_R386Pc32);
+                }
+            }
+
+            uint64_t textOffset = layout.ehSize;
+            uint64_t relOffset = (textOffset + text.size() + wordSize - 1) / wordSize * wordSize;
+            uint64_t symtabOffset = (relOffset + relocations.GetSize() + wordSize - 1) / wordSize * wordSize;
+            uint64_t strtabOffset = symtabOffset + symtab.GetSize();
+            uint64_t shstrtabOffset = strtabOffset + names.GetData().size();
+            uint64_t shOffset = (shstrtabOffset + sectionNames.GetData().size() + wordSize - 1) / wordSize * wordSize;
+
+            WriteHeader(buf, target, gc_EtRel, 0, 0, 0, shOffset, shstrtabIndex + 1, shstrtabIndex);
+
+            buf.Bytes(text);
+            buf.Align(wordSize);
+            buf.Bytes(relocations.GetData());
+            buf.Align(wordSize);
+            buf.Bytes(symtab.GetData());
+            buf.Bytes(names.GetData());
+            buf.Bytes(sectionNames.GetData());
+            buf.Align(wordSize);
+
+            WriteSectionHeader(buf, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+            WriteSectionHeader(buf, textName, gc_ShtProgbits, gc_ShfAlloc | gc_ShfExecInstr, textOffset, text.size(),
+                               0, 0, 1, 0);
+            if (hasRelocations)
+            {
+                WriteSectionHeader(buf, relName, buf.Is64() ? gc_ShtRela : gc_ShtRel, gc_ShfInfoLink, relOffset,
+                                   relocations.GetSize(), symtabIndex, textIndex, wordSize, layout.relEntSize);
+            }
+            WriteSectionHeader(buf, symtabName, gc_ShtSymtab, 0, symtabOffset, symtab.GetSize(),
+                               strtabIndex, firstGlobal, wordSize, layout.symEntSize);
+            WriteSectionHeader(buf, strtabName, gc_ShtStrtab, 0, strtabOffset, names.GetData().size(), 0, 0, 1, 0);
+            WriteSectionHeader(buf, shstrtabName, gc_ShtStrtab, 0, shstrtabOffset, sectionNames.GetData().size(),
+                               0, 0, 1, 0);
+
+            Flush(out, buf);
+        }
+
+        std::vector<std::string> WriteExecutable(std::ostream& out, const ObjectCode& code, Target target)
+        {
+            std::vector<std::string> errors;
+
+            ElfBuffer buf(target);
+            Layout layout = GetLayout(buf);
+
+            ObjectCode linked = code;
+
+            for (const std::string& symbol : ResolveRelocations(linked))
+            {
+                errors.push_back("undefined reference to '" + symbol + "'");
+            }
+
+            auto start = std::find_if(linked.symbols.begin(), linked.symbols.end(),
+                                      [](const Symbol& symbol) { return symbol.defined && symbol.name == "_start"; });
+            if (start == linked.symbols.end())
+            {
+                errors.push_back("no '_start' to enter the program at");
+            }
+
+            if (!errors.empty())
+            {
+                return errors;
+            }
+
+            // The headers are loaded along with the code, in one segment from the start of the file.
+            // Without a PT_GNU_STACK entry the kernel would map the stack executable.
+            uint64_t base = buf.Is64() ? gc_BaseAddress64 : gc_BaseAddress32;
+            uint64_t textOffset = layout.ehSize + 2 * layout.phEntSize;
+            uint64_t fileSize = textOffset + linked.text.size();
+
+            WriteHeader(buf, target, gc_EtExec, base + textOffset + start->offset, layout.ehSize, 2, 0, 0, 0);
+
+            WriteProgramHeader(buf, gc_PtLoad, gc_PfRead | gc_PfExecute, 0, base, fileSize, gc_PageSize);
+            WriteProgramHeader(buf, gc_PtGnuStack, gc_PfRead | gc_PfWrite, 0, 0, 0, 16);
+
+            buf.Bytes(linked.text);
+
+            Flush(out, buf);
+            return errors;
+        }
+    } // namespace Asm
+} // namespace CComp
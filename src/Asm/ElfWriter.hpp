@@ -0,0 +1,25 @@
+#ifndef CCOMP_ASM_ELF_WRITER_HPP
+#define CCOMP_ASM_ELF_WRITER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Encoder.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        // A relocatable object with .text, its relocations and a symbol table, as
+        // ELF32 for i386 and ELF64 for x86-64.
+        void WriteObjectFile(std::ostream& out, const ObjectCode& code, Target target);
+
+        // A static executable for -nostdlib programs: the code in one read-only, executable
+        // segment and the entry point at _start. Relocations are resolved in place, so
+        // every symbol must be defined. Returns what made linking fail, if anything.
+        std::vector<std::string> WriteExecutable(std::ostream& out, const ObjectCode& code, Target target);
+    } // namespace Asm
+} // namespace CComp
+
+#endif // CCOMP_ASM_ELF_WRITER_HPP
@@ -0,0 +1,658 @@
+#include "Encoder.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Printer.hpp"
+#include "../Statistics.hpp"
+#include "../Unreachable.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        namespace
+        {
+            bool FitsInt8(int64_t value)
+            {
+                return value >= INT8_MIN && value <= INT8_MAX;
+            }
+
+            // Register number as encoded in ModRM, SIB and REX; 16 for none, which has no REX bit set.
+            uint8_t Code(Register reg)
+            {
+                return static_cast<uint8_t>(reg);
+            }
+
+            uint8_t CondCode(Cond cond)
+            {
+                switch (cond)
+                {
+                case Cond::E:  return 0x4;
+                case Cond::NE: return 0x5;
+                case Cond::L:  return 0xC;
+                case Cond::GE: return 0xD;
+                case Cond::LE: return 0xE;
+                case Cond::G:  return 0xF;
+                }
+
+                return 0x4;
+            }
+
+            void Put32(std::vector<uint8_t>& out, int32_t value)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    out.push_back(static_cast<uint8_t>(static_cast<uint32_t>(value) >> (i * 8)));
+                }
+            }
+
+            // Everything except labels, jumps and calls, whose encoding depends on where they end up.
+            class InstructionEncoder
+            {
+            public:
+                InstructionEncoder(Target target, std::vector<uint8_t>& out)
+                    : m_Target(target), m_Out(out)
+                {}
+
+                // False if the instruction has no encoding on the target.
+                bool Encode(const Instruction& inst);
+
+            private:
+                Target m_Target;
+                std::vector<uint8_t>& m_Out;
+                bool m_Valid = true;
+
+                void Byte(uint8_t value)
+                { m_Out.push_back(value); }
+
+                void Imm8(int32_t value)
+                { Byte(static_cast<uint8_t>(value)); }
+
+                void Imm32(int32_t value)
+                { Put32(m_Out, value); }
+
+                void Rex(bool wide, uint8_t reg, uint8_t index, uint8_t base, bool force);
+
+                // The opcode with its REX prefix, then ModRM, SIB and displacement for rm.
+                // reg is a register number or the extension of a /digit opcode.
+                void ModRM(std::initializer_list<uint8_t> opcode, uint8_t reg, const Operand& rm, bool wide);
+
+                // Forms with the register in the low bits of the opcode.
+                void ShortReg(uint8_t opcode, Register reg);
+
+                void Alu(uint8_t digit, const Operand& source, const Operand& dest, bool wide);
+                void Shift(uint8_t digit, const Operand& count, const Operand& dest, bool wide);
+            }; // class InstructionEncoder
+
+            void InstructionEncoder::Rex(bool wide, uint8_t reg, uint8_t index, uint8_t base, bool force)
+            {
+                uint8_t rex = (wide ? 0x8 : 0) | (reg & 0x8 ? 0x4 : 0) | (index & 0x8 ? 0x2 : 0) | (base & 0x8 ? 0x1 : 0);
+
+                if (rex == 0 && !force)
+                {
+                    return;
+                }
+
+                if (m_Target != Target::X86_64)
+                {
+                    m_Valid = false;
+                    return;
+                }
+
+                Byte(0x40 | rex);
+            }
+
+            void InstructionEncoder::ModRM(std::initializer_list<uint8_t> opcode, uint8_t reg, const Operand& rm, bool wide)
+            {
+                if (rm.kind == OperandKind::REG)
+                {
+                    uint8_t code = Code(rm.reg);
+
+                    // %spl, %bpl, %sil and %dil replace %ah to %bh only under a REX prefix.
+                    Rex(wide, reg, 0, code, rm.size == 1 && code >= 4 && code < 8);
+                    for (uint8_t byte : opcode)
+                    {
+                        Byte(byte);
+                    }
+                    Byte(0xC0 | (reg & 0x7) << 3 | (code & 0x7));
+                    return;
+                }
+
+                if (rm.kind != OperandKind::MEM || rm.index == Register::ESP)
+                {
+                    m_Valid = false;
+                    return;
+                }
+
+                bool hasBase = rm.reg != Register::NONE;
+                bool hasIndex = rm.index != Register::NONE;
+                uint8_t base = Code(rm.reg);
+                uint8_t index = Code(rm.index);
+
+                Rex(wide, reg, index, base, false);
+                for (uint8_t byte : opcode)
+                {
+                    Byte(byte);
+                }
+
+                // %ebp and %r13 as a base always take a displacement; mod 00 means none there.
+                uint8_t mod = 0;
+                if (hasBase && (rm.value != 0 || (base & 0x7) == 5))
+                {
+                    mod = FitsInt8(rm.value) ? 1 : 2;
+                }
+
+                // %esp and %r12 as a base need a SIB byte, and on x86-64 so does an absolute
+                // address, which would otherwise be relative to %rip.
+                bool hasSib = hasIndex || (hasBase && (base & 0x7) == 4) || (!hasBase && m_Target == Target::X86_64);
+
+                if (!hasSib)
+                {
+                    Byte(mod << 6 | (reg & 0x7) << 3 | (hasBase ? base & 0x7 : 5));
+                }
+                else
+                {
+                    uint8_t scale = 0;
+                    switch (rm.scale)
+                    {
+                    case 1: scale = 0; break;
+                    case 2: scale = 1; break;
+                    case 4: scale = 2; break;
+                    case 8: scale = 3; break;
+                    default:
+                        m_Valid = false;
+                        break;
+                    }
+
+                    Byte(mod << 6 | (reg & 0x7) << 3 | 4);
+                    Byte(scale << 6 | (hasIndex ? index & 0x7 : 4) << 3 | (hasBase ? base & 0x7 : 5));
+                }
+
+                if (mod == 1)
+                {
+                    Imm8(rm.value);
+                }
+                else if (mod == 2 || !hasBase)
+                {
+                    Imm32(rm.value);
+                }
+            }
+
+            void InstructionEncoder::ShortReg(uint8_t opcode, Register reg)
+            {
+                Rex(false, 0, 0, Code(reg), false);
+                Byte(opcode + (Code(reg) & 0x7));
+            }
+
+            void InstructionEncoder::Alu(uint8_t digit, const Operand& source, const Operand& dest, bool wide)
+            {
+                if (source.kind == OperandKind::IMM)
+                {
+                    if (FitsInt8(source.value))
+                    {
+                        ModRM({ 0x83 }, digit, dest, wide);
+                        Imm8(source.value);
+                    }
+                    else if (dest.kind == OperandKind::REG && dest.reg == Register::EAX)
+                    {
+                        // The accumulator has a form without ModRM.
+                        Rex(wide, 0, 0, 0, false);
+                        Byte(static_cast<uint8_t>(digit << 3 | 0x05));
+                        Imm32(source.value);
+                    }
+                    else
+                    {
+                        ModRM({ 0x81 }, digit, dest, wide);
+                        Imm32(source.value);
+                    }
+                }
+                else if (source.kind == OperandKind::REG)
+                {
+                    ModRM({ static_cast<uint8_t>(digit << 3 | 0x01) }, Code(source.reg), dest, wide);
+                }
+                else if (dest.kind == OperandKind::REG)
+                {
+                    ModRM({ static_cast<uint8_t>(digit << 3 | 0x03) }, Code(dest.reg), source, wide);
+                }
+                else
+                {
+                    m_Valid = false;
+                }
+            }
+
+            void InstructionEncoder::Shift(uint8_t digit, const Operand& count, const Operand& dest, bool wide)
+            {
+                if (count.kind == OperandKind::IMM && count.value == 1)
+                {
+                    ModRM({ 0xD1 }, digit, dest, wide);
+                }
+                else if (count.kind == OperandKind::IMM)
+                {
+                    ModRM({ 0xC1 }, digit, dest, wide);
+                    Imm8(count.value);
+                }
+                else if (count.kind == OperandKind::REG && count.reg == Register::ECX)
+                {
+                    ModRM({ 0xD3 }, digit, dest, wide);
+                }
+                else
+                {
+                    m_Valid = false;
+                }
+            }
+
+            bool InstructionEncoder::Encode(const Instruction& inst)
+            {
+                const Operand& first = inst.operands[0];
+                const Operand& second = inst.operands[1];
+
+                bool wide = (first.kind == OperandKind::REG && first.size == 8)
+                    || (second.kind == OperandKind::REG && second.size == 8);
+
+                m_Valid = true;
+
+                switch (inst.op)
+                {
+                case Opcode::MOV:
+                    if (first.kind == OperandKind::IMM && second.kind == OperandKind::REG && !wide)
+                    {
+                        ShortReg(0xB8, second.reg);
+                        Imm32(first.value);
+                    }
+                    else if (first.kind == OperandKind::IMM)
+                    {
+                        ModRM({ 0xC7 }, 0, second, wide);
+                        Imm32(first.value);
+                    }
+                    else if (first.kind == OperandKind::REG)
+                    {
+                        ModRM({ 0x89 }, Code(first.reg), second, wide);
+                    }
+                    else if (second.kind == OperandKind::REG)
+                    {
+                        ModRM({ 0x8B }, Code(second.reg), first, wide);
+                    }
+                    else
+                    {
+                        m_Valid = false;
+                    }
+                    break;
+
+                case Opcode::MOVZB:
+                    ModRM({ 0x0F, 0xB6 }, Code(second.reg), first, second.size == 8);
+                    break;
+
+                case Opcode::LEA:
+                    ModRM({ 0x8D }, Code(second.reg), first, wide);
+                    break;
+
+                case Opcode::ADD: Alu(0, first, second, wide); break;
+                case Opcode::OR:  Alu(1, first, second, wide); break;
+                case Opcode::AND: Alu(4, first, second, wide); break;
+                case Opcode::SUB: Alu(5, first, second, wide); break;
+                case Opcode::XOR: Alu(6, first, second, wide); break;
+                case Opcode::CMP: Alu(7, first, second, wide); break;
+
+                case Opcode::TEST:
+                    if (first.kind == OperandKind::IMM && second.kind == OperandKind::REG && second.reg == Register::EAX)
+                    {
+                        Rex(wide, 0, 0, 0, false);
+                        Byte(0xA9);
+                        Imm32(first.value);
+                    }
+                    else if (first.kind == OperandKind::IMM)
+                    {
+                        ModRM({ 0xF7 }, 0, second, wide);
+                        Imm32(first.value);
+                    }
+                    else if (first.kind == OperandKind::REG)
+                    {
+                        ModRM({ 0x85 }, Code(first.reg), second, wide);
+                    }
+                    else
+                    {
+                        ModRM({ 0x85 }, Code(second.reg), first, wide);
+                    }
+                    break;
+
+                case Opcode::IMUL:
+                    if (inst.GetOperandCount() == 1)
+                    {
+                        ModRM({ 0xF7 }, 5, first, wide);
+                    }
+                    else if (first.kind == OperandKind::IMM && FitsInt8(first.value))
+                    {
+                        ModRM({ 0x6B }, Code(second.reg), second, wide);
+                        Imm8(first.value);
+                    }
+                    else if (first.kind == OperandKind::IMM)
+                    {
+                        ModRM({ 0x69 }, Code(second.reg), second, wide);
+                        Imm32(first.value);
+                    }
+                    else
+                    {
+                        ModRM({ 0x0F, 0xAF }, Code(second.reg), first, wide);
+                    }
+                    break;
+
+                case Opcode::IDIV: ModRM({ 0xF7 }, 7, first, wide); break;
+                case Opcode::NEG:  ModRM({ 0xF7 }, 3, first, wide); break;
+                case Opcode::NOT:  ModRM({ 0xF7 }, 2, first, wide); break;
+
+                // The one-byte forms became REX prefixes on x86-64.
+                case Opcode::INC:
+                case Opcode::DEC:
+                    if (m_Target == Target::I386 && first.kind == OperandKind::REG)
+                    {
+                        ShortReg(inst.op == Opcode::INC ? 0x40 : 0x48, first.reg);
+                    }
+                    else
+                    {
+                        ModRM({ 0xFF }, inst.op == Opcode::INC ? 0 : 1, first, wide);
+                    }
+                    break;
+
+                case Opcode::SAL: Shift(4, first, second, wide); break;
+                case Opcode::SHR: Shift(5, first, second, wide); break;
+                case Opcode::SAR: Shift(7, first, second, wide); break;
+
+                case Opcode::CDQ:
+                    Byte(0x99);
+                    break;
+
+                case Opcode::SETCC:
+                    ModRM({ 0x0F, static_cast<uint8_t>(0x90 | CondCode(inst.cond)) }, 0, first, false);
+                    break;
+
+                // Push and pop always move a whole word, so they take no REX.W.
+                case Opcode::PUSH:
+                    if (first.kind == OperandKind::REG)
+                    {
+                        ShortReg(0x50, first.reg);
+                    }
+                    else if (first.kind == OperandKind::IMM && FitsInt8(first.value))
+                    {
+                        Byte(0x6A);
+                        Imm8(first.value);
+                    }
+                    else if (first.kind == OperandKind::IMM)
+                    {
+                        Byte(0x68);
+                        Imm32(first.value);
+                    }
+                    else
+                    {
+                        ModRM({ 0xFF }, 6, first, false);
+                    }
+                    break;
+
+                case Opcode::POP:
+                    if (first.kind == OperandKind::REG)
+                    {
+                        ShortReg(0x58, first.reg);
+                    }
+                    else
+                    {
+                        ModRM({ 0x8F }, 0, first, false);
+                    }
+                    break;
+
+                case Opcode::RET:
+                    Byte(0xC3);
+                    break;
+
+                case Opcode::INT:
+                    Byte(0xCD);
+                    Imm8(first.value);
+                    break;
+
+                case Opcode::SYSCALL:
+                    Byte(0x0F);
+                    Byte(0x05);
+                    break;
+
+                default:
+                    m_Valid = false;
+                    break;
+                }
+
+                return m_Valid;
+            }
+
+            // A run of encoded bytes, or a branch whose size is still open.
+            struct Fragment
+            {
+                size_t begin = 0;
+                size_t end = 0;
+                const Instruction* branch = nullptr;
+                bool isLong = false;
+            }; // struct Fragment
+
+            uint32_t GetSize(const Fragment& fragment)
+            {
+                if (fragment.branch == nullptr)
+                {
+                    return static_cast<uint32_t>(fragment.end - fragment.begin);
+                }
+
+                if (!fragment.isLong)
+                {
+                    return 2;
+                }
+
+                return fragment.branch->op == Opcode::JCC ? 6 : 5;
+            }
+        } // namespace
+
+        ObjectCode Encode(const std::vector<Instruction>& insts, Target target)
+        {
+            ObjectCode res;
+
+            std::vector<uint8_t> encoded;
+            std::vector<Fragment> fragments;
+
+            // A label stands for the offset of the fragment that follows it.
+            std::unordered_map<std::string, size_t> labels;
+            std::vector<std::string> labelOrder;
+            std::unordered_set<std::string> globals;
+
+            InstructionEncoder encoder(target, encoded);
+
+            for (const Instruction& inst : insts)
+            {
+                switch (inst.op)
+                {
+                case Opcode::LABEL:
+                    if (!labels.emplace(inst.label, fragments.size()).second)
+                    {
+                        Unreachable("label '" + inst.label + "' is defined more than once");
+                    }
+                    labelOrder.push_back(inst.label);
+                    break;
+
+                case Opcode::GLOBL:
+                    globals.insert(inst.label);
+                    break;
+
+                case Opcode::COMMENT:
+                case Opcode::BLANK:
+                    break;
+
+                case Opcode::JMP:
+                case Opcode::JCC:
+                case Opcode::CALL:
+                    fragments.push_back({ encoded.size(), encoded.size(), &inst });
+                    break;
+
+                default:
+                {
+                    size_t begin = encoded.size();
+
+                    if (!encoder.Encode(inst))
+                    {
+                        std::ostringstream text;
+                        PrintInstruction(text, inst, target);
+                        Unreachable("cannot encode '" + text.str().substr(0, text.str().size() - 1) + "' for the target");
+                    }
+
+                    fragments.push_back({ begin, encoded.size() });
+                    break;
+                }
+                }
+            }
+
+            // Branches to labels that may be preempted or live elsewhere go through the linker.
+            auto isLocal = [&](const std::string& label)
+            {
+                return labels.count(label) != 0 && globals.count(label) == 0;
+            };
+
+            for (Fragment& fragment : fragments)
+            {
+                if (fragment.branch != nullptr)
+                {
+                    fragment.isLong = fragment.branch->op == Opcode::CALL || !isLocal(fragment.branch->label);
+                }
+            }
+
+            // Growing a branch only moves code apart, so repeating until nothing grows terminates.
+            std::vector<uint32_t> offsets(fragments.size() + 1);
+            size_t relaxed = 0;
+
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+
+                for (size_t i = 0; i < fragments.size(); i++)
+                {
+                    offsets[i + 1] = offsets[i] + GetSize(fragments[i]);
+                }
+
+                for (size_t i = 0; i < fragments.size(); i++)
+                {
+                    Fragment& fragment = fragments[i];
+
+                    if (fragment.branch == nullptr || fragment.isLong)
+                    {
+                        continue;
+                    }
+
+                    int64_t displacement = static_cast<int64_t>(offsets[labels[fragment.branch->label]]) - offsets[i + 1];
+                    if (!FitsInt8(displacement))
+                    {
+                        fragment.isLong = true;
+                        changed = true;
+                        relaxed++;
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < fragments.size(); i++)
+            {
+                const Fragment& fragment = fragments[i];
+
+                if (fragment.branch == nullptr)
+                {
+                    res.text.insert(res.text.end(), encoded.begin() + fragment.begin, encoded.begin() + fragment.end);
+                    continue;
+                }
+
+                const Instruction& branch = *fragment.branch;
+                bool local = isLocal(branch.label);
+                int64_t displacement = local ? static_cast<int64_t>(offsets[labels[branch.label]]) - offsets[i + 1] : 0;
+
+                if (!fragment.isLong)
+                {
+                    res.text.push_back(branch.op == Opcode::JMP ? 0xEB : static_cast<uint8_t>(0x70 | CondCode(branch.cond)));
+                    res.text.push_back(static_cast<uint8_t>(displacement));
+                    continue;
+                }
+
+                switch (branch.op)
+                {
+                case Opcode::JMP:
+                    res.text.push_back(0xE9);
+                    break;
+                case Opcode::JCC:
+                    res.text.push_back(0x0F);
+                    res.text.push_back(static_cast<uint8_t>(0x80 | CondCode(branch.cond)));
+                    break;
+                default:
+                    res.text.push_back(0xE8);
+                    break;
+                }
+
+                if (!local)
+                {
+                    res.relocations.push_back({ static_cast<uint32_t>(res.text.size()), branch.label });
+                }
+
+                Put32(res.text, static_cast<int32_t>(displacement));
+            }
+
+            for (const std::string& label : labelOrder)
+            {
+                bool global = globals.count(label) != 0;
+
+                if (global || label.compare(0, 2, ".L") != 0)
+                {
+                    res.symbols.push_back({ label, offsets[labels[label]], true, global });
+                }
+            }
+
+            std::unordered_set<std::string> undefined;
+            for (const Relocation& relocation : res.relocations)
+            {
+                if (labels.count(relocation.symbol) == 0 && undefined.insert(relocation.symbol).second)
+                {
+                    res.symbols.push_back({ relocation.symbol, 0, false, true });
+                }
+            }
+
+            AddStatistic("assembler", "bytes of code", static_cast<long long>(res.text.size()));
+            AddStatistic("assembler", "jumps relaxed to rel32", static_cast<long long>(relaxed));
+
+            return res;
+        }
+
+        std::vector<std::string> ResolveRelocations(ObjectCode& code)
+        {
+            std::vector<std::string> undefined;
+
+            std::unordered_map<std::string, uint32_t> offsets;
+            for (const Symbol& symbol : code.symbols)
+            {
+                if (symbol.defined)
+                {
+                    offsets[symbol.name] = symbol.offset;
+                }
+            }
+
+            for (const Relocation& relocation : code.relocations)
+            {
+                auto offset = offsets.find(relocation.symbol);
+                if (offset == offsets.end())
+                {
+                    undefined.push_back(relocation.symbol);
+                    continue;
+                }
+
+                // The displacement counts from the end of the 4-byte field.
+                int32_t displacement = static_cast<int32_t>(offset->second) - static_cast<int32_t>(relocation.offset + 4);
+
+                std::vector<uint8_t> field;
+                Put32(field, displacement);
+                std::copy(field.begin(), field.end(), code.text.begin() + relocation.offset);
+            }
+
+            code.relocations.clear();
+            return undefined;
+        }
+    } // namespace Asm
+} // namespace CComp
@@ -0,0 +1,51 @@
+#ifndef CCOMP_ASM_ENCODER_HPP
+#define CCOMP_ASM_ENCODER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Asm.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        struct Symbol
+        {
+            std::string name;
+            uint32_t offset = 0;
+            bool defined = false;
+            bool global = false;
+        }; // struct Symbol
+
+        // A 32-bit displacement from the end of the field to a symbol, left as zero
+        // for the linker. Only calls and jumps to global or undefined labels need one.
+        struct Relocation
+        {
+            uint32_t offset;
+            std::string symbol;
+        }; // struct Relocation
+
+        // The .text section of one translation unit.
+        struct ObjectCode
+        {
+            std::vector<uint8_t> text;
+            std::vector<Symbol> symbols;
+            std::vector<Relocation> relocations;
+        }; // struct ObjectCode
+
+        // Encodes the instructions the way GNU as does, so the bytes can be compared:
+        // the shortest immediate and displacement forms, and jumps that start as rel8
+        // and grow to rel32 only when their target is out of reach. Labels starting
+        // with .L stay out of the symbol table, as in as.
+        ObjectCode Encode(const std::vector<Instruction>& insts, Target target);
+
+        // Fills in every relocation in text with the displacement to its symbol, as linking
+        // this object on its own would, and returns the symbols that are not defined.
+        // The code then runs wherever it is placed.
+        std::vector<std::string> ResolveRelocations(ObjectCode& code);
+    } // namespace Asm
+} // namespace CComp
+
+#endif // CCOMP_ASM_ENCODER_HPP
@@ -0,0 +1,108 @@
+#include "Jit.hpp"
+
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../Statistics.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        bool GetHostTarget(Target& target)
+        {
+#if defined(__x86_64__)
+            target = Target::X86_64;
+            return true;
+#elif defined(__i386__)
+            target = Target::I386;
+            return true;
+#else
+            (void)target;
+            return false;
+#endif
+        }
+
+        JitModule::~JitModule()
+        {
+            if (m_Memory != nullptr)
+            {
+                munmap(m_Memory, m_Size);
+            }
+        }
+
+        std::vector<std::string> JitModule::Load(const ObjectCode& code)
+        {
+            ObjectCode linked = code;
+
+            std::vector<std::string> errors;
+            for (const std::string& symbol : ResolveRelocations(linked))
+            {
+                errors.push_back("undefined reference to '" + symbol + "'");
+            }
+
+            if (!errors.empty())
+            {
+                return errors;
+            }
+
+            size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            size_t size = (linked.text.size() + pageSize - 1) / pageSize * pageSize;
+            if (size == 0)
+            {
+                size = pageSize;
+            }
+
+            // Never writable and executable at once.
+            void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED)
+            {
+                errors.push_back("could not map memory for the code");
+                return errors;
+            }
+
+            std::memcpy(memory, linked.text.data(), linked.text.size());
+
+            if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+            {
+                munmap(memory, size);
+                errors.push_back("could not make the code executable");
+                return errors;
+            }
+
+            if (m_Memory != nullptr)
+            {
+                munmap(m_Memory, m_Size);
+            }
+
+            m_Memory = memory;
+            m_Size = size;
+
+            m_Symbols.clear();
+            for (const Symbol& symbol : linked.symbols)
+            {
+                if (symbol.defined)
+                {
+                    m_Symbols[symbol.name] = symbol.offset;
+                }
+            }
+
+            AddStatistic("jit", "bytes mapped", static_cast<long long>(size));
+
+            return errors;
+        }
+
+        JitModule::Function JitModule::GetFunction(const std::string& name) const
+        {
+            auto symbol = m_Symbols.find(name);
+            if (m_Memory == nullptr || symbol == m_Symbols.end())
+            {
+                return nullptr;
+            }
+
+            return reinterpret_cast<Function>(static_cast<uint8_t*>(m_Memory) + symbol->second);
+        }
+    } // namespace Asm
+} // namespace CComp
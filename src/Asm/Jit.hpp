@@ -0,0 +1,47 @@
+#ifndef CCOMP_ASM_JIT_HPP
+#define CCOMP_ASM_JIT_HPP
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Encoder.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        // Target::X86_64 on x86-64 hosts and Target::I386 on i386 ones: the only target
+        // whose code the compiler can run in its own process. False if there is none.
+        bool GetHostTarget(Target& target);
+
+        // Encoded code placed in executable memory of this process, so its functions can
+        // be called directly instead of going through an executable on disk.
+        class JitModule
+        {
+        public:
+            using Function = int (*)();
+
+            JitModule() = default;
+            ~JitModule();
+
+            JitModule(const JitModule&) = delete;
+            JitModule& operator=(const JitModule&) = delete;
+
+            // Maps the code writable, resolves its relocations and then makes it read-only
+            // and executable. Returns what made loading fail, if anything.
+            std::vector<std::string> Load(const ObjectCode& code);
+
+            // Nullptr if no function of that name was loaded.
+            Function GetFunction(const std::string& name) const;
+
+        private:
+            void* m_Memory = nullptr;
+            size_t m_Size = 0;
+            std::unordered_map<std::string, uint32_t> m_Symbols;
+        }; // class JitModule
+    } // namespace Asm
+} // namespace CComp
+
+#endif // CCOMP_ASM_JIT_HPP
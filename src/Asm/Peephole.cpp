@@ -0,0 +1,848 @@
+#include "Peephole.hpp"
+
+#include <unordered_map>
+
+namespace CComp
+{
+    namespace Asm
+    {
+        namespace
+        {
+            // Operand-0 positions that may hold an immediate instead of a register or memory.
+            bool AcceptsImmediateSource(const Instruction& inst)
+            {
+                switch (inst.op)
+                {
+                case Opcode::MOV:
+                case Opcode::ADD:
+                case Opcode::SUB:
+                case Opcode::AND:
+                case Opcode::OR:
+                case Opcode::XOR:
+                case Opcode::CMP:
+                case Opcode::TEST:
+                case Opcode::PUSH:
+                    return true;
+
+                case Opcode::IMUL:
+                    return inst.GetOperandCount() == 2;
+
+                default:
+                    return false;
+                }
+            }
+
+            // Operand-0 positions that are only read, so memory there can become a register.
+            bool ReadsOnlySource(const Instruction& inst)
+            {
+                return AcceptsImmediateSource(inst) || inst.op == Opcode::IDIV || inst.op == Opcode::IMUL;
+            }
+
+            bool IsRegister(const Operand& operand, Register reg)
+            {
+                return operand.kind == OperandKind::REG && operand.reg == reg;
+            }
+
+            bool Mentions(const Operand& operand, Register reg)
+            {
+                return operand.kind != OperandKind::NONE && operand.kind != OperandKind::IMM
+                    && (operand.reg == reg || operand.index == reg);
+            }
+
+            // Registers a caller or _start still needs after ret, on either target.
+            constexpr RegisterMask gc_LiveAtReturn = MaskOf(Register::EAX) | MaskOf(Register::EBP) | MaskOf(Register::ESP)
+                | gc_CalleeSaved | gc_CalleeSaved64;
+        } // namespace
+
+        const char* PeepholePatternToString(PeepholePattern pattern)
+        {
+            switch (pattern)
+            {
+            case PeepholePattern::REDUNDANT_MOVE:   return "redundant moves removed";
+            case PeepholePattern::REDUNDANT_LOAD:   return "redundant loads removed";
+            case PeepholePattern::DEAD_STORE:       return "dead stores removed";
+            case PeepholePattern::DEAD_MOVE:        return "dead moves removed";
+            case PeepholePattern::FOLD_IMMEDIATE:   return "immediates folded";
+            case PeepholePattern::PUSH_POP:         return "push/pop pairs replaced";
+            case PeepholePattern::UNREACHABLE:      return "unreachable instructions removed";
+            case PeepholePattern::JUMP_TO_NEXT:     return "jumps to next instruction removed";
+            case PeepholePattern::BRANCH_INVERSION: return "branches inverted";
+            case PeepholePattern::COUNT:            break;
+            }
+
+            return "<unknown>";
+        }
+
+        PeepholeOptimizer::PeepholeOptimizer(size_t window, Target target)
+            : m_Window(window), m_WordSize(GetWordSize(target))
+        {}
+
+        void PeepholeOptimizer::Run(std::vector<Instruction>& insts)
+        {
+            m_Insts = &insts;
+
+            while (RunOnce())
+            {
+                size_t next = 0;
+                for (size_t i = 0; i < insts.size(); i++)
+                {
+                    if (m_Dead[i])
+                    {
+                        continue;
+                    }
+
+                    if (next != i)
+                    {
+                        insts[next] = std::move(insts[i]);
+                    }
+                    next++;
+                }
+
+                insts.erase(insts.begin() + next, insts.end());
+            }
+
+            m_Insts = nullptr;
+        }
+
+        bool PeepholeOptimizer::RunOnce()
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+
+            m_Dead.assign(insts.size(), false);
+            ComputeStackOffsets();
+
+            bool changed = false;
+
+            for (size_t i = 0; i < insts.size(); i++)
+            {
+                if (m_Dead[i])
+                {
+                    continue;
+                }
+
+                // Each rewrite may kill instruction i, so stop at the first one that applies.
+                changed |= RemoveUnreachable(i)
+                    || SimplifyJump(i)
+                    || PairPushPop(i)
+                    || FoldImmediate(i)
+                    || ForwardCopy(i)
+                    || RemoveDeadStore(i)
+                    || RemoveDeadMove(i);
+            }
+
+            return changed;
+        }
+
+        void PeepholeOptimizer::ComputeStackOffsets()
+        {
+            const std::vector<Instruction>& insts = *m_Insts;
+
+            struct LabelState
+            {
+                bool seen = false;
+                std::optional<int32_t> offset;
+            }; // struct LabelState
+
+            std::unordered_map<std::string, LabelState> labels;
+
+            // Returns true if the label's state changed.
+            auto merge = [&](const std::string& label, std::optional<int32_t> offset)
+            {
+                LabelState& state = labels[label];
+
+                if (!state.seen)
+                {
+                    state.seen = true;
+                    state.offset = offset;
+                    return true;
+                }
+
+                if (state.offset.has_value() && state.offset != offset)
+                {
+                    state.offset.reset();
+                    return true;
+                }
+
+                return false;
+            };
+
+            m_StackOffsets.assign(insts.size(), std::nullopt);
+
+            // Jumps back to a label may invalidate what was assumed there, so repeat until stable.
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+
+                std::optional<int32_t> offset;
+                bool reachable = true;
+
+                for (size_t i = 0; i < insts.size(); i++)
+                {
+                    const Instruction& inst = insts[i];
+
+                    if (inst.op == Opcode::LABEL)
+                    {
+                        if (reachable)
+                        {
+                            changed |= merge(inst.label, offset);
+                        }
+
+                        offset = labels[inst.label].offset;
+                        reachable = true;
+                    }
+                    else if (inst.op == Opcode::GLOBL)
+                    {
+                        offset = 0;
+                        reachable = true;
+                    }
+
+                    m_StackOffsets[i] = offset;
+
+                    if (m_Dead[i])
+                    {
+                        continue;
+                    }
+
+                    const Operand& first = inst.operands[0];
+                    const Operand& second = inst.operands[1];
+
+                    switch (inst.op)
+                    {
+                    case Opcode::JMP:
+                    case Opcode::JCC:
+                        changed |= merge(inst.label, offset);
+                        reachable = inst.op == Opcode::JCC;
+                        continue;
+
+                    case Opcode::RET:
+                        reachable = false;
+                        continue;
+
+                    case Opcode::PUSH:
+                        offset = offset.has_value() ? std::optional<int32_t>(*offset - m_WordSize) : std::nullopt;
+                        continue;
+
+                    case Opcode::POP:
+                        if (IsRegister(first, Register::ESP) || IsRegister(first, Register::EBP))
+                        {
+                            offset.reset();
+                        }
+                        else if (offset.has_value())
+                        {
+                            *offset += m_WordSize;
+                        }
+                        continue;
+
+                    case Opcode::MOV:
+                        if ((IsRegister(first, Register::ESP) && IsRegister(second, Register::EBP))
+                            || (IsRegister(first, Register::EBP) && IsRegister(second, Register::ESP)))
+                        {
+                            offset = 0;
+                            continue;
+                        }
+                        break;
+
+                    case Opcode::ADD:
+                    case Opcode::SUB:
+                        if (IsRegister(second, Register::ESP) && first.kind == OperandKind::IMM)
+                        {
+                            if (offset.has_value())
+                            {
+                                *offset += inst.op == Opcode::ADD ? first.value : -first.value;
+                            }
+                            continue;
+                        }
+                        break;
+
+                    default:
+                        break;
+                    }
+
+                    if (GetEffects(inst).writes & (MaskOf(Register::ESP) | MaskOf(Register::EBP)))
+                    {
+                        offset.reset();
+                    }
+                }
+            }
+        }
+
+        bool PeepholeOptimizer::RemoveUnreachable(size_t i)
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+
+            if (!IsUnconditionalJump(insts[i].op))
+            {
+                return false;
+            }
+
+            bool changed = false;
+
+            for (size_t j = Next(i); j < insts.size(); j = Next(j))
+            {
+                if (insts[j].op == Opcode::LABEL || insts[j].op == Opcode::GLOBL)
+                {
+                    break;
+                }
+
+                Kill(j);
+                Hit(PeepholePattern::UNREACHABLE);
+                changed = true;
+            }
+
+            return changed;
+        }
+
+        bool PeepholeOptimizer::SimplifyJump(size_t i)
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+            Instruction& inst = insts[i];
+
+            // Does one of the labels right after instruction `from` name `label`?
+            auto fallsInto = [&](size_t from, const std::string& label)
+            {
+                for (size_t j = Next(from); j < insts.size() && insts[j].op == Opcode::LABEL; j = Next(j))
+                {
+                    if (insts[j].label == label)
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            };
+
+            if (inst.op == Opcode::JMP && fallsInto(i, inst.label))
+            {
+                Kill(i);
+                Hit(PeepholePattern::JUMP_TO_NEXT);
+                return true;
+            }
+
+            if (inst.op == Opcode::JCC)
+            {
+                if (fallsInto(i, inst.label))
+                {
+                    Kill(i);
+                    Hit(PeepholePattern::JUMP_TO_NEXT);
+                    return true;
+                }
+
+                size_t j = Next(i);
+                if (j < insts.size() && insts[j].op == Opcode::JMP && fallsInto(j, inst.label))
+                {
+                    inst.cond = InvertCond(inst.cond);
+                    inst.label = insts[j].label;
+                    Kill(j);
+                    Hit(PeepholePattern::BRANCH_INVERSION);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool PeepholeOptimizer::PairPushPop(size_t i)
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+            Instruction& push = insts[i];
+
+            if (push.op != Opcode::PUSH || !m_StackOffsets[i].has_value())
+            {
+                return false;
+            }
+
+            const int32_t slot = *m_StackOffsets[i] - m_WordSize;
+            const RegisterMask stackMask = MaskOf(Register::ESP);
+
+            size_t j = Next(i);
+            for (size_t count = 0; j < insts.size() && count < m_Window; j = Next(j), count++)
+            {
+                const Instruction& inst = insts[j];
+
+                if (inst.op == Opcode::POP)
+                {
+                    break;
+                }
+
+                Effects effects = GetEffects(inst);
+                if (IsBarrier(inst) || ((effects.reads | effects.writes) & stackMask)
+                    || AccessesMemory(j, slot, static_cast<uint8_t>(m_WordSize), true, true))
+                {
+                    return false;
+                }
+            }
+
+            if (j >= insts.size() || insts[j].op != Opcode::POP || insts[j].operands[0].kind != OperandKind::REG)
+            {
+                return false;
+            }
+
+            const Register reg = insts[j].operands[0].reg;
+            if (reg == Register::ESP || reg == Register::EBP)
+            {
+                return false;
+            }
+
+            // The register now gets its value at the push, so nothing in between may touch it.
+            for (size_t k = Next(i); k < j; k = Next(k))
+            {
+                Effects effects = GetEffects(insts[k]);
+                if ((effects.reads | effects.writes) & MaskOf(reg))
+                {
+                    return false;
+                }
+            }
+
+            if (IsRegister(push.operands[0], reg) && ExtendFrameAllocation(i, j))
+            {
+                // A callee-saved register the body no longer uses: its save slot becomes
+                // padding, so the frame keeps its alignment.
+                Kill(i);
+                Kill(j);
+                Hit(PeepholePattern::PUSH_POP);
+                return true;
+            }
+
+            if (IsRegister(push.operands[0], reg))
+            {
+                Kill(i);
+            }
+            else
+            {
+                push = Instruction(Opcode::MOV, push.operands[0], Reg(reg));
+            }
+
+            Kill(j);
+
+            for (size_t k = i + 1; k <= j; k++)
+            {
+                if (m_StackOffsets[k].has_value())
+                {
+                    *m_StackOffsets[k] += m_WordSize;
+                }
+            }
+
+            Hit(PeepholePattern::PUSH_POP);
+            return true;
+        }
+
+        bool PeepholeOptimizer::ExtendFrameAllocation(size_t push, size_t pop)
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+
+            size_t prev = push;
+            while (prev > 0 && (m_Dead[prev - 1] || insts[prev - 1].op == Opcode::COMMENT || insts[prev - 1].op == Opcode::BLANK))
+            {
+                prev--;
+            }
+
+            if (prev == 0)
+            {
+                return false;
+            }
+
+            Instruction& alloc = insts[prev - 1];
+            if (alloc.op != Opcode::SUB || alloc.operands[0].kind != OperandKind::IMM || !IsRegister(alloc.operands[1], Register::ESP))
+            {
+                return false;
+            }
+
+            size_t next = Next(pop);
+            if (next >= insts.size() || insts[next].op != Opcode::MOV
+                || !IsRegister(insts[next].operands[0], Register::EBP) || !IsRegister(insts[next].operands[1], Register::ESP))
+            {
+                return false;
+            }
+
+            alloc.operands[0].value += m_WordSize;
+            return true;
+        }
+
+        bool PeepholeOptimizer::FoldImmediate(size_t i)
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+            const Instruction& mov = insts[i];
+
+            if (mov.op != Opcode::MOV || mov.operands[0].kind != OperandKind::IMM
+                || mov.operands[1].kind != OperandKind::REG)
+            {
+                return false;
+            }
+
+            const Register reg = mov.operands[1].reg;
+            const int32_t value = mov.operands[0].value;
+
+            size_t j = Next(i);
+            for (size_t count = 0; j < insts.size() && count < m_Window; j = Next(j), count++)
+            {
+                if (IsBarrier(insts[j]))
+                {
+                    return false;
+                }
+
+                Effects effects = GetEffects(insts[j]);
+                if ((effects.reads | effects.writes) & MaskOf(reg))
+                {
+                    break;
+                }
+            }
+
+            if (j >= insts.size() || IsBarrier(insts[j]))
+            {
+                return false;
+            }
+
+            Instruction& user = insts[j];
+            Operand& source = user.operands[0];
+
+            bool isShiftCount = (user.op == Opcode::SAL || user.op == Opcode::SAR || user.op == Opcode::SHR)
+                && source.kind == OperandKind::REG && source.size == 1 && source.reg == reg;
+
+            if (!isShiftCount && (!IsRegister(source, reg) || !AcceptsImmediateSource(user)))
+            {
+                return false;
+            }
+
+            // The register must be read only as that source operand.
+            if (Mentions(user.operands[1], reg))
+            {
+                return false;
+            }
+
+            Effects effects = GetEffects(user);
+            if (!(effects.writes & MaskOf(reg)) && !IsDeadAfter(j, reg))
+            {
+                return false;
+            }
+
+            source = Imm(isShiftCount ? (value & 31) : value);
+            Kill(i);
+            Hit(PeepholePattern::FOLD_IMMEDIATE);
+            return true;
+        }
+
+        bool PeepholeOptimizer::ForwardCopy(size_t i)
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+            const Instruction& mov = insts[i];
+
+            if (mov.op != Opcode::MOV)
+            {
+                return false;
+            }
+
+            // After the move both operands hold the same value until either changes.
+            const Operand source = mov.operands[0];
+            const Operand dest = mov.operands[1];
+
+            if (source == dest)
+            {
+                Kill(i);
+                Hit(PeepholePattern::REDUNDANT_MOVE);
+                return true;
+            }
+
+            const std::optional<int32_t> sourceAddress = GetAddress(i, source);
+            const std::optional<int32_t> destAddress = GetAddress(i, dest);
+
+            RegisterMask watched = 0;
+            for (const Operand& operand : { source, dest })
+            {
+                if (operand.kind == OperandKind::REG || operand.kind == OperandKind::MEM)
+                {
+                    watched |= MaskOf(operand.reg) | MaskOf(operand.index);
+                }
+            }
+
+            bool changed = false;
+
+            size_t j = Next(i);
+            for (size_t count = 0; j < insts.size() && count < m_Window; j = Next(j), count++)
+            {
+                Instruction& inst = insts[j];
+
+                if (IsBarrier(inst))
+                {
+                    break;
+                }
+
+                if (inst.op == Opcode::MOV
+                    && ((inst.operands[0] == source && inst.operands[1] == dest)
+                        || (inst.operands[0] == dest && inst.operands[1] == source)))
+                {
+                    Kill(j);
+                    Hit(inst.operands[0].kind == OperandKind::MEM
+                        ? PeepholePattern::REDUNDANT_LOAD
+                        : PeepholePattern::REDUNDANT_MOVE);
+                    changed = true;
+                    continue;
+                }
+
+                // Read the value from the register (or immediate) instead of memory.
+                if (dest.kind == OperandKind::MEM && inst.operands[0] == dest && source.kind != OperandKind::MEM
+                    && ReadsOnlySource(inst) && inst.operands[1] != dest
+                    && (source.kind == OperandKind::REG || AcceptsImmediateSource(inst)))
+                {
+                    inst.operands[0] = source;
+                    Hit(PeepholePattern::REDUNDANT_LOAD);
+                    changed = true;
+                }
+
+                Effects effects = GetEffects(inst);
+                if ((effects.writes & watched)
+                    || (source.kind == OperandKind::MEM && AccessesMemory(j, sourceAddress, source.size, false, true))
+                    || (dest.kind == OperandKind::MEM && AccessesMemory(j, destAddress, dest.size, false, true)))
+                {
+                    break;
+                }
+            }
+
+            return changed;
+        }
+
+        bool PeepholeOptimizer::RemoveDeadStore(size_t i)
+        {
+            std::vector<Instruction>& insts = *m_Insts;
+            const Instruction& store = insts[i];
+
+            if (store.op != Opcode::MOV || store.operands[1].kind != OperandKind::MEM)
+            {
+                return false;
+            }
+
+            const Operand dest = store.operands[1];
+            const std::optional<int32_t> address = GetAddress(i, dest);
+
+            if (!address.has_value())
+            {
+                return false;
+            }
+
+            size_t j = Next(i);
+            for (size_t count = 0; j < insts.size() && count < m_Window; j = Next(j), count++)
+            {
+                const Instruction& inst = insts[j];
+
+                // Locals below %ebp die with the frame, at the latest once %esp is reset to %ebp.
+                // Without a frame, locals below the return address die at the ret.
+                bool tearsDownFrame = inst.op == Opcode::MOV && IsRegister(inst.operands[0], Register::EBP)
+                    && IsRegister(inst.operands[1], Register::ESP);
+
+                if ((inst.op == Opcode::RET || tearsDownFrame) && *address < 0)
+                {
+                    Kill(i);
+                    Hit(PeepholePattern::DEAD_STORE);
+                    return true;
+                }
+
+                if (IsBarrier(inst) || AccessesMemory(j, address, dest.size, true, false)
+                    || (GetEffects(inst).writes & MaskOf(Register::EBP)))
+                {
+                    return false;
+                }
+
+                if (inst.op == Opcode::MOV && inst.operands[1].kind == OperandKind::MEM
+                    && inst.operands[1].size == dest.size && GetAddress(j, inst.operands[1]) == address)
+                {
+                    Kill(i);
+                    Hit(PeepholePattern::DEAD_STORE);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool PeepholeOptimizer::RemoveDeadMove(size_t i)
+        {
+            const Instruction& inst = (*m_Insts)[i];
+
+            if ((inst.op != Opcode::MOV && inst.op != Opcode::MOVZB)
+                || inst.operands[1].kind != OperandKind::REG
+                || !IsDeadAfter(i, inst.operands[1].reg))
+            {
+                return false;
+            }
+
+            Kill(i);
+            Hit(PeepholePattern::DEAD_MOVE);
+            return true;
+        }
+
+        void PeepholeOptimizer::Hit(PeepholePattern pattern)
+        {
+            m_Hits[static_cast<size_t>(pattern)]++;
+        }
+
+        void PeepholeOptimizer::Kill(size_t i)
+        {
+            m_Dead[i] = true;
+        }
+
+        size_t PeepholeOptimizer::Next(size_t i) const
+        {
+            const std::vector<Instruction>& insts = *m_Insts;
+
+            for (i++; i < insts.size(); i++)
+            {
+                if (!m_Dead[i] && insts[i].op != Opcode::COMMENT && insts[i].op != Opcode::BLANK)
+                {
+                    break;
+                }
+            }
+
+            return i;
+        }
+
+        bool PeepholeOptimizer::IsBarrier(const Instruction& inst) const
+        {
+            switch (inst.op)
+            {
+            case Opcode::LABEL:
+            case Opcode::GLOBL:
+            case Opcode::JMP:
+            case Opcode::JCC:
+            case Opcode::CALL:
+            case Opcode::RET:
+            case Opcode::INT:
+            case Opcode::SYSCALL:
+                return true;
+
+            default:
+                return false;
+            }
+        }
+
+        bool PeepholeOptimizer::IsDeadAfter(size_t i, Register reg) const
+        {
+            const std::vector<Instruction>& insts = *m_Insts;
+
+            size_t j = Next(i);
+            for (size_t count = 0; j < insts.size() && count < m_Window; j = Next(j), count++)
+            {
+                const Instruction& inst = insts[j];
+
+                if (inst.op == Opcode::RET)
+                {
+                    return !(gc_LiveAtReturn & MaskOf(reg));
+                }
+
+                if (IsBarrier(inst))
+                {
+                    return false;
+                }
+
+                Effects effects = GetEffects(inst);
+                if (effects.reads & MaskOf(reg))
+                {
+                    return false;
+                }
+
+                if (effects.writes & MaskOf(reg))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        std::optional<int32_t> PeepholeOptimizer::GetAddress(size_t i, const Operand& operand) const
+        {
+            if (operand.kind != OperandKind::MEM || operand.index != Register::NONE)
+            {
+                return std::nullopt;
+            }
+
+            if (operand.reg == Register::EBP)
+            {
+                return operand.value;
+            }
+
+            if (operand.reg == Register::ESP && m_StackOffsets[i].has_value())
+            {
+                return *m_StackOffsets[i] + operand.value;
+            }
+
+            return std::nullopt;
+        }
+
+        void PeepholeOptimizer::GetMemoryAccesses(size_t i, std::vector<MemoryAccess>& accesses) const
+        {
+            const Instruction& inst = (*m_Insts)[i];
+            const std::optional<int32_t> offset = m_StackOffsets[i];
+
+            accesses.clear();
+
+            switch (inst.op)
+            {
+            case Opcode::PUSH:
+                accesses.push_back({ offset.has_value() ? std::optional<int32_t>(*offset - m_WordSize) : std::nullopt,
+                                     static_cast<uint8_t>(m_WordSize), false, true });
+                break;
+
+            case Opcode::POP:
+            case Opcode::RET:
+                accesses.push_back({ offset, static_cast<uint8_t>(m_WordSize), true, false });
+                break;
+
+            case Opcode::CALL:
+            case Opcode::INT:
+            case Opcode::SYSCALL:
+                accesses.push_back({ std::nullopt, static_cast<uint8_t>(m_WordSize), true, true });
+                break;
+
+            default:
+                break;
+            }
+
+            Effects effects = GetEffects(inst);
+            size_t count = inst.GetOperandCount();
+
+            for (size_t k = 0; k < count; k++)
+            {
+                const Operand& operand = inst.operands[k];
+                if (operand.kind != OperandKind::MEM || inst.op == Opcode::LEA)
+                {
+                    continue;
+                }
+
+                // The last operand of a writing instruction is its destination.
+                bool isDest = k == count - 1 && effects.writesMemory
+                    && inst.op != Opcode::PUSH && inst.op != Opcode::CMP && inst.op != Opcode::TEST;
+                bool readsDest = inst.op != Opcode::MOV && inst.op != Opcode::MOVZB
+                    && inst.op != Opcode::SETCC && inst.op != Opcode::POP;
+
+                accesses.push_back({ GetAddress(i, operand), operand.size, !isDest || readsDest, isDest });
+            }
+        }
+
+        bool PeepholeOptimizer::MayAlias(const MemoryAccess& a, std::optional<int32_t> address, uint8_t size) const
+        {
+            if (!a.address.has_value() || !address.has_value())
+            {
+                return true;
+            }
+
+            return *a.address < *address + size && *address < *a.address + a.size;
+        }
+
+        bool PeepholeOptimizer::AccessesMemory(size_t i, std::optional<int32_t> address, uint8_t size,
+                                               bool reads, bool writes) const
+        {
+            std::vector<MemoryAccess> accesses;
+            GetMemoryAccesses(i, accesses);
+
+            for (const MemoryAccess& access : accesses)
+            {
+                if (((reads && access.read) || (writes && access.write)) && MayAlias(access, address, size))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    } // namespace Asm
+} // namespace CComp
@@ -0,0 +1,97 @@
+#ifndef CCOMP_ASM_PEEPHOLE_HPP
+#define CCOMP_ASM_PEEPHOLE_HPP
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "Asm.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        enum class PeepholePattern
+        {
+            REDUNDANT_MOVE,     // movl %eax, %eax, or a copy that is already in place.
+            REDUNDANT_LOAD,     // A load of a value that is still in a register.
+            DEAD_STORE,         // A store overwritten or discarded before it is read.
+            DEAD_MOVE,          // A register write that is never read.
+            FOLD_IMMEDIATE,     // movl $k, %reg; op %reg, x  ->  op $k, x
+            PUSH_POP,           // pushl x; ...; popl %reg  ->  movl x, %reg; ...
+            UNREACHABLE,        // Instructions after jmp or ret that no label leads to.
+            JUMP_TO_NEXT,       // jmp to the label that follows.
+            BRANCH_INVERSION,   // jcc L1; jmp L2; L1:  ->  jncc L2; L1:
+
+            COUNT,
+        }; // enum class PeepholePattern
+
+        const char* PeepholePatternToString(PeepholePattern pattern);
+
+        constexpr size_t gc_DefaultPeepholeWindow = 16;
+
+        // Rewrites short instruction sequences in place until none of the patterns applies.
+        // Patterns look at most `window` instructions ahead and never across labels or jumps.
+        class PeepholeOptimizer
+        {
+        public:
+            explicit PeepholeOptimizer(size_t window = gc_DefaultPeepholeWindow, Target target = Target::I386);
+
+            void Run(std::vector<Instruction>& insts);
+
+            size_t GetHitCount(PeepholePattern pattern) const
+            { return m_Hits[static_cast<size_t>(pattern)]; }
+
+        private:
+            // A memory access with its address relative to %ebp, if that is known.
+            struct MemoryAccess
+            {
+                std::optional<int32_t> address;
+                uint8_t size;
+                bool read;
+                bool write;
+            }; // struct MemoryAccess
+
+            size_t m_Window;
+            // Bytes moved by push and pop.
+            int32_t m_WordSize;
+            std::array<size_t, static_cast<size_t>(PeepholePattern::COUNT)> m_Hits = {};
+
+            std::vector<Instruction>* m_Insts = nullptr;
+            std::vector<bool> m_Dead;
+
+            // %esp - %ebp before each instruction, where it is known. Until a frame pointer
+            // is set up, %esp at the function's entry stands in for %ebp.
+            std::vector<std::optional<int32_t>> m_StackOffsets;
+
+            bool RunOnce();
+            void ComputeStackOffsets();
+
+            bool RemoveUnreachable(size_t i);
+            bool SimplifyJump(size_t i);
+            bool PairPushPop(size_t i);
+            // Grows the frame's subl by the save slot of a push/pop pair about to be removed.
+            bool ExtendFrameAllocation(size_t push, size_t pop);
+            bool FoldImmediate(size_t i);
+            bool ForwardCopy(size_t i);
+            bool RemoveDeadStore(size_t i);
+            bool RemoveDeadMove(size_t i);
+
+            void Hit(PeepholePattern pattern);
+            void Kill(size_t i);
+
+            // Next live instruction that is not a comment or blank line.
+            size_t Next(size_t i) const;
+            bool IsBarrier(const Instruction& inst) const;
+
+            bool IsDeadAfter(size_t i, Register reg) const;
+
+            std::optional<int32_t> GetAddress(size_t i, const Operand& operand) const;
+            void GetMemoryAccesses(size_t i, std::vector<MemoryAccess>& accesses) const;
+            bool MayAlias(const MemoryAccess& a, std::optional<int32_t> address, uint8_t size) const;
+            bool AccessesMemory(size_t i, std::optional<int32_t> address, uint8_t size, bool reads, bool writes) const;
+        }; // class PeepholeOptimizer
+    } // namespace Asm
+} // namespace CComp
+
+#endif // CCOMP_ASM_PEEPHOLE_HPP
@@ -0,0 +1,215 @@
+#include "Printer.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        namespace
+        {
+            // Big enough for any one instruction, so printing a single one costs no large allocation.
+            constexpr size_t gc_InstructionBufferSize = 256;
+
+            // Without the size suffix, which Suffix decides.
+            const char* Mnemonic(Opcode op)
+            {
+                switch (op)
+                {
+                case Opcode::MOV:     return "mov";
+                case Opcode::MOVZB:   return "movzb";
+                case Opcode::LEA:     return "lea";
+                case Opcode::ADD:     return "add";
+                case Opcode::SUB:     return "sub";
+                case Opcode::IMUL:    return "imul";
+                case Opcode::IDIV:    return "idiv";
+                case Opcode::CDQ:     return "cdq";
+                case Opcode::AND:     return "and";
+                case Opcode::OR:      return "or";
+                case Opcode::XOR:     return "xor";
+                case Opcode::SAL:     return "sal";
+                case Opcode::SAR:     return "sar";
+                case Opcode::SHR:     return "shr";
+                case Opcode::NEG:     return "neg";
+                case Opcode::NOT:     return "not";
+                case Opcode::INC:     return "inc";
+                case Opcode::DEC:     return "dec";
+                case Opcode::CMP:     return "cmp";
+                case Opcode::TEST:    return "test";
+                case Opcode::PUSH:    return "push";
+                case Opcode::POP:     return "pop";
+                case Opcode::JMP:     return "jmp";
+                case Opcode::CALL:    return "call";
+                case Opcode::RET:     return "ret";
+                case Opcode::INT:     return "int";
+                case Opcode::SYSCALL: return "syscall";
+                default:              return "<unknown>";
+                }
+            }
+
+            // Operations on a 64-bit register are quadword ones; everything else works on 32 bits.
+            const char* Suffix(const Instruction& inst)
+            {
+                switch (inst.op)
+                {
+                case Opcode::CDQ:
+                case Opcode::JMP:
+                case Opcode::CALL:
+                case Opcode::RET:
+                case Opcode::INT:
+                case Opcode::SYSCALL:
+                    return "";
+
+                default:
+                    break;
+                }
+
+                for (const Operand& operand : inst.operands)
+                {
+                    if (operand.kind == OperandKind::REG && operand.size == 8)
+                    {
+                        return "q";
+                    }
+                }
+
+                return "l";
+            }
+
+            void PrintOperand(OutputBuffer& out, const Operand& operand, bool hex, uint8_t addressSize)
+            {
+                switch (operand.kind)
+                {
+                case OperandKind::NONE:
+                    break;
+
+                case OperandKind::REG:
+                    out.Put(RegisterToString(operand.reg, operand.size));
+                    break;
+
+                case OperandKind::IMM:
+                    if (hex)
+                    {
+                        out.Put("$0x", 3);
+                        out.PutHex(static_cast<uint32_t>(operand.value));
+                    }
+                    else
+                    {
+                        out.Put('$');
+                        out.PutInt(operand.value);
+                    }
+                    break;
+
+                case OperandKind::MEM:
+                    if (operand.value != 0)
+                    {
+                        out.PutInt(operand.value);
+                    }
+                    out.Put('(');
+                    if (operand.reg != Register::NONE)
+                    {
+                        out.Put(RegisterToString(operand.reg, addressSize));
+                    }
+                    if (operand.index != Register::NONE)
+                    {
+                        out.Put(',');
+                        out.Put(RegisterToString(operand.index, addressSize));
+                        out.Put(',');
+                        out.PutInt(operand.scale);
+                    }
+                    out.Put(')');
+                    break;
+                }
+            }
+        } // namespace
+
+        void PrintInstruction(OutputBuffer& out, const Instruction& inst, Target target)
+        {
+            switch (inst.op)
+            {
+            case Opcode::LABEL:
+                out.Put(inst.label);
+                out.Put(":\n", 2);
+                return;
+
+            case Opcode::GLOBL:
+                out.Put(".globl ", 7);
+                out.Put(inst.label);
+                out.Put('\n');
+                return;
+
+            case Opcode::COMMENT:
+                out.Put("# ", 2);
+                out.Put(inst.label);
+                out.Put('\n');
+                return;
+
+            case Opcode::BLANK:
+                out.Put('\n');
+                return;
+
+            default:
+                break;
+            }
+
+            out.Indent(1);
+
+            if (inst.op == Opcode::SETCC)
+            {
+                out.Put("set", 3);
+                out.Put(CondToString(inst.cond));
+            }
+            else if (inst.op == Opcode::JCC)
+            {
+                out.Put('j');
+                out.Put(CondToString(inst.cond));
+            }
+            else
+            {
+                out.Put(Mnemonic(inst.op));
+                out.Put(Suffix(inst));
+            }
+
+            if (inst.op == Opcode::JMP || inst.op == Opcode::JCC || inst.op == Opcode::CALL)
+            {
+                out.Put(' ');
+                out.Put(inst.label);
+            }
+
+            for (size_t i = 0; i < inst.GetOperandCount(); i++)
+            {
+                if (i == 0)
+                {
+                    out.Put(' ');
+                }
+                else
+                {
+                    out.Put(", ", 2);
+                }
+
+                PrintOperand(out, inst.operands[i], inst.op == Opcode::INT, GetWordSize(target));
+            }
+
+            out.Put('\n');
+        }
+
+        void PrintInstructions(OutputBuffer& out, const std::vector<Instruction>& insts, Target target)
+        {
+            for (const Instruction& inst : insts)
+            {
+                PrintInstruction(out, inst, target);
+            }
+        }
+
+        void PrintInstruction(std::ostream& out, const Instruction& inst, Target target)
+        {
+            OutputBuffer buf(out, gc_InstructionBufferSize);
+
+            PrintInstruction(buf, inst, target);
+        }
+
+        void PrintInstructions(std::ostream& out, const std::vector<Instruction>& insts, Target target)
+        {
+            OutputBuffer buf(out);
+
+            PrintInstructions(buf, insts, target);
+        }
+    } // namespace Asm
+} // namespace CComp
@@ -0,0 +1,25 @@
+#ifndef CCOMP_ASM_PRINTER_HPP
+#define CCOMP_ASM_PRINTER_HPP
+
+#include <ostream>
+#include <vector>
+
+#include "Asm.hpp"
+#include "../File/OutputBuffer.hpp"
+
+namespace CComp
+{
+    namespace Asm
+    {
+        // AT&T syntax, labels and directives unindented. Addresses are formed from
+        // registers of the target's word size.
+        void PrintInstruction(OutputBuffer& out, const Instruction& inst, Target target = Target::I386);
+        void PrintInstructions(OutputBuffer& out, const std::vector<Instruction>& insts, Target target = Target::I386);
+
+        // The same through a buffer of their own, flushed to out once at the end.
+        void PrintInstruction(std::ostream& out, const Instruction& inst, Target target = Target::I386);
+        void PrintInstructions(std::ostream& out, const std::vector<Instruction>& insts, Target target = Target::I386);
+    } // namespace Asm
+} // namespace CComp
+
+#endif // CCOMP_ASM_PRINTER_HPP
@@ -0,0 +1,77 @@
+#include "FrameLayout.hpp"
+
+#include <utility>
+
+namespace CComp
+{
+    using Asm::Opcode;
+    using Asm::Register;
+    using Asm::Reg;
+    using Asm::Imm;
+
+    namespace
+    {
+        // Every slot holds an int, whatever the word size.
+        constexpr int gc_SlotSize = 4;
+    } // namespace
+
+    FrameLayout::FrameLayout(size_t slotCount, std::vector<Register> savedRegisters, Asm::Target target, bool useRedZone)
+        : m_SlotCount(slotCount), m_SavedRegisters(std::move(savedRegisters)), m_Target(target)
+    {
+        int slots = static_cast<int>(m_SlotCount) * gc_SlotSize;
+
+        m_UsesRedZone = useRedZone && target == Asm::Target::X86_64 && slots <= gc_RedZoneSize;
+
+        if (!HasFrame())
+        {
+            return;
+        }
+
+        // The call pushed the return address onto an aligned stack; count everything
+        // pushed or reserved since then and round the reservation up to alignment.
+        int wordSize = Asm::GetWordSize(target);
+        int used = wordSize * 2 + slots + static_cast<int>(m_SavedRegisters.size()) * wordSize;
+        int padding = (gc_StackAlignment - used % gc_StackAlignment) % gc_StackAlignment;
+
+        m_AllocationSize = slots + padding;
+    }
+
+    int FrameLayout::GetSlotOffset(size_t slot)
+    {
+        return -static_cast<int>(slot + 1) * gc_SlotSize;
+    }
+
+    void FrameLayout::EmitProlog(std::vector<Asm::Instruction>& out) const
+    {
+        if (HasFrame())
+        {
+            out.emplace_back(Opcode::PUSH, WordReg(Register::EBP));
+            out.emplace_back(Opcode::MOV, WordReg(Register::ESP), WordReg(Register::EBP));
+            out.emplace_back(Opcode::SUB, Imm(m_AllocationSize), WordReg(Register::ESP));
+        }
+
+        for (Register reg : m_SavedRegisters)
+        {
+            out.emplace_back(Opcode::PUSH, WordReg(reg));
+        }
+    }
+
+    void FrameLayout::EmitEpilog(std::vector<Asm::Instruction>& out) const
+    {
+        for (auto reg = m_SavedRegisters.rbegin(); reg != m_SavedRegisters.rend(); ++reg)
+        {
+            out.emplace_back(Opcode::POP, WordReg(*reg));
+        }
+
+        if (HasFrame())
+        {
+            out.emplace_back(Opcode::MOV, WordReg(Register::EBP), WordReg(Register::ESP));
+            out.emplace_back(Opcode::POP, WordReg(Register::EBP));
+        }
+    }
+
+    Asm::Operand FrameLayout::WordReg(Register reg) const
+    {
+        return m_Target == Asm::Target::X86_64 ? Asm::QuadReg(reg) : Reg(reg);
+    }
+} // namespace CComp
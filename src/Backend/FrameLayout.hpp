@@ -0,0 +1,80 @@
+#ifndef CCOMP_FRAME_LAYOUT_HPP
+#define CCOMP_FRAME_LAYOUT_HPP
+
+#include <vector>
+
+#include "../Asm/Asm.hpp"
+
+namespace CComp
+{
+    // Both System V ABIs keep %esp 16-byte aligned at every call.
+    constexpr int gc_StackAlignment = 16;
+
+    // Bytes below %rsp that the x86-64 ABI leaves alone, even for signal handlers.
+    constexpr int gc_RedZoneSize = 128;
+
+    // Stack frame shared by the code generators:
+    //
+    //     return address
+    //     saved %ebp            <- %ebp
+    //     slot 0                -4(%ebp)
+    //     slot 1                -8(%ebp)
+    //     ...
+    //     padding
+    //     saved registers       <- %esp in the body, 16-byte aligned
+    //
+    // Slots and padding are allocated by one subl. A function without slots
+    // addresses nothing on the stack, so it only saves registers and keeps no frame.
+    //
+    // An x86-64 leaf function whose slots fit in the red zone needs no frame either:
+    //
+    //     return address
+    //     saved registers       <- %rsp in the body
+    //     slot 0                -4(%rsp)
+    //     slot 1                -8(%rsp)
+    //     ...
+    class FrameLayout
+    {
+    public:
+        FrameLayout(size_t slotCount = 0, std::vector<Asm::Register> savedRegisters = {},
+                    Asm::Target target = Asm::Target::I386, bool useRedZone = false);
+
+        // Slot offsets do not depend on the rest of the layout, so code can be
+        // generated before it is known which registers need saving.
+        static int GetSlotOffset(size_t slot);
+
+        bool HasFrame() const
+        { return m_SlotCount != 0 && !m_UsesRedZone; }
+
+        bool UsesRedZone() const
+        { return m_UsesRedZone; }
+
+        // The register slot offsets are relative to.
+        Asm::Register GetSlotBase() const
+        { return m_UsesRedZone ? Asm::Register::ESP : Asm::Register::EBP; }
+
+        // Bytes reserved below the saved %ebp: slots and alignment padding.
+        int GetAllocationSize() const
+        { return m_AllocationSize; }
+
+        const std::vector<Asm::Register>& GetSavedRegisters() const
+        { return m_SavedRegisters; }
+
+        void EmitProlog(std::vector<Asm::Instruction>& out) const;
+
+        // Everything up to, but not including, the ret.
+        void EmitEpilog(std::vector<Asm::Instruction>& out) const;
+
+    private:
+        size_t m_SlotCount;
+        std::vector<Asm::Register> m_SavedRegisters;
+        Asm::Target m_Target;
+        bool m_UsesRedZone = false;
+        int m_AllocationSize = 0;
+
+        // A register as push, pop and the frame pointer moves see it.
+        Asm::Operand WordReg(Asm::Register reg) const;
+    }; // class FrameLayout
+} // namespace CComp
+
+#endif // CCOMP_FRAME_LAYOUT_HPP
@@ -0,0 +1,352 @@
+#include "InstructionSelection.hpp"
+
+#include <iterator>
+
+namespace CComp
+{
+    namespace
+    {
+        using NT = Nonterminal;
+        using Action = SelectionAction;
+
+        constexpr size_t gc_TreeOpCount = static_cast<size_t>(TreeOp::COUNT);
+
+        constexpr size_t ArityOf(TreeOp op)
+        {
+            switch (op)
+            {
+            case TreeOp::CONST:
+            case TreeOp::ZERO:
+            case TreeOp::SCALE:
+            case TreeOp::VAR:
+            case TreeOp::OTHER:
+            case TreeOp::COUNT:
+                return 0;
+
+            case TreeOp::UNARY:
+            case TreeOp::LOGIC_NOT:
+            case TreeOp::STEP:
+                return 1;
+
+            default:
+                return 2;
+            }
+        }
+
+        constexpr SelectionRule Rule(NT lhs, TreeOp op, uint8_t cost, Action action)
+        {
+            return { lhs, op, { NT::COUNT, NT::COUNT }, cost, action };
+        }
+
+        constexpr SelectionRule Rule(NT lhs, TreeOp op, NT kid, uint8_t cost, Action action)
+        {
+            return { lhs, op, { kid, NT::COUNT }, cost, action };
+        }
+
+        constexpr SelectionRule Rule(NT lhs, TreeOp op, NT left, NT right, uint8_t cost, Action action)
+        {
+            return { lhs, op, { left, right }, cost, action };
+        }
+
+        constexpr SelectionRule Chain(NT lhs, NT from, uint8_t cost, Action action)
+        {
+            return { lhs, TreeOp::COUNT, { from, NT::COUNT }, cost, action };
+        }
+
+        // The grammar. Of two rules with the same cost the one listed first wins.
+        constexpr SelectionRule gc_Rules[] =
+        {
+            // Operands.
+            Rule(NT::IMM,    TreeOp::CONST, 0, Action::NONE),
+            Rule(NT::IMM,    TreeOp::ZERO,  0, Action::NONE),
+            Rule(NT::IMM,    TreeOp::SCALE, 0, Action::NONE),
+            Rule(NT::ZERO,   TreeOp::ZERO,  0, Action::NONE),
+            Rule(NT::FACTOR, TreeOp::SCALE, 0, Action::NONE),
+            Rule(NT::MEM,    TreeOp::VAR,   0, Action::NONE),
+            Rule(NT::REG,    TreeOp::OTHER, 0, Action::VISIT),
+
+            // Processors recognize the xor as zeroing and execute it without a unit.
+            Rule(NT::REG, TreeOp::ZERO, 1, Action::CLEAR),
+
+            Chain(NT::REG,   NT::IMM,   2, Action::MOVE),
+            Chain(NT::REG,   NT::MEM,   3, Action::MOVE),
+            Chain(NT::REG,   NT::INDEX, 2, Action::SCALE),
+            Chain(NT::REG,   NT::FLAGS, 4, Action::SET),
+            Chain(NT::FLAGS, NT::REG,   2, Action::TEST),
+            Chain(NT::FLAGS, NT::MEM,   3, Action::COMPARE_ZERO),
+            Chain(NT::STMT,  NT::REG,   0, Action::NONE),
+
+            // Both operands in registers: the right one is pushed while the left one is
+            // computed, then popped into %ebx.
+            Rule(NT::REG, TreeOp::ADD, NT::REG,   NT::IMM,   2, Action::ALU),
+            Rule(NT::REG, TreeOp::ADD, NT::IMM,   NT::REG,   2, Action::ALU),
+            Rule(NT::REG, TreeOp::ADD, NT::REG,   NT::MEM,   3, Action::ALU),
+            Rule(NT::REG, TreeOp::ADD, NT::MEM,   NT::REG,   3, Action::ALU),
+            Rule(NT::REG, TreeOp::ADD, NT::REG,   NT::REG,   8, Action::ALU),
+            Rule(NT::REG, TreeOp::ADD, NT::INDEX, NT::IMM,   2, Action::LEA),
+            Rule(NT::REG, TreeOp::ADD, NT::IMM,   NT::INDEX, 2, Action::LEA),
+            Rule(NT::REG, TreeOp::ADD, NT::REG,   NT::INDEX, 8, Action::LEA),
+            Rule(NT::REG, TreeOp::ADD, NT::INDEX, NT::REG,   8, Action::LEA),
+
+            Rule(NT::REG, TreeOp::SUB, NT::REG,   NT::IMM, 2, Action::ALU),
+            Rule(NT::REG, TreeOp::SUB, NT::REG,   NT::MEM, 3, Action::ALU),
+            Rule(NT::REG, TreeOp::SUB, NT::REG,   NT::REG, 8, Action::ALU),
+            Rule(NT::REG, TreeOp::SUB, NT::MEM,   NT::REG, 5, Action::REVERSE_SUBTRACT),
+            Rule(NT::REG, TreeOp::SUB, NT::INDEX, NT::IMM, 2, Action::LEA),
+
+            Rule(NT::INDEX, TreeOp::MUL, NT::REG,    NT::FACTOR, 0, Action::NONE),
+            Rule(NT::INDEX, TreeOp::MUL, NT::FACTOR, NT::REG,    0, Action::NONE),
+            Rule(NT::REG,   TreeOp::MUL, NT::REG,    NT::IMM,    3, Action::MULTIPLY_CONSTANT),
+            Rule(NT::REG,   TreeOp::MUL, NT::IMM,    NT::REG,    3, Action::MULTIPLY_CONSTANT),
+            Rule(NT::REG,   TreeOp::MUL, NT::REG,    NT::MEM,    5, Action::ALU),
+            Rule(NT::REG,   TreeOp::MUL, NT::MEM,    NT::REG,    5, Action::ALU),
+            Rule(NT::REG,   TreeOp::MUL, NT::REG,    NT::REG,    10, Action::ALU),
+
+            Rule(NT::REG,   TreeOp::AND, NT::REG, NT::IMM, 2, Action::ALU),
+            Rule(NT::REG,   TreeOp::AND, NT::IMM, NT::REG, 2, Action::ALU),
+            Rule(NT::REG,   TreeOp::AND, NT::REG, NT::MEM, 3, Action::ALU),
+            Rule(NT::REG,   TreeOp::AND, NT::MEM, NT::REG, 3, Action::ALU),
+            Rule(NT::REG,   TreeOp::AND, NT::REG, NT::REG, 8, Action::ALU),
+            Rule(NT::FLAGS, TreeOp::AND, NT::REG, NT::IMM, 2, Action::TEST),
+            Rule(NT::FLAGS, TreeOp::AND, NT::IMM, NT::REG, 2, Action::TEST),
+            Rule(NT::FLAGS, TreeOp::AND, NT::MEM, NT::IMM, 3, Action::TEST),
+            Rule(NT::FLAGS, TreeOp::AND, NT::IMM, NT::MEM, 3, Action::TEST),
+
+            Rule(NT::REG, TreeOp::BITWISE, NT::REG, NT::IMM, 2, Action::ALU),
+            Rule(NT::REG, TreeOp::BITWISE, NT::IMM, NT::REG, 2, Action::ALU),
+            Rule(NT::REG, TreeOp::BITWISE, NT::REG, NT::MEM, 3, Action::ALU),
+            Rule(NT::REG, TreeOp::BITWISE, NT::MEM, NT::REG, 3, Action::ALU),
+            Rule(NT::REG, TreeOp::BITWISE, NT::REG, NT::REG, 8, Action::ALU),
+
+            Rule(NT::REG, TreeOp::UNARY, NT::REG, 2, Action::UNARY),
+
+            // Conditions.
+            Rule(NT::FLAGS, TreeOp::COMPARE, NT::REG, NT::ZERO, 2, Action::TEST),
+            Rule(NT::FLAGS, TreeOp::COMPARE, NT::REG, NT::IMM,  2, Action::COMPARE),
+            Rule(NT::FLAGS, TreeOp::COMPARE, NT::MEM, NT::IMM,  3, Action::COMPARE),
+            Rule(NT::FLAGS, TreeOp::COMPARE, NT::REG, NT::MEM,  3, Action::COMPARE),
+            Rule(NT::FLAGS, TreeOp::COMPARE, NT::REG, NT::REG,  8, Action::COMPARE),
+
+            Rule(NT::FLAGS, TreeOp::LOGIC_NOT, NT::FLAGS, 0, Action::INVERT),
+
+            // Assignments, read-modify-write where the value is not needed.
+            Rule(NT::STMT, TreeOp::ASSIGN, NT::MEM, NT::IMM, 3, Action::STORE),
+            Rule(NT::REG,  TreeOp::ASSIGN, NT::MEM, NT::REG, 3, Action::STORE),
+
+            Rule(NT::STMT, TreeOp::ASSIGN_ALU, NT::MEM, NT::IMM, 4, Action::ALU_MEMORY),
+            Rule(NT::STMT, TreeOp::ASSIGN_ALU, NT::MEM, NT::REG, 4, Action::ALU_MEMORY),
+
+            // Where the value is used, reading it back from memory waits for the store, which
+            // costs more than keeping it in %eax; the store after that is often dead.
+            Rule(NT::REG,  TreeOp::ASSIGN_ALU, NT::MEM, NT::IMM, 8, Action::ALU_REGISTER),
+            Rule(NT::REG,  TreeOp::ASSIGN_ALU, NT::MEM, NT::IMM, 9, Action::ALU_MEMORY_LOAD),
+            Rule(NT::REG,  TreeOp::ASSIGN_ALU, NT::MEM, NT::REG, 9, Action::ALU_MEMORY_LOAD),
+
+            Rule(NT::STMT, TreeOp::STEP, NT::MEM, 4, Action::STEP),
+            Rule(NT::REG,  TreeOp::STEP, NT::MEM, 7, Action::STEP_VALUE),
+        };
+
+        constexpr size_t gc_RuleCount = std::size(gc_Rules);
+
+        static_assert(gc_RuleCount <= UINT8_MAX, "rule indices must fit in SelectionState::rules");
+
+        // Rule indices sorted by operator; the chain rules come last, under TreeOp::COUNT.
+        struct RuleTable
+        {
+            std::array<uint8_t, gc_RuleCount> order;
+            std::array<size_t, gc_TreeOpCount + 2> begin;
+        }; // struct RuleTable
+
+        constexpr RuleTable BuildRuleTable()
+        {
+            RuleTable table = {};
+
+            std::array<size_t, gc_TreeOpCount + 1> counts = {};
+            for (const SelectionRule& rule : gc_Rules)
+            {
+                counts[static_cast<size_t>(rule.op)]++;
+            }
+
+            size_t start = 0;
+            for (size_t op = 0; op <= gc_TreeOpCount; op++)
+            {
+                table.begin[op] = start;
+                start += counts[op];
+            }
+            table.begin[gc_TreeOpCount + 1] = start;
+
+            std::array<size_t, gc_TreeOpCount + 1> next = {};
+            for (size_t op = 0; op <= gc_TreeOpCount; op++)
+            {
+                next[op] = table.begin[op];
+            }
+
+            for (size_t i = 0; i < gc_RuleCount; i++)
+            {
+                table.order[next[static_cast<size_t>(gc_Rules[i].op)]++] = static_cast<uint8_t>(i);
+            }
+
+            return table;
+        }
+
+        constexpr RuleTable gc_RuleTable = BuildRuleTable();
+
+        constexpr bool KidsMatchArity()
+        {
+            for (const SelectionRule& rule : gc_Rules)
+            {
+                size_t arity = rule.IsChain() ? 1 : ArityOf(rule.op);
+
+                for (size_t k = 0; k < 2; k++)
+                {
+                    if ((rule.kids[k] != NT::COUNT) != (k < arity))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        static_assert(KidsMatchArity(), "every rule must have one nonterminal per kid of its operator");
+
+        constexpr void Offer(SelectionState& state, NT nt, uint32_t cost, size_t rule)
+        {
+            size_t i = static_cast<size_t>(nt);
+
+            if (cost < state.costs[i])
+            {
+                state.costs[i] = cost;
+                state.rules[i] = static_cast<uint8_t>(rule);
+            }
+        }
+
+        constexpr uint32_t AddCost(uint32_t a, uint32_t b)
+        {
+            return a >= gc_NoMatch - b ? gc_NoMatch - 1 : a + b;
+        }
+
+        // Chains go in cycles, as REG to FLAGS and back, but never for free, so this stops.
+        constexpr void CloseOverChains(SelectionState& state)
+        {
+            bool changed = true;
+
+            while (changed)
+            {
+                changed = false;
+
+                for (size_t i = gc_RuleTable.begin[gc_TreeOpCount]; i < gc_RuleTable.begin[gc_TreeOpCount + 1]; i++)
+                {
+                    size_t index = gc_RuleTable.order[i];
+                    const SelectionRule& rule = gc_Rules[index];
+
+                    if (!state.Derives(rule.kids[0]))
+                    {
+                        continue;
+                    }
+
+                    uint32_t cost = AddCost(state.GetCost(rule.kids[0]), rule.cost);
+                    if (cost < state.GetCost(rule.lhs))
+                    {
+                        Offer(state, rule.lhs, cost, index);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        constexpr SelectionState Label(TreeOp op, const SelectionState& left, const SelectionState& right)
+        {
+            SelectionState state;
+            const SelectionState* kids[2] = { &left, &right };
+
+            size_t opIndex = static_cast<size_t>(op);
+            for (size_t i = gc_RuleTable.begin[opIndex]; i < gc_RuleTable.begin[opIndex + 1]; i++)
+            {
+                size_t index = gc_RuleTable.order[i];
+                const SelectionRule& rule = gc_Rules[index];
+
+                uint32_t cost = rule.cost;
+                bool matches = true;
+
+                for (size_t k = 0; k < ArityOf(op); k++)
+                {
+                    if (!kids[k]->Derives(rule.kids[k]))
+                    {
+                        matches = false;
+                        break;
+                    }
+
+                    cost = AddCost(cost, kids[k]->GetCost(rule.kids[k]));
+                }
+
+                if (matches)
+                {
+                    Offer(state, rule.lhs, cost, index);
+                }
+            }
+
+            CloseOverChains(state);
+            return state;
+        }
+
+        constexpr std::array<SelectionState, gc_TreeOpCount> BuildLeafStates()
+        {
+            std::array<SelectionState, gc_TreeOpCount> states = {};
+
+            for (size_t op = 0; op < gc_TreeOpCount; op++)
+            {
+                if (ArityOf(static_cast<TreeOp>(op)) == 0)
+                {
+                    states[op] = Label(static_cast<TreeOp>(op), SelectionState(), SelectionState());
+                }
+            }
+
+            return states;
+        }
+
+        constexpr std::array<SelectionState, gc_TreeOpCount> gc_LeafStates = BuildLeafStates();
+
+        // A leaf can stand wherever an expression can: as a value, a condition or a statement.
+        constexpr bool LeavesAreCovered()
+        {
+            for (size_t op = 0; op < gc_TreeOpCount; op++)
+            {
+                const SelectionState& state = gc_LeafStates[op];
+
+                if (ArityOf(static_cast<TreeOp>(op)) == 0
+                    && !(state.Derives(NT::REG) && state.Derives(NT::FLAGS) && state.Derives(NT::STMT)))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        static_assert(LeavesAreCovered(), "every leaf must derive REG, FLAGS and STMT");
+        static_assert(gc_LeafStates[static_cast<size_t>(TreeOp::ZERO)].GetCost(NT::REG) == 1,
+                      "0 must be loaded with xorl");
+    } // namespace
+
+    size_t GetArity(TreeOp op)
+    {
+        return ArityOf(op);
+    }
+
+    const SelectionRule& GetSelectionRule(uint8_t index)
+    {
+        return gc_Rules[index];
+    }
+
+    const SelectionState& GetLeafState(TreeOp op)
+    {
+        return gc_LeafStates[static_cast<size_t>(op)];
+    }
+
+    SelectionState LabelNode(TreeOp op, const SelectionState& left, const SelectionState& right)
+    {
+        return Label(op, left, right);
+    }
+} // namespace CComp
@@ -0,0 +1,137 @@
+#ifndef CCOMP_INSTRUCTION_SELECTION_HPP
+#define CCOMP_INSTRUCTION_SELECTION_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace CComp
+{
+    // Bottom-up rewrite instruction selection over expression trees. Every node is
+    // labelled, leaves first, with the cheapest rule that derives each nonterminal
+    // from it; the code is then emitted top-down from the rules chosen for the goal.
+    // The rules are declared in InstructionSelection.cpp and grouped into lookup
+    // tables at compile time, as are the states of the leaves.
+
+    // Operators the grammar covers. A code generator maps its trees onto them;
+    // anything else is OTHER, a leaf it generates on its own.
+    enum class TreeOp : uint8_t
+    {
+        CONST,      // Any other literal.
+        ZERO,       // The literal 0.
+        SCALE,      // The literals 2, 4 and 8.
+        VAR,        // A local variable.
+
+        ADD,
+        SUB,
+        MUL,
+        AND,
+        BITWISE,    // | and ^.
+        UNARY,      // - and ~.
+        COMPARE,    // ==, !=, <, <=, > and >=.
+        LOGIC_NOT,
+
+        ASSIGN,     // local = value
+        ASSIGN_ALU, // local += value, and -=, &=, |=, ^=.
+        STEP,       // ++ and --, either side.
+
+        OTHER,
+
+        COUNT
+    }; // enum class TreeOp
+
+    // What a subtree can be turned into.
+    enum class Nonterminal : uint8_t
+    {
+        STMT,       // Code run for its effect only.
+        REG,        // The value in %eax.
+        FLAGS,      // A condition in the flags.
+        IMM,        // An immediate operand.
+        ZERO,       // The immediate 0.
+        FACTOR,     // An immediate usable as an index scale.
+        MEM,        // A local's stack slot as an operand.
+        INDEX,      // A value in a register still to be scaled by a FACTOR.
+
+        COUNT
+    }; // enum class Nonterminal
+
+    // The code a rule emits once its operands are in place.
+    enum class SelectionAction : uint8_t
+    {
+        NONE,               // An operand, or part of a bigger pattern.
+        VISIT,              // A subtree outside the grammar.
+        CLEAR,              // xorl %eax, %eax
+        MOVE,               // movl operand, %eax
+        SCALE,              // sall $log2(factor), %eax
+        SET,                // setcc %al; movzbl %al, %eax
+        TEST,               // testl (mask|%eax), operand
+        COMPARE,            // cmpl right, left
+        COMPARE_ZERO,       // cmpl $0, operand
+        INVERT,             // The operand's condition, inverted.
+        ALU,                // op source, %eax
+        REVERSE_SUBTRACT,   // negl %eax; addl left, %eax
+        MULTIPLY_CONSTANT,  // Shifts and lea instead of imull where cheaper.
+        LEA,                // leal disp(base, index, factor), %eax
+        UNARY,              // negl or notl %eax
+        STORE,              // movl source, local
+        ALU_MEMORY,         // op source, local
+        ALU_MEMORY_LOAD,    // op source, local; movl local, %eax
+        ALU_REGISTER,       // movl local, %eax; op source, %eax; movl %eax, local
+        STEP,               // incl or decl local
+        STEP_VALUE,         // ++ or -- with its value in %eax.
+    }; // enum class SelectionAction
+
+    struct SelectionRule
+    {
+        Nonterminal lhs;
+        TreeOp op;              // TreeOp::COUNT for a chain rule, which derives lhs from kids[0] of the same node.
+        Nonterminal kids[2];
+        uint8_t cost;           // Two per instruction and one per memory access it makes.
+        SelectionAction action;
+
+        constexpr bool IsChain() const
+        { return op == TreeOp::COUNT; }
+    }; // struct SelectionRule
+
+    constexpr uint32_t gc_NoMatch = UINT32_MAX;
+
+    constexpr size_t gc_NonterminalCount = static_cast<size_t>(Nonterminal::COUNT);
+
+    // The cheapest derivation of every nonterminal from one node.
+    struct SelectionState
+    {
+        std::array<uint32_t, gc_NonterminalCount> costs;
+        std::array<uint8_t, gc_NonterminalCount> rules;
+
+        constexpr SelectionState()
+            : costs(), rules()
+        {
+            for (uint32_t& cost : costs)
+            {
+                cost = gc_NoMatch;
+            }
+        }
+
+        constexpr bool Derives(Nonterminal nt) const
+        { return costs[static_cast<size_t>(nt)] != gc_NoMatch; }
+
+        constexpr uint32_t GetCost(Nonterminal nt) const
+        { return costs[static_cast<size_t>(nt)]; }
+
+        constexpr uint8_t GetRule(Nonterminal nt) const
+        { return rules[static_cast<size_t>(nt)]; }
+    }; // struct SelectionState
+
+    // Number of kids a node of op has.
+    size_t GetArity(TreeOp op);
+
+    const SelectionRule& GetSelectionRule(uint8_t index);
+
+    // State of a leaf, from the tables.
+    const SelectionState& GetLeafState(TreeOp op);
+
+    // State of a node from those of its kids; right is ignored for unary operators.
+    SelectionState LabelNode(TreeOp op, const SelectionState& left, const SelectionState& right = SelectionState());
+} // namespace CComp
+
+#endif // CCOMP_INSTRUCTION_SELECTION_HPP
@@ -0,0 +1,351 @@
+#include "LinearScan.hpp"
+
+#include <algorithm>
+
+namespace CComp
+{
+    namespace
+    {
+        // Dense bit set over value ids, used for block liveness.
+        class ValueSet
+        {
+        public:
+            explicit ValueSet(size_t size = 0)
+                : m_Words((size + 63) / 64, 0)
+            {}
+
+            bool Contains(IR::ValueId value) const
+            { return (m_Words[value / 64] >> (value % 64)) & 1; }
+
+            void Insert(IR::ValueId value)
+            { m_Words[value / 64] |= uint64_t(1) << (value % 64); }
+
+            void Erase(IR::ValueId value)
+            { m_Words[value / 64] &= ~(uint64_t(1) << (value % 64)); }
+
+            // Returns true if the set changed.
+            bool Union(const ValueSet& other)
+            {
+                bool changed = false;
+
+                for (size_t i = 0; i < m_Words.size(); i++)
+                {
+                    uint64_t word = m_Words[i] | other.m_Words[i];
+                    changed |= word != m_Words[i];
+                    m_Words[i] = word;
+                }
+
+                return changed;
+            }
+
+            template <typename F>
+            void ForEach(F f) const
+            {
+                for (size_t i = 0; i < m_Words.size(); i++)
+                {
+                    for (uint64_t word = m_Words[i]; word != 0; word &= word - 1)
+                    {
+                        f(static_cast<IR::ValueId>(i * 64 + __builtin_ctzll(word)));
+                    }
+                }
+            }
+
+        private:
+            std::vector<uint64_t> m_Words;
+        }; // class ValueSet
+    } // namespace
+
+    LinearScan::LinearScan(const IR::Function& func,
+                           const std::vector<IR::BlockId>& order,
+                           const std::vector<int>& allocatable,
+                           ClobberFunction clobbers)
+        : m_Func(func), m_Order(order), m_Allocatable(allocatable), m_Clobbers(std::move(clobbers))
+    {}
+
+    void LinearScan::Allocate(const std::vector<bool>& needsLocation)
+    {
+        m_Registers.assign(m_Func.insts.size(), -1);
+        m_SpillSlots.assign(m_Func.insts.size(), -1);
+        m_SpillSlotCount = 0;
+
+        NumberInstructions();
+
+        std::vector<Interval> intervals = BuildIntervals(needsLocation);
+        std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b)
+        {
+            return a.start != b.start ? a.start < b.start : a.value < b.value;
+        });
+
+        // Active intervals, each holding the register recorded in m_Registers.
+        std::vector<const Interval*> active;
+        std::vector<bool> free(*std::max_element(m_Allocatable.begin(), m_Allocatable.end()) + 1, false);
+        for (int reg : m_Allocatable)
+        {
+            free[reg] = true;
+        }
+
+        for (const Interval& cur : intervals)
+        {
+            // Expire intervals that ended before this one starts.
+            for (size_t i = 0; i < active.size();)
+            {
+                if (active[i]->end < cur.start)
+                {
+                    free[m_Registers[active[i]->value]] = true;
+                    active[i] = active.back();
+                    active.pop_back();
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            int chosen = -1;
+            for (int reg : m_Allocatable)
+            {
+                if (free[reg] && !IsClobberedIn(reg, cur.start, cur.end))
+                {
+                    chosen = reg;
+                    break;
+                }
+            }
+
+            if (chosen != -1)
+            {
+                free[chosen] = false;
+                m_Registers[cur.value] = chosen;
+                active.push_back(&cur);
+                continue;
+            }
+
+            // No register: spill whichever usable interval ends last, preferring the one used least.
+            const Interval* victim = nullptr;
+            for (const Interval* candidate : active)
+            {
+                int reg = m_Registers[candidate->value];
+                if (IsClobberedIn(reg, cur.start, cur.end))
+                {
+                    continue;
+                }
+
+                if (victim == nullptr
+                    || candidate->end > victim->end
+                    || (candidate->end == victim->end && candidate->uses < victim->uses))
+                {
+                    victim = candidate;
+                }
+            }
+
+            if (victim != nullptr
+                && (victim->end > cur.end || (victim->end == cur.end && victim->uses < cur.uses)))
+            {
+                int reg = m_Registers[victim->value];
+                Spill(victim->value);
+
+                m_Registers[cur.value] = reg;
+                *std::find(active.begin(), active.end(), victim) = &cur;
+            }
+            else
+            {
+                Spill(cur.value);
+            }
+        }
+    }
+
+    void LinearScan::NumberInstructions()
+    {
+        m_Positions.assign(m_Func.insts.size(), 0);
+        m_BlockStart.assign(m_Func.blocks.size(), 0);
+        m_BlockEnd.assign(m_Func.blocks.size(), 0);
+        m_ClobberPositions.assign(m_Allocatable.empty()
+                                  ? 0
+                                  : *std::max_element(m_Allocatable.begin(), m_Allocatable.end()) + 1,
+                                  {});
+
+        // Instructions read their operands and clobber registers at even positions
+        // and define their result at the odd position right after.
+        size_t pos = 0;
+        std::vector<int> clobbers;
+
+        for (IR::BlockId block : m_Order)
+        {
+            m_BlockStart[block] = pos;
+
+            for (IR::ValueId id : m_Func.blocks[block].insts)
+            {
+                m_Positions[id] = pos;
+
+                clobbers.clear();
+                m_Clobbers(id, clobbers);
+                for (int reg : clobbers)
+                {
+                    if (static_cast<size_t>(reg) < m_ClobberPositions.size())
+                    {
+                        m_ClobberPositions[reg].push_back(pos);
+                    }
+                }
+
+                pos += 2;
+            }
+
+            m_BlockEnd[block] = pos - 2;
+        }
+    }
+
+    std::vector<LinearScan::Interval> LinearScan::BuildIntervals(const std::vector<bool>& needsLocation)
+    {
+        const size_t valueCount = m_Func.insts.size();
+        const size_t blockCount = m_Func.blocks.size();
+
+        std::vector<bool> reachable(blockCount, false);
+        for (IR::BlockId block : m_Order)
+        {
+            reachable[block] = true;
+        }
+
+        // Phi operands are used at the end of the incoming block, not in the phi's block.
+        std::vector<ValueSet> phiUses(blockCount, ValueSet(valueCount));
+        std::vector<ValueSet> liveIn(blockCount, ValueSet(valueCount));
+        std::vector<ValueSet> liveOut(blockCount, ValueSet(valueCount));
+
+        for (IR::BlockId block : m_Order)
+        {
+            for (IR::ValueId id : m_Func.blocks[block].insts)
+            {
+                const IR::Instruction& inst = m_Func.insts[id];
+                if (inst.op != IR::Opcode::PHI)
+                {
+                    break;
+                }
+
+                for (IR::ValueId i = 0; i < inst.operands[1]; i++)
+                {
+                    const IR::PhiIncoming& incoming = m_Func.phiArgs[inst.operands[0] + i];
+                    if (incoming.block < blockCount && reachable[incoming.block] && needsLocation[incoming.value])
+                    {
+                        phiUses[incoming.block].Insert(incoming.value);
+                    }
+                }
+            }
+        }
+
+        // Backward dataflow in post order; converges in one pass on acyclic graphs.
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+
+            for (auto it = m_Order.rbegin(); it != m_Order.rend(); ++it)
+            {
+                IR::BlockId block = *it;
+                const IR::BasicBlock& bb = m_Func.blocks[block];
+
+                ValueSet live = phiUses[block];
+                for (IR::BlockId succ : IR::GetSuccessors(m_Func, block))
+                {
+                    live.Union(liveIn[succ]);
+                }
+                liveOut[block] = live;
+
+                for (auto inst = bb.insts.rbegin(); inst != bb.insts.rend(); ++inst)
+                {
+                    const IR::Instruction& cur = m_Func.insts[*inst];
+
+                    live.Erase(*inst);
+                    if (cur.op == IR::Opcode::PHI)
+                    {
+                        continue;
+                    }
+
+                    for (size_t i = 0; i < IR::GetOperandCount(cur); i++)
+                    {
+                        if (needsLocation[cur.operands[i]])
+                        {
+                            live.Insert(cur.operands[i]);
+                        }
+                    }
+                }
+
+                changed |= liveIn[block].Union(live);
+            }
+        }
+
+        std::vector<size_t> start(valueCount, SIZE_MAX);
+        std::vector<size_t> end(valueCount, 0);
+        std::vector<size_t> uses(valueCount, 0);
+
+        auto extend = [&](IR::ValueId value, size_t pos)
+        {
+            start[value] = std::min(start[value], pos);
+            end[value] = std::max(end[value], pos);
+        };
+
+        for (IR::BlockId block : m_Order)
+        {
+            liveIn[block].ForEach([&](IR::ValueId value) { extend(value, m_BlockStart[block]); });
+            liveOut[block].ForEach([&](IR::ValueId value) { extend(value, m_BlockEnd[block]); });
+
+            for (IR::ValueId id : m_Func.blocks[block].insts)
+            {
+                const IR::Instruction& inst = m_Func.insts[id];
+
+                // Results are written after the operands are read, so an operand
+                // dying here can hand its register to the result. Phis are all
+                // defined together at the start of the block.
+                if (needsLocation[id])
+                {
+                    extend(id, inst.op == IR::Opcode::PHI ? m_BlockStart[block] : m_Positions[id] + 1);
+                }
+
+                if (inst.op == IR::Opcode::PHI)
+                {
+                    for (IR::ValueId i = 0; i < inst.operands[1]; i++)
+                    {
+                        const IR::PhiIncoming& incoming = m_Func.phiArgs[inst.operands[0] + i];
+                        if (needsLocation[incoming.value])
+                        {
+                            uses[incoming.value]++;
+                        }
+                    }
+                    continue;
+                }
+
+                for (size_t i = 0; i < IR::GetOperandCount(inst); i++)
+                {
+                    if (needsLocation[inst.operands[i]])
+                    {
+                        extend(inst.operands[i], m_Positions[id]);
+                        uses[inst.operands[i]]++;
+                    }
+                }
+            }
+        }
+
+        std::vector<Interval> intervals;
+        for (IR::ValueId value = 0; value < valueCount; value++)
+        {
+            if (needsLocation[value] && start[value] != SIZE_MAX)
+            {
+                intervals.push_back({ value, start[value], end[value], uses[value] });
+            }
+        }
+
+        return intervals;
+    }
+
+    bool LinearScan::IsClobberedIn(int reg, size_t start, size_t end) const
+    {
+        // The defining instruction clobbers before its result is written; later ones may not clobber it.
+        const std::vector<size_t>& positions = m_ClobberPositions[reg];
+        auto it = std::upper_bound(positions.begin(), positions.end(), start);
+
+        return it != positions.end() && *it <= end;
+    }
+
+    void LinearScan::Spill(IR::ValueId value)
+    {
+        m_Registers[value] = -1;
+        m_SpillSlots[value] = static_cast<int>(m_SpillSlotCount++);
+    }
+} // namespace CComp
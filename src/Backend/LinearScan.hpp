@@ -0,0 +1,72 @@
+#ifndef CCOMP_LINEAR_SCAN_HPP
+#define CCOMP_LINEAR_SCAN_HPP
+
+#include <functional>
+#include <vector>
+
+#include "../IR/IR.hpp"
+
+namespace CComp
+{
+    // Linear scan register allocation (Poletto and Sarkar) over SSA values.
+    // Each value gets a single live interval in the given block order; holes are not tracked.
+    class LinearScan
+    {
+    public:
+        // Registers an instruction destroys while it executes. Values live across the
+        // instruction or used by it are kept out of those registers; its own result is not.
+        using ClobberFunction = std::function<void(IR::ValueId, std::vector<int>&)>;
+
+        LinearScan(const IR::Function& func,
+                   const std::vector<IR::BlockId>& order,
+                   const std::vector<int>& allocatable,
+                   ClobberFunction clobbers);
+
+        // Values with needsLocation[value] == false (constants, fused instructions) are skipped.
+        void Allocate(const std::vector<bool>& needsLocation);
+
+        // Register of the value, -1 if it was spilled or has no location.
+        int GetRegister(IR::ValueId value) const
+        { return m_Registers[value]; }
+
+        // Spill slot of the value, -1 if it lives in a register.
+        int GetSpillSlot(IR::ValueId value) const
+        { return m_SpillSlots[value]; }
+
+        size_t GetSpillSlotCount() const
+        { return m_SpillSlotCount; }
+
+    private:
+        struct Interval
+        {
+            IR::ValueId value;
+            size_t start;
+            size_t end;
+            size_t uses;
+        }; // struct Interval
+
+        const IR::Function& m_Func;
+        const std::vector<IR::BlockId>& m_Order;
+        std::vector<int> m_Allocatable;
+        ClobberFunction m_Clobbers;
+
+        std::vector<size_t> m_Positions;
+        std::vector<size_t> m_BlockStart;
+        std::vector<size_t> m_BlockEnd;
+
+        // Positions at which each register is clobbered, in increasing order.
+        std::vector<std::vector<size_t>> m_ClobberPositions;
+
+        std::vector<int> m_Registers;
+        std::vector<int> m_SpillSlots;
+        size_t m_SpillSlotCount = 0;
+
+        void NumberInstructions();
+        std::vector<Interval> BuildIntervals(const std::vector<bool>& needsLocation);
+
+        bool IsClobberedIn(int reg, size_t start, size_t end) const;
+        void Spill(IR::ValueId value);
+    }; // class LinearScan
+} // namespace CComp
+
+#endif // CCOMP_LINEAR_SCAN_HPP
@@ -0,0 +1,297 @@
+#include "StrengthReduction.hpp"
+
+namespace CComp
+{
+    using Asm::Opcode;
+    using Asm::Register;
+    using Asm::Reg;
+    using Asm::Imm;
+
+    namespace
+    {
+        // k for value == 2^k, -1 otherwise.
+        int ExactLog2(uint32_t value)
+        {
+            if (value == 0 || (value & (value - 1)) != 0)
+            {
+                return -1;
+            }
+
+            int k = 0;
+            while ((value >> k) != 1)
+            {
+                k++;
+            }
+            return k;
+        }
+
+        // Factors a single lea can multiply by: reg + reg * (factor - 1).
+        bool IsLeaFactor(uint32_t factor)
+        {
+            return factor == 3 || factor == 5 || factor == 9;
+        }
+
+        void EmitLea(std::vector<Asm::Instruction>& out, Register reg, uint32_t factor)
+        {
+            out.emplace_back(Opcode::LEA, Asm::Mem(reg, reg, static_cast<uint8_t>(factor - 1)), Reg(reg));
+        }
+    } // namespace
+
+    MagicNumber ComputeMagicNumber(int32_t divisor)
+    {
+        const uint32_t two31 = 0x80000000u;
+
+        uint32_t d = static_cast<uint32_t>(divisor);
+        uint32_t ad = divisor < 0 ? 0u - d : d;
+        uint32_t t = two31 + (d >> 31);
+        uint32_t anc = t - 1 - t % ad;
+
+        int p = 31;
+        uint32_t q1 = two31 / anc;
+        uint32_t r1 = two31 - q1 * anc;
+        uint32_t q2 = two31 / ad;
+        uint32_t r2 = two31 - q2 * ad;
+        uint32_t delta = 0;
+
+        do
+        {
+            p++;
+
+            q1 *= 2;
+            r1 *= 2;
+            if (r1 >= anc)
+            {
+                q1++;
+                r1 -= anc;
+            }
+
+            q2 *= 2;
+            r2 *= 2;
+            if (r2 >= ad)
+            {
+                q2++;
+                r2 -= ad;
+            }
+
+            delta = ad - r2;
+        } while (q1 < delta || (q1 == delta && r1 == 0));
+
+        uint32_t multiplier = q2 + 1;
+        if (divisor < 0)
+        {
+            multiplier = 0u - multiplier;
+        }
+
+        return { static_cast<int32_t>(multiplier), p - 32 };
+    }
+
+    bool EmitMultiplyByConstant(std::vector<Asm::Instruction>& out, Register reg, int32_t factor,
+                                Register scratch)
+    {
+        // Work modulo 2^32 so that INT32_MIN and its negation need no special case.
+        const uint32_t u = static_cast<uint32_t>(factor);
+        const uint32_t negated = 0u - u;
+
+        if (u == 0)
+        {
+            out.emplace_back(Opcode::MOV, Imm(0), Reg(reg));
+            return true;
+        }
+
+        if (int k = ExactLog2(u); k >= 0)
+        {
+            if (k > 0)
+            {
+                out.emplace_back(Opcode::SAL, Imm(k), Reg(reg));
+            }
+            return true;
+        }
+
+        if (int k = ExactLog2(negated); k >= 0)
+        {
+            if (k > 0)
+            {
+                out.emplace_back(Opcode::SAL, Imm(k), Reg(reg));
+            }
+            out.emplace_back(Opcode::NEG, Reg(reg));
+            return true;
+        }
+
+        if (IsLeaFactor(u))
+        {
+            EmitLea(out, reg, u);
+            return true;
+        }
+
+        // 3, 5 or 9 times a power of two, or a product of two of those.
+        for (uint32_t first : { 3u, 5u, 9u })
+        {
+            if (u % first != 0)
+            {
+                continue;
+            }
+
+            uint32_t rest = u / first;
+
+            if (int k = ExactLog2(rest); k >= 0)
+            {
+                EmitLea(out, reg, first);
+                if (k > 0)
+                {
+                    out.emplace_back(Opcode::SAL, Imm(k), Reg(reg));
+                }
+                return true;
+            }
+
+            if (IsLeaFactor(rest))
+            {
+                EmitLea(out, reg, first);
+                EmitLea(out, reg, rest);
+                return true;
+            }
+        }
+
+        if (scratch == Register::NONE)
+        {
+            return false;
+        }
+
+        // 2^k + 1 and 2^k - 1.
+        int plus = ExactLog2(u - 1);
+        int minus = ExactLog2(u + 1);
+
+        if (plus > 0 || minus > 0)
+        {
+            out.emplace_back(Opcode::MOV, Reg(reg), Reg(scratch));
+            out.emplace_back(Opcode::SAL, Imm(plus > 0 ? plus : minus), Reg(reg));
+            out.emplace_back(plus > 0 ? Opcode::ADD : Opcode::SUB, Reg(scratch), Reg(reg));
+            return true;
+        }
+
+        return false;
+    }
+
+    void EmitDivideByConstant(std::vector<Asm::Instruction>& out, int32_t divisor)
+    {
+        const Asm::Operand eax = Reg(Register::EAX);
+        const Asm::Operand ecx = Reg(Register::ECX);
+        const Asm::Operand edx = Reg(Register::EDX);
+
+        if (divisor == 1)
+        {
+            return;
+        }
+
+        if (divisor == -1)
+        {
+            out.emplace_back(Opcode::NEG, eax);
+            return;
+        }
+
+        if (divisor == INT32_MIN)
+        {
+            // Only INT32_MIN itself divides to a non-zero quotient.
+            Asm::Instruction set(Opcode::SETCC, Asm::ByteReg(Register::EAX));
+            set.cond = Asm::Cond::E;
+
+            out.emplace_back(Opcode::CMP, Imm(INT32_MIN), eax);
+            out.push_back(set);
+            out.emplace_back(Opcode::MOVZB, Asm::ByteReg(Register::EAX), eax);
+            return;
+        }
+
+        const uint32_t magnitude = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+
+        if (int k = ExactLog2(magnitude); k >= 0)
+        {
+            // Bias negative dividends by 2^k - 1 so the arithmetic shift truncates toward zero.
+            if (k == 1)
+            {
+                out.emplace_back(Opcode::MOV, eax, edx);
+                out.emplace_back(Opcode::SHR, Imm(31), edx);
+            }
+            else
+            {
+                out.emplace_back(Opcode::CDQ);
+                out.emplace_back(Opcode::SHR, Imm(32 - k), edx);
+            }
+            out.emplace_back(Opcode::ADD, edx, eax);
+            out.emplace_back(Opcode::SAR, Imm(k), eax);
+
+            if (divisor < 0)
+            {
+                out.emplace_back(Opcode::NEG, eax);
+            }
+            return;
+        }
+
+        MagicNumber magic = ComputeMagicNumber(divisor);
+
+        // %edx = high half of n * multiplier, with n kept in %ecx.
+        out.emplace_back(Opcode::MOV, eax, ecx);
+        out.emplace_back(Opcode::MOV, Imm(magic.multiplier), edx);
+        out.emplace_back(Opcode::IMUL, edx);
+
+        if (divisor > 0 && magic.multiplier < 0)
+        {
+            out.emplace_back(Opcode::ADD, ecx, edx);
+        }
+        else if (divisor < 0 && magic.multiplier > 0)
+        {
+            out.emplace_back(Opcode::SUB, ecx, edx);
+        }
+
+        if (magic.shift > 0)
+        {
+            out.emplace_back(Opcode::SAR, Imm(magic.shift), edx);
+        }
+
+        // Round a negative quotient up toward zero.
+        out.emplace_back(Opcode::MOV, edx, eax);
+        out.emplace_back(Opcode::SHR, Imm(31), eax);
+        out.emplace_back(Opcode::ADD, edx, eax);
+    }
+
+    void EmitRemainderByConstant(std::vector<Asm::Instruction>& out, int32_t divisor)
+    {
+        const Asm::Operand eax = Reg(Register::EAX);
+        const Asm::Operand ecx = Reg(Register::ECX);
+        const Asm::Operand edx = Reg(Register::EDX);
+
+        if (divisor == 1 || divisor == -1)
+        {
+            out.emplace_back(Opcode::MOV, Imm(0), eax);
+            return;
+        }
+
+        if (divisor == INT32_MIN)
+        {
+            // n % INT32_MIN is n, except for INT32_MIN itself.
+            out.emplace_back(Opcode::MOV, eax, ecx);
+            EmitDivideByConstant(out, divisor);
+            out.emplace_back(Opcode::SAL, Imm(31), eax);
+            out.emplace_back(Opcode::SUB, eax, ecx);
+            out.emplace_back(Opcode::MOV, ecx, eax);
+            return;
+        }
+
+        // The remainder takes the sign of the dividend only, so n % -d == n % d.
+        const uint32_t magnitude = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+
+        if (int k = ExactLog2(magnitude); k >= 0)
+        {
+            // ((n + bias) & (2^k - 1)) - bias, with bias = 2^k - 1 for negative n and 0 otherwise.
+            out.emplace_back(Opcode::CDQ);
+            out.emplace_back(Opcode::SHR, Imm(32 - k), edx);
+            out.emplace_back(Opcode::ADD, edx, eax);
+            out.emplace_back(Opcode::AND, Imm(static_cast<int32_t>(magnitude - 1)), eax);
+            out.emplace_back(Opcode::SUB, edx, eax);
+            return;
+        }
+
+        // n - (n / d) * d, with n still in %ecx after the division.
+        EmitDivideByConstant(out, divisor);
+        out.emplace_back(Opcode::IMUL, Imm(static_cast<int32_t>(0u - static_cast<uint32_t>(divisor))), eax);
+        out.emplace_back(Opcode::ADD, ecx, eax);
+    }
+} // namespace CComp
@@ -0,0 +1,35 @@
+#ifndef CCOMP_STRENGTH_REDUCTION_HPP
+#define CCOMP_STRENGTH_REDUCTION_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "../Asm/Asm.hpp"
+
+namespace CComp
+{
+    // Multiplier and shift that replace signed division by a constant
+    // (Hacker's Delight, section 10-4): n / d == (mulhs(n, multiplier) [+- n]) >> shift,
+    // plus one when that is negative.
+    struct MagicNumber
+    {
+        int32_t multiplier;
+        int shift;
+    }; // struct MagicNumber
+
+    // Requires 2 <= |divisor| and divisor != INT32_MIN.
+    MagicNumber ComputeMagicNumber(int32_t divisor);
+
+    // reg = reg * factor with shifts and lea when that beats imull. scratch may be
+    // Register::NONE; otherwise it is free to overwrite. Returns false, emitting nothing,
+    // if there is no cheaper sequence.
+    bool EmitMultiplyByConstant(std::vector<Asm::Instruction>& out, Asm::Register reg, int32_t factor,
+                                Asm::Register scratch);
+
+    // %eax = %eax / divisor and %eax = %eax % divisor, rounding toward zero like idivl.
+    // divisor must not be 0. Both overwrite %ecx and %edx.
+    void EmitDivideByConstant(std::vector<Asm::Instruction>& out, int32_t divisor);
+    void EmitRemainderByConstant(std::vector<Asm::Instruction>& out, int32_t divisor);
+} // namespace CComp
+
+#endif // CCOMP_STRENGTH_REDUCTION_HPP
@@ -0,0 +1,721 @@
+#include "X86Backend.hpp"
+
+#include <algorithm>
+
+#include "LinearScan.hpp"
+#include "StrengthReduction.hpp"
+#include "../IR/CFG.hpp"
+#include "../AllocationCounter.hpp"
+#include "../Statistics.hpp"
+#include "../TimeReport.hpp"
+#include "../Trace.hpp"
+#include "../Unreachable.hpp"
+
+namespace CComp
+{
+    using Asm::Opcode;
+    using Asm::Register;
+    using Asm::Reg;
+    using Asm::Imm;
+    using Asm::Mem;
+
+    namespace
+    {
+        // Caller-saved registers first: callee-saved ones cost a push and a pop.
+        const std::vector<int> gc_Allocatable =
+        {
+            static_cast<int>(Register::ECX),
+            static_cast<int>(Register::EDX),
+            static_cast<int>(Register::EBX),
+            static_cast<int>(Register::ESI),
+            static_cast<int>(Register::EDI),
+        };
+
+        bool HasByteRegister(Register reg)
+        {
+            return static_cast<int>(reg) < 4;
+        }
+    } // namespace
+
+    X86Backend::X86Backend(std::vector<Asm::Instruction>& out)
+        : m_Out(out)
+    {}
+
+    void X86Backend::Emit(Asm::Opcode op, Asm::Operand a, Asm::Operand b)
+    {
+        m_Out.emplace_back(op, a, b);
+    }
+
+    void X86Backend::Emit(Asm::Opcode op, const std::string& label)
+    {
+        m_Out.emplace_back(op, label);
+    }
+
+    void X86Backend::EmitJump(Asm::Cond cond, const std::string& label)
+    {
+        m_Out.emplace_back(Opcode::JCC, cond, label);
+    }
+
+    void X86Backend::Compile(IR::Module& module)
+    {
+        ScopedTimer timer(TimedPhase::CODEGEN);
+        ScopedMemoryCategory memory(MemoryCategory::CODEGEN);
+
+        MakeHeader();
+
+        for (IR::Function& func : module.functions)
+        {
+            CompileFunction(func);
+        }
+
+        MakeFooter();
+    }
+
+    void X86Backend::MakeHeader()
+    {
+        Emit(Opcode::COMMENT, "Compiled using InAnYan first C compiler v0.1.");
+        Emit(Opcode::BLANK);
+        Emit(Opcode::GLOBL, "_start");
+        Emit(Opcode::LABEL, "_start");
+        Emit(Opcode::CALL, "main");
+        Emit(Opcode::MOV, Reg(Register::EAX), Reg(Register::EBX));
+        Emit(Opcode::MOV, Imm(1), Reg(Register::EAX));
+        Emit(Opcode::INT, Imm(0x80));
+        Emit(Opcode::BLANK);
+    }
+
+    void X86Backend::MakeFooter()
+    {
+        Emit(Opcode::COMMENT, "End of compiling.");
+    }
+
+    void X86Backend::CompileFunction(IR::Function& func)
+    {
+        TraceSpan span("codegen", func.name);
+
+        m_Func = &func;
+
+        IR::SplitCriticalEdges(func);
+        FuseCompares();
+
+        std::vector<IR::BlockId> order = IR::ComputeReversePostOrder(func);
+
+        std::vector<bool> needsLocation(func.insts.size(), false);
+        for (IR::BlockId block : order)
+        {
+            for (IR::ValueId id : func.blocks[block].insts)
+            {
+                const IR::Instruction& inst = func.insts[id];
+
+                needsLocation[id] = inst.type != IR::Type::VOID && inst.op != IR::Opcode::CONST && !m_Fused[id];
+            }
+        }
+
+        LinearScan alloc(func, order, gc_Allocatable, [this](IR::ValueId id, std::vector<int>& clobbers)
+        {
+            CollectClobbers(id, clobbers);
+        });
+        alloc.Allocate(needsLocation);
+        m_Alloc = &alloc;
+
+        Asm::RegisterMask savedMask = 0;
+        size_t registerValues = 0;
+        for (IR::ValueId id = 0; id < func.insts.size(); id++)
+        {
+            Register reg = GetRegister(id);
+            if (reg == Register::NONE)
+            {
+                continue;
+            }
+
+            registerValues++;
+
+            if (Asm::gc_CalleeSaved & Asm::MaskOf(reg))
+            {
+                savedMask |= Asm::MaskOf(reg);
+            }
+        }
+
+        std::vector<Register> savedRegisters;
+        for (Register reg : { Register::EBX, Register::ESI, Register::EDI })
+        {
+            if (savedMask & Asm::MaskOf(reg))
+            {
+                savedRegisters.push_back(reg);
+            }
+        }
+
+        AddStatistic("regalloc", "values in registers", static_cast<long long>(registerValues));
+        AddStatistic("regalloc", "values spilled", static_cast<long long>(alloc.GetSpillSlotCount()));
+
+        m_Frame = FrameLayout(func.slotCount + alloc.GetSpillSlotCount(), std::move(savedRegisters));
+        m_ReturnJumps = 0;
+
+        Emit(Opcode::GLOBL, func.name);
+        Emit(Opcode::LABEL, func.name);
+
+        m_Frame.EmitProlog(m_Out);
+
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            EmitBlock(order[i], i + 1 < order.size() ? order[i + 1] : IR::NO_BLOCK);
+        }
+
+        if (m_ReturnJumps != 0)
+        {
+            Emit(Opcode::LABEL, EpilogLabel());
+        }
+
+        EmitEpilog();
+        Emit(Opcode::BLANK);
+
+        m_Alloc = nullptr;
+        m_Func = nullptr;
+    }
+
+    void X86Backend::FuseCompares()
+    {
+        std::vector<size_t> useCounts(m_Func->insts.size(), 0);
+
+        for (const IR::Instruction& inst : m_Func->insts)
+        {
+            for (size_t i = 0; i < IR::GetOperandCount(inst); i++)
+            {
+                useCounts[inst.operands[i]]++;
+            }
+        }
+
+        for (const IR::PhiIncoming& incoming : m_Func->phiArgs)
+        {
+            useCounts[incoming.value]++;
+        }
+
+        m_Fused.assign(m_Func->insts.size(), false);
+
+        for (const IR::BasicBlock& bb : m_Func->blocks)
+        {
+            const IR::Instruction& term = m_Func->insts[bb.insts.back()];
+            if (term.op != IR::Opcode::CONDBR)
+            {
+                continue;
+            }
+
+            // Constants emit no code, so they do not separate the compare from the branch.
+            size_t i = bb.insts.size() - 1;
+            while (i > 0 && m_Func->insts[bb.insts[i - 1]].op == IR::Opcode::CONST)
+            {
+                i--;
+            }
+
+            if (i == 0)
+            {
+                continue;
+            }
+
+            IR::ValueId cmp = bb.insts[i - 1];
+            if (term.operands[0] == cmp && m_Func->insts[cmp].op == IR::Opcode::ICMP && useCounts[cmp] == 1)
+            {
+                m_Fused[cmp] = true;
+            }
+        }
+    }
+
+    void X86Backend::CollectClobbers(IR::ValueId id, std::vector<int>& clobbers) const
+    {
+        const IR::Instruction& inst = m_Func->insts[id];
+
+        switch (inst.op)
+        {
+        case IR::Opcode::SDIV:
+        case IR::Opcode::SREM:
+            clobbers.push_back(static_cast<int>(Register::EDX));
+
+            if (IsConstant(inst.operands[1]))
+            {
+                clobbers.push_back(static_cast<int>(Register::ECX));
+            }
+            break;
+
+        case IR::Opcode::SHL:
+        case IR::Opcode::ASHR:
+            if (!IsConstant(inst.operands[1]))
+            {
+                clobbers.push_back(static_cast<int>(Register::ECX));
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void X86Backend::EmitBlock(IR::BlockId block, IR::BlockId next)
+    {
+        Emit(Opcode::LABEL, BlockLabel(block));
+
+        for (IR::ValueId id : m_Func->blocks[block].insts)
+        {
+            EmitInstruction(id, block, next);
+        }
+    }
+
+    void X86Backend::EmitInstruction(IR::ValueId id, IR::BlockId block, IR::BlockId next)
+    {
+        const IR::Instruction& inst = m_Func->insts[id];
+
+        if (m_Fused[id])
+        {
+            return;
+        }
+
+        switch (inst.op)
+        {
+        case IR::Opcode::CONST:
+        case IR::Opcode::PHI:
+            break;
+
+        case IR::Opcode::NEG:
+        case IR::Opcode::NOT:
+        {
+            Asm::Operand reg = Reg(GetResultRegister(id));
+
+            Move(Operand(inst.operands[0]), reg);
+            Emit(inst.op == IR::Opcode::NEG ? Opcode::NEG : Opcode::NOT, reg);
+            Move(reg, Operand(id));
+            break;
+        }
+
+        case IR::Opcode::ICMP:
+        {
+            EmitCompare(inst.operands[0], inst.operands[1]);
+
+            Register reg = GetResultRegister(id);
+            if (!HasByteRegister(reg))
+            {
+                reg = Register::EAX;
+            }
+
+            Asm::Instruction set(Opcode::SETCC, Asm::ByteReg(reg));
+            set.cond = ToAsmCond(static_cast<IR::Cond>(inst.imm));
+            m_Out.push_back(set);
+
+            Emit(Opcode::MOVZB, Asm::ByteReg(reg), Reg(reg));
+            Move(Reg(reg), Operand(id));
+            break;
+        }
+
+        case IR::Opcode::ZEXT:
+            Move(Operand(inst.operands[0]), Operand(id));
+            break;
+
+        case IR::Opcode::LOAD:
+            Move(SlotOperand(inst.imm), Operand(id));
+            break;
+
+        case IR::Opcode::STORE:
+            Move(Operand(inst.operands[0]), SlotOperand(inst.imm));
+            break;
+
+        case IR::Opcode::BR:
+            EmitPhiCopies(block, inst.imm);
+
+            if (static_cast<IR::BlockId>(inst.imm) != next)
+            {
+                Emit(Opcode::JMP, BlockLabel(inst.imm));
+            }
+            break;
+
+        case IR::Opcode::CONDBR:
+            EmitCondBr(inst, next);
+            break;
+
+        case IR::Opcode::RET:
+            Move(Operand(inst.operands[0]), Reg(Register::EAX));
+
+            // Every return shares the epilogue emitted after the last block.
+            if (next != IR::NO_BLOCK)
+            {
+                Emit(Opcode::JMP, EpilogLabel());
+                m_ReturnJumps++;
+            }
+            break;
+
+        case IR::Opcode::SDIV:
+        case IR::Opcode::SREM:
+            EmitDivision(id, inst);
+            break;
+
+        case IR::Opcode::SHL:
+        case IR::Opcode::ASHR:
+            EmitShift(id, inst);
+            break;
+
+        default:
+            EmitBinary(id, inst);
+            break;
+        }
+    }
+
+    void X86Backend::EmitCondBr(const IR::Instruction& inst, IR::BlockId next)
+    {
+        IR::BlockId ifTrue = inst.operands[1];
+        IR::BlockId ifFalse = static_cast<IR::BlockId>(inst.imm);
+
+        IR::ValueId condValue = inst.operands[0];
+        const IR::Instruction& cond = m_Func->insts[condValue];
+
+        if (cond.op == IR::Opcode::CONST)
+        {
+            IR::BlockId target = cond.imm != 0 ? ifTrue : ifFalse;
+
+            if (target != next)
+            {
+                Emit(Opcode::JMP, BlockLabel(target));
+            }
+            return;
+        }
+
+        Asm::Cond cc = Asm::Cond::NE;
+
+        if (m_Fused[condValue])
+        {
+            EmitCompare(cond.operands[0], cond.operands[1]);
+            cc = ToAsmCond(static_cast<IR::Cond>(cond.imm));
+        }
+        else if (IsMemory(condValue))
+        {
+            Emit(Opcode::CMP, Imm(0), Operand(condValue));
+        }
+        else
+        {
+            Emit(Opcode::TEST, Operand(condValue), Operand(condValue));
+        }
+
+        if (ifTrue == next)
+        {
+            EmitJump(Asm::InvertCond(cc), BlockLabel(ifFalse));
+        }
+        else
+        {
+            EmitJump(cc, BlockLabel(ifTrue));
+
+            if (ifFalse != next)
+            {
+                Emit(Opcode::JMP, BlockLabel(ifFalse));
+            }
+        }
+    }
+
+    void X86Backend::EmitBinary(IR::ValueId id, const IR::Instruction& inst)
+    {
+        Opcode op = Opcode::ADD;
+
+        switch (inst.op)
+        {
+        case IR::Opcode::ADD: op = Opcode::ADD;  break;
+        case IR::Opcode::SUB: op = Opcode::SUB;  break;
+        case IR::Opcode::AND: op = Opcode::AND;  break;
+        case IR::Opcode::OR:  op = Opcode::OR;   break;
+        case IR::Opcode::XOR: op = Opcode::XOR;  break;
+        case IR::Opcode::MUL: op = Opcode::IMUL; break;
+        default:
+            Unreachable("X86Backend::EmitBinary unreachable");
+            return;
+        }
+
+        // The result may take over the register of an operand that dies here.
+        Register result = GetResultRegister(id);
+        Asm::Operand reg = Reg(result);
+
+        IR::ValueId left = inst.operands[0];
+        IR::ValueId right = inst.operands[1];
+
+        if (inst.op == IR::Opcode::MUL && (IsConstant(left) || IsConstant(right)))
+        {
+            IR::ValueId factor = IsConstant(right) ? right : left;
+            int32_t value = static_cast<int32_t>(m_Func->insts[factor].imm);
+
+            // %eax is never allocated, so it is free as the scratch register.
+            Move(Operand(factor == right ? left : right), reg);
+            if (!EmitMultiplyByConstant(m_Out, result, value, result == Register::EAX ? Register::NONE : Register::EAX))
+            {
+                Emit(Opcode::IMUL, Imm(value), reg);
+            }
+            Move(reg, Operand(id));
+            return;
+        }
+
+        if (left != right && GetRegister(right) == result)
+        {
+            if (inst.op == IR::Opcode::SUB)
+            {
+                Emit(Opcode::NEG, reg);
+                Emit(Opcode::ADD, Operand(left), reg);
+            }
+            else
+            {
+                Emit(op, Operand(left), reg);
+            }
+            return;
+        }
+
+        Move(Operand(left), reg);
+        Emit(op, Operand(right), reg);
+        Move(reg, Operand(id));
+    }
+
+    void X86Backend::EmitShift(IR::ValueId id, const IR::Instruction& inst)
+    {
+        Opcode op = inst.op == IR::Opcode::SHL ? Opcode::SAL : Opcode::SAR;
+        IR::ValueId count = inst.operands[1];
+
+        if (IsConstant(count))
+        {
+            Asm::Operand reg = Reg(GetResultRegister(id));
+
+            Move(Operand(inst.operands[0]), reg);
+            Emit(op, Imm(m_Func->insts[count].imm & 31), reg);
+            Move(reg, Operand(id));
+            return;
+        }
+
+        // The count has to be in %cl, which the allocator keeps free here.
+        Register result = GetResultRegister(id);
+        Asm::Operand reg = Reg(result == Register::ECX ? Register::EAX : result);
+
+        Move(Operand(count), Reg(Register::ECX));
+        Move(Operand(inst.operands[0]), reg);
+        Emit(op, Asm::ByteReg(Register::ECX), reg);
+        Move(reg, Operand(id));
+    }
+
+    void X86Backend::EmitDivision(IR::ValueId id, const IR::Instruction& inst)
+    {
+        IR::ValueId divisor = inst.operands[1];
+
+        Move(Operand(inst.operands[0]), Reg(Register::EAX));
+
+        // Both sequences leave their result in %eax and overwrite %ecx and %edx, which
+        // CollectClobbers reserves for constant divisors.
+        if (IsConstant(divisor) && m_Func->insts[divisor].imm != 0)
+        {
+            int32_t value = static_cast<int32_t>(m_Func->insts[divisor].imm);
+
+            if (inst.op == IR::Opcode::SREM)
+            {
+                EmitRemainderByConstant(m_Out, value);
+            }
+            else
+            {
+                EmitDivideByConstant(m_Out, value);
+            }
+
+            Move(Reg(Register::EAX), Operand(id));
+            return;
+        }
+
+        Asm::Operand divisorOperand = Operand(divisor);
+        if (IsConstant(divisor))
+        {
+            Move(divisorOperand, Reg(Register::ECX));
+            divisorOperand = Reg(Register::ECX);
+        }
+
+        Emit(Opcode::CDQ);
+        Emit(Opcode::IDIV, divisorOperand);
+        Move(Reg(inst.op == IR::Opcode::SREM ? Register::EDX : Register::EAX), Operand(id));
+    }
+
+    void X86Backend::EmitCompare(IR::ValueId left, IR::ValueId right)
+    {
+        if (IsConstant(left) || (IsMemory(left) && IsMemory(right)))
+        {
+            Move(Operand(left), Reg(Register::EAX));
+            Emit(Opcode::CMP, Operand(right), Reg(Register::EAX));
+        }
+        else
+        {
+            Emit(Opcode::CMP, Operand(right), Operand(left));
+        }
+    }
+
+    void X86Backend::EmitPhiCopies(IR::BlockId from, IR::BlockId to)
+    {
+        std::vector<std::pair<Asm::Operand, Asm::Operand>> copies;
+
+        for (IR::ValueId id : m_Func->blocks[to].insts)
+        {
+            const IR::Instruction& inst = m_Func->insts[id];
+            if (inst.op != IR::Opcode::PHI)
+            {
+                break;
+            }
+
+            for (IR::ValueId i = 0; i < inst.operands[1]; i++)
+            {
+                const IR::PhiIncoming& incoming = m_Func->phiArgs[inst.operands[0] + i];
+
+                if (incoming.block == from)
+                {
+                    copies.emplace_back(Operand(incoming.value), Operand(id));
+                }
+            }
+        }
+
+        EmitParallelCopies(std::move(copies));
+    }
+
+    void X86Backend::EmitParallelCopies(std::vector<std::pair<Asm::Operand, Asm::Operand>> copies)
+    {
+        copies.erase(std::remove_if(copies.begin(), copies.end(), [](const auto& copy)
+        {
+            return copy.first == copy.second;
+        }), copies.end());
+
+        const Asm::Operand scratch = Reg(Register::EAX);
+
+        // %eax holds the value saved to break a cycle until the copy reading it is emitted.
+        bool scratchBusy = false;
+
+        while (!copies.empty())
+        {
+            auto ready = std::find_if(copies.begin(), copies.end(), [&](const auto& copy)
+            {
+                return std::none_of(copies.begin(), copies.end(), [&](const auto& other)
+                {
+                    return other.first == copy.second;
+                });
+            });
+
+            if (ready == copies.end())
+            {
+                // Every destination is still read by another copy: move one source aside.
+                Asm::Operand saved = copies.front().first;
+
+                Move(saved, scratch);
+                scratchBusy = true;
+
+                for (auto& copy : copies)
+                {
+                    if (copy.first == saved)
+                    {
+                        copy.first = scratch;
+                    }
+                }
+                continue;
+            }
+
+            if (scratchBusy && ready->first.kind == Asm::OperandKind::MEM && ready->second.kind == Asm::OperandKind::MEM)
+            {
+                Emit(Opcode::PUSH, ready->first);
+                Emit(Opcode::POP, ready->second);
+            }
+            else
+            {
+                Move(ready->first, ready->second);
+            }
+
+            if (ready->first == scratch)
+            {
+                scratchBusy = false;
+            }
+
+            copies.erase(ready);
+        }
+    }
+
+    void X86Backend::EmitEpilog()
+    {
+        m_Frame.EmitEpilog(m_Out);
+        Emit(Opcode::RET);
+    }
+
+    Asm::Operand X86Backend::Operand(IR::ValueId value) const
+    {
+        const IR::Instruction& inst = m_Func->insts[value];
+
+        if (inst.op == IR::Opcode::CONST)
+        {
+            return Imm(inst.imm);
+        }
+
+        Register reg = GetRegister(value);
+        if (reg != Register::NONE)
+        {
+            return Reg(reg);
+        }
+
+        return SlotOperand(static_cast<int>(m_Func->slotCount) + m_Alloc->GetSpillSlot(value));
+    }
+
+    Asm::Operand X86Backend::SlotOperand(int slot) const
+    {
+        return Mem(Register::EBP, FrameLayout::GetSlotOffset(static_cast<size_t>(slot)));
+    }
+
+    bool X86Backend::IsConstant(IR::ValueId value) const
+    {
+        return m_Func->insts[value].op == IR::Opcode::CONST;
+    }
+
+    bool X86Backend::IsMemory(IR::ValueId value) const
+    {
+        return !IsConstant(value) && GetRegister(value) == Register::NONE;
+    }
+
+    Asm::Register X86Backend::GetRegister(IR::ValueId value) const
+    {
+        int reg = m_Alloc->GetRegister(value);
+
+        return reg != -1 ? static_cast<Register>(reg) : Register::NONE;
+    }
+
+    Asm::Register X86Backend::GetResultRegister(IR::ValueId value) const
+    {
+        Register reg = GetRegister(value);
+
+        return reg != Register::NONE ? reg : Register::EAX;
+    }
+
+    void X86Backend::Move(const Asm::Operand& from, const Asm::Operand& to)
+    {
+        if (from == to)
+        {
+            return;
+        }
+
+        if (from.kind == Asm::OperandKind::MEM && to.kind == Asm::OperandKind::MEM)
+        {
+            Emit(Opcode::MOV, from, Reg(Register::EAX));
+            Emit(Opcode::MOV, Reg(Register::EAX), to);
+            return;
+        }
+
+        Emit(Opcode::MOV, from, to);
+    }
+
+    std::string X86Backend::BlockLabel(IR::BlockId block) const
+    {
+        return ".L" + m_Func->name + "_bb" + std::to_string(block);
+    }
+
+    std::string X86Backend::EpilogLabel() const
+    {
+        return ".L" + m_Func->name + "_return";
+    }
+
+    Asm::Cond X86Backend::ToAsmCond(IR::Cond cond) const
+    {
+        switch (cond)
+        {
+        case IR::Cond::EQ: return Asm::Cond::E;
+        case IR::Cond::NE: return Asm::Cond::NE;
+        case IR::Cond::LT: return Asm::Cond::L;
+        case IR::Cond::LE: return Asm::Cond::LE;
+        case IR::Cond::GT: return Asm::Cond::G;
+        case IR::Cond::GE: return Asm::Cond::GE;
+        }
+
+        return Asm::Cond::E;
+    }
+} // namespace CComp
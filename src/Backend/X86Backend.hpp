@@ -0,0 +1,79 @@
+#ifndef CCOMP_X86_BACKEND_HPP
+#define CCOMP_X86_BACKEND_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "FrameLayout.hpp"
+#include "../Asm/Asm.hpp"
+#include "../IR/IR.hpp"
+
+namespace CComp
+{
+    class LinearScan;
+
+    // Emits 32-bit AT&T assembly from IR. Values live in registers chosen by linear scan;
+    // %eax is kept free as a scratch register and spilled values get their own frame slot.
+    class X86Backend
+    {
+    public:
+        X86Backend(std::vector<Asm::Instruction>& out);
+
+        void Compile(IR::Module& module);
+
+    private:
+        std::vector<Asm::Instruction>& m_Out;
+
+        IR::Function* m_Func = nullptr;
+        const LinearScan* m_Alloc = nullptr;
+
+        // ICMPs emitted together with the CONDBR that consumes them.
+        std::vector<bool> m_Fused;
+        FrameLayout m_Frame;
+        size_t m_ReturnJumps = 0;
+
+        void Emit(Asm::Opcode op, Asm::Operand a = Asm::Operand(), Asm::Operand b = Asm::Operand());
+        void Emit(Asm::Opcode op, const std::string& label);
+        void EmitJump(Asm::Cond cond, const std::string& label);
+
+        void MakeHeader();
+        void MakeFooter();
+
+        void CompileFunction(IR::Function& func);
+
+        void EmitBlock(IR::BlockId block, IR::BlockId next);
+        void EmitInstruction(IR::ValueId id, IR::BlockId block, IR::BlockId next);
+        void EmitCondBr(const IR::Instruction& inst, IR::BlockId next);
+        void EmitPhiCopies(IR::BlockId from, IR::BlockId to);
+        void EmitParallelCopies(std::vector<std::pair<Asm::Operand, Asm::Operand>> copies);
+        void EmitBinary(IR::ValueId id, const IR::Instruction& inst);
+        void EmitShift(IR::ValueId id, const IR::Instruction& inst);
+        void EmitDivision(IR::ValueId id, const IR::Instruction& inst);
+        void EmitCompare(IR::ValueId left, IR::ValueId right);
+        void EmitEpilog();
+
+        void FuseCompares();
+        void CollectClobbers(IR::ValueId id, std::vector<int>& clobbers) const;
+
+        // Assembly operand holding the value: an immediate for constants, a register
+        // or a spill slot otherwise.
+        Asm::Operand Operand(IR::ValueId value) const;
+        Asm::Operand SlotOperand(int slot) const;
+
+        bool IsConstant(IR::ValueId value) const;
+        bool IsMemory(IR::ValueId value) const;
+        Asm::Register GetRegister(IR::ValueId value) const;
+
+        // Register to compute the value in: its own register or the scratch one.
+        Asm::Register GetResultRegister(IR::ValueId value) const;
+
+        void Move(const Asm::Operand& from, const Asm::Operand& to);
+
+        std::string BlockLabel(IR::BlockId block) const;
+        std::string EpilogLabel() const;
+        Asm::Cond ToAsmCond(IR::Cond cond) const;
+    }; // class X86Backend
+} // namespace CComp
+
+#endif // CCOMP_X86_BACKEND_HPP
@@ -0,0 +1,93 @@
+#include "Bytecode.hpp"
+
+namespace CComp
+{
+    namespace Bytecode
+    {
+        const Function* Module::FindFunction(const std::string& name) const
+        {
+            for (const Function& func : functions)
+            {
+                if (func.name == name)
+                {
+                    return &func;
+                }
+            }
+
+            return nullptr;
+        }
+
+        bool IsBinary(Opcode op)
+        {
+            switch (op)
+            {
+            case Opcode::ADD:
+            case Opcode::SUB:
+            case Opcode::MUL:
+            case Opcode::DIV:
+            case Opcode::MOD:
+            case Opcode::AND:
+            case Opcode::OR:
+            case Opcode::XOR:
+            case Opcode::SHL:
+            case Opcode::SHR:
+            case Opcode::EQ:
+            case Opcode::NE:
+            case Opcode::LT:
+            case Opcode::LE:
+            case Opcode::GT:
+            case Opcode::GE:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool IsJump(Opcode op)
+        {
+            return op == Opcode::JMP || op == Opcode::JZ || op == Opcode::JNZ;
+        }
+
+        bool HasResult(Opcode op)
+        {
+            return !IsJump(op) && op != Opcode::RET && op != Opcode::COUNT;
+        }
+
+        const char* OpcodeToString(Opcode op)
+        {
+            switch (op)
+            {
+            case Opcode::LOADI: return "loadi";
+            case Opcode::MOV:   return "mov";
+            case Opcode::NEG:   return "neg";
+            case Opcode::NOT:   return "not";
+            case Opcode::LNOT:  return "lnot";
+            case Opcode::BOOL:  return "bool";
+            case Opcode::ADDI:  return "addi";
+            case Opcode::ADD:   return "add";
+            case Opcode::SUB:   return "sub";
+            case Opcode::MUL:   return "mul";
+            case Opcode::DIV:   return "div";
+            case Opcode::MOD:   return "mod";
+            case Opcode::AND:   return "and";
+            case Opcode::OR:    return "or";
+            case Opcode::XOR:   return "xor";
+            case Opcode::SHL:   return "shl";
+            case Opcode::SHR:   return "shr";
+            case Opcode::EQ:    return "eq";
+            case Opcode::NE:    return "ne";
+            case Opcode::LT:    return "lt";
+            case Opcode::LE:    return "le";
+            case Opcode::GT:    return "gt";
+            case Opcode::GE:    return "ge";
+            case Opcode::JMP:   return "jmp";
+            case Opcode::JZ:    return "jz";
+            case Opcode::JNZ:   return "jnz";
+            case Opcode::RET:   return "ret";
+            case Opcode::COUNT: break;
+            }
+
+            return "<unknown>";
+        }
+    } // namespace Bytecode
+} // namespace CComp
@@ -0,0 +1,146 @@
+#ifndef CCOMP_BYTECODE_HPP
+#define CCOMP_BYTECODE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CComp
+{
+    namespace Bytecode
+    {
+        // Registers are indices into the frame of the running function. The first slotCount
+        // registers are the locals, the rest hold temporaries.
+        using Register = uint16_t;
+
+        constexpr size_t gc_MaxRegisterCount = UINT16_MAX;
+
+        enum class Opcode : uint8_t
+        {
+            LOADI,  // dst = imm.
+            MOV,    // dst = a.
+
+            NEG,    // dst = op a.
+            NOT,
+            LNOT,   // dst = a == 0.
+            BOOL,   // dst = a != 0.
+
+            ADDI,   // dst = a + imm.
+
+            ADD,    // dst = a op b.
+            SUB,
+            MUL,
+            DIV,
+            MOD,
+            AND,
+            OR,
+            XOR,
+            SHL,
+            SHR,
+
+            EQ,     // dst = a cond b, 0 or 1.
+            NE,
+            LT,
+            LE,
+            GT,
+            GE,
+
+            JMP,    // Continue at imm.
+            JZ,     // Continue at imm if a == 0.
+            JNZ,    // Continue at imm if a != 0.
+            RET,    // Return a.
+
+            COUNT,
+        }; // enum class Opcode
+
+        // Three-address form: one instruction per operation, without the loads and stores
+        // of a stack machine. imm holds the immediate, the jump target or b.
+        struct Instruction
+        {
+            Opcode op;
+            Register dst;
+            Register a;
+            int32_t imm;
+
+            Instruction(Opcode op, Register dst = 0, Register a = 0, int32_t imm = 0)
+                : op(op), dst(dst), a(a), imm(imm)
+            {}
+
+            Register GetB() const
+            { return static_cast<Register>(imm); }
+        }; // struct Instruction
+
+        static_assert(sizeof(Instruction) == 12, "bytecode instructions are expected to be 12 bytes");
+
+        struct Function
+        {
+            std::string name;
+            size_t slotCount = 0;
+            size_t registerCount = 0;
+
+            std::vector<Instruction> code;
+        }; // struct Function
+
+        struct Module
+        {
+            std::vector<Function> functions;
+
+            // Nullptr if there is no function of that name.
+            const Function* FindFunction(const std::string& name) const;
+        }; // struct Module
+
+        bool IsBinary(Opcode op);
+        bool IsJump(Opcode op);
+
+        // Whether the instruction writes dst.
+        bool HasResult(Opcode op);
+
+        const char* OpcodeToString(Opcode op);
+
+        // 32-bit two's complement arithmetic as the generated x86 code does it: additions
+        // wrap, shift counts are taken modulo 32, and right shifts are arithmetic. Division
+        // returns false where idiv would trap, i.e. on zero and INT_MIN / -1. Inline, since
+        // the interpreters spend most of their time here.
+        inline int32_t Add(int32_t left, int32_t right)
+        { return static_cast<int32_t>(static_cast<uint32_t>(left) + static_cast<uint32_t>(right)); }
+
+        inline int32_t Sub(int32_t left, int32_t right)
+        { return static_cast<int32_t>(static_cast<uint32_t>(left) - static_cast<uint32_t>(right)); }
+
+        inline int32_t Mul(int32_t left, int32_t right)
+        { return static_cast<int32_t>(static_cast<uint32_t>(left) * static_cast<uint32_t>(right)); }
+
+        inline int32_t Neg(int32_t value)
+        { return static_cast<int32_t>(0u - static_cast<uint32_t>(value)); }
+
+        inline int32_t Shl(int32_t left, int32_t right)
+        { return static_cast<int32_t>(static_cast<uint32_t>(left) << (right & 31)); }
+
+        inline int32_t Shr(int32_t left, int32_t right)
+        { return left >> (right & 31); }
+
+        inline bool Div(int32_t left, int32_t right, int32_t& res)
+        {
+            if (right == 0 || (left == INT32_MIN && right == -1))
+            {
+                return false;
+            }
+
+            res = left / right;
+            return true;
+        }
+
+        inline bool Mod(int32_t left, int32_t right, int32_t& res)
+        {
+            if (right == 0 || (left == INT32_MIN && right == -1))
+            {
+                return false;
+            }
+
+            res = left % right;
+            return true;
+        }
+    } // namespace Bytecode
+} // namespace CComp
+
+#endif // CCOMP_BYTECODE_HPP
@@ -0,0 +1,201 @@
+#include "Interpreter.hpp"
+
+#include "../Unreachable.hpp"
+
+#if defined(__GNUC__)
+#define CCOMP_THREADED_DISPATCH
+#endif
+
+#ifdef CCOMP_THREADED_DISPATCH
+#define CCOMP_HANDLER(op) Handle##op:
+#define CCOMP_DISPATCH() goto *s_Handlers[static_cast<size_t>(pc->op)]
+#else
+#define CCOMP_HANDLER(op) case Opcode::op:
+#define CCOMP_DISPATCH() continue
+#endif
+
+#define CCOMP_NEXT() pc++; CCOMP_DISPATCH()
+#define CCOMP_JUMP(target) pc = code + (target); CCOMP_DISPATCH()
+
+namespace CComp
+{
+    namespace Bytecode
+    {
+        bool Interpreter::Run(const std::string& name, int32_t& res)
+        {
+            m_Error.clear();
+
+            const Function* func = m_Module.FindFunction(name);
+            if (func == nullptr)
+            {
+                m_Error = "no function '" + name + "'";
+                return false;
+            }
+
+            return Execute(*func, res);
+        }
+
+        bool Interpreter::Execute(const Function& func, int32_t& res)
+        {
+            // Zeroed, as the tree evaluator's locals are.
+            m_Frame.assign(func.registerCount, 0);
+
+            int32_t* r = m_Frame.data();
+            const Instruction* code = func.code.data();
+            const Instruction* pc = code;
+
+#ifdef CCOMP_THREADED_DISPATCH
+            // In the order of Opcode.
+            static const void* const s_Handlers[] = {
+                &&HandleLOADI, &&HandleMOV,
+                &&HandleNEG, &&HandleNOT, &&HandleLNOT, &&HandleBOOL,
+                &&HandleADDI,
+                &&HandleADD, &&HandleSUB, &&HandleMUL, &&HandleDIV, &&HandleMOD,
+                &&HandleAND, &&HandleOR, &&HandleXOR, &&HandleSHL, &&HandleSHR,
+                &&HandleEQ, &&HandleNE, &&HandleLT, &&HandleLE, &&HandleGT, &&HandleGE,
+                &&HandleJMP, &&HandleJZ, &&HandleJNZ, &&HandleRET,
+            };
+
+            static_assert(sizeof(s_Handlers) / sizeof(s_Handlers[0]) == static_cast<size_t>(Opcode::COUNT),
+                          "every opcode needs a handler");
+
+            CCOMP_DISPATCH();
+#else
+            for (;;)
+            {
+                switch (pc->op)
+                {
+#endif
+            CCOMP_HANDLER(LOADI)
+                r[pc->dst] = pc->imm;
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(MOV)
+                r[pc->dst] = r[pc->a];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(NEG)
+                r[pc->dst] = Neg(r[pc->a]);
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(NOT)
+                r[pc->dst] = ~r[pc->a];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(LNOT)
+                r[pc->dst] = r[pc->a] == 0;
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(BOOL)
+                r[pc->dst] = r[pc->a] != 0;
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(ADDI)
+                r[pc->dst] = Add(r[pc->a], pc->imm);
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(ADD)
+                r[pc->dst] = Add(r[pc->a], r[pc->GetB()]);
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(SUB)
+                r[pc->dst] = Sub(r[pc->a], r[pc->GetB()]);
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(MUL)
+                r[pc->dst] = Mul(r[pc->a], r[pc->GetB()]);
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(DIV)
+                if (!Div(r[pc->a], r[pc->GetB()], r[pc->dst]))
+                {
+                    m_Error = "division by zero or overflow";
+                    return false;
+                }
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(MOD)
+                if (!Mod(r[pc->a], r[pc->GetB()], r[pc->dst]))
+                {
+                    m_Error = "division by zero or overflow";
+                    return false;
+                }
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(AND)
+                r[pc->dst] = r[pc->a] & r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(OR)
+                r[pc->dst] = r[pc->a] | r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(XOR)
+                r[pc->dst] = r[pc->a] ^ r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(SHL)
+                r[pc->dst] = Shl(r[pc->a], r[pc->GetB()]);
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(SHR)
+                r[pc->dst] = Shr(r[pc->a], r[pc->GetB()]);
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(EQ)
+                r[pc->dst] = r[pc->a] == r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(NE)
+                r[pc->dst] = r[pc->a] != r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(LT)
+                r[pc->dst] = r[pc->a] < r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(LE)
+                r[pc->dst] = r[pc->a] <= r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(GT)
+                r[pc->dst] = r[pc->a] > r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(GE)
+                r[pc->dst] = r[pc->a] >= r[pc->GetB()];
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(JMP)
+                CCOMP_JUMP(pc->imm);
+
+            CCOMP_HANDLER(JZ)
+                if (r[pc->a] == 0)
+                {
+                    CCOMP_JUMP(pc->imm);
+                }
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(JNZ)
+                if (r[pc->a] != 0)
+                {
+                    CCOMP_JUMP(pc->imm);
+                }
+                CCOMP_NEXT();
+
+            CCOMP_HANDLER(RET)
+                res = r[pc->a];
+                return true;
+
+#ifndef CCOMP_THREADED_DISPATCH
+                case Opcode::COUNT:
+                    break;
+                }
+
+                Unreachable("invalid bytecode opcode");
+                return false;
+            }
+#endif
+        }
+    } // namespace Bytecode
+} // namespace CComp
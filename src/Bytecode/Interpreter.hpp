@@ -0,0 +1,40 @@
+#ifndef CCOMP_BYTECODE_INTERPRETER_HPP
+#define CCOMP_BYTECODE_INTERPRETER_HPP
+
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+
+namespace CComp
+{
+    namespace Bytecode
+    {
+        // Runs bytecode with threaded dispatch where the compiler supports computed gotos:
+        // every handler jumps straight to the next one, so each has its own indirect branch
+        // for the predictor. Elsewhere it falls back to a switch in a loop.
+        class Interpreter
+        {
+        public:
+            explicit Interpreter(const Module& module)
+                : m_Module(module)
+            {}
+
+            // Calls the function and stores what it returned in res. False if there is no
+            // such function or the program trapped, with the reason in GetError().
+            bool Run(const std::string& name, int32_t& res);
+
+            const std::string& GetError() const
+            { return m_Error; }
+
+        private:
+            const Module& m_Module;
+            std::vector<int32_t> m_Frame;
+            std::string m_Error;
+
+            bool Execute(const Function& func, int32_t& res);
+        }; // class Interpreter
+    } // namespace Bytecode
+} // namespace CComp
+
+#endif // CCOMP_BYTECODE_INTERPRETER_HPP
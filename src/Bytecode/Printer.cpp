@@ -0,0 +1,76 @@
+#include "Printer.hpp"
+
+#include <iomanip>
+
+namespace CComp
+{
+    namespace Bytecode
+    {
+        static void PrintInstruction(std::ostream& out, const Instruction& inst)
+        {
+            out << OpcodeToString(inst.op);
+
+            switch (inst.op)
+            {
+            case Opcode::LOADI:
+                out << " r" << inst.dst << ", " << inst.imm;
+                break;
+
+            case Opcode::ADDI:
+                out << " r" << inst.dst << ", r" << inst.a << ", " << inst.imm;
+                break;
+
+            case Opcode::JMP:
+                out << " " << inst.imm;
+                break;
+
+            case Opcode::JZ:
+            case Opcode::JNZ:
+                out << " r" << inst.a << ", " << inst.imm;
+                break;
+
+            case Opcode::RET:
+                out << " r" << inst.a;
+                break;
+
+            default:
+                out << " r" << inst.dst << ", r" << inst.a;
+
+                if (IsBinary(inst.op))
+                {
+                    out << ", r" << inst.GetB();
+                }
+                break;
+            }
+
+            out << "\n";
+        }
+
+        void PrintFunction(std::ostream& out, const Function& func)
+        {
+            out << "function " << func.name << " (slots: " << func.slotCount
+                << ", registers: " << func.registerCount << ") {\n";
+
+            for (size_t i = 0; i < func.code.size(); i++)
+            {
+                out << std::setw(6) << i << "  ";
+                PrintInstruction(out, func.code[i]);
+            }
+
+            out << "}\n";
+        }
+
+        void PrintModule(std::ostream& out, const Module& module)
+        {
+            for (size_t i = 0; i < module.functions.size(); i++)
+            {
+                if (i != 0)
+                {
+                    out << "\n";
+                }
+
+                PrintFunction(out, module.functions[i]);
+            }
+        }
+    } // namespace Bytecode
+} // namespace CComp
@@ -0,0 +1,17 @@
+#ifndef CCOMP_BYTECODE_PRINTER_HPP
+#define CCOMP_BYTECODE_PRINTER_HPP
+
+#include <ostream>
+
+#include "Bytecode.hpp"
+
+namespace CComp
+{
+    namespace Bytecode
+    {
+        void PrintFunction(std::ostream& out, const Function& func);
+        void PrintModule(std::ostream& out, const Module& module);
+    } // namespace Bytecode
+} // namespace CComp
+
+#endif // CCOMP_BYTECODE_PRINTER_HPP
@@ -1,11 +1,30 @@
 #ifndef CCOMP_FILE_HPP
 #define CCOMP_FILE_HPP
 
+#include <string>
 #include <vector>
 
 namespace CComp
 {
-    using File = std::vector<char>;
+    struct File
+    {
+        using const_iterator = std::vector<char>::const_iterator;
+
+        std::string path;
+        std::vector<char> contents;
+
+        File(const std::string& path, std::vector<char> contents)
+            : path(path),
+              contents(std::move(contents))
+        {}
+
+        const_iterator begin() const
+        { return contents.begin(); }
+
+        const_iterator end() const
+        { return contents.end(); }
+    }; // struct File
+
 } // namespace CComp
 
 #endif // CCOMP_FILE_HPP
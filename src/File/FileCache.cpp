@@ -0,0 +1,130 @@
+#include "FileCache.hpp"
+
+#include <chrono>
+#include <string_view>
+#include <system_error>
+
+#include "Reader.hpp"
+#include "../Statistics.hpp"
+
+namespace CComp
+{
+    namespace
+    {
+        // Coarser than the modification times of any file system in use.
+        constexpr std::chrono::seconds gc_RacyWindow(2);
+
+        size_t HashContents(const File& file)
+        {
+            return std::hash<std::string_view>()(std::string_view(file.contents.data(), file.contents.size()));
+        }
+    } // namespace
+
+    FileCache::FileCache(size_t capacity)
+        : m_Capacity(capacity)
+    {}
+
+    std::shared_ptr<const File> FileCache::Read(const std::filesystem::path& path)
+    {
+        std::error_code error;
+
+        std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        if (error)
+        {
+            return ReadFileFromDisk(path);
+        }
+
+        // Taken before reading, so a change made in between shows up next time.
+        Stamp stamp;
+        stamp.modified = std::filesystem::last_write_time(absolute, error);
+        stamp.size = error ? 0 : std::filesystem::file_size(absolute, error);
+        if (error)
+        {
+            return nullptr;
+        }
+
+        Key key(absolute.lexically_normal().string(), path.string());
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            auto found = m_Entries.find(key);
+            if (found != m_Entries.end() && found->second.stamp == stamp && !found->second.racy)
+            {
+                AddStatistic("file-cache", "hits", 1);
+                m_Recent.splice(m_Recent.begin(), m_Recent, found->second.recent);
+                return found->second.file;
+            }
+        }
+
+        std::shared_ptr<const File> file = ReadFileFromDisk(path);
+        if (file == nullptr)
+        {
+            return nullptr;
+        }
+
+        Entry entry;
+        entry.file = file;
+        entry.stamp = stamp;
+        entry.hash = HashContents(*file);
+        entry.racy = std::filesystem::file_time_type::clock::now() - stamp.modified < gc_RacyWindow;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto found = m_Entries.find(key);
+        if (found != m_Entries.end() && found->second.hash == entry.hash
+            && found->second.file->contents == file->contents)
+        {
+            // Touched but not changed: later compilations keep seeing the same File.
+            AddStatistic("file-cache", "revalidated", 1);
+            entry.file = found->second.file;
+        }
+        else
+        {
+            AddStatistic("file-cache", "misses", 1);
+        }
+
+        Store(key, entry);
+        return entry.file;
+    }
+
+    size_t FileCache::GetSize() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Entries.size();
+    }
+
+    size_t FileCache::GetByteCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Bytes;
+    }
+
+    void FileCache::Store(const Key& key, Entry entry)
+    {
+        auto found = m_Entries.find(key);
+        if (found != m_Entries.end())
+        {
+            m_Bytes -= found->second.file->contents.size();
+            m_Recent.erase(found->second.recent);
+            m_Entries.erase(found);
+        }
+
+        m_Bytes += entry.file->contents.size();
+        m_Recent.push_front(key);
+        entry.recent = m_Recent.begin();
+        m_Entries.emplace(key, std::move(entry));
+
+        // The newest entry stays even when it alone is over the capacity.
+        while (m_Bytes > m_Capacity && m_Recent.size() > 1)
+        {
+            auto oldest = m_Entries.find(m_Recent.back());
+
+            m_Bytes -= oldest->second.file->contents.size();
+            m_Entries.erase(oldest);
+            m_Recent.pop_back();
+
+            AddStatistic("file-cache", "evicted", 1);
+        }
+    }
+} // namespace CComp
@@ -0,0 +1,81 @@
+#ifndef CCOMP_FILE_FILE_CACHE_HPP
+#define CCOMP_FILE_FILE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "File.hpp"
+
+namespace CComp
+{
+    // What the compile server keeps of source files unless told otherwise.
+    constexpr size_t gc_DefaultFileCacheCapacity = 128 * 1024 * 1024;
+
+    // Source files kept in memory between compilations, for the compile server. An entry
+    // is trusted while the file's modification time and size stay as they were. When they
+    // change the file is read again, and kept as it was if its contents hash the same.
+    // Once the contents held pass the capacity, the files used longest ago are dropped.
+    // Safe to use from several threads.
+    class FileCache
+    {
+    public:
+        // In bytes of file contents.
+        explicit FileCache(size_t capacity = gc_DefaultFileCacheCapacity);
+
+        // Nullptr if the file cannot be read, as with ReadFile.
+        std::shared_ptr<const File> Read(const std::filesystem::path& path);
+
+        size_t GetSize() const;
+
+        // Bytes of file contents held.
+        size_t GetByteCount() const;
+
+    private:
+        struct Stamp
+        {
+            std::filesystem::file_time_type modified;
+            uintmax_t size;
+
+            bool operator==(const Stamp& other) const
+            { return modified == other.modified && size == other.size; }
+        }; // struct Stamp
+
+        using Key = std::pair<std::string, std::string>;
+
+        struct Entry
+        {
+            std::shared_ptr<const File> file;
+            Stamp stamp;
+            size_t hash;
+
+            // Read so soon after it was written that a change within the same tick of the
+            // file system's clock would leave the stamp as it is.
+            bool racy;
+
+            // Where the entry is in m_Recent.
+            std::list<Key>::iterator recent;
+        }; // struct Entry
+
+        size_t m_Capacity;
+        size_t m_Bytes = 0;
+
+        mutable std::mutex m_Mutex;
+
+        // By absolute path, and by the path as given, which diagnostics show.
+        std::map<Key, Entry> m_Entries;
+
+        // The keys, most recently used first.
+        std::list<Key> m_Recent;
+
+        void Store(const Key& key, Entry entry);
+    }; // class FileCache
+} // namespace CComp
+
+#endif // CCOMP_FILE_FILE_CACHE_HPP
@@ -11,10 +11,12 @@ namespace CComp
     struct FilePosition
     {
         size_t line;
+        size_t column;
         std::shared_ptr<const File> file;
 
-        FilePosition(size_t line, std::shared_ptr<const File> file)
+        FilePosition(size_t line, size_t column, std::shared_ptr<const File> file)
             : line(line),
+              column(column),
               file(file)
         {}
     }; // struct FilePosition
@@ -0,0 +1,142 @@
+#include "OutputBuffer.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace CComp
+{
+    namespace
+    {
+        constexpr size_t gc_IndentWidth = 4;
+        constexpr size_t gc_CachedIndentLevels = 16;
+
+        // Longer than any integer std::to_chars produces.
+        constexpr size_t gc_MaxIntegerLength = 24;
+
+        const std::string& GetIndentation()
+        {
+            static const std::string indentation(gc_IndentWidth * gc_CachedIndentLevels, ' ');
+            return indentation;
+        }
+    } // namespace
+
+    OutputBuffer::OutputBuffer(int fd, size_t capacity)
+        : m_Fd(fd), m_Data(new char[capacity]), m_Capacity(capacity)
+    {}
+
+    OutputBuffer::OutputBuffer(std::ostream& out, size_t capacity)
+        : m_Stream(&out), m_Data(new char[capacity]), m_Capacity(capacity)
+    {}
+
+    OutputBuffer::~OutputBuffer()
+    {
+        Flush();
+    }
+
+    void OutputBuffer::Put(const char* str, size_t size)
+    {
+        if (size > m_Capacity - m_Size)
+        {
+            Flush();
+
+            // Too large to be worth copying.
+            if (size > m_Capacity)
+            {
+                WriteOut(str, size);
+                return;
+            }
+        }
+
+        std::memcpy(m_Data.get() + m_Size, str, size);
+        m_Size += size;
+    }
+
+    void OutputBuffer::Put(const char* str)
+    {
+        Put(str, std::strlen(str));
+    }
+
+    void OutputBuffer::PutInt(int64_t value)
+    {
+        if (m_Capacity - m_Size < gc_MaxIntegerLength)
+        {
+            Flush();
+        }
+
+        char* begin = m_Data.get() + m_Size;
+        m_Size += static_cast<size_t>(std::to_chars(begin, begin + gc_MaxIntegerLength, value).ptr - begin);
+    }
+
+    void OutputBuffer::PutHex(uint64_t value)
+    {
+        if (m_Capacity - m_Size < gc_MaxIntegerLength)
+        {
+            Flush();
+        }
+
+        char* begin = m_Data.get() + m_Size;
+        m_Size += static_cast<size_t>(std::to_chars(begin, begin + gc_MaxIntegerLength, value, 16).ptr - begin);
+    }
+
+    void OutputBuffer::Indent(size_t level)
+    {
+        const std::string& indentation = GetIndentation();
+
+        for (; level > gc_CachedIndentLevels; level -= gc_CachedIndentLevels)
+        {
+            Put(indentation);
+        }
+
+        Put(indentation.data(), level * gc_IndentWidth);
+    }
+
+    bool OutputBuffer::Flush()
+    {
+        if (m_Size != 0)
+        {
+            WriteOut(m_Data.get(), m_Size);
+            m_Size = 0;
+        }
+
+        return !m_Failed;
+    }
+
+    void OutputBuffer::WriteOut(const char* data, size_t size)
+    {
+        if (m_Failed)
+        {
+            return;
+        }
+
+        if (m_Stream != nullptr)
+        {
+            m_Stream->write(data, static_cast<std::streamsize>(size));
+            m_Failed = !*m_Stream;
+            m_Written += size;
+            return;
+        }
+
+        // write() may take less than it was given, e.g. when the other end is a pipe.
+        while (size != 0)
+        {
+            ssize_t res = write(m_Fd, data, size);
+            if (res < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                m_Failed = true;
+                return;
+            }
+
+            data += res;
+            size -= static_cast<size_t>(res);
+            m_Written += static_cast<size_t>(res);
+        }
+    }
+} // namespace CComp
@@ -0,0 +1,73 @@
+#ifndef CCOMP_FILE_OUTPUT_BUFFER_HPP
+#define CCOMP_FILE_OUTPUT_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace CComp
+{
+    constexpr size_t gc_OutputBufferSize = 1 << 20;
+
+    // Collects text in one preallocated buffer and hands it on a full buffer at a time:
+    // with a single write() to a file descriptor, or a single write to an ostream. Numbers
+    // are formatted with std::to_chars, which does not consult the locale.
+    class OutputBuffer
+    {
+    public:
+        explicit OutputBuffer(int fd, size_t capacity = gc_OutputBufferSize);
+        explicit OutputBuffer(std::ostream& out, size_t capacity = gc_OutputBufferSize);
+
+        ~OutputBuffer();
+
+        OutputBuffer(const OutputBuffer&) = delete;
+        OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+        void Put(char c)
+        {
+            if (m_Size == m_Capacity)
+            {
+                Flush();
+            }
+
+            m_Data[m_Size++] = c;
+        }
+
+        void Put(const char* str, size_t size);
+
+        void Put(const char* str);
+
+        void Put(const std::string& str)
+        { Put(str.data(), str.size()); }
+
+        void PutInt(int64_t value);
+        void PutHex(uint64_t value);
+
+        // level steps of gc_IndentWidth spaces, copied from a prefix made once.
+        void Indent(size_t level);
+
+        // Hands everything buffered on. False if writing failed, now or before.
+        bool Flush();
+
+        // Bytes handed on by Flush so far.
+        size_t GetBytesWritten() const
+        { return m_Written; }
+
+    private:
+        int m_Fd = -1;
+        std::ostream* m_Stream = nullptr;
+
+        std::unique_ptr<char[]> m_Data;
+        size_t m_Size = 0;
+        size_t m_Capacity;
+
+        size_t m_Written = 0;
+        bool m_Failed = false;
+
+        void WriteOut(const char* data, size_t size);
+    }; // class OutputBuffer
+} // namespace CComp
+
+#endif // CCOMP_FILE_OUTPUT_BUFFER_HPP
@@ -1,10 +1,31 @@
 #include "Reader.hpp"
 
+#include <atomic>
 #include <fstream>
 
+#include "FileCache.hpp"
+#include "../AllocationCounter.hpp"
+#include "../TimeReport.hpp"
+
 namespace CComp
 {
-    std::shared_ptr<File> ReadFile(std::filesystem::path path)
+    std::atomic<FileCache*> g_FileCache = nullptr;
+
+    std::shared_ptr<const File> ReadFile(std::filesystem::path path)
+    {
+        ScopedTimer timer(TimedPhase::READ);
+        ScopedMemoryCategory memory(MemoryCategory::SOURCE);
+
+        FileCache* cache = g_FileCache.load();
+        if (cache != nullptr)
+        {
+            return cache->Read(path);
+        }
+
+        return ReadFileFromDisk(path);
+    }
+
+    std::shared_ptr<File> ReadFileFromDisk(const std::filesystem::path& path)
     {
         std::ifstream file(path);
         if (!file)
@@ -13,9 +34,15 @@ namespace CComp
         }
 
         std::shared_ptr<File> res =
-            std::make_shared<File>(std::istreambuf_iterator<char>(file),
-                                   std::istreambuf_iterator<char>());
+            std::make_shared<File>(path.string(),
+                                   std::vector<char>(std::istreambuf_iterator<char>(file),
+                                                     std::istreambuf_iterator<char>()));
 
         return res;
     }
+
+    void SetFileCache(FileCache* cache)
+    {
+        g_FileCache = cache;
+    }
 }
@@ -8,7 +8,15 @@
 
 namespace CComp
 {
-    std::shared_ptr<File> ReadFile(std::filesystem::path path);
+    class FileCache;
+
+    // Through the file cache, if one is set.
+    std::shared_ptr<const File> ReadFile(std::filesystem::path path);
+
+    std::shared_ptr<File> ReadFileFromDisk(const std::filesystem::path& path);
+
+    // Makes ReadFile, on every thread, go through cache; nullptr reads from disk again.
+    void SetFileCache(FileCache* cache);
 } // namespace CComp
 
 #endif // CCOMP_FILE_READER_HPP
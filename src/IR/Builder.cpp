@@ -0,0 +1,98 @@
+#include "Builder.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        Builder::Builder(Function& func)
+            : m_Func(func)
+        {}
+
+        BlockId Builder::CreateBlock()
+        {
+            m_Func.blocks.emplace_back();
+            return static_cast<BlockId>(m_Func.blocks.size() - 1);
+        }
+
+        bool Builder::IsTerminated() const
+        {
+            const BasicBlock& bb = m_Func.blocks[m_Block];
+            return !bb.insts.empty() && IsTerminator(m_Func.insts[bb.insts.back()].op);
+        }
+
+        ValueId Builder::Const(Type type, int32_t value)
+        {
+            return Append(Instruction(Opcode::CONST, type, NO_VALUE, NO_VALUE, value));
+        }
+
+        ValueId Builder::Binary(Opcode op, ValueId left, ValueId right)
+        {
+            return Append(Instruction(op, Type::I32, left, right));
+        }
+
+        ValueId Builder::Unary(Opcode op, ValueId value)
+        {
+            return Append(Instruction(op, Type::I32, value));
+        }
+
+        ValueId Builder::ICmp(Cond cond, ValueId left, ValueId right)
+        {
+            return Append(Instruction(Opcode::ICMP, Type::I1, left, right, static_cast<int32_t>(cond)));
+        }
+
+        ValueId Builder::ZExt(ValueId value)
+        {
+            return Append(Instruction(Opcode::ZEXT, Type::I32, value));
+        }
+
+        ValueId Builder::Phi(Type type, const std::vector<PhiIncoming>& incoming)
+        {
+            ValueId start = static_cast<ValueId>(m_Func.phiArgs.size());
+            m_Func.phiArgs.insert(m_Func.phiArgs.end(), incoming.begin(), incoming.end());
+
+            return Append(Instruction(Opcode::PHI, type, start, static_cast<ValueId>(incoming.size())));
+        }
+
+        ValueId Builder::Load(int slot)
+        {
+            return Append(Instruction(Opcode::LOAD, Type::I32, NO_VALUE, NO_VALUE, slot));
+        }
+
+        void Builder::Store(int slot, ValueId value)
+        {
+            Append(Instruction(Opcode::STORE, Type::VOID, value, NO_VALUE, slot));
+        }
+
+        void Builder::Br(BlockId target)
+        {
+            Append(Instruction(Opcode::BR, Type::VOID, NO_VALUE, NO_VALUE, static_cast<int32_t>(target)));
+            m_Func.blocks[target].preds.push_back(m_Block);
+        }
+
+        void Builder::CondBr(ValueId cond, BlockId ifTrue, BlockId ifFalse)
+        {
+            Append(Instruction(Opcode::CONDBR, Type::VOID, cond, ifTrue, static_cast<int32_t>(ifFalse)));
+            m_Func.blocks[ifTrue].preds.push_back(m_Block);
+
+            if (ifFalse != ifTrue)
+            {
+                m_Func.blocks[ifFalse].preds.push_back(m_Block);
+            }
+        }
+
+        void Builder::Ret(ValueId value)
+        {
+            Append(Instruction(Opcode::RET, Type::VOID, value));
+        }
+
+        ValueId Builder::Append(const Instruction& inst)
+        {
+            m_Func.insts.push_back(inst);
+
+            ValueId id = static_cast<ValueId>(m_Func.insts.size() - 1);
+            m_Func.blocks[m_Block].insts.push_back(id);
+
+            return id;
+        }
+    } // namespace IR
+} // namespace CComp
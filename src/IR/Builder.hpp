@@ -0,0 +1,49 @@
+#ifndef CCOMP_IR_BUILDER_HPP
+#define CCOMP_IR_BUILDER_HPP
+
+#include "IR.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        // Appends instructions to the end of a block and keeps predecessor lists up to date.
+        class Builder
+        {
+        public:
+            Builder(Function& func);
+
+            BlockId CreateBlock();
+
+            void SetInsertBlock(BlockId block)
+            { m_Block = block; }
+
+            BlockId GetInsertBlock() const
+            { return m_Block; }
+
+            bool IsTerminated() const;
+
+            ValueId Const(Type type, int32_t value);
+            ValueId Binary(Opcode op, ValueId left, ValueId right);
+            ValueId Unary(Opcode op, ValueId value);
+            ValueId ICmp(Cond cond, ValueId left, ValueId right);
+            ValueId ZExt(ValueId value);
+            ValueId Phi(Type type, const std::vector<PhiIncoming>& incoming);
+
+            ValueId Load(int slot);
+            void Store(int slot, ValueId value);
+
+            void Br(BlockId target);
+            void CondBr(ValueId cond, BlockId ifTrue, BlockId ifFalse);
+            void Ret(ValueId value);
+
+        private:
+            Function& m_Func;
+            BlockId m_Block = NO_BLOCK;
+
+            ValueId Append(const Instruction& inst);
+        }; // class Builder
+    } // namespace IR
+} // namespace CComp
+
+#endif // CCOMP_IR_BUILDER_HPP
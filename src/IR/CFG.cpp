@@ -0,0 +1,290 @@
+#include "CFG.hpp"
+
+#include <algorithm>
+
+namespace CComp
+{
+    namespace IR
+    {
+        std::vector<BlockId> ComputeReversePostOrder(const Function& func)
+        {
+            std::vector<BlockId> postOrder;
+            std::vector<bool> visited(func.blocks.size(), false);
+
+            // Explicit stack of (block, next successor index) to survive very long chains of blocks.
+            std::vector<std::pair<BlockId, size_t>> stack;
+            std::vector<std::vector<BlockId>> succs(func.blocks.size());
+
+            stack.push_back({ func.entry, 0 });
+            visited[func.entry] = true;
+            succs[func.entry] = GetSuccessors(func, func.entry);
+
+            while (!stack.empty())
+            {
+                auto& [block, next] = stack.back();
+
+                if (next < succs[block].size())
+                {
+                    BlockId succ = succs[block][next++];
+
+                    if (!visited[succ])
+                    {
+                        visited[succ] = true;
+                        succs[succ] = GetSuccessors(func, succ);
+                        stack.push_back({ succ, 0 });
+                    }
+                }
+                else
+                {
+                    postOrder.push_back(block);
+                    stack.pop_back();
+                }
+            }
+
+            std::reverse(postOrder.begin(), postOrder.end());
+            return postOrder;
+        }
+
+        std::vector<BlockId> ComputeDominators(const Function& func)
+        {
+            // Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+            std::vector<BlockId> rpo = ComputeReversePostOrder(func);
+            std::vector<size_t> order(func.blocks.size(), SIZE_MAX);
+
+            for (size_t i = 0; i < rpo.size(); i++)
+            {
+                order[rpo[i]] = i;
+            }
+
+            std::vector<BlockId> idom(func.blocks.size(), NO_BLOCK);
+            idom[func.entry] = func.entry;
+
+            auto intersect = [&] (BlockId a, BlockId b)
+            {
+                while (a != b)
+                {
+                    while (order[a] > order[b])
+                    {
+                        a = idom[a];
+                    }
+
+                    while (order[b] > order[a])
+                    {
+                        b = idom[b];
+                    }
+                }
+
+                return a;
+            };
+
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+
+                for (size_t i = 1; i < rpo.size(); i++)
+                {
+                    BlockId block = rpo[i];
+                    BlockId newIdom = NO_BLOCK;
+
+                    for (BlockId pred : func.blocks[block].preds)
+                    {
+                        if (order[pred] == SIZE_MAX || idom[pred] == NO_BLOCK)
+                        {
+                            continue;
+                        }
+
+                        newIdom = newIdom == NO_BLOCK ? pred : intersect(pred, newIdom);
+                    }
+
+                    if (idom[block] != newIdom)
+                    {
+                        idom[block] = newIdom;
+                        changed = true;
+                    }
+                }
+            }
+
+            return idom;
+        }
+
+        bool Dominates(const std::vector<BlockId>& idom, BlockId dominator, BlockId block)
+        {
+            while (block != NO_BLOCK)
+            {
+                if (block == dominator)
+                {
+                    return true;
+                }
+
+                if (idom[block] == block)
+                {
+                    return false;
+                }
+
+                block = idom[block];
+            }
+
+            return false;
+        }
+
+        static void RemapTerminator(Instruction& inst, const std::vector<BlockId>& map)
+        {
+            if (inst.op == Opcode::BR)
+            {
+                inst.imm = static_cast<int32_t>(map[inst.imm]);
+            }
+            else if (inst.op == Opcode::CONDBR)
+            {
+                inst.operands[1] = map[inst.operands[1]];
+                inst.imm = static_cast<int32_t>(map[inst.imm]);
+            }
+        }
+
+        void RemoveUnreachableBlocks(Function& func)
+        {
+            std::vector<BlockId> rpo = ComputeReversePostOrder(func);
+            if (rpo.size() == func.blocks.size())
+            {
+                return;
+            }
+
+            std::vector<BlockId> map(func.blocks.size(), NO_BLOCK);
+            std::vector<bool> reachable(func.blocks.size(), false);
+
+            for (BlockId block : rpo)
+            {
+                reachable[block] = true;
+            }
+
+            std::vector<BasicBlock> blocks;
+
+            for (BlockId block = 0; block < func.blocks.size(); block++)
+            {
+                if (reachable[block])
+                {
+                    map[block] = static_cast<BlockId>(blocks.size());
+                    blocks.push_back(std::move(func.blocks[block]));
+                }
+            }
+
+            for (BasicBlock& bb : blocks)
+            {
+                std::vector<BlockId> preds;
+
+                for (BlockId pred : bb.preds)
+                {
+                    if (map[pred] != NO_BLOCK)
+                    {
+                        preds.push_back(map[pred]);
+                    }
+                }
+
+                bb.preds = std::move(preds);
+
+                for (ValueId id : bb.insts)
+                {
+                    Instruction& inst = func.insts[id];
+
+                    if (inst.op == Opcode::PHI)
+                    {
+                        ValueId start = static_cast<ValueId>(func.phiArgs.size());
+
+                        for (ValueId i = 0; i < inst.operands[1]; i++)
+                        {
+                            PhiIncoming incoming = func.phiArgs[inst.operands[0] + i];
+
+                            if (map[incoming.block] != NO_BLOCK)
+                            {
+                                func.phiArgs.push_back({ incoming.value, map[incoming.block] });
+                            }
+                        }
+
+                        inst.operands[0] = start;
+                        inst.operands[1] = static_cast<ValueId>(func.phiArgs.size() - start);
+                    }
+
+                    RemapTerminator(inst, map);
+                }
+            }
+
+            func.blocks = std::move(blocks);
+            func.entry = map[func.entry];
+        }
+
+        void SplitCriticalEdges(Function& func)
+        {
+            size_t blockCount = func.blocks.size();
+
+            for (BlockId block = 0; block < blockCount; block++)
+            {
+                std::vector<BlockId> succs = GetSuccessors(func, block);
+                if (succs.size() < 2)
+                {
+                    continue;
+                }
+
+                for (BlockId succ : succs)
+                {
+                    if (func.blocks[succ].preds.size() < 2)
+                    {
+                        continue;
+                    }
+
+                    BlockId edge = static_cast<BlockId>(func.blocks.size());
+                    func.blocks.emplace_back();
+
+                    func.insts.push_back(Instruction(Opcode::BR, Type::VOID, NO_VALUE, NO_VALUE,
+                                                     static_cast<int32_t>(succ)));
+                    func.blocks[edge].insts.push_back(static_cast<ValueId>(func.insts.size() - 1));
+                    func.blocks[edge].preds.push_back(block);
+
+                    Instruction& term = func.insts[func.blocks[block].insts.back()];
+                    if (term.operands[1] == succ)
+                    {
+                        term.operands[1] = edge;
+                    }
+                    else
+                    {
+                        term.imm = static_cast<int32_t>(edge);
+                    }
+
+                    std::replace(func.blocks[succ].preds.begin(), func.blocks[succ].preds.end(), block, edge);
+
+                    for (ValueId id : func.blocks[succ].insts)
+                    {
+                        const Instruction& inst = func.insts[id];
+                        if (inst.op != Opcode::PHI)
+                        {
+                            break;
+                        }
+
+                        for (ValueId i = 0; i < inst.operands[1]; i++)
+                        {
+                            PhiIncoming& incoming = func.phiArgs[inst.operands[0] + i];
+                            if (incoming.block == block)
+                            {
+                                incoming.block = edge;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<BlockId> ComputeInstructionBlocks(const Function& func)
+        {
+            std::vector<BlockId> res(func.insts.size(), NO_BLOCK);
+
+            for (BlockId block = 0; block < func.blocks.size(); block++)
+            {
+                for (ValueId id : func.blocks[block].insts)
+                {
+                    res[id] = block;
+                }
+            }
+
+            return res;
+        }
+    } // namespace IR
+} // namespace CComp
@@ -0,0 +1,30 @@
+#ifndef CCOMP_IR_CFG_HPP
+#define CCOMP_IR_CFG_HPP
+
+#include "IR.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        // Reachable blocks, entry first.
+        std::vector<BlockId> ComputeReversePostOrder(const Function& func);
+
+        // Immediate dominator of every block. The entry dominates itself, unreachable blocks get NO_BLOCK.
+        std::vector<BlockId> ComputeDominators(const Function& func);
+
+        bool Dominates(const std::vector<BlockId>& idom, BlockId dominator, BlockId block);
+
+        // Drops blocks that cannot be reached from the entry and renumbers the rest.
+        void RemoveUnreachableBlocks(Function& func);
+
+        // Inserts an empty block on every edge from a block with several successors
+        // to a block with several predecessors, so phis can be lowered to copies.
+        void SplitCriticalEdges(Function& func);
+
+        // Maps each instruction to the block that contains it, NO_BLOCK if it was removed.
+        std::vector<BlockId> ComputeInstructionBlocks(const Function& func);
+    } // namespace IR
+} // namespace CComp
+
+#endif // CCOMP_IR_CFG_HPP
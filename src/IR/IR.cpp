@@ -0,0 +1,172 @@
+#include "IR.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        bool IsTerminator(Opcode op)
+        {
+            return op == Opcode::BR || op == Opcode::CONDBR || op == Opcode::RET;
+        }
+
+        bool IsBinary(Opcode op)
+        {
+            switch (op)
+            {
+            case Opcode::ADD:
+            case Opcode::SUB:
+            case Opcode::MUL:
+            case Opcode::SDIV:
+            case Opcode::SREM:
+            case Opcode::AND:
+            case Opcode::OR:
+            case Opcode::XOR:
+            case Opcode::SHL:
+            case Opcode::ASHR:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool IsUnary(Opcode op)
+        {
+            return op == Opcode::NEG || op == Opcode::NOT;
+        }
+
+        size_t GetOperandCount(const Instruction& inst)
+        {
+            if (IsBinary(inst.op) || inst.op == Opcode::ICMP)
+            {
+                return 2;
+            }
+
+            switch (inst.op)
+            {
+            case Opcode::NEG:
+            case Opcode::NOT:
+            case Opcode::ZEXT:
+            case Opcode::STORE:
+            case Opcode::CONDBR:
+            case Opcode::RET:
+                return 1;
+            default:
+                return 0;
+            }
+        }
+
+        void GetSuccessors(const Instruction& inst, BlockId& first, BlockId& second)
+        {
+            first = NO_BLOCK;
+            second = NO_BLOCK;
+
+            if (inst.op == Opcode::BR)
+            {
+                first = static_cast<BlockId>(inst.imm);
+            }
+            else if (inst.op == Opcode::CONDBR)
+            {
+                first = inst.operands[1];
+                second = static_cast<BlockId>(inst.imm);
+            }
+        }
+
+        std::vector<BlockId> GetSuccessors(const Function& func, BlockId block)
+        {
+            std::vector<BlockId> res;
+
+            const BasicBlock& bb = func.blocks[block];
+            if (bb.insts.empty())
+            {
+                return res;
+            }
+
+            BlockId first, second;
+            GetSuccessors(func.insts[bb.insts.back()], first, second);
+
+            if (first != NO_BLOCK)
+            {
+                res.push_back(first);
+            }
+
+            if (second != NO_BLOCK && second != first)
+            {
+                res.push_back(second);
+            }
+
+            return res;
+        }
+
+        const char* OpcodeToString(Opcode op)
+        {
+            switch (op)
+            {
+            case Opcode::CONST:  return "const";
+            case Opcode::ADD:    return "add";
+            case Opcode::SUB:    return "sub";
+            case Opcode::MUL:    return "mul";
+            case Opcode::SDIV:   return "sdiv";
+            case Opcode::SREM:   return "srem";
+            case Opcode::AND:    return "and";
+            case Opcode::OR:     return "or";
+            case Opcode::XOR:    return "xor";
+            case Opcode::SHL:    return "shl";
+            case Opcode::ASHR:   return "ashr";
+            case Opcode::NEG:    return "neg";
+            case Opcode::NOT:    return "not";
+            case Opcode::ICMP:   return "icmp";
+            case Opcode::ZEXT:   return "zext";
+            case Opcode::PHI:    return "phi";
+            case Opcode::LOAD:   return "load";
+            case Opcode::STORE:  return "store";
+            case Opcode::BR:     return "br";
+            case Opcode::CONDBR: return "condbr";
+            case Opcode::RET:    return "ret";
+            }
+
+            return "?";
+        }
+
+        const char* TypeToString(Type type)
+        {
+            switch (type)
+            {
+            case Type::VOID: return "void";
+            case Type::I1:   return "i1";
+            case Type::I32:  return "i32";
+            }
+
+            return "?";
+        }
+
+        const char* CondToString(Cond cond)
+        {
+            switch (cond)
+            {
+            case Cond::EQ: return "eq";
+            case Cond::NE: return "ne";
+            case Cond::LT: return "slt";
+            case Cond::LE: return "sle";
+            case Cond::GT: return "sgt";
+            case Cond::GE: return "sge";
+            }
+
+            return "?";
+        }
+
+        bool EvaluateCond(Cond cond, int32_t left, int32_t right)
+        {
+            switch (cond)
+            {
+            case Cond::EQ: return left == right;
+            case Cond::NE: return left != right;
+            case Cond::LT: return left < right;
+            case Cond::LE: return left <= right;
+            case Cond::GT: return left > right;
+            case Cond::GE: return left >= right;
+            }
+
+            return false;
+        }
+    } // namespace IR
+} // namespace CComp
@@ -0,0 +1,132 @@
+#ifndef CCOMP_IR_HPP
+#define CCOMP_IR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CComp
+{
+    namespace IR
+    {
+        // Values and blocks are referred to by their index in the owning function.
+        using ValueId = uint32_t;
+        using BlockId = uint32_t;
+
+        constexpr ValueId NO_VALUE = UINT32_MAX;
+        constexpr BlockId NO_BLOCK = UINT32_MAX;
+
+        enum class Type : uint8_t
+        {
+            VOID,
+            I1,
+            I32,
+        }; // enum class Type
+
+        enum class Opcode : uint8_t
+        {
+            CONST,      // imm = value.
+
+            ADD,        // operands[0] op operands[1].
+            SUB,
+            MUL,
+            SDIV,
+            SREM,
+            AND,
+            OR,
+            XOR,
+            SHL,
+            ASHR,
+
+            NEG,        // op operands[0].
+            NOT,
+
+            ICMP,       // operands[0] cond operands[1], imm = Cond.
+            ZEXT,       // I1 operands[0] to I32.
+
+            PHI,        // Incoming pairs are phiArgs[operands[0]] .. phiArgs[operands[0] + operands[1]].
+
+            LOAD,       // imm = local slot.
+            STORE,      // operands[0] is stored to local slot imm.
+
+            BR,         // imm = target block.
+            CONDBR,     // operands[0] is I1 condition, operands[1] = true block, imm = false block.
+            RET,        // operands[0] is returned.
+        }; // enum class Opcode
+
+        enum class Cond : uint8_t
+        {
+            EQ,
+            NE,
+            LT,
+            LE,
+            GT,
+            GE,
+        }; // enum class Cond
+
+        // Fixed size and free of pointers, so a function body is a single flat array.
+        struct Instruction
+        {
+            Opcode op;
+            Type type;
+            uint16_t flags;
+            ValueId operands[2];
+            int32_t imm;
+
+            Instruction(Opcode op, Type type, ValueId a = NO_VALUE, ValueId b = NO_VALUE, int32_t imm = 0)
+                : op(op), type(type), flags(0), operands{ a, b }, imm(imm)
+            {}
+        }; // struct Instruction
+
+        static_assert(sizeof(Instruction) == 16, "IR instructions are expected to be 16 bytes");
+
+        struct PhiIncoming
+        {
+            ValueId value;
+            BlockId block;
+        }; // struct PhiIncoming
+
+        struct BasicBlock
+        {
+            std::vector<ValueId> insts;
+            std::vector<BlockId> preds;
+        }; // struct BasicBlock
+
+        struct Function
+        {
+            std::string name;
+            size_t slotCount = 0;
+
+            std::vector<Instruction> insts;
+            std::vector<BasicBlock> blocks;
+            std::vector<PhiIncoming> phiArgs;
+
+            BlockId entry = 0;
+        }; // struct Function
+
+        struct Module
+        {
+            std::vector<Function> functions;
+        }; // struct Module
+
+        bool IsTerminator(Opcode op);
+        bool IsBinary(Opcode op);
+        bool IsUnary(Opcode op);
+
+        // Number of value operands stored in Instruction::operands.
+        size_t GetOperandCount(const Instruction& inst);
+
+        // Block targets of a terminator, NO_BLOCK if absent.
+        void GetSuccessors(const Instruction& inst, BlockId& first, BlockId& second);
+        std::vector<BlockId> GetSuccessors(const Function& func, BlockId block);
+
+        const char* OpcodeToString(Opcode op);
+        const char* TypeToString(Type type);
+        const char* CondToString(Cond cond);
+
+        // Evaluates ICMP on constants.
+        bool EvaluateCond(Cond cond, int32_t left, int32_t right);
+    } // namespace IR
+} // namespace CComp
+
+#endif // CCOMP_IR_HPP
@@ -0,0 +1,458 @@
+#include "Mem2Reg.hpp"
+
+#include <algorithm>
+
+#include "CFG.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        namespace
+        {
+            class Promoter
+            {
+            public:
+                Promoter(Function& func)
+                    : m_Func(func)
+                {}
+
+                size_t Run()
+                {
+                    const size_t slotCount = m_Func.slotCount;
+                    if (slotCount == 0)
+                    {
+                        return 0;
+                    }
+
+                    m_Idom = ComputeDominators(m_Func);
+
+                    InsertPhis();
+                    CreateUndefined();
+                    Rename();
+                    SimplifyPhis();
+                    RemoveUndefinedIfUnused();
+
+                    m_Func.slotCount = 0;
+                    return slotCount;
+                }
+
+            private:
+                Function& m_Func;
+                std::vector<BlockId> m_Idom;
+
+                // Slot of every phi inserted here, indexed by value; NO_VALUE for other values.
+                std::vector<ValueId> m_PhiSlots;
+                std::vector<ValueId> m_Replacements;
+
+                ValueId m_Undefined = NO_VALUE;
+
+                bool IsReachable(BlockId block) const
+                { return m_Idom[block] != NO_BLOCK; }
+
+                std::vector<std::vector<BlockId>> ComputeDominanceFrontiers() const
+                {
+                    // Cooper, Harvey and Kennedy: walk up from each predecessor of a join
+                    // until reaching the join's immediate dominator.
+                    std::vector<std::vector<BlockId>> frontiers(m_Func.blocks.size());
+
+                    for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                    {
+                        const std::vector<BlockId>& preds = m_Func.blocks[block].preds;
+
+                        if (preds.size() < 2 || !IsReachable(block))
+                        {
+                            continue;
+                        }
+
+                        for (BlockId pred : preds)
+                        {
+                            for (BlockId runner = pred; IsReachable(runner) && runner != m_Idom[block]; runner = m_Idom[runner])
+                            {
+                                std::vector<BlockId>& frontier = frontiers[runner];
+
+                                if (std::find(frontier.begin(), frontier.end(), block) == frontier.end())
+                                {
+                                    frontier.push_back(block);
+                                }
+                            }
+                        }
+                    }
+
+                    return frontiers;
+                }
+
+                void InsertPhis()
+                {
+                    std::vector<std::vector<BlockId>> frontiers = ComputeDominanceFrontiers();
+                    std::vector<std::vector<BlockId>> storeBlocks(m_Func.slotCount);
+
+                    for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                    {
+                        for (ValueId id : m_Func.blocks[block].insts)
+                        {
+                            const Instruction& inst = m_Func.insts[id];
+
+                            if (inst.op == Opcode::STORE
+                                && (storeBlocks[inst.imm].empty() || storeBlocks[inst.imm].back() != block))
+                            {
+                                storeBlocks[inst.imm].push_back(block);
+                            }
+                        }
+                    }
+
+                    // Phis to prepend to each block, in slot order.
+                    std::vector<std::vector<ValueId>> newPhis(m_Func.blocks.size());
+                    std::vector<size_t> hasPhi(m_Func.blocks.size(), SIZE_MAX);
+
+                    for (size_t slot = 0; slot < m_Func.slotCount; slot++)
+                    {
+                        std::vector<BlockId> work = storeBlocks[slot];
+
+                        while (!work.empty())
+                        {
+                            BlockId block = work.back();
+                            work.pop_back();
+
+                            for (BlockId join : frontiers[block])
+                            {
+                                if (hasPhi[join] == slot)
+                                {
+                                    continue;
+                                }
+
+                                hasPhi[join] = slot;
+                                newPhis[join].push_back(CreatePhi(join, slot));
+                                work.push_back(join);
+                            }
+                        }
+                    }
+
+                    for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                    {
+                        std::vector<ValueId>& insts = m_Func.blocks[block].insts;
+                        insts.insert(insts.begin(), newPhis[block].begin(), newPhis[block].end());
+                    }
+                }
+
+                ValueId CreatePhi(BlockId block, size_t slot)
+                {
+                    const std::vector<BlockId>& preds = m_Func.blocks[block].preds;
+
+                    ValueId start = static_cast<ValueId>(m_Func.phiArgs.size());
+                    for (BlockId pred : preds)
+                    {
+                        m_Func.phiArgs.push_back({ NO_VALUE, pred });
+                    }
+
+                    ValueId id = static_cast<ValueId>(m_Func.insts.size());
+                    m_Func.insts.emplace_back(Opcode::PHI, Type::I32, start, static_cast<ValueId>(preds.size()));
+
+                    m_PhiSlots.resize(m_Func.insts.size(), NO_VALUE);
+                    m_PhiSlots[id] = static_cast<ValueId>(slot);
+                    return id;
+                }
+
+                void CreateUndefined()
+                {
+                    // Reading a local before any store is undefined; zero is as good as anything.
+                    m_Undefined = static_cast<ValueId>(m_Func.insts.size());
+                    m_Func.insts.emplace_back(Opcode::CONST, Type::I32, NO_VALUE, NO_VALUE, 0);
+
+                    std::vector<ValueId>& entry = m_Func.blocks[m_Func.entry].insts;
+                    auto firstNonPhi = std::find_if(entry.begin(), entry.end(),
+                        [this] (ValueId id) { return m_Func.insts[id].op != Opcode::PHI; });
+                    entry.insert(firstNonPhi, m_Undefined);
+                }
+
+                void RemoveUndefinedIfUnused()
+                {
+                    for (const BasicBlock& bb : m_Func.blocks)
+                    {
+                        for (ValueId id : bb.insts)
+                        {
+                            const Instruction& inst = m_Func.insts[id];
+
+                            for (size_t k = 0; k < GetOperandCount(inst); k++)
+                            {
+                                if (inst.operands[k] == m_Undefined)
+                                {
+                                    return;
+                                }
+                            }
+
+                            for (ValueId k = 0; inst.op == Opcode::PHI && k < inst.operands[1]; k++)
+                            {
+                                if (m_Func.phiArgs[inst.operands[0] + k].value == m_Undefined)
+                                {
+                                    return;
+                                }
+                            }
+                        }
+                    }
+
+                    std::vector<ValueId>& entry = m_Func.blocks[m_Func.entry].insts;
+                    entry.erase(std::find(entry.begin(), entry.end(), m_Undefined));
+                }
+
+                ValueId Resolve(ValueId value) const
+                {
+                    while (value < m_Replacements.size() && m_Replacements[value] != value)
+                    {
+                        value = m_Replacements[value];
+                    }
+                    return value;
+                }
+
+                void Rename()
+                {
+                    m_PhiSlots.resize(m_Func.insts.size(), NO_VALUE);
+                    m_Replacements.resize(m_Func.insts.size());
+                    for (ValueId id = 0; id < m_Replacements.size(); id++)
+                    {
+                        m_Replacements[id] = id;
+                    }
+
+                    std::vector<std::vector<BlockId>> children(m_Func.blocks.size());
+                    for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                    {
+                        if (IsReachable(block) && block != m_Func.entry)
+                        {
+                            children[m_Idom[block]].push_back(block);
+                        }
+                    }
+
+                    // Walk the dominator tree with an explicit stack; each entry remembers the
+                    // reaching values to restore once the block's subtree is done.
+                    struct Frame
+                    {
+                        BlockId block;
+                        std::vector<ValueId> values;
+                    }; // struct Frame
+
+                    std::vector<Frame> stack;
+                    stack.push_back({ m_Func.entry, std::vector<ValueId>(m_Func.slotCount, NO_VALUE) });
+
+                    while (!stack.empty())
+                    {
+                        Frame frame = std::move(stack.back());
+                        stack.pop_back();
+
+                        RenameBlock(frame.block, frame.values);
+
+                        for (BlockId child : children[frame.block])
+                        {
+                            stack.push_back({ child, frame.values });
+                        }
+                    }
+
+                    // Phis built by the lowering may name removed loads in their incoming values.
+                    for (PhiIncoming& incoming : m_Func.phiArgs)
+                    {
+                        if (incoming.value != NO_VALUE)
+                        {
+                            incoming.value = Resolve(incoming.value);
+                        }
+                    }
+                }
+
+                void RenameBlock(BlockId block, std::vector<ValueId>& values)
+                {
+                    std::vector<ValueId>& insts = m_Func.blocks[block].insts;
+                    size_t kept = 0;
+
+                    for (ValueId id : insts)
+                    {
+                        Instruction& inst = m_Func.insts[id];
+
+                        for (size_t k = 0; k < GetOperandCount(inst); k++)
+                        {
+                            inst.operands[k] = Resolve(inst.operands[k]);
+                        }
+
+                        if (inst.op == Opcode::PHI && m_PhiSlots[id] != NO_VALUE)
+                        {
+                            values[m_PhiSlots[id]] = id;
+                        }
+                        else if (inst.op == Opcode::LOAD)
+                        {
+                            ValueId value = values[inst.imm];
+                            m_Replacements[id] = value == NO_VALUE ? m_Undefined : value;
+                            continue;
+                        }
+                        else if (inst.op == Opcode::STORE)
+                        {
+                            values[inst.imm] = inst.operands[0];
+                            continue;
+                        }
+
+                        insts[kept++] = id;
+                    }
+
+                    insts.resize(kept);
+
+                    for (BlockId succ : GetSuccessors(m_Func, block))
+                    {
+                        for (ValueId id : m_Func.blocks[succ].insts)
+                        {
+                            const Instruction& phi = m_Func.insts[id];
+                            if (phi.op != Opcode::PHI)
+                            {
+                                break;
+                            }
+
+                            if (id >= m_PhiSlots.size() || m_PhiSlots[id] == NO_VALUE)
+                            {
+                                continue;
+                            }
+
+                            ValueId value = values[m_PhiSlots[id]];
+                            for (ValueId k = 0; k < phi.operands[1]; k++)
+                            {
+                                PhiIncoming& incoming = m_Func.phiArgs[phi.operands[0] + k];
+                                if (incoming.block == block)
+                                {
+                                    incoming.value = value == NO_VALUE ? m_Undefined : value;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                void SimplifyPhis()
+                {
+                    bool changed = true;
+
+                    while (changed)
+                    {
+                        changed = false;
+
+                        std::vector<size_t> useCounts(m_Func.insts.size(), 0);
+                        for (const BasicBlock& bb : m_Func.blocks)
+                        {
+                            for (ValueId id : bb.insts)
+                            {
+                                const Instruction& inst = m_Func.insts[id];
+
+                                for (size_t k = 0; k < GetOperandCount(inst); k++)
+                                {
+                                    useCounts[inst.operands[k]]++;
+                                }
+
+                                if (inst.op == Opcode::PHI)
+                                {
+                                    for (ValueId k = 0; k < inst.operands[1]; k++)
+                                    {
+                                        ValueId value = m_Func.phiArgs[inst.operands[0] + k].value;
+
+                                        // A phi feeding itself around a loop does not keep it alive.
+                                        if (value != id)
+                                        {
+                                            useCounts[value]++;
+                                        }
+                                    }
+                                }
+                            }
+                        }
+
+                        for (BasicBlock& bb : m_Func.blocks)
+                        {
+                            size_t kept = 0;
+
+                            for (ValueId id : bb.insts)
+                            {
+                                const Instruction& inst = m_Func.insts[id];
+
+                                if (inst.op == Opcode::PHI && id < m_PhiSlots.size() && m_PhiSlots[id] != NO_VALUE)
+                                {
+                                    ValueId same = GetSingleIncoming(id);
+
+                                    if (useCounts[id] == 0 || same != NO_VALUE)
+                                    {
+                                        m_Replacements[id] = same;
+                                        m_PhiSlots[id] = NO_VALUE;
+                                        changed = true;
+                                        continue;
+                                    }
+                                }
+
+                                bb.insts[kept++] = id;
+                            }
+
+                            bb.insts.resize(kept);
+                        }
+
+                        if (!changed)
+                        {
+                            break;
+                        }
+
+                        for (BasicBlock& bb : m_Func.blocks)
+                        {
+                            for (ValueId id : bb.insts)
+                            {
+                                Instruction& inst = m_Func.insts[id];
+
+                                for (size_t k = 0; k < GetOperandCount(inst); k++)
+                                {
+                                    inst.operands[k] = Resolve(inst.operands[k]);
+                                }
+                            }
+                        }
+
+                        for (PhiIncoming& incoming : m_Func.phiArgs)
+                        {
+                            if (incoming.value != NO_VALUE)
+                            {
+                                incoming.value = Resolve(incoming.value);
+                            }
+                        }
+                    }
+                }
+
+                // The one value other than the phi itself that reaches it, NO_VALUE if there are several.
+                ValueId GetSingleIncoming(ValueId phi) const
+                {
+                    const Instruction& inst = m_Func.insts[phi];
+                    ValueId same = NO_VALUE;
+
+                    for (ValueId k = 0; k < inst.operands[1]; k++)
+                    {
+                        ValueId value = m_Func.phiArgs[inst.operands[0] + k].value;
+
+                        if (value == phi || value == same)
+                        {
+                            continue;
+                        }
+
+                        if (same != NO_VALUE)
+                        {
+                            return NO_VALUE;
+                        }
+
+                        same = value;
+                    }
+
+                    return same;
+                }
+            }; // class Promoter
+        } // namespace
+
+        size_t PromoteLocals(Function& func)
+        {
+            return Promoter(func).Run();
+        }
+
+        size_t PromoteLocals(Module& module)
+        {
+            size_t promoted = 0;
+
+            for (Function& func : module.functions)
+            {
+                promoted += PromoteLocals(func);
+            }
+
+            return promoted;
+        }
+    } // namespace IR
+} // namespace CComp
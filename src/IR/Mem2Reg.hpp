@@ -0,0 +1,20 @@
+#ifndef CCOMP_IR_MEM2REG_HPP
+#define CCOMP_IR_MEM2REG_HPP
+
+#include "IR.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        // Promotes local slots to SSA values (Cytron et al.): phis are placed on the iterated
+        // dominance frontier of the stores, loads are replaced by the reaching value and every
+        // load and store of a promoted slot is removed. Phis that merge a single value are
+        // folded into it and unused ones dropped, which is all the copy propagation SSA needs.
+        // The IR has no address-of, so every slot is promoted. Returns the number of slots promoted.
+        size_t PromoteLocals(Function& func);
+        size_t PromoteLocals(Module& module);
+    } // namespace IR
+} // namespace CComp
+
+#endif // CCOMP_IR_MEM2REG_HPP
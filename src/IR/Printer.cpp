@@ -0,0 +1,140 @@
+#include "Printer.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        static void PrintValue(std::ostream& out, ValueId value)
+        {
+            if (value == NO_VALUE)
+            {
+                out << "<none>";
+            }
+            else
+            {
+                out << "%" << value;
+            }
+        }
+
+        static void PrintInstruction(std::ostream& out, const Function& func, ValueId id)
+        {
+            const Instruction& inst = func.insts[id];
+
+            out << "    ";
+
+            if (inst.type != Type::VOID)
+            {
+                PrintValue(out, id);
+                out << " = ";
+            }
+
+            out << OpcodeToString(inst.op);
+
+            switch (inst.op)
+            {
+            case Opcode::CONST:
+                out << " " << TypeToString(inst.type) << " " << inst.imm;
+                break;
+
+            case Opcode::ICMP:
+                out << " " << CondToString(static_cast<Cond>(inst.imm)) << " ";
+                PrintValue(out, inst.operands[0]);
+                out << ", ";
+                PrintValue(out, inst.operands[1]);
+                break;
+
+            case Opcode::PHI:
+                out << " " << TypeToString(inst.type);
+
+                for (ValueId i = 0; i < inst.operands[1]; i++)
+                {
+                    const PhiIncoming& incoming = func.phiArgs[inst.operands[0] + i];
+
+                    out << (i == 0 ? " [" : ", [");
+                    PrintValue(out, incoming.value);
+                    out << ", bb" << incoming.block << "]";
+                }
+                break;
+
+            case Opcode::LOAD:
+                out << " " << TypeToString(inst.type) << " slot" << inst.imm;
+                break;
+
+            case Opcode::STORE:
+                out << " ";
+                PrintValue(out, inst.operands[0]);
+                out << ", slot" << inst.imm;
+                break;
+
+            case Opcode::BR:
+                out << " bb" << inst.imm;
+                break;
+
+            case Opcode::CONDBR:
+                out << " ";
+                PrintValue(out, inst.operands[0]);
+                out << ", bb" << inst.operands[1] << ", bb" << inst.imm;
+                break;
+
+            default:
+                if (inst.type != Type::VOID)
+                {
+                    out << " " << TypeToString(inst.type);
+                }
+
+                for (size_t i = 0; i < GetOperandCount(inst); i++)
+                {
+                    out << (i == 0 ? " " : ", ");
+                    PrintValue(out, inst.operands[i]);
+                }
+                break;
+            }
+
+            out << "\n";
+        }
+
+        void PrintFunction(std::ostream& out, const Function& func)
+        {
+            out << "function " << func.name << " (slots: " << func.slotCount << ") {\n";
+
+            for (BlockId block = 0; block < func.blocks.size(); block++)
+            {
+                const BasicBlock& bb = func.blocks[block];
+
+                out << "bb" << block << ":";
+
+                if (!bb.preds.empty())
+                {
+                    out << "    ; preds:";
+
+                    for (BlockId pred : bb.preds)
+                    {
+                        out << " bb" << pred;
+                    }
+                }
+
+                out << "\n";
+
+                for (ValueId id : bb.insts)
+                {
+                    PrintInstruction(out, func, id);
+                }
+            }
+
+            out << "}\n";
+        }
+
+        void PrintModule(std::ostream& out, const Module& module)
+        {
+            for (size_t i = 0; i < module.functions.size(); i++)
+            {
+                if (i != 0)
+                {
+                    out << "\n";
+                }
+
+                PrintFunction(out, module.functions[i]);
+            }
+        }
+    } // namespace IR
+} // namespace CComp
@@ -0,0 +1,17 @@
+#ifndef CCOMP_IR_PRINTER_HPP
+#define CCOMP_IR_PRINTER_HPP
+
+#include <ostream>
+
+#include "IR.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        void PrintFunction(std::ostream& out, const Function& func);
+        void PrintModule(std::ostream& out, const Module& module);
+    } // namespace IR
+} // namespace CComp
+
+#endif // CCOMP_IR_PRINTER_HPP
@@ -0,0 +1,184 @@
+#include "ValueNumbering.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+namespace CComp
+{
+    namespace IR
+    {
+        namespace
+        {
+            struct ExpressionKey
+            {
+                Opcode op;
+                Type type;
+                ValueId left;
+                ValueId right;
+                int32_t imm;
+
+                bool operator==(const ExpressionKey& other) const
+                {
+                    return op == other.op && type == other.type && left == other.left
+                        && right == other.right && imm == other.imm;
+                }
+            }; // struct ExpressionKey
+
+            struct ExpressionKeyHash
+            {
+                size_t operator()(const ExpressionKey& key) const
+                {
+                    size_t hash = static_cast<size_t>(key.op) | static_cast<size_t>(key.type) << 8;
+                    hash = hash * 31 + key.left;
+                    hash = hash * 31 + key.right;
+                    hash = hash * 31 + static_cast<uint32_t>(key.imm);
+                    return hash;
+                }
+            }; // struct ExpressionKeyHash
+
+            bool IsCommutative(const Instruction& inst)
+            {
+                switch (inst.op)
+                {
+                case Opcode::ADD:
+                case Opcode::MUL:
+                case Opcode::AND:
+                case Opcode::OR:
+                case Opcode::XOR:
+                    return true;
+
+                case Opcode::ICMP:
+                    return static_cast<Cond>(inst.imm) == Cond::EQ || static_cast<Cond>(inst.imm) == Cond::NE;
+
+                default:
+                    return false;
+                }
+            }
+
+            // Instructions whose result depends only on their operands. Division is included:
+            // an earlier identical division in the same block would already have trapped.
+            bool IsPure(Opcode op)
+            {
+                return op == Opcode::CONST || op == Opcode::ICMP || op == Opcode::ZEXT || IsBinary(op) || IsUnary(op);
+            }
+        } // namespace
+
+        size_t NumberValues(Function& func)
+        {
+            std::vector<ValueId> replacement(func.insts.size());
+            for (ValueId id = 0; id < replacement.size(); id++)
+            {
+                replacement[id] = id;
+            }
+
+            size_t removed = 0;
+
+            std::unordered_map<ExpressionKey, ValueId, ExpressionKeyHash> available;
+            std::vector<ValueId> slotValues(func.slotCount, NO_VALUE);
+
+            for (BasicBlock& block : func.blocks)
+            {
+                available.clear();
+                std::fill(slotValues.begin(), slotValues.end(), NO_VALUE);
+
+                size_t kept = 0;
+                for (ValueId id : block.insts)
+                {
+                    Instruction& inst = func.insts[id];
+
+                    // Earlier instructions of the block dominate this one, so their
+                    // replacements can be substituted right away.
+                    for (size_t i = 0; i < GetOperandCount(inst); i++)
+                    {
+                        inst.operands[i] = replacement[inst.operands[i]];
+                    }
+
+                    ValueId existing = NO_VALUE;
+
+                    if (IsPure(inst.op))
+                    {
+                        ExpressionKey key = { inst.op, inst.type, inst.operands[0], inst.operands[1], inst.imm };
+
+                        if (IsCommutative(inst) && key.left > key.right)
+                        {
+                            std::swap(key.left, key.right);
+                        }
+
+                        auto [it, inserted] = available.emplace(key, id);
+                        if (!inserted)
+                        {
+                            existing = it->second;
+                        }
+                    }
+                    else if (inst.op == Opcode::LOAD)
+                    {
+                        ValueId& known = slotValues[inst.imm];
+
+                        if (known != NO_VALUE && func.insts[known].type == inst.type)
+                        {
+                            existing = known;
+                        }
+                        else
+                        {
+                            known = id;
+                        }
+                    }
+                    else if (inst.op == Opcode::STORE)
+                    {
+                        slotValues[inst.imm] = inst.operands[0];
+                    }
+
+                    if (existing != NO_VALUE)
+                    {
+                        replacement[id] = existing;
+                        removed++;
+                        continue;
+                    }
+
+                    block.insts[kept++] = id;
+                }
+
+                block.insts.resize(kept);
+            }
+
+            if (removed == 0)
+            {
+                return 0;
+            }
+
+            // Uses in later blocks and in phis.
+            for (BasicBlock& block : func.blocks)
+            {
+                for (ValueId id : block.insts)
+                {
+                    Instruction& inst = func.insts[id];
+
+                    for (size_t i = 0; i < GetOperandCount(inst); i++)
+                    {
+                        inst.operands[i] = replacement[inst.operands[i]];
+                    }
+                }
+            }
+
+            for (PhiIncoming& incoming : func.phiArgs)
+            {
+                incoming.value = replacement[incoming.value];
+            }
+
+            return removed;
+        }
+
+        size_t NumberValues(Module& module)
+        {
+            size_t removed = 0;
+
+            for (Function& func : module.functions)
+            {
+                removed += NumberValues(func);
+            }
+
+            return removed;
+        }
+    } // namespace IR
+} // namespace CComp
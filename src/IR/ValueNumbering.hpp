@@ -0,0 +1,20 @@
+#ifndef CCOMP_IR_VALUE_NUMBERING_HPP
+#define CCOMP_IR_VALUE_NUMBERING_HPP
+
+#include "IR.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        // Local value numbering: inside each block, an instruction that recomputes an
+        // available value (same opcode on the same operands) is removed and its uses
+        // redirected. A load reuses the last value stored to or loaded from its slot in
+        // the block, so ++, -- and compound assignments, which store, end the reuse.
+        // Returns the number of instructions removed.
+        size_t NumberValues(Function& func);
+        size_t NumberValues(Module& module);
+    } // namespace IR
+} // namespace CComp
+
+#endif // CCOMP_IR_VALUE_NUMBERING_HPP
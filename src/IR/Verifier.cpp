@@ -0,0 +1,344 @@
+#include "Verifier.hpp"
+
+#include <algorithm>
+
+#include "CFG.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        class Verifier
+        {
+        public:
+            Verifier(const Function& func)
+                : m_Func(func)
+            {}
+
+            std::vector<std::string> Verify()
+            {
+                if (m_Func.blocks.empty() || m_Func.entry >= m_Func.blocks.size())
+                {
+                    Error("function has no entry block");
+                    return m_Errors;
+                }
+
+                if (!CheckLayout())
+                {
+                    return m_Errors;
+                }
+
+                m_Idom = ComputeDominators(m_Func);
+
+                for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                {
+                    if (m_Idom[block] == NO_BLOCK)
+                    {
+                        Error("bb" + std::to_string(block) + " is unreachable");
+                    }
+                }
+
+                CheckPredecessors();
+
+                for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                {
+                    for (ValueId id : m_Func.blocks[block].insts)
+                    {
+                        CheckInstruction(block, id);
+                    }
+                }
+
+                return m_Errors;
+            }
+
+        private:
+            const Function& m_Func;
+            std::vector<std::string> m_Errors;
+
+            std::vector<BlockId> m_InstBlock;
+            std::vector<size_t> m_InstIndex;
+            std::vector<BlockId> m_Idom;
+
+            void Error(const std::string& msg)
+            {
+                m_Errors.push_back("function " + m_Func.name + ": " + msg);
+            }
+
+            void ErrorAt(ValueId id, const std::string& msg)
+            {
+                Error("%" + std::to_string(id) + " (" + OpcodeToString(m_Func.insts[id].op) + "): " + msg);
+            }
+
+            bool CheckLayout()
+            {
+                m_InstBlock.assign(m_Func.insts.size(), NO_BLOCK);
+                m_InstIndex.assign(m_Func.insts.size(), 0);
+
+                for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                {
+                    const BasicBlock& bb = m_Func.blocks[block];
+                    std::string name = "bb" + std::to_string(block);
+
+                    if (bb.insts.empty())
+                    {
+                        Error(name + " is empty");
+                        continue;
+                    }
+
+                    bool seenNonPhi = false;
+
+                    for (size_t i = 0; i < bb.insts.size(); i++)
+                    {
+                        ValueId id = bb.insts[i];
+
+                        if (id >= m_Func.insts.size())
+                        {
+                            Error(name + " refers to nonexistent instruction %" + std::to_string(id));
+                            return false;
+                        }
+
+                        if (m_InstBlock[id] != NO_BLOCK)
+                        {
+                            ErrorAt(id, "appears more than once");
+                            continue;
+                        }
+
+                        m_InstBlock[id] = block;
+                        m_InstIndex[id] = i;
+
+                        const Instruction& inst = m_Func.insts[id];
+
+                        if (inst.op == Opcode::PHI && seenNonPhi)
+                        {
+                            ErrorAt(id, "phi is not at the start of " + name);
+                        }
+
+                        seenNonPhi = seenNonPhi || inst.op != Opcode::PHI;
+
+                        bool isLast = i + 1 == bb.insts.size();
+                        if (IsTerminator(inst.op) != isLast)
+                        {
+                            ErrorAt(id, isLast ? name + " does not end with a terminator"
+                                               : "terminator in the middle of " + name);
+                        }
+
+                        BlockId first, second;
+                        GetSuccessors(inst, first, second);
+
+                        if ((first != NO_BLOCK && first >= m_Func.blocks.size())
+                            || (second != NO_BLOCK && second >= m_Func.blocks.size()))
+                        {
+                            ErrorAt(id, "branches to a nonexistent block");
+                            return false;
+                        }
+                    }
+                }
+
+                return m_Errors.empty();
+            }
+
+            void CheckPredecessors()
+            {
+                std::vector<std::vector<BlockId>> expected(m_Func.blocks.size());
+
+                for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                {
+                    for (BlockId succ : GetSuccessors(m_Func, block))
+                    {
+                        expected[succ].push_back(block);
+                    }
+                }
+
+                for (BlockId block = 0; block < m_Func.blocks.size(); block++)
+                {
+                    std::vector<BlockId> actual = m_Func.blocks[block].preds;
+
+                    std::sort(actual.begin(), actual.end());
+                    std::sort(expected[block].begin(), expected[block].end());
+
+                    if (actual != expected[block])
+                    {
+                        Error("predecessor list of bb" + std::to_string(block) + " does not match the branches");
+                    }
+                }
+            }
+
+            // Whether the definition of value is available at the end of block.
+            bool IsAvailableAtEnd(ValueId value, BlockId block) const
+            {
+                return Dominates(m_Idom, m_InstBlock[value], block);
+            }
+
+            bool IsAvailableAt(ValueId value, ValueId user) const
+            {
+                BlockId defBlock = m_InstBlock[value];
+                BlockId useBlock = m_InstBlock[user];
+
+                if (defBlock == useBlock)
+                {
+                    return m_InstIndex[value] < m_InstIndex[user];
+                }
+
+                return Dominates(m_Idom, defBlock, useBlock);
+            }
+
+            bool CheckOperand(ValueId user, ValueId value, Type expected)
+            {
+                if (value >= m_Func.insts.size() || m_InstBlock[value] == NO_BLOCK)
+                {
+                    ErrorAt(user, "uses a value that is not defined");
+                    return false;
+                }
+
+                if (m_Func.insts[value].type != expected)
+                {
+                    ErrorAt(user, std::string("expected an operand of type ") + TypeToString(expected)
+                            + ", got %" + std::to_string(value) + " of type "
+                            + TypeToString(m_Func.insts[value].type));
+                    return false;
+                }
+
+                return true;
+            }
+
+            void CheckType(ValueId id, Type expected)
+            {
+                if (m_Func.insts[id].type != expected)
+                {
+                    ErrorAt(id, std::string("has type ") + TypeToString(m_Func.insts[id].type)
+                            + ", expected " + TypeToString(expected));
+                }
+            }
+
+            void CheckInstruction(BlockId block, ValueId id)
+            {
+                const Instruction& inst = m_Func.insts[id];
+
+                if (inst.op == Opcode::PHI)
+                {
+                    CheckPhi(block, id);
+                    return;
+                }
+
+                switch (inst.op)
+                {
+                case Opcode::CONST:
+                    if (inst.type == Type::VOID)
+                    {
+                        ErrorAt(id, "constant of type void");
+                    }
+                    break;
+
+                case Opcode::ICMP:
+                    CheckType(id, Type::I1);
+                    if (inst.imm < 0 || inst.imm > static_cast<int32_t>(Cond::GE))
+                    {
+                        ErrorAt(id, "invalid condition");
+                    }
+                    break;
+
+                case Opcode::LOAD:
+                case Opcode::STORE:
+                    CheckType(id, inst.op == Opcode::LOAD ? Type::I32 : Type::VOID);
+                    if (inst.imm < 0 || static_cast<size_t>(inst.imm) >= m_Func.slotCount)
+                    {
+                        ErrorAt(id, "slot " + std::to_string(inst.imm) + " is out of range");
+                    }
+                    break;
+
+                case Opcode::BR:
+                case Opcode::CONDBR:
+                case Opcode::RET:
+                    CheckType(id, Type::VOID);
+                    break;
+
+                default:
+                    CheckType(id, Type::I32);
+                    break;
+                }
+
+                Type operandType = Type::I32;
+                if (inst.op == Opcode::ZEXT || inst.op == Opcode::CONDBR)
+                {
+                    operandType = Type::I1;
+                }
+
+                for (size_t i = 0; i < GetOperandCount(inst); i++)
+                {
+                    if (CheckOperand(id, inst.operands[i], operandType)
+                        && !IsAvailableAt(inst.operands[i], id))
+                    {
+                        ErrorAt(id, "operand %" + std::to_string(inst.operands[i]) + " does not dominate its use");
+                    }
+                }
+            }
+
+            void CheckPhi(BlockId block, ValueId id)
+            {
+                const Instruction& inst = m_Func.insts[id];
+                const BasicBlock& bb = m_Func.blocks[block];
+
+                if (inst.type == Type::VOID)
+                {
+                    ErrorAt(id, "phi of type void");
+                }
+
+                if (static_cast<size_t>(inst.operands[0]) + inst.operands[1] > m_Func.phiArgs.size())
+                {
+                    ErrorAt(id, "incoming list is out of range");
+                    return;
+                }
+
+                std::vector<BlockId> incomingBlocks;
+
+                for (ValueId i = 0; i < inst.operands[1]; i++)
+                {
+                    const PhiIncoming& incoming = m_Func.phiArgs[inst.operands[0] + i];
+
+                    incomingBlocks.push_back(incoming.block);
+
+                    if (incoming.block >= m_Func.blocks.size())
+                    {
+                        ErrorAt(id, "incoming block does not exist");
+                        continue;
+                    }
+
+                    if (CheckOperand(id, incoming.value, inst.type)
+                        && !IsAvailableAtEnd(incoming.value, incoming.block))
+                    {
+                        ErrorAt(id, "incoming %" + std::to_string(incoming.value)
+                                + " is not available at the end of bb" + std::to_string(incoming.block));
+                    }
+                }
+
+                std::vector<BlockId> preds = bb.preds;
+
+                std::sort(preds.begin(), preds.end());
+                std::sort(incomingBlocks.begin(), incomingBlocks.end());
+
+                if (preds != incomingBlocks)
+                {
+                    ErrorAt(id, "incoming blocks do not match the predecessors of bb" + std::to_string(block));
+                }
+            }
+        }; // class Verifier
+
+        std::vector<std::string> VerifyFunction(const Function& func)
+        {
+            return Verifier(func).Verify();
+        }
+
+        std::vector<std::string> VerifyModule(const Module& module)
+        {
+            std::vector<std::string> res;
+
+            for (const Function& func : module.functions)
+            {
+                std::vector<std::string> errors = VerifyFunction(func);
+                res.insert(res.end(), errors.begin(), errors.end());
+            }
+
+            return res;
+        }
+    } // namespace IR
+} // namespace CComp
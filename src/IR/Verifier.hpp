@@ -0,0 +1,19 @@
+#ifndef CCOMP_IR_VERIFIER_HPP
+#define CCOMP_IR_VERIFIER_HPP
+
+#include <string>
+#include <vector>
+
+#include "IR.hpp"
+
+namespace CComp
+{
+    namespace IR
+    {
+        // Checks structural, type and SSA dominance rules. Returns a description of every violation.
+        std::vector<std::string> VerifyFunction(const Function& func);
+        std::vector<std::string> VerifyModule(const Module& module);
+    } // namespace IR
+} // namespace CComp
+
+#endif // CCOMP_IR_VERIFIER_HPP
@@ -1,6 +1,9 @@
 #include "Parser.hpp"
 
+#include "AllocationCounter.hpp"
 #include "Reporter.hpp"
+#include "TimeReport.hpp"
+#include "Trace.hpp"
 #include "AST/AST.hpp"
 #include "Unreachable.hpp"
 
@@ -12,13 +15,27 @@ namespace CComp
 
     std::vector<std::unique_ptr<AST::Decl>> Parser::Parse()
     {
+        ScopedTimer timer(TimedPhase::PARSE);
+        ScopedMemoryCategory memory(MemoryCategory::AST);
+
         Advance();
 
         std::vector<std::unique_ptr<AST::Decl>> res;
 
-        while (!IsAtEnd())
+        while (!IsAtEnd() && !GetReporter().ErrorLimitReached())
         {
             res.push_back(ParseDecl());
+
+            if (m_PanicMode)
+            {
+                Synchronize();
+
+                // Only a type starts a declaration, so skip a stray '}' or statement.
+                while (!IsAtEnd() && !Check(TokenType::INT))
+                {
+                    Advance();
+                }
+            }
         }
 
         if (!m_HadError)
@@ -33,9 +50,12 @@ namespace CComp
 
     std::unique_ptr<AST::Decl> Parser::ParseDecl()
     {
+        TraceSpan span("parse", "<function>");
+
         std::unique_ptr<AST::Type> returnType = ParseType();
         Consume(TokenType::IDENTIFIER, "expected function name");
         Token name = m_Current; 
+        span.SetName(name.str);
         Consume(TokenType::LEFT_PAREN, "expected '(' after function name");
         Consume(TokenType::RIGHT_PAREN, "expected ')' after function parameters");
         Consume(TokenType::LEFT_BRACKET, "expected '{'");
@@ -57,15 +77,20 @@ namespace CComp
         {
             return ParseVarDeclStmt();
         }
+        else if (Match(TokenType::LEFT_BRACKET))
+        {
+            return ParseBlock();
+        }
 
         return ParseExprStmt();
     }
 
     std::unique_ptr<AST::ExprStmt> Parser::ParseExprStmt()
     {
+        FilePosition pos = m_Next.pos;
         std::unique_ptr<AST::Expr> expr = ParseExpr();
         Consume(TokenType::SEMICOLON, "expected ';' after expression statement");
-        return std::make_unique<AST::ExprStmt>(expr->pos, std::move(expr));
+        return std::make_unique<AST::ExprStmt>(pos, std::move(expr));
     }
 
     std::unique_ptr<AST::VarDeclStmt> Parser::ParseVarDeclStmt()
@@ -447,7 +472,8 @@ namespace CComp
         std::vector<std::unique_ptr<AST::Stmt>> stmts;
         FilePosition pos = m_Current.pos;
 
-        while (!IsAtEnd() && !Check(TokenType::RIGHT_BRACKET))
+        while (!IsAtEnd() && !Check(TokenType::RIGHT_BRACKET)
+               && !GetReporter().ErrorLimitReached())
         {
             stmts.push_back(ParseStmt());
 
@@ -482,8 +508,6 @@ namespace CComp
     {
         if (!Check(type))
         {
-            m_HadError = true;
-            m_PanicMode = true;
             ErrorAtNext(errorMsg);
             return;
         }
@@ -504,35 +528,54 @@ namespace CComp
 
     void Parser::ErrorAtCurrent(const std::string& errorMsg)
     {
-        ReportError(m_Current.pos, errorMsg);
+        ErrorAt(m_Current, errorMsg);
     }
 
     void Parser::ErrorAtNext(const std::string& errorMsg)
     {
-        ReportError(m_Next.pos, errorMsg);
+        ErrorAt(m_Next, errorMsg);
+    }
+
+    void Parser::ErrorAt(const Token& token, const std::string& errorMsg)
+    {
+        m_HadError = true;
+
+        // Errors following the first one are usually caused by it, so stay quiet until we synchronize.
+        if (m_PanicMode)
+        {
+            return;
+        }
+
+        m_PanicMode = true;
+        ReportError(token.pos, errorMsg);
     }
 
     void Parser::Synchronize()
     {
-        m_PanicMode = false;
-        
-        while (true)
+        // Stop before a token that starts a statement or closes the block, so that the
+        // block still sees its '}', and after a ';' that ends the broken statement.
+        while (!IsAtEnd())
         {
+            if (m_Next.type == TokenType::INT
+                || m_Next.type == TokenType::RETURN
+                || m_Next.type == TokenType::RIGHT_BRACKET)
+            {
+                break;
+            }
+
             Advance();
 
             if (m_Current.type == TokenType::SEMICOLON)
             {
                 break;
             }
+        }
 
-            switch (m_Next.type)
-            {
-            case TokenType::INT:
-            case TokenType::RETURN:
-                return;
-            default:
-                continue;
-            }
+        // Truncated input leaves nothing to recover at; whatever else is found missing
+        // is caused by the same error.
+        if (!IsAtEnd())
+        {
+            m_PanicMode = false;
         }
     }
 
@@ -556,9 +599,7 @@ namespace CComp
 
             if (m_Next.type == TokenType::ERROR)
             {
-                m_HadError = true;
-                m_PanicMode = true;
-                ReportError(m_Next.pos, m_Next.str);
+                ErrorAt(m_Next, m_Next.str);
                 continue;
             }
 
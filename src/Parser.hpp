@@ -48,6 +48,7 @@ namespace CComp
 
         void ErrorAtCurrent(const std::string& errorMsg);
         void ErrorAtNext(const std::string& errorMsg);
+        void ErrorAt(const Token& token, const std::string& errorMsg);
 
         void Synchronize();
 
@@ -0,0 +1,78 @@
+#include "PassManager.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace CComp
+{
+    namespace
+    {
+        // In the order a full pipeline would run them.
+        const char* const gc_PassNames[] =
+        {
+            "parse",
+            "sema",
+            "constant-fold",
+            "bytecode-gen",
+            "irgen",
+            "mem2reg",
+            "value-numbering",
+            "verify",
+            "codegen",
+            "peephole",
+        };
+    } // namespace
+
+    bool IsPassName(const std::string& name)
+    {
+        return std::find(std::begin(gc_PassNames), std::end(gc_PassNames), name) != std::end(gc_PassNames);
+    }
+
+    PassInstrumentation::PassInstrumentation(std::vector<std::string> printAfter, bool timePasses, std::ostream& out)
+        : m_PrintAfter(std::move(printAfter)), m_TimePasses(timePasses), m_Out(out)
+    {}
+
+    bool PassInstrumentation::ShouldPrintAfter(const std::string& pass) const
+    {
+        for (const std::string& name : m_PrintAfter)
+        {
+            if (name == pass || name == "all")
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void PassInstrumentation::RecordTiming(const std::string& pass, double milliseconds, size_t allocations)
+    {
+        m_Timings.push_back({ pass, milliseconds, allocations });
+    }
+
+    void PassInstrumentation::PrintTimings(std::ostream& out) const
+    {
+        double totalTime = 0;
+        size_t totalAllocations = 0;
+
+        out << "=== Pass timings ===" << std::endl;
+        out << std::setw(12) << "Wall (ms)" << std::setw(14) << "Allocations" << "  Pass" << std::endl;
+
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(3);
+
+        for (const Timing& timing : m_Timings)
+        {
+            out << std::setw(12) << timing.milliseconds << std::setw(14) << timing.allocations
+                << "  " << timing.pass << std::endl;
+
+            totalTime += timing.milliseconds;
+            totalAllocations += timing.allocations;
+        }
+
+        out << std::setw(12) << totalTime << std::setw(14) << totalAllocations << "  Total" << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+} // namespace CComp
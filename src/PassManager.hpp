@@ -0,0 +1,113 @@
+#ifndef CCOMP_PASS_MANAGER_HPP
+#define CCOMP_PASS_MANAGER_HPP
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AllocationCounter.hpp"
+#include "Trace.hpp"
+
+namespace CComp
+{
+    // Whether name is a pass some pipeline may run: what -print-after= accepts besides "all".
+    bool IsPassName(const std::string& name);
+
+    // What -print-after= and -time-passes ask of every pass, whichever pipeline runs it.
+    class PassInstrumentation
+    {
+    public:
+        PassInstrumentation(std::vector<std::string> printAfter, bool timePasses, std::ostream& out);
+
+        bool ShouldPrintAfter(const std::string& pass) const;
+
+        bool ShouldTimePasses() const
+        { return m_TimePasses; }
+
+        // Where the dumps of -print-after= go.
+        std::ostream& GetOutput()
+        { return m_Out; }
+
+        void RecordTiming(const std::string& pass, double milliseconds, size_t allocations);
+
+        // The -time-passes table: one line per pass in the order they ran, then the total.
+        void PrintTimings(std::ostream& out) const;
+
+    private:
+        struct Timing
+        {
+            std::string pass;
+            double milliseconds;
+            size_t allocations;
+        }; // struct Timing
+
+        std::vector<std::string> m_PrintAfter;
+        bool m_TimePasses;
+        std::ostream& m_Out;
+        std::vector<Timing> m_Timings;
+    }; // class PassInstrumentation
+
+    // Runs named passes over one representation of the program, in the order they were
+    // added. The first pass may build the unit from an earlier representation.
+    template <typename Unit>
+    class PassManager
+    {
+    public:
+        // A pass returns false when it failed, having reported why; the rest are skipped.
+        using Pass = std::function<bool(Unit&)>;
+        using Printer = std::function<void(std::ostream&, const Unit&)>;
+
+        PassManager(PassInstrumentation& instrumentation, Printer printer)
+            : m_Instrumentation(instrumentation), m_Printer(std::move(printer))
+        {}
+
+        void AddPass(const std::string& name, Pass pass)
+        {
+            m_Passes.emplace_back(name, std::move(pass));
+        }
+
+        bool Run(Unit& unit)
+        {
+            for (const auto& [name, pass] : m_Passes)
+            {
+                size_t allocations = GetAllocationCount();
+                auto start = std::chrono::steady_clock::now();
+
+                bool succeeded;
+                {
+                    TraceSpan span("pass", name);
+                    succeeded = pass(unit);
+                }
+
+                if (m_Instrumentation.ShouldTimePasses())
+                {
+                    std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+                    m_Instrumentation.RecordTiming(name, time.count(), GetAllocationCount() - allocations);
+                }
+
+                if (!succeeded)
+                {
+                    return false;
+                }
+
+                if (m_Instrumentation.ShouldPrintAfter(name))
+                {
+                    m_Instrumentation.GetOutput() << "*** After " << name << " ***" << std::endl;
+                    m_Printer(m_Instrumentation.GetOutput(), unit);
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        PassInstrumentation& m_Instrumentation;
+        Printer m_Printer;
+        std::vector<std::pair<std::string, Pass>> m_Passes;
+    }; // class PassManager
+} // namespace CComp
+
+#endif // CCOMP_PASS_MANAGER_HPP
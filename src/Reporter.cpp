@@ -4,8 +4,237 @@
 
 namespace CComp
 {
+    constexpr size_t gc_FlushThreshold = 256;
+
+    thread_local Reporter* g_CurrentReporter = nullptr;
+
+    const char* SeverityToString(Severity severity)
+    {
+        switch (severity)
+        {
+        case Severity::NOTE:    return "note";
+        case Severity::WARNING: return "warning";
+        case Severity::ERROR:   return "error";
+        case Severity::FATAL:   return "fatal error";
+        }
+
+        return "error";
+    }
+
+    void AppendJsonString(std::string& buffer, const std::string& str)
+    {
+        static const char* hexDigits = "0123456789abcdef";
+
+        buffer += '"';
+
+        for (char ch : str)
+        {
+            switch (ch)
+            {
+            case '"':  buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\n': buffer += "\\n"; break;
+            case '\t': buffer += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20)
+                {
+                    buffer += "\\u00";
+                    buffer += hexDigits[(ch >> 4) & 0xF];
+                    buffer += hexDigits[ch & 0xF];
+                }
+                else
+                {
+                    buffer += ch;
+                }
+            }
+        }
+
+        buffer += '"';
+    }
+
+    Reporter::Reporter(std::ostream& out, DiagnosticsFormat format, size_t errorLimit)
+        : m_Out(out),
+          m_Format(format),
+          m_ErrorLimit(errorLimit)
+    {
+        m_Diagnostics.reserve(gc_FlushThreshold);
+    }
+
+    Reporter::~Reporter()
+    {
+        Flush();
+
+        if (g_CurrentReporter == this)
+        {
+            g_CurrentReporter = nullptr;
+        }
+    }
+
+    void Reporter::Report(Severity severity, FilePosition pos, const std::string& msg)
+    {
+        if (severity == Severity::NOTE)
+        {
+            AddNote(pos, msg);
+            return;
+        }
+
+        if (ErrorLimitReached())
+        {
+            m_DroppedLast = true;
+            return;
+        }
+
+        m_DroppedLast = false;
+
+        if (m_Diagnostics.size() >= gc_FlushThreshold)
+        {
+            Flush();
+        }
+
+        m_Diagnostics.emplace_back(severity, pos, msg);
+
+        if (severity == Severity::ERROR || severity == Severity::FATAL)
+        {
+            m_ErrorCount++;
+        }
+    }
+
+    void Reporter::AddNote(FilePosition pos, const std::string& msg)
+    {
+        if (m_DroppedLast || m_Diagnostics.empty())
+        {
+            return;
+        }
+
+        m_Diagnostics.back().notes.emplace_back(Severity::NOTE, pos, msg);
+    }
+
+    void Reporter::Flush()
+    {
+        if (ErrorLimitReached() && !m_LimitReported)
+        {
+            m_LimitReported = true;
+            m_Diagnostics.emplace_back(Severity::FATAL, FilePosition(0, 0, nullptr),
+                                       "too many errors emitted, stopping now [-ferror-limit="
+                                       + std::to_string(m_ErrorLimit) + "]");
+        }
+
+        if (m_Diagnostics.empty())
+        {
+            return;
+        }
+
+        std::string buffer;
+        buffer.reserve(m_Diagnostics.size() * 96);
+
+        for (const Diagnostic& diag : m_Diagnostics)
+        {
+            if (m_Format == DiagnosticsFormat::JSON)
+            {
+                WriteJson(buffer, diag);
+                buffer += '\n';
+            }
+            else
+            {
+                WriteText(buffer, diag);
+            }
+        }
+
+        m_Diagnostics.clear();
+
+        m_Out.write(buffer.data(), buffer.size());
+        m_Out.flush();
+    }
+
+    void Reporter::WriteText(std::string& buffer, const Diagnostic& diag) const
+    {
+        if (diag.pos.file != nullptr)
+        {
+            buffer += diag.pos.file->path;
+            buffer += ':';
+            buffer += std::to_string(diag.pos.line);
+            buffer += ':';
+            buffer += std::to_string(diag.pos.column);
+            buffer += ": ";
+        }
+
+        buffer += SeverityToString(diag.severity);
+        buffer += ": ";
+        buffer += diag.msg;
+        buffer += ".\n";
+
+        for (const Diagnostic& note : diag.notes)
+        {
+            WriteText(buffer, note);
+        }
+    }
+
+    void Reporter::WriteJson(std::string& buffer, const Diagnostic& diag) const
+    {
+        buffer += "{\"severity\":";
+        AppendJsonString(buffer, SeverityToString(diag.severity));
+
+        if (diag.pos.file != nullptr)
+        {
+            buffer += ",\"file\":";
+            AppendJsonString(buffer, diag.pos.file->path);
+            buffer += ",\"line\":";
+            buffer += std::to_string(diag.pos.line);
+            buffer += ",\"column\":";
+            buffer += std::to_string(diag.pos.column);
+        }
+
+        buffer += ",\"message\":";
+        AppendJsonString(buffer, diag.msg);
+
+        if (!diag.notes.empty())
+        {
+            buffer += ",\"notes\":[";
+
+            for (size_t i = 0; i < diag.notes.size(); i++)
+            {
+                if (i != 0)
+                {
+                    buffer += ',';
+                }
+
+                WriteJson(buffer, diag.notes[i]);
+            }
+
+            buffer += ']';
+        }
+
+        buffer += '}';
+    }
+
+    Reporter& GetReporter()
+    {
+        if (g_CurrentReporter == nullptr)
+        {
+            static Reporter defaultReporter(std::cerr);
+            return defaultReporter;
+        }
+
+        return *g_CurrentReporter;
+    }
+
+    void SetReporter(Reporter* reporter)
+    {
+        g_CurrentReporter = reporter;
+    }
+
     void ReportError(FilePosition pos, const std::string& msg)
     {
-        std::cerr << pos.line << ": error: " << msg << "." << std::endl;
+        GetReporter().Report(Severity::ERROR, pos, msg);
+    }
+
+    void ReportWarning(FilePosition pos, const std::string& msg)
+    {
+        GetReporter().Report(Severity::WARNING, pos, msg);
+    }
+
+    void ReportNote(FilePosition pos, const std::string& msg)
+    {
+        GetReporter().AddNote(pos, msg);
     }
 } // namespace CComp
@@ -1,11 +1,95 @@
 #ifndef CCOMP_REPORTER_HPP
 #define CCOMP_REPORTER_HPP
 
+#include <string>
+#include <vector>
+#include <ostream>
+
 #include "File/FilePosition.hpp"
 
 namespace CComp
 {
+    enum class Severity
+    {
+        NOTE,
+        WARNING,
+        ERROR,
+        FATAL,
+    }; // enum class Severity
+
+    enum class DiagnosticsFormat
+    {
+        TEXT,
+        JSON,
+    }; // enum class DiagnosticsFormat
+
+    struct Diagnostic
+    {
+        Severity severity;
+        FilePosition pos;
+        std::string msg;
+        std::vector<Diagnostic> notes;
+
+        Diagnostic(Severity severity, FilePosition pos, const std::string& msg)
+            : severity(severity),
+              pos(pos),
+              msg(msg)
+        {}
+    }; // struct Diagnostic
+
+    // Collects diagnostics in a buffer and writes them out in batches.
+    // Once the error limit is reached a single fatal diagnostic is added and
+    // everything reported after it is dropped.
+    class Reporter
+    {
+    public:
+        Reporter(std::ostream& out,
+                 DiagnosticsFormat format = DiagnosticsFormat::TEXT,
+                 size_t errorLimit = 0); // 0 means no limit.
+        ~Reporter();
+
+        void Report(Severity severity, FilePosition pos, const std::string& msg);
+
+        // Attaches a note to the last reported diagnostic.
+        void AddNote(FilePosition pos, const std::string& msg);
+
+        void Flush();
+
+        bool HadError() const
+        { return m_ErrorCount != 0; }
+
+        size_t GetErrorCount() const
+        { return m_ErrorCount; }
+
+        bool ErrorLimitReached() const
+        { return m_ErrorLimit != 0 && m_ErrorCount >= m_ErrorLimit; }
+
+    private:
+        std::ostream& m_Out;
+        DiagnosticsFormat m_Format;
+        size_t m_ErrorLimit;
+
+        size_t m_ErrorCount = 0;
+        size_t m_FlushedCount = 0;
+        bool m_DroppedLast = false;
+        bool m_LimitReported = false;
+
+        std::vector<Diagnostic> m_Diagnostics;
+
+        void WriteText(std::string& buffer, const Diagnostic& diag) const;
+        void WriteJson(std::string& buffer, const Diagnostic& diag) const;
+    }; // class Reporter
+
+    // The reporter used by ReportError and friends. Each thread may install its own.
+    Reporter& GetReporter();
+    void SetReporter(Reporter* reporter);
+
+    // Appends str to buffer as a quoted JSON string.
+    void AppendJsonString(std::string& buffer, const std::string& str);
+
     void ReportError(FilePosition pos, const std::string& msg);
+    void ReportWarning(FilePosition pos, const std::string& msg);
+    void ReportNote(FilePosition pos, const std::string& msg);
 } // namespace CComp
 
 #endif // CCOMP_REPORTER_HPP
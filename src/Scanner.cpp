@@ -1,14 +1,24 @@
 #include "Scanner.hpp"
 
+#include <string_view>
+#include <utility>
+
+#include "AllocationCounter.hpp"
 #include "File/Reader.hpp"
+#include "TimeReport.hpp"
+#include "Trace.hpp"
 
 namespace CComp
 {
-    std::unordered_map<std::string, TokenType> g_StringToKeyword =
+    namespace
     {
-        { "int", TokenType::INT },
-        { "return", TokenType::RETURN }
-    };
+        // Read-only, so scanners on different threads can share it.
+        constexpr std::pair<std::string_view, TokenType> gc_Keywords[] =
+        {
+            { "int", TokenType::INT },
+            { "return", TokenType::RETURN }
+        };
+    } // namespace
 
     bool IsAlpha(char ch)
     {
@@ -28,6 +38,14 @@ namespace CComp
     }
 
     Token Scanner::NextToken()
+    {
+        ScopedTimer timer(TimedPhase::SCAN);
+        ScopedMemoryCategory memory(MemoryCategory::TOKENS);
+
+        return ScanToken();
+    }
+
+    Token Scanner::ScanToken()
     {
         SkipWhitespace();
         BeginNewToken();
@@ -37,7 +55,7 @@ namespace CComp
             if (!m_States.empty())
             {
                 PopState();
-                return NextToken();
+                return ScanToken();
             }
 
             return MakeToken(TokenType::END_OF_FILE);
@@ -52,6 +70,7 @@ namespace CComp
         case ')': return MakeToken(TokenType::RIGHT_PAREN);
         case '{': return MakeToken(TokenType::LEFT_BRACKET);
         case '}': return MakeToken(TokenType::RIGHT_BRACKET);
+        case ',': return MakeToken(TokenType::COMMA);
 
         case '-': return Match('-')
                 ? MakeToken(TokenType::MINUS_MINUS)
@@ -154,6 +173,7 @@ namespace CComp
             case '\n':
                 m_Line++;
                 Advance();
+                m_LineStart = m_Current;
                 break;
             default:
                 return;
@@ -169,9 +189,10 @@ namespace CComp
     void Scanner::BeginNewFile(std::shared_ptr<const File> file)
     {
         m_File = file;
-        m_Line = 0;
+        m_Line = 1;
         m_Start = file->begin();
         m_Current = m_Start;
+        m_LineStart = m_Start;
     }
 
     char Scanner::Peek(size_t offset) const
@@ -222,10 +243,25 @@ namespace CComp
         {
             Macro& macro = m_Macro[name];
 
-            PushState();
-            BeginNewFile(std::make_shared<File>(macro.rewrite)); // That's a hack. What if File type changes?
+            {
+                ScopedMemoryCategory memory(MemoryCategory::MACROS);
+
+                PushState();
+                BeginNewFile(std::make_shared<File>("<macro " + name + ">", macro.rewrite));
+            }
+
+            if (IsTracing())
+            {
+                // Expansions within expansions belong to the same burst.
+                if (m_OpenTraceSpans.empty() || !m_OpenTraceSpans.back().isMacro)
+                {
+                    m_OpenTraceSpans.push_back({ m_States.size(), GetTraceTime(), true, "macro expansion", 0 });
+                }
 
-            return NextToken();
+                m_OpenTraceSpans.back().expansions++;
+            }
+
+            return ScanToken();
         }
 
         return MakeToken(CheckKeyword(name));
@@ -243,16 +279,15 @@ namespace CComp
 
     TokenType Scanner::CheckKeyword(const std::string& str) const
     {
-        auto iter = g_StringToKeyword.find(str);
-
-        if (iter != g_StringToKeyword.end())
+        for (const auto& [keyword, type] : gc_Keywords)
         {
-            return iter->second;
-        }
-        else
-        {
-            return TokenType::IDENTIFIER;
+            if (keyword == str)
+            {
+                return type;
+            }
         }
+
+        return TokenType::IDENTIFIER;
     }
 
     Token Scanner::MakeToken(TokenType type) const
@@ -267,7 +302,7 @@ namespace CComp
 
     FilePosition Scanner::MakeCurrentPosition() const
     {
-        return FilePosition(m_Line, m_File);
+        return FilePosition(m_Line, m_Start - m_LineStart + 1, m_File);
     }
 
     Token Scanner::Directive()
@@ -331,11 +366,18 @@ namespace CComp
         PushState();
         BeginNewFile(file);
 
-        return NextToken();
+        if (IsTracing())
+        {
+            m_OpenTraceSpans.push_back({ m_States.size(), GetTraceTime(), false, path, 0 });
+        }
+
+        return ScanToken();
     }
 
     Token Scanner::DefineDirective()
     {
+        ScopedMemoryCategory memory(MemoryCategory::MACROS);
+
         if (IsAtEnd())
         {
             return MakeErrorToken("expected macro name");
@@ -381,7 +423,7 @@ namespace CComp
 
             rewrite.insert(rewrite.end(), m_Start, m_Current);
 
-            if (rewrite.back() == '\\')
+            if (!rewrite.empty() && rewrite.back() == '\\')
             {
                 rewrite.pop_back();
                 rewrite.push_back('\n');
@@ -391,7 +433,7 @@ namespace CComp
             break;
         }
 
-        if (rewrite.back() == '\n')
+        if (!rewrite.empty() && rewrite.back() == '\n')
         {
             rewrite.pop_back();
         }
@@ -404,13 +446,15 @@ namespace CComp
         {
             m_Macro[name.str] = { isFunction, argCount, rewrite };
 
-            return NextToken();
+            return ScanToken();
         }
     }
 
     void Scanner::PushState()
     {
-        m_States.push_back({ m_File, m_Line, m_Start, m_Current });
+        ScopedMemoryCategory memory(MemoryCategory::SCANNER_STATES);
+
+        m_States.push_back({ m_File, m_Line, m_LineStart, m_Start, m_Current });
     }
 
     void Scanner::PopState()
@@ -422,7 +466,24 @@ namespace CComp
 
         m_File = state.file;
         m_Line = state.line;
+        m_LineStart = state.lineStart;
         m_Start = state.start;
         m_Current = state.current;
+
+        while (!m_OpenTraceSpans.empty() && m_OpenTraceSpans.back().depth > m_States.size())
+        {
+            const OpenTraceSpan& span = m_OpenTraceSpans.back();
+
+            if (span.isMacro)
+            {
+                AddTraceSpan("macro", span.name, span.start, "expansions", span.expansions);
+            }
+            else
+            {
+                AddTraceSpan("include", span.name, span.start);
+            }
+
+            m_OpenTraceSpans.pop_back();
+        }
     }
 }
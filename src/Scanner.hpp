@@ -1,9 +1,11 @@
 #ifndef CCOMP_SCANNER_HPP
 #define CCOMP_SCANNER_HPP
 
+#include <cstdint>
 #include <memory>
 #include <fstream>
 #include <functional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -29,6 +31,7 @@ namespace CComp
 
         std::shared_ptr<const File> m_File;
         size_t m_Line;
+        File::const_iterator m_LineStart;
         File::const_iterator m_Start;
         File::const_iterator m_Current;
 
@@ -36,6 +39,7 @@ namespace CComp
         {
             std::shared_ptr<const File> file;
             size_t line;
+            File::const_iterator lineStart;
             File::const_iterator start;
             File::const_iterator current;
         }; // struct ScannerState
@@ -45,6 +49,19 @@ namespace CComp
         void PushState();
         void PopState();
 
+        // An included file, or a burst of macro expansions, being scanned while tracing.
+        // It ends once the state it pushed is popped.
+        struct OpenTraceSpan
+        {
+            size_t depth;
+            int64_t start;
+            bool isMacro;
+            std::string name;
+            long long expansions;
+        }; // struct OpenTraceSpan
+
+        std::vector<OpenTraceSpan> m_OpenTraceSpans;
+
         struct Macro
         {
             bool isFunction;
@@ -66,6 +83,10 @@ namespace CComp
         void AdvanceWhile(const std::function<bool(char)> func);
         bool Match(char ch);
 
+        // NextToken without its timer, for the calls that restart the scan after a directive,
+        // a macro or the end of an included file: the time report counts one call per token.
+        Token ScanToken();
+
         Token IdentifierOrKeyword();
         Token Number();
 
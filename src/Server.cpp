@@ -0,0 +1,500 @@
+#include "Server.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "AllocationCounter.hpp"
+#include "Statistics.hpp"
+#include "TimeReport.hpp"
+
+namespace CComp
+{
+    namespace
+    {
+        // A request is the length of the rest, the number of strings, then each string as
+        // its length and bytes: the working directory first, then the arguments. The
+        // client's standard output and error come with its first byte. The reply is the
+        // exit code. Numbers are 32 bits, in host order; both ends are on the same host.
+        constexpr size_t gc_DescriptorCount = 2;
+
+        // Large enough for any command line.
+        constexpr uint32_t gc_MaxRequestSize = 1 << 24;
+
+        // How long a read of a request may wait, so that a client which stalls does not hold
+        // up the ones behind it.
+        constexpr time_t gc_ReceiveTimeoutSeconds = 5;
+
+        volatile std::sig_atomic_t g_Stopping = 0;
+
+        void Stop(int)
+        {
+            g_Stopping = 1;
+        }
+
+        bool MakeAddress(const std::filesystem::path& socketPath, sockaddr_un& address)
+        {
+            const std::string& path = socketPath.native();
+            if (path.size() >= sizeof(address.sun_path))
+            {
+                std::cerr << "Error: socket path '" << path << "' is too long." << std::endl;
+                return false;
+            }
+
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return true;
+        }
+
+        // The socket goes in a directory that only its user, or root, can take it out of:
+        // one that is theirs, or a sticky one like /tmp. A missing last component is
+        // created, readable by the user alone.
+        bool PrepareSocketDirectory(const std::filesystem::path& directory)
+        {
+            if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST)
+            {
+                std::cerr << "Error: could not create the directory '" << directory.string() << "': "
+                          << std::strerror(errno) << "." << std::endl;
+                return false;
+            }
+
+            struct stat status;
+            if (lstat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)
+                || (status.st_uid != getuid() && status.st_uid != 0)
+                || ((status.st_mode & (S_IWGRP | S_IWOTH)) != 0 && (status.st_mode & S_ISVTX) == 0))
+            {
+                std::cerr << "Error: the directory '" << directory.string()
+                          << "' is not a safe place for the socket; other users could replace it." << std::endl;
+                return false;
+            }
+
+            return true;
+        }
+
+        // Requests hand over the client's output and run in its directory, so both ends
+        // deal only with their own user.
+        bool IsPeerSameUser(int connection)
+        {
+            ucred credentials;
+            socklen_t size = sizeof(credentials);
+
+            return getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0
+                   && credentials.uid == getuid();
+        }
+
+        bool WriteAll(int fd, const void* data, size_t size)
+        {
+            const char* bytes = static_cast<const char*>(data);
+
+            while (size != 0)
+            {
+                ssize_t written = write(fd, bytes, size);
+                if (written < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (written <= 0)
+                {
+                    return false;
+                }
+
+                bytes += written;
+                size -= static_cast<size_t>(written);
+            }
+
+            return true;
+        }
+
+        bool ReadAll(int fd, void* data, size_t size)
+        {
+            char* bytes = static_cast<char*>(data);
+
+            while (size != 0)
+            {
+                ssize_t got = read(fd, bytes, size);
+                if (got < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (got <= 0)
+                {
+                    return false;
+                }
+
+                bytes += got;
+                size -= static_cast<size_t>(got);
+            }
+
+            return true;
+        }
+
+        void PutUint32(std::string& buffer, uint32_t value)
+        {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        bool GetUint32(const std::string& buffer, size_t& offset, uint32_t& value)
+        {
+            if (buffer.size() - offset < sizeof(value))
+            {
+                return false;
+            }
+
+            std::memcpy(&value, buffer.data() + offset, sizeof(value));
+            offset += sizeof(value);
+            return true;
+        }
+
+        // Reads one request, and the descriptors sent with it, from a client.
+        // Whatever descriptors came with a message that is refused are open in this process all the same.
+        void CloseReceivedDescriptors(msghdr& message)
+        {
+            for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+            {
+                if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+                {
+                    continue;
+                }
+
+                size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (size_t i = 0; i < count; i++)
+                {
+                    int fd;
+                    std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(fd));
+                    close(fd);
+                }
+            }
+        }
+
+        bool ReceiveRequest(int connection, std::vector<std::string>& strings, int (&fds)[gc_DescriptorCount])
+        {
+            uint32_t size = 0;
+
+            iovec part = { &size, sizeof(size) };
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+
+            msghdr message = {};
+            message.msg_iov = &part;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+
+            ssize_t got = recvmsg(connection, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+            if (got < 0)
+            {
+                return false;
+            }
+
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            if (got != static_cast<ssize_t>(sizeof(size)) || (message.msg_flags & MSG_CTRUNC) != 0
+                || header == nullptr || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS
+                || header->cmsg_len != CMSG_LEN(sizeof(fds)) || CMSG_NXTHDR(&message, header) != nullptr)
+            {
+                CloseReceivedDescriptors(message);
+                return false;
+            }
+
+            std::memcpy(fds, CMSG_DATA(header), sizeof(fds));
+
+            if (size > gc_MaxRequestSize)
+            {
+                return false;
+            }
+
+            std::string buffer(size, '\0');
+            if (!ReadAll(connection, buffer.data(), size))
+            {
+                return false;
+            }
+
+            size_t offset = 0;
+            uint32_t count = 0;
+            if (!GetUint32(buffer, offset, count))
+            {
+                return false;
+            }
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t length = 0;
+                if (!GetUint32(buffer, offset, length) || buffer.size() - offset < length)
+                {
+                    return false;
+                }
+
+                strings.push_back(buffer.substr(offset, length));
+                offset += length;
+            }
+
+            return !strings.empty();
+        }
+
+        // Runs one request with the client's directory and output in place of the server's.
+        int Serve(const CompileRequestHandler& handler, const std::vector<std::string>& strings,
+                  const int (&fds)[gc_DescriptorCount])
+        {
+            std::error_code error;
+            std::filesystem::path serverDirectory = std::filesystem::current_path(error);
+
+            std::cout.flush();
+
+            int savedOut = dup(STDOUT_FILENO);
+            int savedErr = dup(STDERR_FILENO);
+
+            dup2(fds[0], STDOUT_FILENO);
+            dup2(fds[1], STDERR_FILENO);
+
+            int exitCode = 1;
+
+            std::filesystem::current_path(strings[0], error);
+            if (error)
+            {
+                std::cerr << "Error: could not change to the directory '" << strings[0] << "'." << std::endl;
+            }
+            else
+            {
+                ResetStatistics();
+                ResetTimeReport();
+                ResetMemoryUsage();
+                exitCode = handler(std::vector<std::string>(strings.begin() + 1, strings.end()));
+            }
+
+            // The client may have gone; its streams are not the server's to keep failing.
+            std::cout.flush();
+            std::cerr.flush();
+            std::fflush(nullptr);
+            std::cout.clear();
+            std::cerr.clear();
+
+            dup2(savedOut, STDOUT_FILENO);
+            dup2(savedErr, STDERR_FILENO);
+            close(savedOut);
+            close(savedErr);
+
+            std::filesystem::current_path(serverDirectory, error);
+
+            return exitCode;
+        }
+    } // namespace
+
+    std::filesystem::path GetDefaultSocketPath()
+    {
+        const char* runtimeDirectory = std::getenv("XDG_RUNTIME_DIR");
+        if (runtimeDirectory != nullptr && runtimeDirectory[0] == '/')
+        {
+            return std::filesystem::path(runtimeDirectory) / "ccomp.sock";
+        }
+
+        std::error_code error;
+
+        std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+        if (error)
+        {
+            directory = "/tmp";
+        }
+
+        return directory / ("ccomp-" + std::to_string(getuid())) / "server.sock";
+    }
+
+    int RunServer(const std::filesystem::path& socketPath, const CompileRequestHandler& handler)
+    {
+        sockaddr_un address;
+        if (!MakeAddress(socketPath, address))
+        {
+            return 1;
+        }
+
+        if (!PrepareSocketDirectory(socketPath.parent_path().empty() ? "." : socketPath.parent_path()))
+        {
+            return 1;
+        }
+
+        int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0)
+        {
+            std::cerr << "Error: could not create a socket." << std::endl;
+            return 1;
+        }
+
+        // A socket left behind by a server that is gone is taken over; a live one is not.
+        std::error_code error;
+        if (std::filesystem::is_socket(socketPath, error))
+        {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+            close(probe);
+
+            if (live)
+            {
+                std::cerr << "Error: a compile server is already listening on '" << socketPath.string() << "'."
+                          << std::endl;
+                close(listener);
+                return 1;
+            }
+
+            std::filesystem::remove(socketPath, error);
+        }
+
+        if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+            || listen(listener, SOMAXCONN) != 0)
+        {
+            std::cerr << "Error: could not listen on '" << socketPath.string() << "': " << std::strerror(errno) << "."
+                      << std::endl;
+            close(listener);
+            return 1;
+        }
+
+        // Without SA_RESTART, so a signal interrupts accept and the loop can end.
+        struct sigaction stop = {};
+        stop.sa_handler = Stop;
+        sigaction(SIGINT, &stop, nullptr);
+        sigaction(SIGTERM, &stop, nullptr);
+
+        // A client that goes away must not take the server with it.
+        std::signal(SIGPIPE, SIG_IGN);
+
+        while (!g_Stopping)
+        {
+            int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection < 0)
+            {
+                continue;
+            }
+
+            if (!IsPeerSameUser(connection))
+            {
+                std::cerr << "Error: refused a request from another user." << std::endl;
+                close(connection);
+                continue;
+            }
+
+            timeval timeout = { gc_ReceiveTimeoutSeconds, 0 };
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            std::vector<std::string> strings;
+            int fds[gc_DescriptorCount] = { -1, -1 };
+
+            if (ReceiveRequest(connection, strings, fds))
+            {
+                int32_t exitCode = Serve(handler, strings, fds);
+
+                WriteAll(connection, &exitCode, sizeof(exitCode));
+            }
+
+            for (int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+
+            close(connection);
+        }
+
+        close(listener);
+        std::filesystem::remove(socketPath, error);
+
+        return 0;
+    }
+
+    int RunClient(const std::filesystem::path& socketPath, const std::vector<std::string>& args)
+    {
+        sockaddr_un address;
+        if (!MakeAddress(socketPath, address))
+        {
+            return 1;
+        }
+
+        // Whoever made the socket gets the client's output; it has to be a server of this user.
+        struct stat status;
+        if (lstat(socketPath.c_str(), &status) == 0 && (!S_ISSOCK(status.st_mode) || status.st_uid != getuid()))
+        {
+            std::cerr << "Error: '" << socketPath.string() << "' is not a socket of this user." << std::endl;
+            return 1;
+        }
+
+        int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connection < 0
+            || connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::cerr << "Error: no compile server is listening on '" << socketPath.string() << "'." << std::endl;
+
+            if (connection >= 0)
+            {
+                close(connection);
+            }
+
+            return 1;
+        }
+
+        // The socket may have been replaced since it was checked.
+        if (!IsPeerSameUser(connection))
+        {
+            std::cerr << "Error: the compile server on '" << socketPath.string() << "' runs as another user."
+                      << std::endl;
+            close(connection);
+            return 1;
+        }
+
+        std::error_code error;
+
+        std::vector<std::string> strings;
+        strings.push_back(std::filesystem::current_path(error).string());
+        strings.insert(strings.end(), args.begin(), args.end());
+
+        std::string payload;
+        PutUint32(payload, static_cast<uint32_t>(strings.size()));
+
+        for (const std::string& str : strings)
+        {
+            PutUint32(payload, static_cast<uint32_t>(str.size()));
+            payload += str;
+        }
+
+        uint32_t size = static_cast<uint32_t>(payload.size());
+        int fds[gc_DescriptorCount] = { STDOUT_FILENO, STDERR_FILENO };
+
+        iovec part = { &size, sizeof(size) };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+
+        msghdr message = {};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(fds));
+        std::memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+        int32_t exitCode = 1;
+
+        bool sent = sendmsg(connection, &message, 0) == static_cast<ssize_t>(sizeof(size))
+                    && WriteAll(connection, payload.data(), payload.size());
+
+        if (!sent || !ReadAll(connection, &exitCode, sizeof(exitCode)))
+        {
+            std::cerr << "Error: the compile server did not finish the request." << std::endl;
+            exitCode = 1;
+        }
+
+        close(connection);
+        return exitCode;
+    }
+} // namespace CComp
@@ -0,0 +1,34 @@
+#ifndef CCOMP_SERVER_HPP
+#define CCOMP_SERVER_HPP
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace CComp
+{
+    // A resident compiler, so builds of many small files do not pay for starting a process
+    // and reading the same headers for each. The client sends its arguments, its working
+    // directory and its standard output and error; the server compiles with those in place,
+    // so output and diagnostics reach the client's terminal as they are written, and sends
+    // the exit code back. Requests are served one at a time.
+
+    // Where --server and --client meet unless told otherwise: one socket per user, in
+    // $XDG_RUNTIME_DIR or else in a directory of the user's own under the temporary one.
+    // Both ends refuse a peer running as another user.
+    std::filesystem::path GetDefaultSocketPath();
+
+    // Compiles as args say and returns the exit code.
+    using CompileRequestHandler = std::function<int(const std::vector<std::string>& args)>;
+
+    // Serves requests on a Unix socket at socketPath until SIGINT or SIGTERM. Returns the
+    // exit code of the server, having written to the standard error what went wrong.
+    int RunServer(const std::filesystem::path& socketPath, const CompileRequestHandler& handler);
+
+    // Has the server at socketPath compile as args say. Returns the exit code of the
+    // compilation, or 1 if the server could not be reached.
+    int RunClient(const std::filesystem::path& socketPath, const std::vector<std::string>& args);
+} // namespace CComp
+
+#endif // CCOMP_SERVER_HPP
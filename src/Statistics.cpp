@@ -0,0 +1,35 @@
+#include "Statistics.hpp"
+
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace CComp
+{
+    std::mutex g_StatisticsMutex;
+    std::map<std::pair<std::string, std::string>, long long> g_Statistics;
+
+    void AddStatistic(const std::string& group, const std::string& name, long long value)
+    {
+        std::lock_guard<std::mutex> lock(g_StatisticsMutex);
+        g_Statistics[{ group, name }] += value;
+    }
+
+    void PrintStatistics(std::ostream& out)
+    {
+        std::lock_guard<std::mutex> lock(g_StatisticsMutex);
+
+        out << "=== Statistics ===" << std::endl;
+
+        for (const auto& [key, value] : g_Statistics)
+        {
+            out << key.first << ": " << key.second << ": " << value << std::endl;
+        }
+    }
+
+    void ResetStatistics()
+    {
+        std::lock_guard<std::mutex> lock(g_StatisticsMutex);
+        g_Statistics.clear();
+    }
+} // namespace CComp
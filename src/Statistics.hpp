@@ -0,0 +1,17 @@
+#ifndef CCOMP_STATISTICS_HPP
+#define CCOMP_STATISTICS_HPP
+
+#include <string>
+#include <ostream>
+
+namespace CComp
+{
+    // Named counters that passes bump and --stats prints. Safe to use from several threads.
+    void AddStatistic(const std::string& group, const std::string& name, long long value);
+    void PrintStatistics(std::ostream& out);
+
+    // Forgets every counter, e.g. between the compilations of a compile server.
+    void ResetStatistics();
+} // namespace CComp
+
+#endif // CCOMP_STATISTICS_HPP
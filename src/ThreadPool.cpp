@@ -0,0 +1,132 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include "AllocationCounter.hpp"
+
+namespace CComp
+{
+    ThreadPool::ThreadPool(size_t threadCount)
+    {
+        threadCount = GetJobCount(threadCount);
+
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            m_Threads.emplace_back(&ThreadPool::Work, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+
+        m_TaskReady.notify_all();
+
+        for (std::thread& thread : m_Threads)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Tasks.push_back(std::move(task));
+            m_Unfinished++;
+        }
+
+        m_TaskReady.notify_one();
+    }
+
+    void ThreadPool::Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_AllDone.wait(lock, [this] { return m_Unfinished == 0; });
+    }
+
+    void ThreadPool::Work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_TaskReady.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+
+                if (m_Tasks.empty())
+                {
+                    ReleaseThreadMemoryUsage();
+                    return;
+                }
+
+                task = std::move(m_Tasks.front());
+                m_Tasks.pop_front();
+            }
+
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (--m_Unfinished == 0)
+                {
+                    m_AllDone.notify_all();
+                }
+            }
+        }
+    }
+
+    size_t GetJobCount(size_t jobs)
+    {
+        if (jobs != 0)
+        {
+            return jobs;
+        }
+
+        // hardware_concurrency may not know, and says 0 then.
+        return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    void ParallelFor(size_t count, size_t jobs, const std::function<void(size_t)>& body)
+    {
+        jobs = std::min(GetJobCount(jobs), count);
+
+        if (jobs <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                body(i);
+            }
+
+            return;
+        }
+
+        // What the workers allocate counts toward the calling thread, as it would have
+        // with a single job. So does the memory they use, once they have exited.
+        std::atomic<size_t> allocations{ 0 };
+
+        {
+            ThreadPool pool(jobs);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                pool.Submit([&body, &allocations, i]
+                {
+                    size_t start = GetAllocationCount();
+                    body(i);
+                    allocations.fetch_add(GetAllocationCount() - start, std::memory_order_relaxed);
+                });
+            }
+
+            pool.Wait();
+        }
+
+        AddAllocationCount(allocations.load());
+        AdoptReleasedMemoryUsage();
+    }
+} // namespace CComp
@@ -0,0 +1,56 @@
+#ifndef CCOMP_THREAD_POOL_HPP
+#define CCOMP_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CComp
+{
+    // A fixed set of worker threads taking tasks from one queue, in the order submitted.
+    class ThreadPool
+    {
+    public:
+        // A threadCount of 0 means one thread per hardware thread.
+        explicit ThreadPool(size_t threadCount);
+
+        // Finishes the queued tasks, then joins the threads.
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void Submit(std::function<void()> task);
+
+        // Blocks until every task submitted so far has finished.
+        void Wait();
+
+        size_t GetThreadCount() const
+        { return m_Threads.size(); }
+
+    private:
+        std::vector<std::thread> m_Threads;
+        std::deque<std::function<void()>> m_Tasks;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_TaskReady;
+        std::condition_variable m_AllDone;
+        size_t m_Unfinished = 0;
+        bool m_Stopping = false;
+
+        void Work();
+    }; // class ThreadPool
+
+    // Resolves a job count of 0 to the number of hardware threads.
+    size_t GetJobCount(size_t jobs);
+
+    // Calls body(i) for every i < count on up to jobs threads. With a single job the calls
+    // happen in order on the calling thread, without starting any threads.
+    void ParallelFor(size_t count, size_t jobs, const std::function<void(size_t)>& body);
+} // namespace CComp
+
+#endif // CCOMP_THREAD_POOL_HPP
@@ -0,0 +1,136 @@
+#include "TimeReport.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+
+namespace CComp
+{
+    namespace
+    {
+        constexpr size_t gc_PhaseCount = static_cast<size_t>(TimedPhase::COUNT);
+
+        const char* const gc_PhaseNames[gc_PhaseCount] =
+        {
+            "read",
+            "scan",
+            "parse",
+            "codegen",
+        };
+
+        struct PhaseTotal
+        {
+            std::atomic<int64_t> nanoseconds{ 0 };
+            std::atomic<uint64_t> calls{ 0 };
+        }; // struct PhaseTotal
+
+        std::atomic<bool> g_TimeReportEnabled{ false };
+        PhaseTotal g_PhaseTotals[gc_PhaseCount];
+
+        // The innermost running timer of this thread.
+        thread_local ScopedTimer* g_CurrentTimer = nullptr;
+    } // namespace
+
+    void EnableTimeReport(bool enable)
+    {
+        g_TimeReportEnabled.store(enable, std::memory_order_relaxed);
+    }
+
+    bool IsTimeReportEnabled()
+    {
+        return g_TimeReportEnabled.load(std::memory_order_relaxed);
+    }
+
+    void ResetTimeReport()
+    {
+        for (PhaseTotal& total : g_PhaseTotals)
+        {
+            total.nanoseconds = 0;
+            total.calls = 0;
+        }
+    }
+
+    void PrintTimeReport(std::ostream& out, TimeReportFormat format)
+    {
+        double milliseconds[gc_PhaseCount];
+        double totalTime = 0;
+
+        for (size_t i = 0; i < gc_PhaseCount; i++)
+        {
+            milliseconds[i] = static_cast<double>(g_PhaseTotals[i].nanoseconds.load()) / 1e6;
+            totalTime += milliseconds[i];
+        }
+
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(3);
+
+        if (format == TimeReportFormat::JSON)
+        {
+            out << "{\"phases\":[";
+
+            for (size_t i = 0; i < gc_PhaseCount; i++)
+            {
+                out << (i == 0 ? "" : ",") << "{\"name\":\"" << gc_PhaseNames[i] << "\",\"wall_ms\":"
+                    << milliseconds[i] << ",\"calls\":" << g_PhaseTotals[i].calls.load() << '}';
+            }
+
+            out << "],\"total_ms\":" << totalTime << '}' << std::endl;
+        }
+        else
+        {
+            out << "=== Time report ===" << std::endl;
+            out << std::setw(12) << "Wall (ms)" << std::setw(8) << "%" << std::setw(14) << "Calls" << "  Phase"
+                << std::endl;
+
+            for (size_t i = 0; i < gc_PhaseCount; i++)
+            {
+                double percent = totalTime == 0 ? 0 : 100 * milliseconds[i] / totalTime;
+
+                out << std::setw(12) << milliseconds[i] << std::setw(8) << std::setprecision(1) << percent
+                    << std::setprecision(3) << std::setw(14) << g_PhaseTotals[i].calls.load() << "  "
+                    << gc_PhaseNames[i] << std::endl;
+            }
+
+            out << std::setw(12) << totalTime << std::setw(8) << "" << std::setw(14) << "" << "  Total" << std::endl;
+        }
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    ScopedTimer::ScopedTimer(TimedPhase phase)
+        : m_Phase(phase), m_Enabled(IsTimeReportEnabled())
+    {
+        if (!m_Enabled)
+        {
+            return;
+        }
+
+        m_Parent = g_CurrentTimer;
+        g_CurrentTimer = this;
+        m_Start = std::chrono::steady_clock::now();
+    }
+
+    ScopedTimer::~ScopedTimer()
+    {
+        if (!m_Enabled)
+        {
+            return;
+        }
+
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - m_Start;
+
+        PhaseTotal& total = g_PhaseTotals[static_cast<size_t>(m_Phase)];
+        total.nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed - m_Nested).count(),
+                                    std::memory_order_relaxed);
+        total.calls.fetch_add(1, std::memory_order_relaxed);
+
+        if (m_Parent != nullptr)
+        {
+            m_Parent->m_Nested += elapsed;
+        }
+
+        g_CurrentTimer = m_Parent;
+    }
+} // namespace CComp
@@ -0,0 +1,59 @@
+#ifndef CCOMP_TIME_REPORT_HPP
+#define CCOMP_TIME_REPORT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+namespace CComp
+{
+    // What -ftime-report breaks the compilation into.
+    enum class TimedPhase
+    {
+        READ,    // ReadFile, sources and includes alike.
+        SCAN,    // Scanner::NextToken, over all calls.
+        PARSE,   // Parser::Parse, less the scanning it asks for.
+        CODEGEN, // CodeGenVisitor, X64CodeGenVisitor and X86Backend.
+
+        COUNT
+    }; // enum class TimedPhase
+
+    enum class TimeReportFormat
+    {
+        NONE,
+        TEXT,
+        JSON,
+    }; // enum class TimeReportFormat
+
+    // Whether ScopedTimer measures anything; off, it does not read the clock.
+    void EnableTimeReport(bool enable);
+    bool IsTimeReportEnabled();
+
+    // Forgets what was measured so far, e.g. between the compilations of a compile server.
+    void ResetTimeReport();
+
+    // Every phase's time summed over all threads, so with -j above 1 it may exceed the wall time.
+    void PrintTimeReport(std::ostream& out, TimeReportFormat format);
+
+    // Adds the time from construction to destruction to a phase. Time spent in timers
+    // nested inside it on the same thread goes to their phases instead, so that nothing
+    // is counted twice: the reads NextToken does for includes, for one.
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(TimedPhase phase);
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        TimedPhase m_Phase;
+        bool m_Enabled;
+        ScopedTimer* m_Parent = nullptr;
+        std::chrono::steady_clock::time_point m_Start;
+        std::chrono::steady_clock::duration m_Nested = std::chrono::steady_clock::duration::zero();
+    }; // class ScopedTimer
+} // namespace CComp
+
+#endif // CCOMP_TIME_REPORT_HPP
@@ -21,7 +21,7 @@ namespace CComp
         {}
 
         Token()
-            : type(TokenType::IDENTIFIER), str("null"), pos(FilePosition(0, nullptr))
+            : type(TokenType::IDENTIFIER), str("null"), pos(FilePosition(0, 0, nullptr))
         {}
     }; // struct Token
 
@@ -0,0 +1,170 @@
+#include "Trace.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include "Reporter.hpp"
+
+namespace CComp
+{
+    namespace
+    {
+        struct TraceEvent
+        {
+            const char* category;
+            std::string name;
+            int64_t start;
+            int64_t duration;
+            uint32_t thread;
+            const char* counterName;
+            long long counter;
+        }; // struct TraceEvent
+
+        std::atomic<bool> g_Tracing{ false };
+        std::chrono::steady_clock::time_point g_TraceEpoch;
+
+        std::mutex g_TraceMutex;
+        std::vector<TraceEvent> g_TraceEvents;
+
+        std::atomic<uint32_t> g_NextThreadId{ 1 };
+
+        // Small numbers read better in a trace viewer than std::thread::id hashes.
+        uint32_t GetThreadId()
+        {
+            thread_local uint32_t id = g_NextThreadId++;
+            return id;
+        }
+
+        // Trace times are in microseconds; nanoseconds keep three decimals of them.
+        void AppendMicroseconds(std::string& buffer, int64_t nanoseconds)
+        {
+            char digits[24];
+            char* end = std::to_chars(digits, digits + sizeof(digits), nanoseconds / 1000).ptr;
+            buffer.append(digits, end);
+
+            int64_t fraction = nanoseconds % 1000;
+            buffer += '.';
+            buffer += static_cast<char>('0' + fraction / 100);
+            buffer += static_cast<char>('0' + fraction / 10 % 10);
+            buffer += static_cast<char>('0' + fraction % 10);
+        }
+    } // namespace
+
+    void StartTrace()
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_TraceMutex);
+            g_TraceEvents.clear();
+            g_TraceEpoch = std::chrono::steady_clock::now();
+        }
+
+        // The thread that starts the trace shows first.
+        GetThreadId();
+
+        g_Tracing = true;
+    }
+
+    void StopTrace()
+    {
+        g_Tracing = false;
+
+        std::lock_guard<std::mutex> lock(g_TraceMutex);
+        g_TraceEvents.clear();
+    }
+
+    bool IsTracing()
+    {
+        return g_Tracing.load(std::memory_order_relaxed);
+    }
+
+    int64_t GetTraceTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_TraceEpoch)
+            .count();
+    }
+
+    void AddTraceSpan(const char* category, const std::string& name, int64_t start,
+                      const char* counterName, long long counter)
+    {
+        int64_t end = GetTraceTime();
+        uint32_t thread = GetThreadId();
+
+        std::lock_guard<std::mutex> lock(g_TraceMutex);
+        g_TraceEvents.push_back({ category, name, start, end - start, thread, counterName, counter });
+    }
+
+    bool WriteTrace(const std::filesystem::path& path)
+    {
+        std::string buffer = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        {
+            std::lock_guard<std::mutex> lock(g_TraceMutex);
+
+            for (size_t i = 0; i < g_TraceEvents.size(); i++)
+            {
+                const TraceEvent& event = g_TraceEvents[i];
+
+                buffer += i == 0 ? "" : ",\n";
+                buffer += "{\"ph\":\"X\",\"pid\":1,\"tid\":";
+                buffer += std::to_string(event.thread);
+                buffer += ",\"cat\":\"";
+                buffer += event.category;
+                buffer += "\",\"name\":";
+                AppendJsonString(buffer, event.name);
+                buffer += ",\"ts\":";
+                AppendMicroseconds(buffer, event.start);
+                buffer += ",\"dur\":";
+                AppendMicroseconds(buffer, event.duration);
+
+                if (event.counterName != nullptr)
+                {
+                    buffer += ",\"args\":{\"";
+                    buffer += event.counterName;
+                    buffer += "\":";
+                    buffer += std::to_string(event.counter);
+                    buffer += '}';
+                }
+
+                buffer += '}';
+            }
+        }
+
+        buffer += "\n]}\n";
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.close();
+
+        return static_cast<bool>(out);
+    }
+
+    TraceSpan::TraceSpan(const char* category, std::string_view name)
+        : m_Category(category), m_Enabled(IsTracing())
+    {
+        if (m_Enabled)
+        {
+            m_Name = name;
+            m_Start = GetTraceTime();
+        }
+    }
+
+    TraceSpan::~TraceSpan()
+    {
+        if (m_Enabled)
+        {
+            AddTraceSpan(m_Category, m_Name, m_Start);
+        }
+    }
+
+    void TraceSpan::SetName(std::string_view name)
+    {
+        if (m_Enabled)
+        {
+            m_Name = name;
+        }
+    }
+} // namespace CComp
@@ -0,0 +1,53 @@
+#ifndef CCOMP_TRACE_HPP
+#define CCOMP_TRACE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace CComp
+{
+    // Spans of the compilation for --trace, written out as Chrome trace events, which
+    // chrome://tracing and Perfetto show as a flame view with one row per thread.
+
+    // Forgets earlier spans and starts recording; times count from here.
+    void StartTrace();
+    void StopTrace();
+
+    bool IsTracing();
+
+    // Nanoseconds since StartTrace.
+    int64_t GetTraceTime();
+
+    // Records a span from start until now on the calling thread. A counter, when named,
+    // shows among the span's arguments.
+    void AddTraceSpan(const char* category, const std::string& name, int64_t start,
+                      const char* counterName = nullptr, long long counter = 0);
+
+    // Writes the spans recorded so far as a JSON trace. False if the file cannot be written.
+    bool WriteTrace(const std::filesystem::path& path);
+
+    // A span covering the lifetime of the object, recorded only while tracing. The name
+    // is copied only then, so a span costs no allocation otherwise.
+    class TraceSpan
+    {
+    public:
+        TraceSpan(const char* category, std::string_view name);
+        ~TraceSpan();
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        // For spans whose name is only known once they are under way.
+        void SetName(std::string_view name);
+
+    private:
+        const char* m_Category;
+        std::string m_Name;
+        bool m_Enabled;
+        int64_t m_Start = 0;
+    }; // class TraceSpan
+} // namespace CComp
+
+#endif // CCOMP_TRACE_HPP
@@ -0,0 +1,370 @@
+#include "BytecodeGenVisitor.hpp"
+
+#include <algorithm>
+
+#include "../AST/AST.hpp"
+#include "../Reporter.hpp"
+#include "../Statistics.hpp"
+#include "../Unreachable.hpp"
+
+namespace CComp
+{
+    Bytecode::Module BytecodeGenVisitor::Compile(std::vector<std::unique_ptr<AST::Decl>>& ast)
+    {
+        module = Bytecode::Module();
+
+        for (auto& decl : ast)
+        {
+            decl->Accept(*this);
+        }
+
+        return std::move(module);
+    }
+
+    Bytecode::Register BytecodeGenVisitor::Compile(AST::Expr& expr)
+    {
+        expr.Accept(*this);
+        return result;
+    }
+
+    void BytecodeGenVisitor::VisitBasicType(AST::BasicType& node)
+    {}
+
+    void BytecodeGenVisitor::VisitTypeAndNameDecl(AST::TypeAndNameDecl& node)
+    {}
+
+    void BytecodeGenVisitor::VisitFunctionDecl(AST::FunctionDecl& node)
+    {
+        module.functions.emplace_back();
+
+        func = &module.functions.back();
+        func->name = node.name;
+        func->slotCount = node.slotCount;
+        func->registerCount = node.slotCount;
+
+        nextTemporary = node.slotCount;
+        jumpTarget = 0;
+
+        node.body->Accept(*this);
+
+        // The implicit return 0, as in EvalVisitor::VisitFunctionDecl.
+        if (func->code.empty() || func->code.back().op != Bytecode::Opcode::RET || jumpTarget == func->code.size())
+        {
+            Bytecode::Register zero = NewTemporary();
+            Emit(Bytecode::Opcode::LOADI, zero, 0, 0);
+            Emit(Bytecode::Opcode::RET, 0, zero);
+        }
+
+        // Registers are numbered past the limit like any other and wrap when cast, so the
+        // code of a function that needs too many is thrown away here.
+        if (func->registerCount > Bytecode::gc_MaxRegisterCount)
+        {
+            ReportError(node.pos, "function '" + node.name + "' needs " + std::to_string(func->registerCount)
+                        + " bytecode registers, more than the " + std::to_string(Bytecode::gc_MaxRegisterCount)
+                        + " an instruction can name");
+            hadError = true;
+
+            module.functions.pop_back();
+            func = nullptr;
+            return;
+        }
+
+        AddStatistic("bytecode", "instructions emitted", static_cast<long long>(func->code.size()));
+
+        func = nullptr;
+    }
+
+    void BytecodeGenVisitor::VisitIntegerNumberExpr(AST::IntegerNumberExpr& node)
+    {
+        result = NewTemporary();
+        Emit(Bytecode::Opcode::LOADI, result, 0, node.GetValue());
+    }
+
+    void BytecodeGenVisitor::VisitBlockStmt(AST::BlockStmt& node)
+    {
+        for (auto& stmt : node.stmts)
+        {
+            stmt->Accept(*this);
+
+            // Temporaries do not outlive their statement.
+            nextTemporary = func->slotCount;
+        }
+    }
+
+    void BytecodeGenVisitor::VisitReturnStmt(AST::ReturnStmt& node)
+    {
+        Emit(Bytecode::Opcode::RET, 0, Compile(*node.expr));
+    }
+
+    void BytecodeGenVisitor::VisitUnaryOpExpr(AST::UnaryOpExpr& node)
+    {
+        size_t mark = nextTemporary;
+
+        switch (node.op)
+        {
+        case AST::UnaryOp::NEGATION:
+        case AST::UnaryOp::BITWISE_COMPLEMENT:
+        case AST::UnaryOp::NOT:
+        {
+            Bytecode::Register value = Compile(*node.expr);
+
+            Bytecode::Opcode op = Bytecode::Opcode::NEG;
+            if (node.op == AST::UnaryOp::BITWISE_COMPLEMENT)
+            {
+                op = Bytecode::Opcode::NOT;
+            }
+            else if (node.op == AST::UnaryOp::NOT)
+            {
+                op = Bytecode::Opcode::LNOT;
+            }
+
+            nextTemporary = mark;
+            result = NewTemporary();
+            Emit(op, result, value);
+            return;
+        }
+
+        default:
+            break;
+        }
+
+        Bytecode::Register slot = static_cast<Bytecode::Register>(static_cast<AST::VarExpr&>(*node.expr).slot);
+
+        bool isIncrement = node.op == AST::UnaryOp::PRE_INCREMENT
+            || node.op == AST::UnaryOp::POST_INCREMENT;
+        bool isPrefix = node.op == AST::UnaryOp::PRE_INCREMENT
+            || node.op == AST::UnaryOp::PRE_DECREMENT;
+
+        if (isPrefix)
+        {
+            result = slot;
+        }
+        else
+        {
+            result = NewTemporary();
+            Emit(Bytecode::Opcode::MOV, result, slot);
+        }
+
+        Emit(Bytecode::Opcode::ADDI, slot, slot, isIncrement ? 1 : -1);
+    }
+
+    void BytecodeGenVisitor::VisitBinaryOpExpr(AST::BinaryOpExpr& node)
+    {
+        if (node.op == AST::BinaryOp::COMMA)
+        {
+            size_t mark = nextTemporary;
+
+            Compile(*node.left);
+            nextTemporary = mark;
+            Compile(*node.right);
+            return;
+        }
+
+        if (node.op == AST::BinaryOp::LOGIC_AND || node.op == AST::BinaryOp::LOGIC_OR)
+        {
+            ShortCircuitBinary(node);
+            return;
+        }
+
+        size_t mark = nextTemporary;
+
+        Bytecode::Register left = Compile(*node.left);
+
+        // A local is read where the instruction runs, after the right operand has been evaluated.
+        if (IsLocal(left) && HasSideEffects(*node.right))
+        {
+            Bytecode::Register copy = NewTemporary();
+            Emit(Bytecode::Opcode::MOV, copy, left);
+            left = copy;
+        }
+
+        auto number = dynamic_cast<AST::IntegerNumberExpr*>(node.right.get());
+        if (number != nullptr && (node.op == AST::BinaryOp::ADD || node.op == AST::BinaryOp::SUBSTRACT))
+        {
+            int32_t value = node.op == AST::BinaryOp::ADD ? number->GetValue() : Bytecode::Neg(number->GetValue());
+
+            nextTemporary = mark;
+            result = NewTemporary();
+            Emit(Bytecode::Opcode::ADDI, result, left, value);
+            return;
+        }
+
+        Bytecode::Register right = Compile(*node.right);
+
+        nextTemporary = mark;
+        result = NewTemporary();
+        Emit(BinaryOpToOpcode(node.op), result, left, right);
+    }
+
+    void BytecodeGenVisitor::ShortCircuitBinary(AST::BinaryOpExpr& node)
+    {
+        bool isAnd = node.op == AST::BinaryOp::LOGIC_AND;
+
+        Bytecode::Register res = NewTemporary();
+
+        Bytecode::Register left = Compile(*node.left);
+        size_t shortCircuit = EmitJump(isAnd ? Bytecode::Opcode::JZ : Bytecode::Opcode::JNZ, left);
+
+        Bytecode::Register right = Compile(*node.right);
+        Emit(Bytecode::Opcode::BOOL, res, right);
+        size_t end = EmitJump(Bytecode::Opcode::JMP);
+
+        PatchJump(shortCircuit);
+        Emit(Bytecode::Opcode::LOADI, res, 0, isAnd ? 0 : 1);
+
+        PatchJump(end);
+
+        nextTemporary = res + 1;
+        result = res;
+    }
+
+    void BytecodeGenVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
+    {
+        if (node.init != nullptr)
+        {
+            MoveTo(static_cast<Bytecode::Register>(node.slot), Compile(*node.init));
+        }
+    }
+
+    void BytecodeGenVisitor::VisitExprStmt(AST::ExprStmt& node)
+    {
+        Compile(*node.expr);
+    }
+
+    void BytecodeGenVisitor::VisitVarExpr(AST::VarExpr& node)
+    {
+        result = static_cast<Bytecode::Register>(node.slot);
+    }
+
+    void BytecodeGenVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    {
+        Bytecode::Register slot = static_cast<Bytecode::Register>(static_cast<AST::VarExpr&>(*node.target).slot);
+
+        size_t mark = nextTemporary;
+
+        Bytecode::Register value = Compile(*node.expr);
+
+        if (node.op == AST::AssignOp::SIMPLE_ASSIGN)
+        {
+            MoveTo(slot, value);
+        }
+        else
+        {
+            Emit(AssignOpToOpcode(node.op), slot, slot, value);
+        }
+
+        nextTemporary = mark;
+        result = slot;
+    }
+
+    Bytecode::Register BytecodeGenVisitor::NewTemporary()
+    {
+        Bytecode::Register reg = static_cast<Bytecode::Register>(nextTemporary++);
+        func->registerCount = std::max(func->registerCount, nextTemporary);
+        return reg;
+    }
+
+    bool BytecodeGenVisitor::IsLocal(Bytecode::Register reg) const
+    {
+        return reg < func->slotCount;
+    }
+
+    void BytecodeGenVisitor::Emit(Bytecode::Opcode op, Bytecode::Register dst, Bytecode::Register a, int32_t imm)
+    {
+        func->code.emplace_back(op, dst, a, imm);
+    }
+
+    void BytecodeGenVisitor::MoveTo(Bytecode::Register dst, Bytecode::Register value)
+    {
+        std::vector<Bytecode::Instruction>& code = func->code;
+
+        if (!IsLocal(value) && code.size() > jumpTarget
+            && Bytecode::HasResult(code.back().op) && code.back().dst == value)
+        {
+            code.back().dst = dst;
+            return;
+        }
+
+        Emit(Bytecode::Opcode::MOV, dst, value);
+    }
+
+    size_t BytecodeGenVisitor::EmitJump(Bytecode::Opcode op, Bytecode::Register cond)
+    {
+        Emit(op, 0, cond);
+        return func->code.size() - 1;
+    }
+
+    void BytecodeGenVisitor::PatchJump(size_t jump)
+    {
+        jumpTarget = func->code.size();
+        func->code[jump].imm = static_cast<int32_t>(jumpTarget);
+    }
+
+    bool BytecodeGenVisitor::HasSideEffects(const AST::Expr& expr) const
+    {
+        if (auto unary = dynamic_cast<const AST::UnaryOpExpr*>(&expr))
+        {
+            switch (unary->op)
+            {
+            case AST::UnaryOp::NEGATION:
+            case AST::UnaryOp::BITWISE_COMPLEMENT:
+            case AST::UnaryOp::NOT:
+                return HasSideEffects(*unary->expr);
+            default:
+                return true;
+            }
+        }
+        else if (auto binary = dynamic_cast<const AST::BinaryOpExpr*>(&expr))
+        {
+            return HasSideEffects(*binary->left) || HasSideEffects(*binary->right);
+        }
+
+        return dynamic_cast<const AST::AssignExpr*>(&expr) != nullptr;
+    }
+
+    Bytecode::Opcode BytecodeGenVisitor::BinaryOpToOpcode(AST::BinaryOp op) const
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::ADD:                 return Bytecode::Opcode::ADD;
+        case AST::BinaryOp::SUBSTRACT:           return Bytecode::Opcode::SUB;
+        case AST::BinaryOp::MULTIPLY:            return Bytecode::Opcode::MUL;
+        case AST::BinaryOp::DIVIDE:              return Bytecode::Opcode::DIV;
+        case AST::BinaryOp::MODULO:              return Bytecode::Opcode::MOD;
+        case AST::BinaryOp::BITWISE_AND:         return Bytecode::Opcode::AND;
+        case AST::BinaryOp::BITWISE_OR:          return Bytecode::Opcode::OR;
+        case AST::BinaryOp::BITWISE_XOR:         return Bytecode::Opcode::XOR;
+        case AST::BinaryOp::BITWISE_SHIFT_LEFT:  return Bytecode::Opcode::SHL;
+        case AST::BinaryOp::BITWISE_SHIFT_RIGHT: return Bytecode::Opcode::SHR;
+        case AST::BinaryOp::EQUAL:               return Bytecode::Opcode::EQ;
+        case AST::BinaryOp::NOT_EQUAL:           return Bytecode::Opcode::NE;
+        case AST::BinaryOp::LESS:                return Bytecode::Opcode::LT;
+        case AST::BinaryOp::LESS_EQUAL:          return Bytecode::Opcode::LE;
+        case AST::BinaryOp::GREATER:             return Bytecode::Opcode::GT;
+        case AST::BinaryOp::GREATER_EQUAL:       return Bytecode::Opcode::GE;
+        default:
+            Unreachable("BinaryOpToOpcode unreachable");
+            return Bytecode::Opcode::ADD;
+        }
+    }
+
+    Bytecode::Opcode BytecodeGenVisitor::AssignOpToOpcode(AST::AssignOp op) const
+    {
+        switch (op)
+        {
+        case AST::AssignOp::ADD_ASSIGN:                 return Bytecode::Opcode::ADD;
+        case AST::AssignOp::SUBSTRACT_ASSIGN:           return Bytecode::Opcode::SUB;
+        case AST::AssignOp::MULTIPLY_ASSIGN:            return Bytecode::Opcode::MUL;
+        case AST::AssignOp::DIVIDE_ASSIGN:              return Bytecode::Opcode::DIV;
+        case AST::AssignOp::MODULO_ASSIGN:              return Bytecode::Opcode::MOD;
+        case AST::AssignOp::BITWISE_AND_ASSIGN:         return Bytecode::Opcode::AND;
+        case AST::AssignOp::BITWISE_OR_ASSIGN:          return Bytecode::Opcode::OR;
+        case AST::AssignOp::BITWISE_XOR_ASSIGN:         return Bytecode::Opcode::XOR;
+        case AST::AssignOp::BITWISE_SHIFT_LEFT_ASSIGN:  return Bytecode::Opcode::SHL;
+        case AST::AssignOp::BITWISE_SHIFT_RIGHT_ASSIGN: return Bytecode::Opcode::SHR;
+        default:
+            Unreachable("AssignOpToOpcode unreachable");
+            return Bytecode::Opcode::ADD;
+        }
+    }
+} // namespace CComp
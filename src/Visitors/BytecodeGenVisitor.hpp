@@ -0,0 +1,75 @@
+#ifndef CCOMP_BYTECODE_GEN_VISITOR_HPP
+#define CCOMP_BYTECODE_GEN_VISITOR_HPP
+
+#include "../AST/Visitor.hpp"
+#include "../Bytecode/Bytecode.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace CComp
+{
+    // Compiles a resolved AST to register-based bytecode. Locals live in the registers
+    // numbered by their slots, and temporaries are allocated above them like a stack,
+    // so an expression needs as many registers as it is deep.
+    class BytecodeGenVisitor : public AST::Visitor
+    {
+    public:
+        BytecodeGenVisitor() = default;
+
+        Bytecode::Module Compile(std::vector<std::unique_ptr<AST::Decl>>& ast);
+
+        bool HadError() const
+        { return hadError; }
+
+        virtual void VisitBasicType(AST::BasicType& node);
+        virtual void VisitTypeAndNameDecl(AST::TypeAndNameDecl& node);
+        virtual void VisitFunctionDecl(AST::FunctionDecl& node);
+        virtual void VisitIntegerNumberExpr(AST::IntegerNumberExpr& node);
+        virtual void VisitBlockStmt(AST::BlockStmt& node);
+        virtual void VisitReturnStmt(AST::ReturnStmt& node);
+        virtual void VisitUnaryOpExpr(AST::UnaryOpExpr& node);
+        virtual void VisitBinaryOpExpr(AST::BinaryOpExpr& node);
+        virtual void VisitVarDeclStmt(AST::VarDeclStmt& node);
+        virtual void VisitExprStmt(AST::ExprStmt& node);
+        virtual void VisitVarExpr(AST::VarExpr& node);
+        virtual void VisitAssignExpr(AST::AssignExpr& node);
+
+    private:
+        Bytecode::Module module;
+        Bytecode::Function* func = nullptr;
+        bool hadError = false;
+
+        // Register holding the value of the expression just compiled.
+        Bytecode::Register result = 0;
+        size_t nextTemporary = 0;
+
+        // Instructions before this may be jumped over, so their results are not the only
+        // way a register gets its value.
+        size_t jumpTarget = 0;
+
+        Bytecode::Register Compile(AST::Expr& expr);
+
+        Bytecode::Register NewTemporary();
+        bool IsLocal(Bytecode::Register reg) const;
+
+        void Emit(Bytecode::Opcode op, Bytecode::Register dst = 0, Bytecode::Register a = 0, int32_t imm = 0);
+
+        // Makes the instruction that just computed value write dst instead, or emits a move.
+        void MoveTo(Bytecode::Register dst, Bytecode::Register value);
+
+        // Emits a jump to be pointed at the next instruction by PatchJump.
+        size_t EmitJump(Bytecode::Opcode op, Bytecode::Register cond = 0);
+        void PatchJump(size_t jump);
+
+        void ShortCircuitBinary(AST::BinaryOpExpr& node);
+
+        // Whether evaluating the expression can change a local.
+        bool HasSideEffects(const AST::Expr& expr) const;
+
+        Bytecode::Opcode BinaryOpToOpcode(AST::BinaryOp op) const;
+        Bytecode::Opcode AssignOpToOpcode(AST::AssignOp op) const;
+    }; // class BytecodeGenVisitor
+} // namespace CComp
+
+#endif // CCOMP_BYTECODE_GEN_VISITOR_HPP
@@ -1,29 +1,74 @@
 #include "CodeGenVisitor.hpp"
 
+#include <iterator>
+
+#include "../AllocationCounter.hpp"
 #include "../AST/AST.hpp"
+#include "../Backend/FrameLayout.hpp"
+#include "../Backend/StrengthReduction.hpp"
 #include "../Reporter.hpp"
+#include "../Statistics.hpp"
+#include "../ThreadPool.hpp"
+#include "../TimeReport.hpp"
+#include "../Trace.hpp"
 #include "../Unreachable.hpp"
 
 namespace CComp
 {
-    constexpr size_t gc_TabWidth = 4;
-
-    CodeGenVisitor::CodeGenVisitor(std::ostream& out)
-        : out(out)
+    using Asm::Opcode;
+    using Asm::Register;
+    using Asm::Reg;
+    using Asm::Imm;
+    using Asm::Mem;
+
+    CodeGenVisitor::CodeGenVisitor(std::vector<Asm::Instruction>& out, bool forwardStores)
+        : out(out), forwardStores(forwardStores)
     {}
 
-    std::ostream& CodeGenVisitor::Print()
+    void CodeGenVisitor::Emit(Asm::Opcode op, Asm::Operand a, Asm::Operand b)
     {
-        return out << std::string(tab * gc_TabWidth, ' ');
+        out.emplace_back(op, a, b);
     }
 
-    void CodeGenVisitor::Compile(std::vector<std::unique_ptr<AST::Decl>>& ast)
+    void CodeGenVisitor::Emit(Asm::Opcode op, const std::string& label)
     {
+        out.emplace_back(op, label);
+    }
+
+    void CodeGenVisitor::EmitJump(Asm::Cond cond, const std::string& label)
+    {
+        out.emplace_back(Opcode::JCC, cond, label);
+    }
+
+    void CodeGenVisitor::EmitSet(Asm::Cond cond)
+    {
+        Asm::Instruction set(Opcode::SETCC, Asm::ByteReg(Register::EAX));
+        set.cond = cond;
+        out.push_back(set);
+    }
+
+    void CodeGenVisitor::Compile(std::vector<std::unique_ptr<AST::Decl>>& ast, size_t jobs)
+    {
+        ScopedTimer timer(TimedPhase::CODEGEN);
+        ScopedMemoryCategory memory(MemoryCategory::CODEGEN);
+
         MakeHeader();
 
-        for (auto& decl : ast)
+        std::vector<std::vector<Asm::Instruction>> functions(ast.size());
+        std::vector<char> errors(ast.size(), false);
+
+        ParallelFor(ast.size(), jobs, [&](size_t i)
         {
-            decl->Accept(*this);
+            CodeGenVisitor vis(functions[i], forwardStores);
+
+            ast[i]->Accept(vis);
+            errors[i] = vis.HadError();
+        });
+
+        for (size_t i = 0; i < ast.size(); i++)
+        {
+            out.insert(out.end(), std::make_move_iterator(functions[i].begin()), std::make_move_iterator(functions[i].end()));
+            hadError = hadError || errors[i];
         }
 
         MakeFooter();
@@ -31,22 +76,20 @@ namespace CComp
     
     void CodeGenVisitor::MakeHeader()
     {
-        Print() << "# Compiled using InAnYan first C compiler v0.1." << std::endl;
-        Print() << std::endl;
-        Print() << ".globl _start" << std::endl;
-        Print() << "_start:" << std::endl;
-        tab++;
-        Print() << "call main" << std::endl;
-        Print() << "movl %eax, %ebx" << std::endl;
-        Print() << "movl $1, %eax" << std::endl;
-        Print() << "int $0x80" << std::endl;
-        tab--;
-        Print() << std::endl;
+        Emit(Opcode::COMMENT, "Compiled using InAnYan first C compiler v0.1.");
+        Emit(Opcode::BLANK);
+        Emit(Opcode::GLOBL, "_start");
+        Emit(Opcode::LABEL, "_start");
+        Emit(Opcode::CALL, "main");
+        Emit(Opcode::MOV, Reg(Register::EAX), Reg(Register::EBX));
+        Emit(Opcode::MOV, Imm(1), Reg(Register::EAX));
+        Emit(Opcode::INT, Imm(0x80));
+        Emit(Opcode::BLANK);
     }
 
     void CodeGenVisitor::MakeFooter()
     {
-        Print() << "# End of compiling." << std::endl;
+        Emit(Opcode::COMMENT, "End of compiling.");
     }
 
     void CodeGenVisitor::VisitBasicType(AST::BasicType& node)
@@ -57,83 +100,135 @@ namespace CComp
 
     void CodeGenVisitor::VisitFunctionDecl(AST::FunctionDecl& node)
     {
+        TraceSpan span("codegen", node.name);
+        ScopedMemoryCategory memory(MemoryCategory::CODEGEN);
+
         // TODO: Add prototype and source position.
-        Print() << ".globl " << node.name << std::endl;
-        Print() << node.name << ":" << std::endl;
-        tab++;
+        Emit(Opcode::GLOBL, node.name);
+        Emit(Opcode::LABEL, node.name);
 
-        EmitProlog();
+        size_t bodyStart = out.size();
+
+        functionName = node.name;
+        labelCount = 0;
+        storedSlot = -1;
+
+        returnLabel = ".L" + node.name + "_return";
+        returnJumps = 0;
+        terminated = false;
 
         node.body->Accept(*this);
 
-        Print() << "ret" << std::endl; // TODO: If last statement was a return statement.
-        tab--;
-        Print() << std::endl;
+        if (!terminated)
+        {
+            // Falling off the end returns 0, as main does.
+            Emit(Opcode::MOV, Imm(0), Reg(Register::EAX));
+        }
+        else if (out.back().op == Opcode::JMP && out.back().label == returnLabel)
+        {
+            // The last return falls through into the epilogue.
+            out.pop_back();
+            returnJumps--;
+        }
+
+        if (returnJumps != 0)
+        {
+            Emit(Opcode::LABEL, returnLabel);
+        }
+
+        // The layout is fixed only now that it is known which callee-saved registers the body uses.
+        std::vector<Register> savedRegisters;
+        for (Register reg : { Register::EBX, Register::ESI, Register::EDI })
+        {
+            if (UsesRegister(bodyStart, reg))
+            {
+                savedRegisters.push_back(reg);
+            }
+        }
+
+        FrameLayout frame(node.slotCount, std::move(savedRegisters));
+
+        std::vector<Asm::Instruction> prolog;
+        frame.EmitProlog(prolog);
+        out.insert(out.begin() + bodyStart, prolog.begin(), prolog.end());
+
+        frame.EmitEpilog(out);
+        Emit(Opcode::RET);
+        Emit(Opcode::BLANK);
     }
 
     void CodeGenVisitor::VisitIntegerNumberExpr(AST::IntegerNumberExpr& node)
     {
-        Print() << "movl $" << node.number << ", %eax" << std::endl;
+        Select(node, Nonterminal::REG);
     }
 
     void CodeGenVisitor::VisitBlockStmt(AST::BlockStmt& node)
     {
-        for (auto& stmt : node.stmts)
+        // Worked out from the last statement back, since whether a read-modify-write
+        // loads its local depends on the statement after it.
+        std::vector<int> firstLoadedSlots(node.stmts.size() + 1, -1);
+        for (size_t i = node.stmts.size(); i > 0; i--)
         {
-            stmt->Accept(*this);
+            firstLoadedSlots[i - 1] = GetFirstLoadedSlot(*node.stmts[i - 1], firstLoadedSlots[i]);
         }
 
-        Print() << std::endl;
+        for (size_t i = 0; i < node.stmts.size(); i++)
+        {
+            if (terminated)
+            {
+                AddStatistic("codegen", "unreachable statements removed", static_cast<long long>(node.stmts.size() - i));
+                break;
+            }
+
+            nextLoadedSlot = firstLoadedSlots[i + 1];
+            node.stmts[i]->Accept(*this);
+        }
     }
 
     void CodeGenVisitor::VisitReturnStmt(AST::ReturnStmt& node)
     {
         node.expr->Accept(*this);
-        EmitEpilog();
-        Print() << "ret" << std::endl;
+
+        Emit(Opcode::JMP, returnLabel);
+        returnJumps++;
+        terminated = true;
     }
 
     void CodeGenVisitor::VisitUnaryOpExpr(AST::UnaryOpExpr& node)
     {
-        node.expr->Accept(*this);
+        AST::Expr* kids[2] = {};
 
-        switch (node.op)
+        // Only a ! over && or || is left out of the grammar.
+        if (ClassifyNode(node, kids) == TreeOp::OTHER)
         {
-        case AST::UnaryOp::NEGATION:
-            Print() << "neg %eax" << std::endl;
+            MaterializeCondition(node);
             return;
-        case AST::UnaryOp::NOT:
-            Print() << "cmpl $0, %eax" << std::endl;
-            Print() << "xor %eax, %eax" << std::endl;
-            Print() << "sete %al" << std::endl;
-            return;
-        case AST::UnaryOp::BITWISE_COMPLEMENT:
-            Print() << "not %eax" << std::endl;
-            return;
-
-        default:
-            break;
         }
 
-        int stackIndex = MaybeGetVarIndex(node.expr);
-        Print() << "movl " << stackIndex << "(%ebp), %eax" << std::endl;
+        Select(node, Nonterminal::REG);
+    }
+
+    void CodeGenVisitor::EmitStepValue(AST::UnaryOpExpr& node)
+    {
+        Asm::Operand var = Mem(Register::EBP, GetVarOffset(node.expr));
+        Emit(Opcode::MOV, var, Reg(Register::EAX));
 
         switch (node.op)
         {
         case AST::UnaryOp::PRE_INCREMENT:
-            Print() << "incl %eax" << std::endl;
-            Print() << "movl %eax, " << stackIndex << "(%ebp)" << std::endl;
+            Emit(Opcode::INC, Reg(Register::EAX));
+            Emit(Opcode::MOV, Reg(Register::EAX), var);
             break;
         case AST::UnaryOp::PRE_DECREMENT:
-            Print() << "decl %eax" << std::endl;
-            Print() << "movl %eax, " << stackIndex << "(%ebp)" << std::endl;
+            Emit(Opcode::DEC, Reg(Register::EAX));
+            Emit(Opcode::MOV, Reg(Register::EAX), var);
             break;
 
         case AST::UnaryOp::POST_INCREMENT:
-            Print() << "addl $1, " << stackIndex << "(%ebp)" << std::endl;
+            Emit(Opcode::ADD, Imm(1), var);
             break;
         case AST::UnaryOp::POST_DECREMENT:
-            Print() << "subl $1, " << stackIndex << "(%ebp)" << std::endl;
+            Emit(Opcode::SUB, Imm(1), var);
             break;
 
         default:
@@ -148,41 +243,44 @@ namespace CComp
             node.left->Accept(*this);
             node.right->Accept(*this);
         }
-        else if (node.op == AST::BinaryOp::LOGIC_OR
-            || node.op == AST::BinaryOp::LOGIC_AND)
+        else if (node.op == AST::BinaryOp::LOGIC_OR || node.op == AST::BinaryOp::LOGIC_AND)
         {
-            ShortCircuitBinary(node);
+            MaterializeCondition(node);
+        }
+        else if (AST::Expr* kids[2] = {}; ClassifyNode(node, kids) != TreeOp::OTHER)
+        {
+            Select(node, Nonterminal::REG);
         }
         else
         {
             SimpleBinary(node);
         }
-
-        Print() << std::endl;
     }
     
-    void CodeGenVisitor::BinaryComparison(const std::string& setOp)
-    {
-        Print() << "cmpl %ebx, %eax" << std::endl;
-        Print() << "movl $0, %eax" << std::endl;
-        Print() << "set" << setOp << " %al" << std::endl;
-    }
-
     void CodeGenVisitor::SimpleBinary(AST::BinaryOpExpr& node)
     {
+        int32_t constant = 0;
+
+        if (IsReducibleConstant(node.op, *node.right, constant))
+        {
+            node.left->Accept(*this);
+            BinaryByConstant(node.op, constant);
+            return;
+        }
+
         node.right->Accept(*this);
         
-        Print() << "push %eax" << std::endl;
+        Emit(Opcode::PUSH, Reg(Register::EAX));
 
         node.left->Accept(*this);
         if (node.op == AST::BinaryOp::BITWISE_SHIFT_LEFT
             || node.op == AST::BinaryOp::BITWISE_SHIFT_RIGHT)
         {
-            Print() << "pop %ecx" << std::endl;
+            Emit(Opcode::POP, Reg(Register::ECX));
         }
         else
         {
-            Print() << "pop %ebx" << std::endl;
+            Emit(Opcode::POP, Reg(Register::EBX));
         }
         
         SimpleBinaryOnEaxEbx(node.op);
@@ -193,46 +291,39 @@ namespace CComp
         switch (op)
         {
         case AST::BinaryOp::ADD:
-            Print() << "addl %ebx, %eax" << std::endl;
+            Emit(Opcode::ADD, Reg(Register::EBX), Reg(Register::EAX));
             break;
         case AST::BinaryOp::SUBSTRACT:
-            Print() << "subl %ebx, %eax" << std::endl;
+            Emit(Opcode::SUB, Reg(Register::EBX), Reg(Register::EAX));
             break;
         case AST::BinaryOp::MULTIPLY:
-            Print() << "imul %ebx" << std::endl;
+            Emit(Opcode::IMUL, Reg(Register::EBX), Reg(Register::EAX));
             break;
         case AST::BinaryOp::DIVIDE:
-            Print() << "cdq" << std::endl;
-            Print() << "idivl %ebx" << std::endl;
+            Emit(Opcode::CDQ);
+            Emit(Opcode::IDIV, Reg(Register::EBX));
             break;
         case AST::BinaryOp::MODULO:
-            Print() << "cdq" << std::endl;
-            Print() << "idivl %ebx" << std::endl;
-            Print() << "movl %edx, %eax" << std::endl;
+            Emit(Opcode::CDQ);
+            Emit(Opcode::IDIV, Reg(Register::EBX));
+            Emit(Opcode::MOV, Reg(Register::EDX), Reg(Register::EAX));
             break;
 
         case AST::BinaryOp::BITWISE_AND:
-            Print() << "and %ebx, %eax" << std::endl;
+            Emit(Opcode::AND, Reg(Register::EBX), Reg(Register::EAX));
             break;
         case AST::BinaryOp::BITWISE_XOR:
-            Print() << "xor %ebx, %eax" << std::endl;
+            Emit(Opcode::XOR, Reg(Register::EBX), Reg(Register::EAX));
             break;
         case AST::BinaryOp::BITWISE_OR:
-            Print() << "or %ebx, %eax" << std::endl;
-            break;
-
-        case AST::BinaryOp::EQUAL:
-            BinaryComparison("e");
-            break;
-        case AST::BinaryOp::NOT_EQUAL:
-            BinaryComparison("ne");
+            Emit(Opcode::OR, Reg(Register::EBX), Reg(Register::EAX));
             break;
 
         case AST::BinaryOp::BITWISE_SHIFT_LEFT:
-            Print() << "sall %eax" << std::endl;
+            Emit(Opcode::SAL, Asm::ByteReg(Register::ECX), Reg(Register::EAX));
             break;
         case AST::BinaryOp::BITWISE_SHIFT_RIGHT:
-            Print() << "sarl %eax" << std::endl;
+            Emit(Opcode::SAR, Asm::ByteReg(Register::ECX), Reg(Register::EAX));
             break;
 
         default:
@@ -240,73 +331,668 @@ namespace CComp
         }       
     }
 
-    void CodeGenVisitor::ShortCircuitBinary(AST::BinaryOpExpr& node)
+    bool CodeGenVisitor::IsReducibleConstant(AST::BinaryOp op, AST::Expr& expr, int32_t& value) const
     {
-        // TODO: Optimize if left or right are also logical operators, so we don't have to convert %eax to 1 or 0.
+        auto number = dynamic_cast<AST::IntegerNumberExpr*>(&expr);
+        if (number == nullptr)
+        {
+            return false;
+        }
 
-        std::string labelRight = GenerateUniqueLabel(); 
-        std::string labelEnd = GenerateUniqueLabel(); 
+        value = number->GetValue();
 
-        if (node.op == AST::BinaryOp::LOGIC_AND)
+        switch (op)
         {
-            node.left->Accept(*this);
+        case AST::BinaryOp::MULTIPLY:
+            return true;
 
-            Print() << "cmpl $0, %eax" << std::endl;
-            Print() << "jne " << labelRight << std::endl;
-            Print() << "jmp " << labelEnd << std::endl;
+        // Division by a literal zero keeps its idivl and traps at run time.
+        case AST::BinaryOp::DIVIDE:
+        case AST::BinaryOp::MODULO:
+            return value != 0;
 
-            Print() << labelRight << ":" << std::endl;
-            node.right->Accept(*this);
-            Print() << "cmpl $0, %eax" << std::endl;
-            Print() << "xor %eax, %eax" << std::endl;
-            Print() << "setne %al" << std::endl;
+        default:
+            return false;
+        }
+    }
 
-            Print() << labelEnd << ":" << std::endl;
+    void CodeGenVisitor::BinaryByConstant(AST::BinaryOp op, int32_t value)
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::MULTIPLY:
+            if (!EmitMultiplyByConstant(out, Register::EAX, value, Register::ECX))
+            {
+                Emit(Opcode::IMUL, Imm(value), Reg(Register::EAX));
+            }
+            break;
+        case AST::BinaryOp::DIVIDE:
+            EmitDivideByConstant(out, value);
+            break;
+        case AST::BinaryOp::MODULO:
+            EmitRemainderByConstant(out, value);
+            break;
+
+        default:
+            Unreachable("CodeGenVisitor::BinaryByConstant unreachable");
+            break;
         }
-        else
+
+        AddStatistic("codegen", "operations by constants strength-reduced", 1);
+    }
+
+    bool CodeGenVisitor::IsComparison(AST::BinaryOp op) const
+    {
+        switch (op)
         {
-            node.left->Accept(*this);
+        case AST::BinaryOp::EQUAL:
+        case AST::BinaryOp::NOT_EQUAL:
+        case AST::BinaryOp::GREATER:
+        case AST::BinaryOp::GREATER_EQUAL:
+        case AST::BinaryOp::LESS:
+        case AST::BinaryOp::LESS_EQUAL:
+            return true;
 
-            Print() << "cmpl $0, %eax" << std::endl;
-            Print() << "je " << labelRight << std::endl;
-            Print() << "movl $1, %eax" << std::endl;
-            Print() << "jmp " << labelEnd << std::endl;
+        default:
+            return false;
+        }
+    }
 
-            Print() << labelRight << ":" << std::endl;
-            node.right->Accept(*this);
-            Print() << "cmpl $0, %eax" << std::endl;
-            Print() << "xor %eax, %eax" << std::endl;
-            Print() << "setne %al" << std::endl;
+    Asm::Cond CodeGenVisitor::ComparisonToCond(AST::BinaryOp op) const
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::EQUAL:         return Asm::Cond::E;
+        case AST::BinaryOp::NOT_EQUAL:     return Asm::Cond::NE;
+        case AST::BinaryOp::GREATER:       return Asm::Cond::G;
+        case AST::BinaryOp::GREATER_EQUAL: return Asm::Cond::GE;
+        case AST::BinaryOp::LESS:          return Asm::Cond::L;
+        case AST::BinaryOp::LESS_EQUAL:    return Asm::Cond::LE;
 
-            Print() << labelEnd << ":" << std::endl;
+        default:
+            Unreachable("ComparisonToCond unreachable");
+            return Asm::Cond::E;
         }
     }
 
-    void CodeGenVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    bool CodeGenVisitor::NeedsBranches(AST::Expr& expr) const
     {
-        int stackIndex = MaybeGetVarIndex(node.target);
-        // It may be 0, but actually it is possible to generate wrong code. MaybeGetVarIndex will signal error anyways.
+        if (auto binary = dynamic_cast<AST::BinaryOpExpr*>(&expr))
+        {
+            return binary->op == AST::BinaryOp::LOGIC_AND || binary->op == AST::BinaryOp::LOGIC_OR;
+        }
 
-        node.expr->Accept(*this);
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr))
+        {
+            return unary->op == AST::UnaryOp::NOT && NeedsBranches(*unary->expr);
+        }
+
+        return false;
+    }
+
+    Asm::Cond CodeGenVisitor::EmitFlags(AST::Expr& expr)
+    {
+        return Select(expr, Nonterminal::FLAGS);
+    }
+
+    void CodeGenVisitor::EmitBranch(AST::Expr& expr, bool jumpIfTrue, const std::string& target)
+    {
+        if (auto binary = dynamic_cast<AST::BinaryOpExpr*>(&expr);
+            binary != nullptr && (binary->op == AST::BinaryOp::LOGIC_AND || binary->op == AST::BinaryOp::LOGIC_OR))
+        {
+            // Jumping when an && is false or an || is true can leave from either operand;
+            // otherwise the left operand skips over the right one.
+            bool isAnd = binary->op == AST::BinaryOp::LOGIC_AND;
+
+            if (jumpIfTrue != isAnd)
+            {
+                EmitBranch(*binary->left, jumpIfTrue, target);
+                EmitBranch(*binary->right, jumpIfTrue, target);
+            }
+            else
+            {
+                std::string skip = GenerateUniqueLabel();
+
+                EmitBranch(*binary->left, !jumpIfTrue, skip);
+                EmitBranch(*binary->right, jumpIfTrue, target);
+                Emit(Opcode::LABEL, skip);
+            }
+            return;
+        }
+
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr); unary != nullptr && unary->op == AST::UnaryOp::NOT)
+        {
+            EmitBranch(*unary->expr, !jumpIfTrue, target);
+            return;
+        }
+
+        if (auto number = dynamic_cast<AST::IntegerNumberExpr*>(&expr))
+        {
+            if ((number->GetValue() != 0) == jumpIfTrue)
+            {
+                Emit(Opcode::JMP, target);
+            }
+            return;
+        }
+
+        Asm::Cond cond = EmitFlags(expr);
+        EmitJump(jumpIfTrue ? cond : Asm::InvertCond(cond), target);
+    }
+
+    void CodeGenVisitor::MaterializeCondition(AST::Expr& expr)
+    {
+        if (!NeedsBranches(expr))
+        {
+            EmitSet(EmitFlags(expr));
+            Emit(Opcode::MOVZB, Asm::ByteReg(Register::EAX), Reg(Register::EAX));
+            return;
+        }
+
+        std::string labelFalse = GenerateUniqueLabel();
+        std::string labelEnd = GenerateUniqueLabel();
+
+        EmitBranch(expr, false, labelFalse);
+        Emit(Opcode::MOV, Imm(1), Reg(Register::EAX));
+        Emit(Opcode::JMP, labelEnd);
+
+        Emit(Opcode::LABEL, labelFalse);
+        Emit(Opcode::MOV, Imm(0), Reg(Register::EAX));
+
+        Emit(Opcode::LABEL, labelEnd);
+    }
+
+    TreeOp CodeGenVisitor::ClassifyNode(AST::Expr& expr, AST::Expr* kids[2]) const
+    {
+        if (auto number = dynamic_cast<AST::IntegerNumberExpr*>(&expr))
+        {
+            int32_t value = number->GetValue();
+
+            if (value == 0)
+            {
+                return TreeOp::ZERO;
+            }
+
+            return value == 2 || value == 4 || value == 8 ? TreeOp::SCALE : TreeOp::CONST;
+        }
+
+        if (dynamic_cast<AST::VarExpr*>(&expr) != nullptr)
+        {
+            return TreeOp::VAR;
+        }
+
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr))
+        {
+            kids[0] = unary->expr.get();
+
+            switch (unary->op)
+            {
+            case AST::UnaryOp::NEGATION:
+            case AST::UnaryOp::BITWISE_COMPLEMENT:
+                return TreeOp::UNARY;
+            case AST::UnaryOp::NOT:
+                return NeedsBranches(*unary->expr) ? TreeOp::OTHER : TreeOp::LOGIC_NOT;
+
+            default:
+                return TreeOp::STEP;
+            }
+        }
+
+        if (auto binary = dynamic_cast<AST::BinaryOpExpr*>(&expr))
+        {
+            kids[0] = binary->left.get();
+            kids[1] = binary->right.get();
+
+            if (IsComparison(binary->op))
+            {
+                return TreeOp::COMPARE;
+            }
+
+            switch (binary->op)
+            {
+            case AST::BinaryOp::ADD:         return TreeOp::ADD;
+            case AST::BinaryOp::SUBSTRACT:   return TreeOp::SUB;
+            case AST::BinaryOp::MULTIPLY:    return TreeOp::MUL;
+            case AST::BinaryOp::BITWISE_AND: return TreeOp::AND;
+            case AST::BinaryOp::BITWISE_OR:
+            case AST::BinaryOp::BITWISE_XOR: return TreeOp::BITWISE;
+
+            default:
+                return TreeOp::OTHER;
+            }
+        }
+
+        if (auto assign = dynamic_cast<AST::AssignExpr*>(&expr))
+        {
+            kids[0] = assign->target.get();
+            kids[1] = assign->expr.get();
+
+            switch (assign->op)
+            {
+            case AST::AssignOp::SIMPLE_ASSIGN:
+                return TreeOp::ASSIGN;
+
+            case AST::AssignOp::ADD_ASSIGN:
+            case AST::AssignOp::SUBSTRACT_ASSIGN:
+            case AST::AssignOp::BITWISE_AND_ASSIGN:
+            case AST::AssignOp::BITWISE_OR_ASSIGN:
+            case AST::AssignOp::BITWISE_XOR_ASSIGN:
+                return TreeOp::ASSIGN_ALU;
+
+            default:
+                return TreeOp::OTHER;
+            }
+        }
+
+        return TreeOp::OTHER;
+    }
+
+    const SelectionState& CodeGenVisitor::Label(AST::Expr& expr)
+    {
+        auto found = selection.find(&expr);
+        if (found != selection.end())
+        {
+            return found->second;
+        }
+
+        AST::Expr* kids[2] = {};
+        TreeOp op = ClassifyNode(expr, kids);
+
+        // Nothing below an OTHER leaf is labelled until it is generated.
+        SelectionState state;
+        switch (GetArity(op))
+        {
+        case 0:
+            state = GetLeafState(op);
+            break;
+        case 1:
+            state = LabelNode(op, Label(*kids[0]));
+            break;
+        default:
+            state = LabelNode(op, Label(*kids[0]), Label(*kids[1]));
+            break;
+        }
+
+        return selection.emplace(&expr, state).first->second;
+    }
+
+    Asm::Cond CodeGenVisitor::Select(AST::Expr& expr, Nonterminal goal)
+    {
+        Label(expr);
+        return Reduce(expr, goal);
+    }
+
+    Asm::Cond CodeGenVisitor::Reduce(AST::Expr& expr, Nonterminal goal)
+    {
+        const SelectionState& state = Label(expr);
+        if (!state.Derives(goal))
+        {
+            Unreachable("CodeGenVisitor::Reduce: no rule derives the goal");
+            return Asm::Cond::NE;
+        }
+
+        const SelectionRule& rule = GetSelectionRule(state.GetRule(goal));
+
+        AST::Expr* kids[2] = {};
+        TreeOp op = ClassifyNode(expr, kids);
+
+        Asm::Cond cond = Asm::Cond::NE;
+        Asm::Operand operands[2];
+
+        auto inRegister = [](Nonterminal nt)
+        {
+            return nt == Nonterminal::REG || nt == Nonterminal::INDEX;
+        };
 
-        if (node.op != AST::AssignOp::SIMPLE_ASSIGN)
+        if (rule.IsChain())
         {
-            if (node.op == AST::AssignOp::BITWISE_SHIFT_LEFT_ASSIGN
-                || node.op == AST::AssignOp::BITWISE_SHIFT_RIGHT_ASSIGN)
+            cond = Reduce(expr, rule.kids[0]);
+            operands[0] = GetSelectedOperand(expr, rule.kids[0], Register::EAX);
+        }
+        else if (GetArity(op) == 2 && inRegister(rule.kids[0]) && inRegister(rule.kids[1]))
+        {
+            Reduce(*kids[1], rule.kids[1]);
+            Emit(Opcode::PUSH, Reg(Register::EAX));
+            Reduce(*kids[0], rule.kids[0]);
+            Emit(Opcode::POP, Reg(Register::EBX));
+
+            operands[0] = GetSelectedOperand(*kids[0], rule.kids[0], Register::EAX);
+            operands[1] = GetSelectedOperand(*kids[1], rule.kids[1], Register::EBX);
+        }
+        else
+        {
+            // At most one kid needs code; the others are immediates and locals.
+            for (size_t k = 0; k < GetArity(op); k++)
             {
-                Print() << "movl %eax, %ecx" << std::endl;
+                if (inRegister(rule.kids[k]) || rule.kids[k] == Nonterminal::FLAGS)
+                {
+                    cond = Reduce(*kids[k], rule.kids[k]);
+                }
+
+                operands[k] = GetSelectedOperand(*kids[k], rule.kids[k], Register::EAX);
+            }
+        }
+
+        // The operand not in %eax, for rules that leave their result there.
+        const Asm::Operand& source = inRegister(rule.kids[0]) ? operands[1] : operands[0];
+
+        switch (rule.action)
+        {
+        case SelectionAction::NONE:
+            break;
+
+        case SelectionAction::VISIT:
+            expr.Accept(*this);
+            break;
+
+        case SelectionAction::CLEAR:
+            Emit(Opcode::XOR, Reg(Register::EAX), Reg(Register::EAX));
+            break;
+
+        case SelectionAction::MOVE:
+            Emit(Opcode::MOV, operands[0], Reg(Register::EAX));
+            break;
+
+        case SelectionAction::SCALE:
+        {
+            int32_t shift = 1;
+            while ((1 << shift) != GetScale(expr))
+            {
+                shift++;
+            }
+
+            Emit(Opcode::SAL, Imm(shift), Reg(Register::EAX));
+            break;
+        }
+
+        case SelectionAction::SET:
+            EmitSet(cond);
+            Emit(Opcode::MOVZB, Asm::ByteReg(Register::EAX), Reg(Register::EAX));
+            break;
+
+        case SelectionAction::TEST:
+            if (rule.IsChain() || op == TreeOp::COMPARE)
+            {
+                Emit(Opcode::TEST, Reg(Register::EAX), Reg(Register::EAX));
             }
             else
             {
-                Print() << "movl %eax, %ebx" << std::endl;
+                // An & with a mask sets the flags without computing the value.
+                size_t mask = rule.kids[0] == Nonterminal::IMM ? 0 : 1;
+                Emit(Opcode::TEST, operands[mask], operands[1 - mask]);
             }
 
-            Print() << "movl " << stackIndex << "(%ebp), %eax" << std::endl;
+            cond = op == TreeOp::COMPARE && !rule.IsChain()
+                ? ComparisonToCond(static_cast<AST::BinaryOpExpr&>(expr).op) : Asm::Cond::NE;
+            break;
+
+        case SelectionAction::COMPARE:
+            Emit(Opcode::CMP, operands[1], operands[0]);
+            cond = ComparisonToCond(static_cast<AST::BinaryOpExpr&>(expr).op);
+            break;
+
+        case SelectionAction::COMPARE_ZERO:
+            Emit(Opcode::CMP, Imm(0), operands[0]);
+            cond = Asm::Cond::NE;
+            break;
 
-            SimpleBinaryOnEaxEbx(AssignOpToBinaryOp(node.op));
+        case SelectionAction::INVERT:
+            cond = Asm::InvertCond(cond);
+            break;
+
+        case SelectionAction::ALU:
+            Emit(GetAluOpcode(expr), source, Reg(Register::EAX));
+            break;
+
+        case SelectionAction::REVERSE_SUBTRACT:
+            Emit(Opcode::NEG, Reg(Register::EAX));
+            Emit(Opcode::ADD, operands[0], Reg(Register::EAX));
+            break;
+
+        case SelectionAction::MULTIPLY_CONSTANT:
+            BinaryByConstant(AST::BinaryOp::MULTIPLY, source.value);
+            break;
+
+        case SelectionAction::LEA:
+        {
+            size_t index = rule.kids[0] == Nonterminal::INDEX ? 0 : 1;
+            const Asm::Operand& other = operands[1 - index];
+            uint8_t scale = GetScale(*kids[index]);
+
+            if (other.kind == Asm::OperandKind::IMM)
+            {
+                // Only x*k - c reaches here with SUB; it wraps like subl.
+                int32_t disp = op == TreeOp::SUB
+                    ? static_cast<int32_t>(0u - static_cast<uint32_t>(other.value)) : other.value;
+                Emit(Opcode::LEA, Mem(Register::NONE, operands[index].reg, scale, disp), Reg(Register::EAX));
+            }
+            else
+            {
+                Emit(Opcode::LEA, Mem(other.reg, operands[index].reg, scale), Reg(Register::EAX));
+            }
+            break;
+        }
+
+        case SelectionAction::UNARY:
+            Emit(static_cast<AST::UnaryOpExpr&>(expr).op == AST::UnaryOp::NEGATION ? Opcode::NEG : Opcode::NOT,
+                 Reg(Register::EAX));
+            break;
+
+        case SelectionAction::STORE:
+            Emit(Opcode::MOV, operands[1], operands[0]);
+            break;
+
+        case SelectionAction::ALU_MEMORY:
+            Emit(GetAluOpcode(expr), operands[1], operands[0]);
+            break;
+
+        case SelectionAction::ALU_MEMORY_LOAD:
+            Emit(GetAluOpcode(expr), operands[1], operands[0]);
+            Emit(Opcode::MOV, operands[0], Reg(Register::EAX));
+            break;
+
+        case SelectionAction::ALU_REGISTER:
+            Emit(Opcode::MOV, operands[0], Reg(Register::EAX));
+            Emit(GetAluOpcode(expr), operands[1], Reg(Register::EAX));
+            Emit(Opcode::MOV, Reg(Register::EAX), operands[0]);
+            break;
+
+        case SelectionAction::STEP:
+        {
+            AST::UnaryOp step = static_cast<AST::UnaryOpExpr&>(expr).op;
+            bool increment = step == AST::UnaryOp::PRE_INCREMENT || step == AST::UnaryOp::POST_INCREMENT;
+            Emit(increment ? Opcode::INC : Opcode::DEC, operands[0]);
+            break;
         }
 
-        Print() << "movl %eax, " << stackIndex << "(%ebp)" << std::endl;
+        case SelectionAction::STEP_VALUE:
+            EmitStepValue(static_cast<AST::UnaryOpExpr&>(expr));
+            break;
+        }
+
+        return cond;
+    }
+
+    int CodeGenVisitor::GetFirstLoadedSlot(AST::Stmt& stmt, int nextLoadedSlot) const
+    {
+        if (auto exprStmt = dynamic_cast<AST::ExprStmt*>(&stmt))
+        {
+            // Kept in memory, a read-modify-write loads nothing; it is not where the next
+            // statement does not load the local either.
+            if (IsReadModifyWrite(*exprStmt->expr))
+            {
+                int slot = GetAssignedSlot(*exprStmt->expr);
+                return slot == nextLoadedSlot ? slot : -1;
+            }
+
+            return GetFirstLoadedSlot(*exprStmt->expr);
+        }
+
+        if (auto returnStmt = dynamic_cast<AST::ReturnStmt*>(&stmt))
+        {
+            return GetFirstLoadedSlot(*returnStmt->expr);
+        }
+
+        if (auto varDecl = dynamic_cast<AST::VarDeclStmt*>(&stmt); varDecl != nullptr && varDecl->init != nullptr)
+        {
+            return GetFirstLoadedSlot(*varDecl->init);
+        }
+
+        return -1;
+    }
+
+    // Follows the operand evaluated first: the left one, the value of a plain assignment,
+    // and the local of a compound one unless the value needs code of its own.
+    int CodeGenVisitor::GetFirstLoadedSlot(AST::Expr& expr) const
+    {
+        if (auto var = dynamic_cast<AST::VarExpr*>(&expr))
+        {
+            return var->slot;
+        }
+
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr))
+        {
+            return GetFirstLoadedSlot(*unary->expr);
+        }
+
+        if (auto binary = dynamic_cast<AST::BinaryOpExpr*>(&expr))
+        {
+            return GetFirstLoadedSlot(*binary->left);
+        }
+
+        if (auto assign = dynamic_cast<AST::AssignExpr*>(&expr))
+        {
+            bool loadsTarget = assign->op != AST::AssignOp::SIMPLE_ASSIGN
+                && dynamic_cast<AST::IntegerNumberExpr*>(assign->expr.get()) != nullptr;
+            return GetFirstLoadedSlot(loadsTarget ? *assign->target : *assign->expr);
+        }
+
+        return -1;
+    }
+
+    // Only where the value of the expression is the new value of the local.
+    int CodeGenVisitor::GetAssignedSlot(AST::Expr& expr) const
+    {
+        if (auto assign = dynamic_cast<AST::AssignExpr*>(&expr))
+        {
+            return static_cast<AST::VarExpr&>(*assign->target).slot;
+        }
+
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr);
+            unary != nullptr && (unary->op == AST::UnaryOp::PRE_INCREMENT || unary->op == AST::UnaryOp::PRE_DECREMENT))
+        {
+            return static_cast<AST::VarExpr&>(*unary->expr).slot;
+        }
+
+        return -1;
+    }
+
+    bool CodeGenVisitor::IsReadModifyWrite(AST::Expr& expr) const
+    {
+        AST::Expr* kids[2] = {};
+        TreeOp op = ClassifyNode(expr, kids);
+
+        return op == TreeOp::ASSIGN_ALU || op == TreeOp::STEP;
+    }
+
+    Asm::Operand CodeGenVisitor::GetSelectedOperand(AST::Expr& expr, Nonterminal nt, Asm::Register reg) const
+    {
+        switch (nt)
+        {
+        case Nonterminal::IMM:
+        case Nonterminal::ZERO:
+        case Nonterminal::FACTOR:
+            return Imm(static_cast<AST::IntegerNumberExpr&>(expr).GetValue());
+
+        case Nonterminal::MEM:
+            return Mem(Register::EBP, GetSlotOffset(static_cast<AST::VarExpr&>(expr).slot));
+
+        case Nonterminal::REG:
+        case Nonterminal::INDEX:
+            return Reg(reg);
+
+        default:
+            return Asm::Operand();
+        }
+    }
+
+    Asm::Opcode CodeGenVisitor::GetAluOpcode(AST::Expr& expr) const
+    {
+        AST::BinaryOp op = AST::BinaryOp::ADD;
+
+        if (auto assign = dynamic_cast<AST::AssignExpr*>(&expr))
+        {
+            op = AssignOpToBinaryOp(assign->op);
+        }
+        else
+        {
+            op = static_cast<AST::BinaryOpExpr&>(expr).op;
+        }
+
+        switch (op)
+        {
+        case AST::BinaryOp::ADD:         return Opcode::ADD;
+        case AST::BinaryOp::SUBSTRACT:   return Opcode::SUB;
+        case AST::BinaryOp::MULTIPLY:    return Opcode::IMUL;
+        case AST::BinaryOp::BITWISE_AND: return Opcode::AND;
+        case AST::BinaryOp::BITWISE_OR:  return Opcode::OR;
+        case AST::BinaryOp::BITWISE_XOR: return Opcode::XOR;
+
+        default:
+            Unreachable("CodeGenVisitor::GetAluOpcode unreachable");
+            return Opcode::ADD;
+        }
+    }
+
+    // The factor of a node labelled INDEX: a * by 2, 4 or 8.
+    uint8_t CodeGenVisitor::GetScale(AST::Expr& expr) const
+    {
+        // Both sides may be literals, so the factor is the side the rule took it from.
+        auto& binary = static_cast<AST::BinaryOpExpr&>(expr);
+        const SelectionRule& rule = GetSelectionRule(selection.at(&expr).GetRule(Nonterminal::INDEX));
+        AST::Expr& factor = rule.kids[0] == Nonterminal::FACTOR ? *binary.left : *binary.right;
+
+        return static_cast<uint8_t>(static_cast<AST::IntegerNumberExpr&>(factor).GetValue());
+    }
+
+    void CodeGenVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    {
+        AST::Expr* kids[2] = {};
+        if (ClassifyNode(node, kids) != TreeOp::OTHER)
+        {
+            Select(node, Nonterminal::REG);
+            return;
+        }
+
+        // *=, /=, %=, <<= and >>=.
+        Asm::Operand var = Mem(Register::EBP, GetVarOffset(node.target));
+
+        int32_t constant = 0;
+
+        if (IsReducibleConstant(AssignOpToBinaryOp(node.op), *node.expr, constant))
+        {
+            Emit(Opcode::MOV, var, Reg(Register::EAX));
+            BinaryByConstant(AssignOpToBinaryOp(node.op), constant);
+            Emit(Opcode::MOV, Reg(Register::EAX), var);
+            return;
+        }
+
+        node.expr->Accept(*this);
+
+        if (node.op == AST::AssignOp::BITWISE_SHIFT_LEFT_ASSIGN
+            || node.op == AST::AssignOp::BITWISE_SHIFT_RIGHT_ASSIGN)
+        {
+            Emit(Opcode::MOV, Reg(Register::EAX), Reg(Register::ECX));
+        }
+        else
+        {
+            Emit(Opcode::MOV, Reg(Register::EAX), Reg(Register::EBX));
+        }
+
+        Emit(Opcode::MOV, var, Reg(Register::EAX));
+
+        SimpleBinaryOnEaxEbx(AssignOpToBinaryOp(node.op));
+
+        Emit(Opcode::MOV, Reg(Register::EAX), var);
     }
 
     AST::BinaryOp CodeGenVisitor::AssignOpToBinaryOp(AST::AssignOp op) const
@@ -334,85 +1020,84 @@ namespace CComp
 
     std::string CodeGenVisitor::GenerateUniqueLabel()
     {
-        if (labelCount == SIZE_MAX)
-        {
-            // TODO: ReportError.
-            hadError = true;
-        }
-
-        return "_label" + std::to_string(labelCount++);
+        // Every label marks instructions held in memory, so the count cannot wrap.
+        return ".L" + functionName + "_" + std::to_string(labelCount++);
     }
 
-    void CodeGenVisitor::EmitProlog()
+    bool CodeGenVisitor::UsesRegister(size_t from, Asm::Register reg) const
     {
-        Print() << "pushl %ebx" << std::endl;
-        Print() << "movl %esp, %ebp" << std::endl;
-        Print() << std::endl;
+        for (size_t i = from; i < out.size(); i++)
+        {
+            Asm::Effects effects = Asm::GetEffects(out[i]);
+
+            if ((effects.reads | effects.writes) & Asm::MaskOf(reg))
+            {
+                return true;
+            }
+        }
+
+        return false;
     }
 
-    void CodeGenVisitor::EmitEpilog()
+    int CodeGenVisitor::GetSlotOffset(int slot) const
     {
-        Print() << std::endl;
-        Print() << "movl %ebp, %esp" << std::endl;
-        Print() << "popl %ebx" << std::endl;
+        return FrameLayout::GetSlotOffset(static_cast<size_t>(slot));
     }
 
-    int CodeGenVisitor::MaybeGetVarIndex(std::unique_ptr<AST::Expr>& node)
+    int CodeGenVisitor::GetVarOffset(std::unique_ptr<AST::Expr>& node) const
     {
+        // SemanticVisitor guarantees that assignment targets are resolved variables.
         AST::VarExpr* var = dynamic_cast<AST::VarExpr*>(node.get());
         if (var == nullptr)
         {
-            ReportError(node->pos, "invalid assignment target");
-            hadError = true;
-            return 0;
-        }
-
-        auto iter = vars.find(var->name);
-        if (iter == vars.end())
-        {
-            ReportError(node->pos, "undefined variable");
-            hadError = true;
+            Unreachable("GetVarOffset on a non-variable expression");
             return 0;
         }
 
-        return iter->second;
+        return GetSlotOffset(var->slot);
     }
 
     void CodeGenVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
     {
-        auto iter = vars.find(node.name);
-        if (iter != vars.end())
+        // The slot itself was reserved by the prologue.
+        if (node.init == nullptr)
         {
-            ReportError(node.pos, "redefinition of variable '" + node.name + "'");
-            // TODO: Add 'note: first declared here'.
             return;
         }
 
-        if (node.init != nullptr)
+        // Initialized as by an assignment: a constant goes straight into the slot.
+        Asm::Operand slot = Mem(Register::EBP, GetSlotOffset(node.slot));
+
+        if (Label(*node.init).Derives(Nonterminal::IMM))
         {
-            node.init->Accept(*this);
+            Emit(Opcode::MOV, GetSelectedOperand(*node.init, Nonterminal::IMM, Register::NONE), slot);
+        }
+        else
+        {
+            Select(*node.init, Nonterminal::REG);
+            Emit(Opcode::MOV, Reg(Register::EAX), slot);
         }
 
-        Print() << "pushl %eax" << std::endl;
-
-        vars[node.name] = currentStackIndex;
-        currentStackIndex -= WORD_SIZE;
+        storedSlot = node.slot;
     }
 
     void CodeGenVisitor::VisitExprStmt(AST::ExprStmt& node)
     {
-        node.expr->Accept(*this);
+        int slot = GetAssignedSlot(*node.expr);
+
+        bool isReadModifyWrite = IsReadModifyWrite(*node.expr);
+
+        // The register form of a read-modify-write starts by loading the local, which the
+        // peephole pass only makes free where the previous statement stored it.
+        bool inRegister = forwardStores && isReadModifyWrite && slot != -1 && slot == nextLoadedSlot && slot == storedSlot;
+
+        Select(*node.expr, inRegister ? Nonterminal::REG : Nonterminal::STMT);
+        storedSlot = !isReadModifyWrite || inRegister ? slot : -1;
     }
 
     void CodeGenVisitor::VisitVarExpr(AST::VarExpr& node)
     {
-        auto iter = vars.find(node.name);
-        if (iter == vars.end())
-        {
-            ReportError(node.pos, "undefined variable '" + node.name + "'");
-        }
-
-        Print() << "movl " << iter->second << "(%ebp), %eax" << std::endl;
+        Select(node, Nonterminal::REG);
     }
 
 } // namespace CComp
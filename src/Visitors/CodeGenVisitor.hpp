@@ -2,8 +2,9 @@
 #define CCOMP_CODE_GEN_VISITOR_HPP
 
 #include "../AST/Visitor.hpp"
+#include "../Asm/Asm.hpp"
+#include "../Backend/InstructionSelection.hpp"
 
-#include <iostream>
 #include <vector>
 #include <memory>
 #include <unordered_map>
@@ -13,9 +14,12 @@ namespace CComp
     class CodeGenVisitor : public AST::Visitor
     {
     public:
-        CodeGenVisitor(std::ostream& out);
+        // With forwardStores, code is chosen for the peephole pass to forward stored locals.
+        CodeGenVisitor(std::vector<Asm::Instruction>& out, bool forwardStores = true);
 
-        void Compile(std::vector<std::unique_ptr<AST::Decl>>& ast);
+        // Functions share no state, so jobs of them are generated at once, each into its own
+        // buffer. The buffers are joined in source order, so the output never depends on jobs.
+        void Compile(std::vector<std::unique_ptr<AST::Decl>>& ast, size_t jobs = 1);
 
         bool HadError() const
         { return hadError; }
@@ -35,29 +39,71 @@ namespace CComp
 
     private:
         bool hadError = false;
-        std::ostream& out;
-        size_t tab = 0;
+        std::vector<Asm::Instruction>& out;
+        bool forwardStores;
 
-        const int WORD_SIZE = 4;
-        int currentStackIndex = -WORD_SIZE;
-        std::unordered_map<std::string, int> vars;
+        int GetSlotOffset(int slot) const;
+        int GetVarOffset(std::unique_ptr<AST::Expr>& node) const;
 
-        int MaybeGetVarIndex(std::unique_ptr<AST::Expr>& node);
-        
-        void EmitProlog();
-        void EmitEpilog();
+        // Whether code emitted since from touches reg; decides which callee-saved registers are saved.
+        bool UsesRegister(size_t from, Asm::Register reg) const;
 
-        std::ostream& Print();
+        void Emit(Asm::Opcode op, Asm::Operand a = Asm::Operand(), Asm::Operand b = Asm::Operand());
+        void Emit(Asm::Opcode op, const std::string& label);
+        void EmitJump(Asm::Cond cond, const std::string& label);
+        void EmitSet(Asm::Cond cond);
 
         void MakeHeader();
         void MakeFooter();
 
-        void BinaryComparison(const std::string& setOp);
+        // Expressions are covered by the tree grammar of InstructionSelection: memory and
+        // immediate operands, lea, test and xorl. What it leaves out, the Visit methods
+        // generate as before, as OTHER leaves.
+        std::unordered_map<const AST::Expr*, SelectionState> selection;
+
+        TreeOp ClassifyNode(AST::Expr& expr, AST::Expr* kids[2]) const;
+        const SelectionState& Label(AST::Expr& expr);
+        Asm::Cond Reduce(AST::Expr& expr, Nonterminal goal);
+        Asm::Cond Select(AST::Expr& expr, Nonterminal goal);
+        Asm::Operand GetSelectedOperand(AST::Expr& expr, Nonterminal nt, Asm::Register reg) const;
+        Asm::Opcode GetAluOpcode(AST::Expr& expr) const;
+        uint8_t GetScale(AST::Expr& expr) const;
+        void EmitStepValue(AST::UnaryOpExpr& node);
+
+        // A read-modify-write of a local that the previous statement stored and the next one
+        // starts by loading goes through %eax, so the peephole pass can forward the value
+        // both ways and drop the stores. -1 where there is no such local.
+        int nextLoadedSlot = -1;
+        int storedSlot = -1;
+        int GetFirstLoadedSlot(AST::Stmt& stmt, int nextLoadedSlot) const;
+        int GetFirstLoadedSlot(AST::Expr& expr) const;
+        int GetAssignedSlot(AST::Expr& expr) const;
+        bool IsReadModifyWrite(AST::Expr& expr) const;
 
         void SimpleBinary(AST::BinaryOpExpr& node);
         void SimpleBinaryOnEaxEbx(AST::BinaryOp op);
-        void ShortCircuitBinary(AST::BinaryOpExpr& node);
 
+        // Conditions compile to compare-and-jump; a 0/1 value is only produced when
+        // MaterializeCondition is asked for one.
+        bool IsComparison(AST::BinaryOp op) const;
+        Asm::Cond ComparisonToCond(AST::BinaryOp op) const;
+        bool NeedsBranches(AST::Expr& expr) const;
+        Asm::Cond EmitFlags(AST::Expr& expr);
+        void EmitBranch(AST::Expr& expr, bool jumpIfTrue, const std::string& target);
+        void MaterializeCondition(AST::Expr& expr);
+
+        // *, / and % by a literal: shifts, lea and multiply-high instead of imull and idivl.
+        bool IsReducibleConstant(AST::BinaryOp op, AST::Expr& expr, int32_t& value) const;
+        void BinaryByConstant(AST::BinaryOp op, int32_t value);
+
+        // Returns jump to one shared epilogue; code after a return is not emitted.
+        std::string returnLabel;
+        size_t returnJumps = 0;
+        bool terminated = false;
+
+        // Labels are numbered per function and carry its name, which keeps them unique
+        // in the output without a counter shared between functions.
+        std::string functionName;
         size_t labelCount = 0;
         std::string GenerateUniqueLabel();
 
@@ -0,0 +1,626 @@
+#include "ConstantFoldVisitor.hpp"
+
+#include <climits>
+
+#include "../AST/AST.hpp"
+
+namespace CComp
+{
+    static long long CountNodes(const AST::Expr& expr)
+    {
+        if (auto unary = dynamic_cast<const AST::UnaryOpExpr*>(&expr))
+        {
+            return 1 + CountNodes(*unary->expr);
+        }
+        else if (auto binary = dynamic_cast<const AST::BinaryOpExpr*>(&expr))
+        {
+            return 1 + CountNodes(*binary->left) + CountNodes(*binary->right);
+        }
+        else if (auto assign = dynamic_cast<const AST::AssignExpr*>(&expr))
+        {
+            return 1 + CountNodes(*assign->target) + CountNodes(*assign->expr);
+        }
+
+        return 1;
+    }
+
+    static bool IsConstant(const AST::Expr& expr, int32_t& value)
+    {
+        auto number = dynamic_cast<const AST::IntegerNumberExpr*>(&expr);
+        if (number == nullptr)
+        {
+            return false;
+        }
+
+        value = number->GetValue();
+        return true;
+    }
+
+    // Whether evaluating the expression can be skipped without changing the program.
+    static bool IsPure(const AST::Expr& expr)
+    {
+        if (auto unary = dynamic_cast<const AST::UnaryOpExpr*>(&expr))
+        {
+            switch (unary->op)
+            {
+            case AST::UnaryOp::NEGATION:
+            case AST::UnaryOp::BITWISE_COMPLEMENT:
+            case AST::UnaryOp::NOT:
+                return IsPure(*unary->expr);
+            default:
+                return false;
+            }
+        }
+        else if (auto binary = dynamic_cast<const AST::BinaryOpExpr*>(&expr))
+        {
+            return IsPure(*binary->left) && IsPure(*binary->right);
+        }
+        else if (dynamic_cast<const AST::AssignExpr*>(&expr) != nullptr)
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    // Structural equality of two pure expressions.
+    static bool IsSameExpr(const AST::Expr& a, const AST::Expr& b)
+    {
+        int32_t left, right;
+        if (IsConstant(a, left) && IsConstant(b, right))
+        {
+            return left == right;
+        }
+
+        auto varA = dynamic_cast<const AST::VarExpr*>(&a);
+        auto varB = dynamic_cast<const AST::VarExpr*>(&b);
+        if (varA != nullptr && varB != nullptr)
+        {
+            return varA->slot == varB->slot;
+        }
+
+        auto unaryA = dynamic_cast<const AST::UnaryOpExpr*>(&a);
+        auto unaryB = dynamic_cast<const AST::UnaryOpExpr*>(&b);
+        if (unaryA != nullptr && unaryB != nullptr)
+        {
+            return unaryA->op == unaryB->op && IsSameExpr(*unaryA->expr, *unaryB->expr);
+        }
+
+        auto binaryA = dynamic_cast<const AST::BinaryOpExpr*>(&a);
+        auto binaryB = dynamic_cast<const AST::BinaryOpExpr*>(&b);
+        if (binaryA != nullptr && binaryB != nullptr)
+        {
+            return binaryA->op == binaryB->op
+                && IsSameExpr(*binaryA->left, *binaryB->left)
+                && IsSameExpr(*binaryA->right, *binaryB->right);
+        }
+
+        return false;
+    }
+
+    // Whether the expression always evaluates to 0 or 1.
+    static bool IsTruthValue(const AST::Expr& expr)
+    {
+        int32_t value;
+        if (IsConstant(expr, value))
+        {
+            return value == 0 || value == 1;
+        }
+
+        if (auto unary = dynamic_cast<const AST::UnaryOpExpr*>(&expr))
+        {
+            return unary->op == AST::UnaryOp::NOT;
+        }
+
+        if (auto binary = dynamic_cast<const AST::BinaryOpExpr*>(&expr))
+        {
+            switch (binary->op)
+            {
+            case AST::BinaryOp::LOGIC_AND:
+            case AST::BinaryOp::LOGIC_OR:
+            case AST::BinaryOp::EQUAL:
+            case AST::BinaryOp::NOT_EQUAL:
+            case AST::BinaryOp::GREATER:
+            case AST::BinaryOp::GREATER_EQUAL:
+            case AST::BinaryOp::LESS:
+            case AST::BinaryOp::LESS_EQUAL:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    static bool IsCommutative(AST::BinaryOp op)
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::ADD:
+        case AST::BinaryOp::MULTIPLY:
+        case AST::BinaryOp::BITWISE_AND:
+        case AST::BinaryOp::BITWISE_OR:
+        case AST::BinaryOp::BITWISE_XOR:
+        case AST::BinaryOp::EQUAL:
+        case AST::BinaryOp::NOT_EQUAL:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void ConstantFoldVisitor::Fold(std::vector<std::unique_ptr<AST::Decl>>& ast)
+    {
+        for (auto& decl : ast)
+        {
+            decl->Accept(*this);
+        }
+    }
+
+    void ConstantFoldVisitor::FoldExpr(std::unique_ptr<AST::Expr>& expr)
+    {
+        if (expr == nullptr)
+        {
+            return;
+        }
+
+        expr->Accept(*this);
+
+        if (replacement != nullptr)
+        {
+            expr = std::move(replacement);
+        }
+    }
+
+    void ConstantFoldVisitor::ReplaceWithConstant(AST::Expr& node, int32_t value)
+    {
+        removedNodes += CountNodes(node) - 1;
+        replacement = std::make_unique<AST::IntegerNumberExpr>(node.pos, std::to_string(value));
+    }
+
+    void ConstantFoldVisitor::ReplaceWithOperand(AST::Expr& node,
+                                                 std::unique_ptr<AST::Expr>& keep,
+                                                 std::unique_ptr<AST::Expr>& drop)
+    {
+        removedNodes += 1 + CountNodes(*drop);
+        replacement = std::move(keep);
+    }
+
+    void ConstantFoldVisitor::ReplaceWithTruthValue(AST::Expr& node,
+                                                    std::unique_ptr<AST::Expr>& keep,
+                                                    std::unique_ptr<AST::Expr>& drop)
+    {
+        if (IsTruthValue(*keep))
+        {
+            ReplaceWithOperand(node, keep, drop);
+            return;
+        }
+
+        // keep != 0 takes two new nodes.
+        removedNodes += 1 + CountNodes(*drop) - 2;
+        replacement = std::make_unique<AST::BinaryOpExpr>(node.pos, AST::BinaryOp::NOT_EQUAL, std::move(keep),
+                                                          std::make_unique<AST::IntegerNumberExpr>(node.pos, "0"));
+    }
+
+    void ConstantFoldVisitor::VisitBasicType(AST::BasicType& node)
+    {}
+
+    void ConstantFoldVisitor::VisitTypeAndNameDecl(AST::TypeAndNameDecl& node)
+    {}
+
+    void ConstantFoldVisitor::VisitFunctionDecl(AST::FunctionDecl& node)
+    {
+        node.body->Accept(*this);
+    }
+
+    void ConstantFoldVisitor::VisitIntegerNumberExpr(AST::IntegerNumberExpr& node)
+    {}
+
+    void ConstantFoldVisitor::VisitBlockStmt(AST::BlockStmt& node)
+    {
+        for (auto& stmt : node.stmts)
+        {
+            stmt->Accept(*this);
+        }
+    }
+
+    void ConstantFoldVisitor::VisitReturnStmt(AST::ReturnStmt& node)
+    {
+        FoldExpr(node.expr);
+    }
+
+    void ConstantFoldVisitor::VisitUnaryOpExpr(AST::UnaryOpExpr& node)
+    {
+        FoldExpr(node.expr);
+
+        int32_t value;
+        if (IsConstant(*node.expr, value))
+        {
+            uint32_t bits = static_cast<uint32_t>(value);
+
+            switch (node.op)
+            {
+            case AST::UnaryOp::NEGATION:
+                ReplaceWithConstant(node, static_cast<int32_t>(0u - bits));
+                return;
+            case AST::UnaryOp::BITWISE_COMPLEMENT:
+                ReplaceWithConstant(node, static_cast<int32_t>(~bits));
+                return;
+            case AST::UnaryOp::NOT:
+                ReplaceWithConstant(node, value == 0);
+                return;
+            default:
+                return;
+            }
+        }
+
+        // -(-x) and ~(~x) are x.
+        auto inner = dynamic_cast<AST::UnaryOpExpr*>(node.expr.get());
+        if (inner != nullptr && inner->op == node.op
+            && (node.op == AST::UnaryOp::NEGATION || node.op == AST::UnaryOp::BITWISE_COMPLEMENT))
+        {
+            removedNodes += 2;
+            replacement = std::move(inner->expr);
+        }
+    }
+
+    void ConstantFoldVisitor::VisitBinaryOpExpr(AST::BinaryOpExpr& node)
+    {
+        FoldExpr(node.left);
+        FoldExpr(node.right);
+
+        if (node.op == AST::BinaryOp::LOGIC_AND || node.op == AST::BinaryOp::LOGIC_OR)
+        {
+            SimplifyLogical(node);
+            return;
+        }
+
+        int32_t left, right;
+        bool isLeftConstant = IsConstant(*node.left, left);
+        bool isRightConstant = IsConstant(*node.right, right);
+
+        if (isLeftConstant && isRightConstant)
+        {
+            int32_t res;
+            if (FoldBinaryConstants(node.op, left, right, res))
+            {
+                ReplaceWithConstant(node, res);
+            }
+            return;
+        }
+
+        if (node.op == AST::BinaryOp::COMMA)
+        {
+            if (IsPure(*node.left))
+            {
+                ReplaceWithOperand(node, node.right, node.left);
+            }
+            return;
+        }
+
+        // Keep constants on the right so the rules below only look at one side.
+        if (isLeftConstant && IsCommutative(node.op))
+        {
+            std::swap(node.left, node.right);
+        }
+
+        if (Reassociate(node))
+        {
+            return;
+        }
+
+        SimplifyBinary(node);
+    }
+
+    bool ConstantFoldVisitor::FoldBinaryConstants(AST::BinaryOp op, int32_t left, int32_t right, int32_t& res) const
+    {
+        uint32_t l = static_cast<uint32_t>(left);
+        uint32_t r = static_cast<uint32_t>(right);
+
+        switch (op)
+        {
+        case AST::BinaryOp::COMMA:     res = right; return true;
+        case AST::BinaryOp::ADD:       res = static_cast<int32_t>(l + r); return true;
+        case AST::BinaryOp::SUBSTRACT: res = static_cast<int32_t>(l - r); return true;
+        case AST::BinaryOp::MULTIPLY:  res = static_cast<int32_t>(l * r); return true;
+
+        case AST::BinaryOp::DIVIDE:
+        case AST::BinaryOp::MODULO:
+            // Both trap at run time; the program is undefined, so keep whatever the target does.
+            if (right == 0 || (left == INT32_MIN && right == -1))
+            {
+                return false;
+            }
+
+            res = op == AST::BinaryOp::DIVIDE ? left / right : left % right;
+            return true;
+
+        case AST::BinaryOp::BITWISE_AND: res = left & right; return true;
+        case AST::BinaryOp::BITWISE_OR:  res = left | right; return true;
+        case AST::BinaryOp::BITWISE_XOR: res = left ^ right; return true;
+
+        case AST::BinaryOp::BITWISE_SHIFT_LEFT:
+        case AST::BinaryOp::BITWISE_SHIFT_RIGHT:
+            // Negative counts and counts of at least the width are undefined, the target masks them.
+            if (right < 0 || right > 31)
+            {
+                return false;
+            }
+
+            res = op == AST::BinaryOp::BITWISE_SHIFT_LEFT
+                ? static_cast<int32_t>(l << right)
+                : left >> right;
+            return true;
+
+        case AST::BinaryOp::EQUAL:         res = left == right; return true;
+        case AST::BinaryOp::NOT_EQUAL:     res = left != right; return true;
+        case AST::BinaryOp::GREATER:       res = left > right;  return true;
+        case AST::BinaryOp::GREATER_EQUAL: res = left >= right; return true;
+        case AST::BinaryOp::LESS:          res = left < right;  return true;
+        case AST::BinaryOp::LESS_EQUAL:    res = left <= right; return true;
+
+        case AST::BinaryOp::LOGIC_AND: res = left != 0 && right != 0; return true;
+        case AST::BinaryOp::LOGIC_OR:  res = left != 0 || right != 0; return true;
+        }
+
+        return false;
+    }
+
+    bool ConstantFoldVisitor::Reassociate(AST::BinaryOpExpr& node)
+    {
+        int32_t outer;
+        if (!IsConstant(*node.right, outer))
+        {
+            return false;
+        }
+
+        // x - c is x + (-c), which lets it combine with other additions.
+        if (node.op == AST::BinaryOp::SUBSTRACT && outer != 0)
+        {
+            node.op = AST::BinaryOp::ADD;
+            outer = static_cast<int32_t>(0u - static_cast<uint32_t>(outer));
+            node.right = std::make_unique<AST::IntegerNumberExpr>(node.right->pos, std::to_string(outer));
+        }
+
+        switch (node.op)
+        {
+        case AST::BinaryOp::ADD:
+        case AST::BinaryOp::MULTIPLY:
+        case AST::BinaryOp::BITWISE_AND:
+        case AST::BinaryOp::BITWISE_OR:
+        case AST::BinaryOp::BITWISE_XOR:
+            break;
+        default:
+            return false;
+        }
+
+        // (x op c1) op c2 is x op (c1 op c2) for these operators, even with wrap around.
+        auto inner = dynamic_cast<AST::BinaryOpExpr*>(node.left.get());
+        int32_t innerConstant;
+        if (inner == nullptr || inner->op != node.op || !IsConstant(*inner->right, innerConstant))
+        {
+            return false;
+        }
+
+        int32_t combined;
+        FoldBinaryConstants(node.op, innerConstant, outer, combined);
+
+        node.right = std::make_unique<AST::IntegerNumberExpr>(node.right->pos, std::to_string(combined));
+        node.left = std::move(inner->left);
+        removedNodes += 2;
+
+        SimplifyBinary(node);
+        return true;
+    }
+
+    bool ConstantFoldVisitor::SimplifyBinary(AST::BinaryOpExpr& node)
+    {
+        int32_t left, right;
+        bool isLeftConstant = IsConstant(*node.left, left);
+        bool isRightConstant = IsConstant(*node.right, right);
+
+        if (isRightConstant)
+        {
+            bool isPureLeft = IsPure(*node.left);
+
+            switch (node.op)
+            {
+            case AST::BinaryOp::ADD:
+            case AST::BinaryOp::SUBSTRACT:
+            case AST::BinaryOp::BITWISE_OR:
+            case AST::BinaryOp::BITWISE_XOR:
+            case AST::BinaryOp::BITWISE_SHIFT_LEFT:
+            case AST::BinaryOp::BITWISE_SHIFT_RIGHT:
+                if (right == 0)
+                {
+                    ReplaceWithOperand(node, node.left, node.right);
+                    return true;
+                }
+                if (node.op == AST::BinaryOp::BITWISE_OR && right == -1 && isPureLeft)
+                {
+                    ReplaceWithConstant(node, -1);
+                    return true;
+                }
+                break;
+
+            case AST::BinaryOp::MULTIPLY:
+                if (right == 1)
+                {
+                    ReplaceWithOperand(node, node.left, node.right);
+                    return true;
+                }
+                if (right == 0 && isPureLeft)
+                {
+                    ReplaceWithConstant(node, 0);
+                    return true;
+                }
+                break;
+
+            case AST::BinaryOp::DIVIDE:
+                if (right == 1)
+                {
+                    ReplaceWithOperand(node, node.left, node.right);
+                    return true;
+                }
+                break;
+
+            case AST::BinaryOp::MODULO:
+                if ((right == 1 || right == -1) && isPureLeft)
+                {
+                    ReplaceWithConstant(node, 0);
+                    return true;
+                }
+                break;
+
+            case AST::BinaryOp::BITWISE_AND:
+                if (right == -1)
+                {
+                    ReplaceWithOperand(node, node.left, node.right);
+                    return true;
+                }
+                if (right == 0 && isPureLeft)
+                {
+                    ReplaceWithConstant(node, 0);
+                    return true;
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (isLeftConstant && left == 0 && IsPure(*node.right))
+        {
+            switch (node.op)
+            {
+            case AST::BinaryOp::BITWISE_SHIFT_LEFT:
+            case AST::BinaryOp::BITWISE_SHIFT_RIGHT:
+                ReplaceWithConstant(node, 0);
+                return true;
+            default:
+                break;
+            }
+        }
+
+        if (IsPure(*node.left) && IsPure(*node.right) && IsSameExpr(*node.left, *node.right))
+        {
+            switch (node.op)
+            {
+            case AST::BinaryOp::SUBSTRACT:
+            case AST::BinaryOp::BITWISE_XOR:
+            case AST::BinaryOp::NOT_EQUAL:
+            case AST::BinaryOp::LESS:
+            case AST::BinaryOp::GREATER:
+                ReplaceWithConstant(node, 0);
+                return true;
+
+            case AST::BinaryOp::EQUAL:
+            case AST::BinaryOp::LESS_EQUAL:
+            case AST::BinaryOp::GREATER_EQUAL:
+                ReplaceWithConstant(node, 1);
+                return true;
+
+            case AST::BinaryOp::BITWISE_AND:
+            case AST::BinaryOp::BITWISE_OR:
+                ReplaceWithOperand(node, node.left, node.right);
+                return true;
+
+            default:
+                break;
+            }
+        }
+
+        return false;
+    }
+
+    void ConstantFoldVisitor::SimplifyLogical(AST::BinaryOpExpr& node)
+    {
+        bool isAnd = node.op == AST::BinaryOp::LOGIC_AND;
+
+        int32_t left, right;
+        bool isLeftConstant = IsConstant(*node.left, left);
+        bool isRightConstant = IsConstant(*node.right, right);
+
+        if (isLeftConstant)
+        {
+            // The right operand is either never evaluated or decides the result alone.
+            if (isAnd == (left == 0))
+            {
+                ReplaceWithConstant(node, isAnd ? 0 : 1);
+            }
+            else
+            {
+                ReplaceWithTruthValue(node, node.right, node.left);
+            }
+            return;
+        }
+
+        if (isRightConstant)
+        {
+            if (isAnd == (right != 0))
+            {
+                // x && 1 and x || 0 are just the truth value of x.
+                ReplaceWithTruthValue(node, node.left, node.right);
+            }
+            else if (IsPure(*node.left))
+            {
+                ReplaceWithConstant(node, isAnd ? 0 : 1);
+            }
+        }
+    }
+
+    void ConstantFoldVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
+    {
+        FoldExpr(node.init);
+    }
+
+    void ConstantFoldVisitor::VisitExprStmt(AST::ExprStmt& node)
+    {
+        FoldExpr(node.expr);
+    }
+
+    void ConstantFoldVisitor::VisitVarExpr(AST::VarExpr& node)
+    {}
+
+    void ConstantFoldVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    {
+        FoldExpr(node.expr);
+
+        int32_t value;
+        if (!IsConstant(*node.expr, value))
+        {
+            return;
+        }
+
+        bool isIdentity = false;
+
+        switch (node.op)
+        {
+        case AST::AssignOp::ADD_ASSIGN:
+        case AST::AssignOp::SUBSTRACT_ASSIGN:
+        case AST::AssignOp::BITWISE_OR_ASSIGN:
+        case AST::AssignOp::BITWISE_XOR_ASSIGN:
+        case AST::AssignOp::BITWISE_SHIFT_LEFT_ASSIGN:
+        case AST::AssignOp::BITWISE_SHIFT_RIGHT_ASSIGN:
+            isIdentity = value == 0;
+            break;
+        case AST::AssignOp::MULTIPLY_ASSIGN:
+        case AST::AssignOp::DIVIDE_ASSIGN:
+            isIdentity = value == 1;
+            break;
+        case AST::AssignOp::BITWISE_AND_ASSIGN:
+            isIdentity = value == -1;
+            break;
+        default:
+            break;
+        }
+
+        // x += 0 leaves x unchanged, so only its value remains.
+        if (isIdentity)
+        {
+            ReplaceWithOperand(node, node.target, node.expr);
+        }
+    }
+} // namespace CComp
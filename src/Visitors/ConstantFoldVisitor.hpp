@@ -0,0 +1,57 @@
+#ifndef CCOMP_CONSTANT_FOLD_VISITOR_HPP
+#define CCOMP_CONSTANT_FOLD_VISITOR_HPP
+
+#include "../AST/Visitor.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+namespace CComp
+{
+    // Evaluates constant subexpressions with 32-bit C semantics and applies algebraic identities.
+    // Operations whose result the target decides at run time (division by zero, INT_MIN / -1,
+    // out of range shift counts) are left alone. Must run after SemanticVisitor.
+    class ConstantFoldVisitor : public AST::Visitor
+    {
+    public:
+        ConstantFoldVisitor() = default;
+
+        void Fold(std::vector<std::unique_ptr<AST::Decl>>& ast);
+
+        long long GetRemovedNodeCount() const
+        { return removedNodes; }
+
+        virtual void VisitBasicType(AST::BasicType& node);
+        virtual void VisitTypeAndNameDecl(AST::TypeAndNameDecl& node);
+        virtual void VisitFunctionDecl(AST::FunctionDecl& node);
+        virtual void VisitIntegerNumberExpr(AST::IntegerNumberExpr& node);
+        virtual void VisitBlockStmt(AST::BlockStmt& node);
+        virtual void VisitReturnStmt(AST::ReturnStmt& node);
+        virtual void VisitUnaryOpExpr(AST::UnaryOpExpr& node);
+        virtual void VisitBinaryOpExpr(AST::BinaryOpExpr& node);
+        virtual void VisitVarDeclStmt(AST::VarDeclStmt& node);
+        virtual void VisitExprStmt(AST::ExprStmt& node);
+        virtual void VisitVarExpr(AST::VarExpr& node);
+        virtual void VisitAssignExpr(AST::AssignExpr& node);
+
+    private:
+        long long removedNodes = 0;
+
+        // Set by a Visit method when the visited expression should be replaced.
+        std::unique_ptr<AST::Expr> replacement;
+
+        void FoldExpr(std::unique_ptr<AST::Expr>& expr);
+
+        void ReplaceWithConstant(AST::Expr& node, int32_t value);
+        void ReplaceWithOperand(AST::Expr& node, std::unique_ptr<AST::Expr>& keep, std::unique_ptr<AST::Expr>& drop);
+        void ReplaceWithTruthValue(AST::Expr& node, std::unique_ptr<AST::Expr>& keep, std::unique_ptr<AST::Expr>& drop);
+
+        bool FoldBinaryConstants(AST::BinaryOp op, int32_t left, int32_t right, int32_t& res) const;
+        bool SimplifyBinary(AST::BinaryOpExpr& node);
+        bool Reassociate(AST::BinaryOpExpr& node);
+        void SimplifyLogical(AST::BinaryOpExpr& node);
+    }; // class ConstantFoldVisitor
+} // namespace CComp
+
+#endif // CCOMP_CONSTANT_FOLD_VISITOR_HPP
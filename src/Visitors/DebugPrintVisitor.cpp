@@ -100,7 +100,7 @@ namespace CComp
     void DebugPrintVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
     {
         out << std::string(tab, ' ');
-        out << node.pos.line << ":" << "VarDeclStmt: " << std::endl;
+        out << node.pos.line << ":" << "VarDeclStmt: " << node.name << " (slot " << node.slot << ")" << std::endl;
 
         if (node.init != nullptr)
         {
@@ -123,7 +123,7 @@ namespace CComp
     void DebugPrintVisitor::VisitVarExpr(AST::VarExpr& node)
     {
         out << std::string(tab, ' ');
-        out << node.pos.line << ":" << "VarStmt: " << node.name << std::endl;
+        out << node.pos.line << ":" << "VarStmt: " << node.name << " (slot " << node.slot << ")" << std::endl;
     }
 
     void DebugPrintVisitor::VisitAssignExpr(AST::AssignExpr& node)
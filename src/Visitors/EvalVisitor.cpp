@@ -0,0 +1,225 @@
+#include "EvalVisitor.hpp"
+
+#include "../AST/AST.hpp"
+#include "../Bytecode/Bytecode.hpp"
+#include "../Unreachable.hpp"
+
+namespace CComp
+{
+    bool EvalVisitor::Run(std::vector<std::unique_ptr<AST::Decl>>& ast, const std::string& name, int32_t& res)
+    {
+        error.clear();
+
+        for (auto& decl : ast)
+        {
+            auto func = dynamic_cast<AST::FunctionDecl*>(decl.get());
+            if (func != nullptr && func->name == name)
+            {
+                func->Accept(*this);
+
+                res = value;
+                return error.empty();
+            }
+        }
+
+        error = "no function '" + name + "'";
+        return false;
+    }
+
+    int32_t EvalVisitor::Evaluate(AST::Expr& expr)
+    {
+        expr.Accept(*this);
+        return value;
+    }
+
+    void EvalVisitor::VisitBasicType(AST::BasicType& node)
+    {}
+
+    void EvalVisitor::VisitTypeAndNameDecl(AST::TypeAndNameDecl& node)
+    {}
+
+    void EvalVisitor::VisitFunctionDecl(AST::FunctionDecl& node)
+    {
+        // Locals start out as zero, like the stack of a fresh process.
+        locals.assign(node.slotCount, 0);
+        returned = false;
+
+        node.body->Accept(*this);
+
+        // Falling off the end of a function returns 0, which is what main requires.
+        if (!returned)
+        {
+            value = 0;
+        }
+    }
+
+    void EvalVisitor::VisitIntegerNumberExpr(AST::IntegerNumberExpr& node)
+    {
+        value = node.GetValue();
+    }
+
+    void EvalVisitor::VisitBlockStmt(AST::BlockStmt& node)
+    {
+        for (auto& stmt : node.stmts)
+        {
+            if (returned || !error.empty())
+            {
+                return;
+            }
+
+            stmt->Accept(*this);
+        }
+    }
+
+    void EvalVisitor::VisitReturnStmt(AST::ReturnStmt& node)
+    {
+        Evaluate(*node.expr);
+        returned = true;
+    }
+
+    void EvalVisitor::VisitUnaryOpExpr(AST::UnaryOpExpr& node)
+    {
+        switch (node.op)
+        {
+        case AST::UnaryOp::NEGATION:
+            value = Bytecode::Neg(Evaluate(*node.expr));
+            return;
+        case AST::UnaryOp::BITWISE_COMPLEMENT:
+            value = ~Evaluate(*node.expr);
+            return;
+        case AST::UnaryOp::NOT:
+            value = Evaluate(*node.expr) == 0;
+            return;
+        default:
+            break;
+        }
+
+        int32_t& local = locals[static_cast<AST::VarExpr&>(*node.expr).slot];
+
+        int32_t old = local;
+
+        bool isIncrement = node.op == AST::UnaryOp::PRE_INCREMENT
+            || node.op == AST::UnaryOp::POST_INCREMENT;
+        local = Bytecode::Add(old, isIncrement ? 1 : -1);
+
+        bool isPrefix = node.op == AST::UnaryOp::PRE_INCREMENT
+            || node.op == AST::UnaryOp::PRE_DECREMENT;
+        value = isPrefix ? local : old;
+    }
+
+    void EvalVisitor::VisitBinaryOpExpr(AST::BinaryOpExpr& node)
+    {
+        switch (node.op)
+        {
+        case AST::BinaryOp::COMMA:
+            Evaluate(*node.left);
+            Evaluate(*node.right);
+            return;
+
+        case AST::BinaryOp::LOGIC_AND:
+            value = Evaluate(*node.left) != 0 && Evaluate(*node.right) != 0;
+            return;
+
+        case AST::BinaryOp::LOGIC_OR:
+            value = Evaluate(*node.left) != 0 || Evaluate(*node.right) != 0;
+            return;
+
+        default:
+        {
+            int32_t left = Evaluate(*node.left);
+            int32_t right = Evaluate(*node.right);
+            Apply(node.op, left, right, value);
+            return;
+        }
+        }
+    }
+
+    void EvalVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
+    {
+        if (node.init != nullptr)
+        {
+            locals[node.slot] = Evaluate(*node.init);
+        }
+    }
+
+    void EvalVisitor::VisitExprStmt(AST::ExprStmt& node)
+    {
+        Evaluate(*node.expr);
+    }
+
+    void EvalVisitor::VisitVarExpr(AST::VarExpr& node)
+    {
+        value = locals[node.slot];
+    }
+
+    void EvalVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    {
+        int slot = static_cast<AST::VarExpr&>(*node.target).slot;
+
+        int32_t res = Evaluate(*node.expr);
+
+        if (node.op != AST::AssignOp::SIMPLE_ASSIGN)
+        {
+            Apply(AssignOpToBinaryOp(node.op), locals[slot], res, res);
+        }
+
+        locals[slot] = res;
+        value = res;
+    }
+
+    bool EvalVisitor::Apply(AST::BinaryOp op, int32_t left, int32_t right, int32_t& res)
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::ADD:                 res = Bytecode::Add(left, right); return true;
+        case AST::BinaryOp::SUBSTRACT:           res = Bytecode::Sub(left, right); return true;
+        case AST::BinaryOp::MULTIPLY:            res = Bytecode::Mul(left, right); return true;
+        case AST::BinaryOp::BITWISE_AND:         res = left & right;               return true;
+        case AST::BinaryOp::BITWISE_OR:          res = left | right;               return true;
+        case AST::BinaryOp::BITWISE_XOR:         res = left ^ right;               return true;
+        case AST::BinaryOp::BITWISE_SHIFT_LEFT:  res = Bytecode::Shl(left, right); return true;
+        case AST::BinaryOp::BITWISE_SHIFT_RIGHT: res = Bytecode::Shr(left, right); return true;
+        case AST::BinaryOp::EQUAL:               res = left == right;              return true;
+        case AST::BinaryOp::NOT_EQUAL:           res = left != right;              return true;
+        case AST::BinaryOp::LESS:                res = left < right;               return true;
+        case AST::BinaryOp::LESS_EQUAL:          res = left <= right;              return true;
+        case AST::BinaryOp::GREATER:             res = left > right;               return true;
+        case AST::BinaryOp::GREATER_EQUAL:       res = left >= right;              return true;
+
+        case AST::BinaryOp::DIVIDE:
+        case AST::BinaryOp::MODULO:
+        {
+            bool ok = op == AST::BinaryOp::DIVIDE ? Bytecode::Div(left, right, res) : Bytecode::Mod(left, right, res);
+            if (!ok && error.empty())
+            {
+                error = "division by zero or overflow";
+            }
+            return ok;
+        }
+
+        default:
+            Unreachable("EvalVisitor::Apply unreachable");
+            return false;
+        }
+    }
+
+    AST::BinaryOp EvalVisitor::AssignOpToBinaryOp(AST::AssignOp op) const
+    {
+        switch (op)
+        {
+        case AST::AssignOp::ADD_ASSIGN:                 return AST::BinaryOp::ADD;
+        case AST::AssignOp::SUBSTRACT_ASSIGN:           return AST::BinaryOp::SUBSTRACT;
+        case AST::AssignOp::MULTIPLY_ASSIGN:            return AST::BinaryOp::MULTIPLY;
+        case AST::AssignOp::DIVIDE_ASSIGN:              return AST::BinaryOp::DIVIDE;
+        case AST::AssignOp::MODULO_ASSIGN:              return AST::BinaryOp::MODULO;
+        case AST::AssignOp::BITWISE_AND_ASSIGN:         return AST::BinaryOp::BITWISE_AND;
+        case AST::AssignOp::BITWISE_OR_ASSIGN:          return AST::BinaryOp::BITWISE_OR;
+        case AST::AssignOp::BITWISE_XOR_ASSIGN:         return AST::BinaryOp::BITWISE_XOR;
+        case AST::AssignOp::BITWISE_SHIFT_LEFT_ASSIGN:  return AST::BinaryOp::BITWISE_SHIFT_LEFT;
+        case AST::AssignOp::BITWISE_SHIFT_RIGHT_ASSIGN: return AST::BinaryOp::BITWISE_SHIFT_RIGHT;
+        default:
+            Unreachable("AssignOpToBinaryOp unreachable");
+            return AST::BinaryOp::ADD;
+        }
+    }
+} // namespace CComp
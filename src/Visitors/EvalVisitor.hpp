@@ -0,0 +1,58 @@
+#ifndef CCOMP_EVAL_VISITOR_HPP
+#define CCOMP_EVAL_VISITOR_HPP
+
+#include "../AST/Visitor.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace CComp
+{
+    // Runs a resolved AST by walking it, one virtual call per node. The straightforward
+    // baseline for the bytecode interpreter, with the same 32-bit semantics.
+    class EvalVisitor : public AST::Visitor
+    {
+    public:
+        EvalVisitor() = default;
+
+        // Calls the function and stores what it returned in res. False if there is no
+        // such function or the program trapped, with the reason in GetError().
+        bool Run(std::vector<std::unique_ptr<AST::Decl>>& ast, const std::string& name, int32_t& res);
+
+        const std::string& GetError() const
+        { return error; }
+
+        virtual void VisitBasicType(AST::BasicType& node);
+        virtual void VisitTypeAndNameDecl(AST::TypeAndNameDecl& node);
+        virtual void VisitFunctionDecl(AST::FunctionDecl& node);
+        virtual void VisitIntegerNumberExpr(AST::IntegerNumberExpr& node);
+        virtual void VisitBlockStmt(AST::BlockStmt& node);
+        virtual void VisitReturnStmt(AST::ReturnStmt& node);
+        virtual void VisitUnaryOpExpr(AST::UnaryOpExpr& node);
+        virtual void VisitBinaryOpExpr(AST::BinaryOpExpr& node);
+        virtual void VisitVarDeclStmt(AST::VarDeclStmt& node);
+        virtual void VisitExprStmt(AST::ExprStmt& node);
+        virtual void VisitVarExpr(AST::VarExpr& node);
+        virtual void VisitAssignExpr(AST::AssignExpr& node);
+
+    private:
+        std::vector<int32_t> locals;
+
+        // Value of the expression just evaluated.
+        int32_t value = 0;
+
+        bool returned = false;
+        std::string error;
+
+        int32_t Evaluate(AST::Expr& expr);
+
+        // False, with error set, where the operation traps.
+        bool Apply(AST::BinaryOp op, int32_t left, int32_t right, int32_t& res);
+
+        AST::BinaryOp AssignOpToBinaryOp(AST::AssignOp op) const;
+    }; // class EvalVisitor
+} // namespace CComp
+
+#endif // CCOMP_EVAL_VISITOR_HPP
@@ -0,0 +1,286 @@
+#include "IRGenVisitor.hpp"
+
+#include "../AST/AST.hpp"
+#include "../IR/CFG.hpp"
+#include "../Unreachable.hpp"
+
+namespace CComp
+{
+    IR::Module IRGenVisitor::Lower(std::vector<std::unique_ptr<AST::Decl>>& ast)
+    {
+        module = IR::Module();
+
+        for (auto& decl : ast)
+        {
+            decl->Accept(*this);
+        }
+
+        return std::move(module);
+    }
+
+    IR::ValueId IRGenVisitor::Lower(AST::Expr& expr)
+    {
+        result = IR::NO_VALUE;
+        expr.Accept(*this);
+        return result;
+    }
+
+    void IRGenVisitor::VisitBasicType(AST::BasicType& node)
+    {}
+
+    void IRGenVisitor::VisitTypeAndNameDecl(AST::TypeAndNameDecl& node)
+    {}
+
+    void IRGenVisitor::VisitFunctionDecl(AST::FunctionDecl& node)
+    {
+        module.functions.emplace_back();
+
+        func = &module.functions.back();
+        func->name = node.name;
+        func->slotCount = node.slotCount;
+
+        builder = std::make_unique<IR::Builder>(*func);
+        builder->SetInsertBlock(builder->CreateBlock());
+
+        node.body->Accept(*this);
+
+        // The implicit return 0, as in EvalVisitor::VisitFunctionDecl.
+        if (!builder->IsTerminated())
+        {
+            builder->Ret(builder->Const(IR::Type::I32, 0));
+        }
+
+        IR::RemoveUnreachableBlocks(*func);
+
+        builder.reset();
+        func = nullptr;
+    }
+
+    void IRGenVisitor::VisitIntegerNumberExpr(AST::IntegerNumberExpr& node)
+    {
+        result = builder->Const(IR::Type::I32, node.GetValue());
+    }
+
+    void IRGenVisitor::VisitBlockStmt(AST::BlockStmt& node)
+    {
+        for (auto& stmt : node.stmts)
+        {
+            stmt->Accept(*this);
+        }
+    }
+
+    void IRGenVisitor::VisitReturnStmt(AST::ReturnStmt& node)
+    {
+        builder->Ret(Lower(*node.expr));
+
+        // Anything after a return goes into a block without predecessors, which is removed later.
+        builder->SetInsertBlock(builder->CreateBlock());
+    }
+
+    void IRGenVisitor::VisitUnaryOpExpr(AST::UnaryOpExpr& node)
+    {
+        switch (node.op)
+        {
+        case AST::UnaryOp::NEGATION:
+            result = builder->Unary(IR::Opcode::NEG, Lower(*node.expr));
+            return;
+        case AST::UnaryOp::BITWISE_COMPLEMENT:
+            result = builder->Unary(IR::Opcode::NOT, Lower(*node.expr));
+            return;
+        case AST::UnaryOp::NOT:
+        {
+            IR::ValueId value = Lower(*node.expr);
+            IR::ValueId zero = builder->Const(IR::Type::I32, 0);
+            result = builder->ZExt(builder->ICmp(IR::Cond::EQ, value, zero));
+            return;
+        }
+
+        default:
+            break;
+        }
+
+        int slot = static_cast<AST::VarExpr&>(*node.expr).slot;
+
+        IR::ValueId old = builder->Load(slot);
+        IR::ValueId one = builder->Const(IR::Type::I32, 1);
+
+        bool isIncrement = node.op == AST::UnaryOp::PRE_INCREMENT
+            || node.op == AST::UnaryOp::POST_INCREMENT;
+        IR::ValueId updated = builder->Binary(isIncrement ? IR::Opcode::ADD : IR::Opcode::SUB, old, one);
+
+        builder->Store(slot, updated);
+
+        bool isPrefix = node.op == AST::UnaryOp::PRE_INCREMENT
+            || node.op == AST::UnaryOp::PRE_DECREMENT;
+        result = isPrefix ? updated : old;
+    }
+
+    void IRGenVisitor::VisitBinaryOpExpr(AST::BinaryOpExpr& node)
+    {
+        switch (node.op)
+        {
+        case AST::BinaryOp::COMMA:
+            Lower(*node.left);
+            result = Lower(*node.right);
+            return;
+
+        case AST::BinaryOp::LOGIC_AND:
+        case AST::BinaryOp::LOGIC_OR:
+            ShortCircuitBinary(node);
+            return;
+
+        case AST::BinaryOp::EQUAL:
+        case AST::BinaryOp::NOT_EQUAL:
+        case AST::BinaryOp::GREATER:
+        case AST::BinaryOp::GREATER_EQUAL:
+        case AST::BinaryOp::LESS:
+        case AST::BinaryOp::LESS_EQUAL:
+        {
+            IR::ValueId left = Lower(*node.left);
+            IR::ValueId right = Lower(*node.right);
+            result = builder->ZExt(builder->ICmp(BinaryOpToCond(node.op), left, right));
+            return;
+        }
+
+        default:
+        {
+            IR::ValueId left = Lower(*node.left);
+            IR::ValueId right = Lower(*node.right);
+            result = builder->Binary(BinaryOpToOpcode(node.op), left, right);
+            return;
+        }
+        }
+    }
+
+    void IRGenVisitor::ShortCircuitBinary(AST::BinaryOpExpr& node)
+    {
+        bool isAnd = node.op == AST::BinaryOp::LOGIC_AND;
+
+        IR::ValueId left = ToBool(Lower(*node.left));
+        IR::BlockId leftEnd = builder->GetInsertBlock();
+
+        IR::ValueId shortCircuit = builder->Const(IR::Type::I1, isAnd ? 0 : 1);
+
+        IR::BlockId rightBlock = builder->CreateBlock();
+        IR::BlockId endBlock = builder->CreateBlock();
+
+        if (isAnd)
+        {
+            builder->CondBr(left, rightBlock, endBlock);
+        }
+        else
+        {
+            builder->CondBr(left, endBlock, rightBlock);
+        }
+
+        builder->SetInsertBlock(rightBlock);
+        IR::ValueId right = ToBool(Lower(*node.right));
+        IR::BlockId rightEnd = builder->GetInsertBlock();
+        builder->Br(endBlock);
+
+        builder->SetInsertBlock(endBlock);
+        result = builder->ZExt(builder->Phi(IR::Type::I1, { { shortCircuit, leftEnd }, { right, rightEnd } }));
+    }
+
+    void IRGenVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
+    {
+        if (node.init != nullptr)
+        {
+            builder->Store(node.slot, Lower(*node.init));
+        }
+    }
+
+    void IRGenVisitor::VisitExprStmt(AST::ExprStmt& node)
+    {
+        Lower(*node.expr);
+    }
+
+    void IRGenVisitor::VisitVarExpr(AST::VarExpr& node)
+    {
+        result = builder->Load(node.slot);
+    }
+
+    void IRGenVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    {
+        int slot = static_cast<AST::VarExpr&>(*node.target).slot;
+
+        IR::ValueId value = Lower(*node.expr);
+
+        if (node.op != AST::AssignOp::SIMPLE_ASSIGN)
+        {
+            value = builder->Binary(AssignOpToOpcode(node.op), builder->Load(slot), value);
+        }
+
+        builder->Store(slot, value);
+        result = value;
+    }
+
+    IR::ValueId IRGenVisitor::ToBool(IR::ValueId value)
+    {
+        const IR::Instruction& inst = func->insts[value];
+
+        if (inst.op == IR::Opcode::ZEXT)
+        {
+            return inst.operands[0];
+        }
+
+        IR::ValueId zero = builder->Const(IR::Type::I32, 0);
+        return builder->ICmp(IR::Cond::NE, value, zero);
+    }
+
+    IR::Opcode IRGenVisitor::BinaryOpToOpcode(AST::BinaryOp op) const
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::ADD:                 return IR::Opcode::ADD;
+        case AST::BinaryOp::SUBSTRACT:           return IR::Opcode::SUB;
+        case AST::BinaryOp::MULTIPLY:            return IR::Opcode::MUL;
+        case AST::BinaryOp::DIVIDE:              return IR::Opcode::SDIV;
+        case AST::BinaryOp::MODULO:              return IR::Opcode::SREM;
+        case AST::BinaryOp::BITWISE_AND:         return IR::Opcode::AND;
+        case AST::BinaryOp::BITWISE_OR:          return IR::Opcode::OR;
+        case AST::BinaryOp::BITWISE_XOR:         return IR::Opcode::XOR;
+        case AST::BinaryOp::BITWISE_SHIFT_LEFT:  return IR::Opcode::SHL;
+        case AST::BinaryOp::BITWISE_SHIFT_RIGHT: return IR::Opcode::ASHR;
+        default:
+            Unreachable("BinaryOpToOpcode unreachable");
+            return IR::Opcode::ADD;
+        }
+    }
+
+    IR::Opcode IRGenVisitor::AssignOpToOpcode(AST::AssignOp op) const
+    {
+        switch (op)
+        {
+        case AST::AssignOp::ADD_ASSIGN:                 return IR::Opcode::ADD;
+        case AST::AssignOp::SUBSTRACT_ASSIGN:           return IR::Opcode::SUB;
+        case AST::AssignOp::MULTIPLY_ASSIGN:            return IR::Opcode::MUL;
+        case AST::AssignOp::DIVIDE_ASSIGN:              return IR::Opcode::SDIV;
+        case AST::AssignOp::MODULO_ASSIGN:              return IR::Opcode::SREM;
+        case AST::AssignOp::BITWISE_AND_ASSIGN:         return IR::Opcode::AND;
+        case AST::AssignOp::BITWISE_OR_ASSIGN:          return IR::Opcode::OR;
+        case AST::AssignOp::BITWISE_XOR_ASSIGN:         return IR::Opcode::XOR;
+        case AST::AssignOp::BITWISE_SHIFT_LEFT_ASSIGN:  return IR::Opcode::SHL;
+        case AST::AssignOp::BITWISE_SHIFT_RIGHT_ASSIGN: return IR::Opcode::ASHR;
+        default:
+            Unreachable("AssignOpToOpcode unreachable");
+            return IR::Opcode::ADD;
+        }
+    }
+
+    IR::Cond IRGenVisitor::BinaryOpToCond(AST::BinaryOp op) const
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::EQUAL:         return IR::Cond::EQ;
+        case AST::BinaryOp::NOT_EQUAL:     return IR::Cond::NE;
+        case AST::BinaryOp::LESS:          return IR::Cond::LT;
+        case AST::BinaryOp::LESS_EQUAL:    return IR::Cond::LE;
+        case AST::BinaryOp::GREATER:       return IR::Cond::GT;
+        case AST::BinaryOp::GREATER_EQUAL: return IR::Cond::GE;
+        default:
+            Unreachable("BinaryOpToCond unreachable");
+            return IR::Cond::EQ;
+        }
+    }
+} // namespace CComp
@@ -0,0 +1,55 @@
+#ifndef CCOMP_IR_GEN_VISITOR_HPP
+#define CCOMP_IR_GEN_VISITOR_HPP
+
+#include "../AST/Visitor.hpp"
+#include "../IR/IR.hpp"
+#include "../IR/Builder.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace CComp
+{
+    // Lowers a resolved AST to IR. Locals stay in their slots (load/store), only the
+    // values of && and || are merged with phis.
+    class IRGenVisitor : public AST::Visitor
+    {
+    public:
+        IRGenVisitor() = default;
+
+        IR::Module Lower(std::vector<std::unique_ptr<AST::Decl>>& ast);
+
+        virtual void VisitBasicType(AST::BasicType& node);
+        virtual void VisitTypeAndNameDecl(AST::TypeAndNameDecl& node);
+        virtual void VisitFunctionDecl(AST::FunctionDecl& node);
+        virtual void VisitIntegerNumberExpr(AST::IntegerNumberExpr& node);
+        virtual void VisitBlockStmt(AST::BlockStmt& node);
+        virtual void VisitReturnStmt(AST::ReturnStmt& node);
+        virtual void VisitUnaryOpExpr(AST::UnaryOpExpr& node);
+        virtual void VisitBinaryOpExpr(AST::BinaryOpExpr& node);
+        virtual void VisitVarDeclStmt(AST::VarDeclStmt& node);
+        virtual void VisitExprStmt(AST::ExprStmt& node);
+        virtual void VisitVarExpr(AST::VarExpr& node);
+        virtual void VisitAssignExpr(AST::AssignExpr& node);
+
+    private:
+        IR::Module module;
+        IR::Function* func = nullptr;
+        std::unique_ptr<IR::Builder> builder;
+
+        IR::ValueId result = IR::NO_VALUE;
+
+        IR::ValueId Lower(AST::Expr& expr);
+
+        // Turns an I32 value into an I1 truth value, reusing the comparison a ZEXT came from.
+        IR::ValueId ToBool(IR::ValueId value);
+
+        void ShortCircuitBinary(AST::BinaryOpExpr& node);
+
+        IR::Opcode BinaryOpToOpcode(AST::BinaryOp op) const;
+        IR::Opcode AssignOpToOpcode(AST::AssignOp op) const;
+        IR::Cond BinaryOpToCond(AST::BinaryOp op) const;
+    }; // class IRGenVisitor
+} // namespace CComp
+
+#endif // CCOMP_IR_GEN_VISITOR_HPP
@@ -0,0 +1,229 @@
+#include "SemanticVisitor.hpp"
+
+#include "../AST/AST.hpp"
+#include "../Reporter.hpp"
+
+namespace CComp
+{
+    void SemanticVisitor::Analyze(std::vector<std::unique_ptr<AST::Decl>>& ast)
+    {
+        for (auto& decl : ast)
+        {
+            decl->Accept(*this);
+        }
+    }
+
+    void SemanticVisitor::VisitBasicType(AST::BasicType& node)
+    {
+        if (node.name != "int")
+        {
+            Error(node.pos, "unknown type name '" + node.name + "'");
+        }
+    }
+
+    void SemanticVisitor::VisitTypeAndNameDecl(AST::TypeAndNameDecl& node)
+    {
+        CheckType(*node.type);
+    }
+
+    void SemanticVisitor::VisitFunctionDecl(AST::FunctionDecl& node)
+    {
+        for (const Symbol& function : functions)
+        {
+            if (function.name == node.name)
+            {
+                Error(node.pos, "redefinition of function '" + node.name + "'");
+                ReportNote(function.pos, "previous definition is here");
+                break;
+            }
+        }
+
+        functions.push_back({ node.name, -1, node.pos });
+
+        CheckType(*node.returnType);
+
+        slotCount = 0;
+
+        BeginScope();
+
+        for (auto& param : node.parameters)
+        {
+            param->Accept(*this);
+        }
+
+        node.body->Accept(*this);
+
+        EndScope();
+
+        node.slotCount = slotCount;
+    }
+
+    void SemanticVisitor::VisitIntegerNumberExpr(AST::IntegerNumberExpr& node)
+    {}
+
+    void SemanticVisitor::VisitBlockStmt(AST::BlockStmt& node)
+    {
+        BeginScope();
+
+        for (auto& stmt : node.stmts)
+        {
+            stmt->Accept(*this);
+        }
+
+        EndScope();
+    }
+
+    void SemanticVisitor::VisitReturnStmt(AST::ReturnStmt& node)
+    {
+        node.expr->Accept(*this);
+    }
+
+    void SemanticVisitor::VisitUnaryOpExpr(AST::UnaryOpExpr& node)
+    {
+        node.expr->Accept(*this);
+
+        switch (node.op)
+        {
+        case AST::UnaryOp::PRE_INCREMENT:
+        case AST::UnaryOp::PRE_DECREMENT:
+        case AST::UnaryOp::POST_INCREMENT:
+        case AST::UnaryOp::POST_DECREMENT:
+            CheckAssignable(*node.expr);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void SemanticVisitor::VisitBinaryOpExpr(AST::BinaryOpExpr& node)
+    {
+        node.left->Accept(*this);
+        node.right->Accept(*this);
+    }
+
+    void SemanticVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
+    {
+        CheckType(*node.type);
+
+        const Symbol* previous = FindInCurrentScope(node.name);
+        if (previous != nullptr)
+        {
+            Error(node.pos, "redefinition of variable '" + node.name + "'");
+            ReportNote(previous->pos, "previous definition is here");
+        }
+
+        // Slots are never reused inside a function, so they follow declaration order.
+        node.slot = static_cast<int>(slotCount++);
+        Declare({ node.name, node.slot, node.pos });
+
+        if (node.init != nullptr)
+        {
+            node.init->Accept(*this);
+        }
+    }
+
+    void SemanticVisitor::VisitExprStmt(AST::ExprStmt& node)
+    {
+        node.expr->Accept(*this);
+    }
+
+    void SemanticVisitor::VisitVarExpr(AST::VarExpr& node)
+    {
+        const Symbol* symbol = Find(node.name);
+        if (symbol == nullptr)
+        {
+            Error(node.pos, "undefined variable '" + node.name + "'");
+            return;
+        }
+
+        node.slot = symbol->slot;
+    }
+
+    void SemanticVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    {
+        node.target->Accept(*this);
+        node.expr->Accept(*this);
+
+        CheckAssignable(*node.target);
+    }
+
+    void SemanticVisitor::BeginScope()
+    {
+        scopeStarts.push_back(symbols.size());
+    }
+
+    void SemanticVisitor::EndScope()
+    {
+        while (symbols.size() > scopeStarts.back())
+        {
+            const Symbol& symbol = symbols.back();
+
+            if (symbol.shadowed == gc_NoSymbol)
+            {
+                innermost.erase(symbol.name);
+            }
+            else
+            {
+                innermost[symbol.name] = symbol.shadowed;
+            }
+
+            symbols.pop_back();
+        }
+
+        scopeStarts.pop_back();
+    }
+
+    void SemanticVisitor::Declare(Symbol symbol)
+    {
+        auto [found, inserted] = innermost.try_emplace(symbol.name, symbols.size());
+        if (!inserted)
+        {
+            symbol.shadowed = found->second;
+            found->second = symbols.size();
+        }
+
+        symbols.push_back(std::move(symbol));
+    }
+
+    const SemanticVisitor::Symbol* SemanticVisitor::FindInCurrentScope(const std::string& name) const
+    {
+        auto found = innermost.find(name);
+        if (found == innermost.end() || found->second < scopeStarts.back())
+        {
+            return nullptr;
+        }
+
+        return &symbols[found->second];
+    }
+
+    const SemanticVisitor::Symbol* SemanticVisitor::Find(const std::string& name) const
+    {
+        auto found = innermost.find(name);
+        if (found == innermost.end())
+        {
+            return nullptr;
+        }
+
+        return &symbols[found->second];
+    }
+
+    void SemanticVisitor::CheckType(AST::Type& type)
+    {
+        type.Accept(*this);
+    }
+
+    void SemanticVisitor::CheckAssignable(AST::Expr& expr)
+    {
+        if (dynamic_cast<AST::VarExpr*>(&expr) == nullptr)
+        {
+            Error(expr.pos, "expression is not assignable");
+        }
+    }
+
+    void SemanticVisitor::Error(FilePosition pos, const std::string& msg)
+    {
+        ReportError(pos, msg);
+        hadError = true;
+    }
+} // namespace CComp
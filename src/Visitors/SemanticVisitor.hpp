@@ -0,0 +1,81 @@
+#ifndef CCOMP_SEMANTIC_VISITOR_HPP
+#define CCOMP_SEMANTIC_VISITOR_HPP
+
+#include "../AST/Visitor.hpp"
+#include "../File/FilePosition.hpp"
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+namespace CComp
+{
+    // Resolves every variable to a frame slot and checks the program before code generation.
+    // Scopes are kept in one flat vector of symbols; a scope is the range starting at its entry in m_ScopeStarts.
+    // A map from each name to its innermost symbol makes lookups constant time; symbols remember
+    // the one they shadow, which the map points to again once their scope ends.
+    class SemanticVisitor : public AST::Visitor
+    {
+    public:
+        SemanticVisitor() = default;
+
+        void Analyze(std::vector<std::unique_ptr<AST::Decl>>& ast);
+
+        bool HadError() const
+        { return hadError; }
+
+        virtual void VisitBasicType(AST::BasicType& node);
+        virtual void VisitTypeAndNameDecl(AST::TypeAndNameDecl& node);
+        virtual void VisitFunctionDecl(AST::FunctionDecl& node);
+        virtual void VisitIntegerNumberExpr(AST::IntegerNumberExpr& node);
+        virtual void VisitBlockStmt(AST::BlockStmt& node);
+        virtual void VisitReturnStmt(AST::ReturnStmt& node);
+        virtual void VisitUnaryOpExpr(AST::UnaryOpExpr& node);
+        virtual void VisitBinaryOpExpr(AST::BinaryOpExpr& node);
+        virtual void VisitVarDeclStmt(AST::VarDeclStmt& node);
+        virtual void VisitExprStmt(AST::ExprStmt& node);
+        virtual void VisitVarExpr(AST::VarExpr& node);
+        virtual void VisitAssignExpr(AST::AssignExpr& node);
+
+    private:
+        bool hadError = false;
+
+        static constexpr size_t gc_NoSymbol = SIZE_MAX;
+
+        struct Symbol
+        {
+            std::string name;
+            int slot;
+            FilePosition pos;
+
+            // Index in symbols of the symbol of the same name this one hides, or gc_NoSymbol.
+            size_t shadowed = gc_NoSymbol;
+        }; // struct Symbol
+
+        std::vector<Symbol> symbols;
+        std::vector<size_t> scopeStarts;
+
+        // Index in symbols of the innermost symbol of each name in scope.
+        std::unordered_map<std::string, size_t> innermost;
+
+        std::vector<Symbol> functions;
+
+        size_t slotCount = 0;
+
+        void BeginScope();
+        void EndScope();
+        void Declare(Symbol symbol);
+
+        const Symbol* FindInCurrentScope(const std::string& name) const;
+        const Symbol* Find(const std::string& name) const;
+
+        void CheckType(AST::Type& type);
+        void CheckAssignable(AST::Expr& expr);
+
+        void Error(FilePosition pos, const std::string& msg);
+    }; // class SemanticVisitor
+} // namespace CComp
+
+#endif // CCOMP_SEMANTIC_VISITOR_HPP
@@ -0,0 +1,717 @@
+#include "X64CodeGenVisitor.hpp"
+
+#include "../AllocationCounter.hpp"
+#include "../AST/AST.hpp"
+#include "../Backend/FrameLayout.hpp"
+#include "../Backend/StrengthReduction.hpp"
+#include "../Reporter.hpp"
+#include "../Statistics.hpp"
+#include "../ThreadPool.hpp"
+#include "../TimeReport.hpp"
+#include "../Trace.hpp"
+#include "../Unreachable.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace CComp
+{
+    using Asm::Opcode;
+    using Asm::Register;
+    using Asm::Reg;
+    using Asm::Imm;
+    using Asm::Mem;
+
+    namespace
+    {
+        // %ecx and %edx stay free for shift counts, cdq and the strength-reduced sequences.
+        // Caller-saved registers come first, as they cost no save in the prologue.
+        const Register gc_Temporaries[] = {
+            Register::ESI, Register::EDI, Register::R8, Register::R9, Register::R10, Register::R11,
+            Register::EBX, Register::R12, Register::R13, Register::R14, Register::R15,
+        };
+
+        constexpr size_t gc_TemporaryRegisterCount = sizeof(gc_Temporaries) / sizeof(gc_Temporaries[0]);
+
+        const Register gc_CalleeSavedOrder[] = {
+            Register::EBX, Register::R12, Register::R13, Register::R14, Register::R15,
+        };
+
+        constexpr int32_t gc_SysExit = 60;
+    } // namespace
+
+    X64CodeGenVisitor::X64CodeGenVisitor(std::vector<Asm::Instruction>& out, bool useRedZone)
+        : out(out), useRedZone(useRedZone)
+    {}
+
+    void X64CodeGenVisitor::Emit(Asm::Opcode op, Asm::Operand a, Asm::Operand b)
+    {
+        out.emplace_back(op, a, b);
+    }
+
+    void X64CodeGenVisitor::Emit(Asm::Opcode op, const std::string& label)
+    {
+        out.emplace_back(op, label);
+    }
+
+    void X64CodeGenVisitor::EmitJump(Asm::Cond cond, const std::string& label)
+    {
+        out.emplace_back(Opcode::JCC, cond, label);
+    }
+
+    void X64CodeGenVisitor::EmitSet(Asm::Cond cond)
+    {
+        Asm::Instruction set(Opcode::SETCC, Asm::ByteReg(Register::EAX));
+        set.cond = cond;
+        out.push_back(set);
+    }
+
+    void X64CodeGenVisitor::Compile(std::vector<std::unique_ptr<AST::Decl>>& ast, size_t jobs)
+    {
+        ScopedTimer timer(TimedPhase::CODEGEN);
+        ScopedMemoryCategory memory(MemoryCategory::CODEGEN);
+
+        MakeHeader();
+
+        std::vector<std::vector<Asm::Instruction>> functions(ast.size());
+        std::vector<char> errors(ast.size(), false);
+
+        ParallelFor(ast.size(), jobs, [&](size_t i)
+        {
+            X64CodeGenVisitor vis(functions[i], useRedZone);
+
+            ast[i]->Accept(vis);
+            errors[i] = vis.HadError();
+        });
+
+        for (size_t i = 0; i < ast.size(); i++)
+        {
+            out.insert(out.end(), std::make_move_iterator(functions[i].begin()), std::make_move_iterator(functions[i].end()));
+            hadError = hadError || errors[i];
+        }
+
+        MakeFooter();
+    }
+
+    void X64CodeGenVisitor::MakeHeader()
+    {
+        Emit(Opcode::COMMENT, "Compiled using InAnYan first C compiler v0.1.");
+        Emit(Opcode::BLANK);
+        Emit(Opcode::GLOBL, "_start");
+        Emit(Opcode::LABEL, "_start");
+        Emit(Opcode::CALL, "main");
+        Emit(Opcode::MOV, Reg(Register::EAX), Reg(Register::EDI));
+        Emit(Opcode::MOV, Imm(gc_SysExit), Reg(Register::EAX));
+        Emit(Opcode::SYSCALL);
+        Emit(Opcode::BLANK);
+    }
+
+    void X64CodeGenVisitor::MakeFooter()
+    {
+        Emit(Opcode::COMMENT, "End of compiling.");
+    }
+
+    void X64CodeGenVisitor::VisitBasicType(AST::BasicType& node)
+    {}
+
+    void X64CodeGenVisitor::VisitTypeAndNameDecl(AST::TypeAndNameDecl& node)
+    {}
+
+    void X64CodeGenVisitor::VisitFunctionDecl(AST::FunctionDecl& node)
+    {
+        TraceSpan span("codegen", node.name);
+        ScopedMemoryCategory memory(MemoryCategory::CODEGEN);
+
+        Emit(Opcode::GLOBL, node.name);
+        Emit(Opcode::LABEL, node.name);
+
+        size_t bodyStart = out.size();
+
+        slotCount = node.slotCount;
+        temporaryCount = 0;
+        spillCount = 0;
+
+        functionName = node.name;
+        labelCount = 0;
+
+        returnLabel = ".L" + node.name + "_return";
+        returnJumps = 0;
+        terminated = false;
+
+        node.body->Accept(*this);
+
+        if (!terminated)
+        {
+            // Falling off the end returns 0, as main does.
+            Emit(Opcode::MOV, Imm(0), Reg(Register::EAX));
+        }
+        else if (out.back().op == Opcode::JMP && out.back().label == returnLabel)
+        {
+            // The last return falls through into the epilogue.
+            out.pop_back();
+            returnJumps--;
+        }
+
+        if (returnJumps != 0)
+        {
+            Emit(Opcode::LABEL, returnLabel);
+        }
+
+        std::vector<Register> savedRegisters;
+        for (Register reg : gc_CalleeSavedOrder)
+        {
+            if (UsesRegister(bodyStart, reg))
+            {
+                savedRegisters.push_back(reg);
+            }
+        }
+
+        // Nothing below %rsp survives a call, so only leaf functions may use the red zone.
+        FrameLayout frame(slotCount + spillCount, std::move(savedRegisters), Asm::Target::X86_64,
+                          useRedZone && !HasCalls(bodyStart));
+
+        if (frame.UsesRedZone() && slotCount + spillCount != 0)
+        {
+            for (size_t i = bodyStart; i < out.size(); i++)
+            {
+                for (Asm::Operand& operand : out[i].operands)
+                {
+                    if (operand.kind == Asm::OperandKind::MEM && operand.reg == Register::EBP)
+                    {
+                        operand.reg = frame.GetSlotBase();
+                    }
+                }
+            }
+
+            AddStatistic("codegen", "frames kept in the red zone", 1);
+        }
+
+        std::vector<Asm::Instruction> prolog;
+        frame.EmitProlog(prolog);
+        out.insert(out.begin() + bodyStart, prolog.begin(), prolog.end());
+
+        frame.EmitEpilog(out);
+        Emit(Opcode::RET);
+        Emit(Opcode::BLANK);
+    }
+
+    void X64CodeGenVisitor::VisitIntegerNumberExpr(AST::IntegerNumberExpr& node)
+    {
+        Emit(Opcode::MOV, Imm(node.GetValue()), Reg(Register::EAX));
+    }
+
+    void X64CodeGenVisitor::VisitBlockStmt(AST::BlockStmt& node)
+    {
+        for (size_t i = 0; i < node.stmts.size(); i++)
+        {
+            if (terminated)
+            {
+                AddStatistic("codegen", "unreachable statements removed", static_cast<long long>(node.stmts.size() - i));
+                break;
+            }
+
+            node.stmts[i]->Accept(*this);
+        }
+    }
+
+    void X64CodeGenVisitor::VisitReturnStmt(AST::ReturnStmt& node)
+    {
+        node.expr->Accept(*this);
+
+        Emit(Opcode::JMP, returnLabel);
+        returnJumps++;
+        terminated = true;
+    }
+
+    void X64CodeGenVisitor::VisitUnaryOpExpr(AST::UnaryOpExpr& node)
+    {
+        if (node.op == AST::UnaryOp::NOT)
+        {
+            MaterializeCondition(node);
+            return;
+        }
+
+        node.expr->Accept(*this);
+
+        switch (node.op)
+        {
+        case AST::UnaryOp::NEGATION:
+            Emit(Opcode::NEG, Reg(Register::EAX));
+            return;
+        case AST::UnaryOp::BITWISE_COMPLEMENT:
+            Emit(Opcode::NOT, Reg(Register::EAX));
+            return;
+
+        default:
+            break;
+        }
+
+        Asm::Operand var = Mem(Register::EBP, GetVarOffset(node.expr));
+        Emit(Opcode::MOV, var, Reg(Register::EAX));
+
+        switch (node.op)
+        {
+        case AST::UnaryOp::PRE_INCREMENT:
+            Emit(Opcode::INC, Reg(Register::EAX));
+            Emit(Opcode::MOV, Reg(Register::EAX), var);
+            break;
+        case AST::UnaryOp::PRE_DECREMENT:
+            Emit(Opcode::DEC, Reg(Register::EAX));
+            Emit(Opcode::MOV, Reg(Register::EAX), var);
+            break;
+
+        case AST::UnaryOp::POST_INCREMENT:
+            Emit(Opcode::ADD, Imm(1), var);
+            break;
+        case AST::UnaryOp::POST_DECREMENT:
+            Emit(Opcode::SUB, Imm(1), var);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void X64CodeGenVisitor::VisitBinaryOpExpr(AST::BinaryOpExpr& node)
+    {
+        if (node.op == AST::BinaryOp::COMMA)
+        {
+            node.left->Accept(*this);
+            node.right->Accept(*this);
+        }
+        else if (node.op == AST::BinaryOp::LOGIC_OR
+            || node.op == AST::BinaryOp::LOGIC_AND
+            || IsComparison(node.op))
+        {
+            MaterializeCondition(node);
+        }
+        else
+        {
+            SimpleBinary(node);
+        }
+    }
+
+    Asm::Operand X64CodeGenVisitor::PushTemporary()
+    {
+        size_t index = temporaryCount++;
+
+        if (index < gc_TemporaryRegisterCount)
+        {
+            return Reg(gc_Temporaries[index]);
+        }
+
+        size_t spill = index - gc_TemporaryRegisterCount;
+        spillCount = std::max(spillCount, spill + 1);
+
+        AddStatistic("codegen", "temporaries spilled", 1);
+        return Mem(Register::EBP, GetSlotOffset(slotCount + spill));
+    }
+
+    void X64CodeGenVisitor::PopTemporary()
+    {
+        temporaryCount--;
+    }
+
+    void X64CodeGenVisitor::SimpleBinary(AST::BinaryOpExpr& node)
+    {
+        int32_t constant = 0;
+
+        if (IsReducibleConstant(node.op, *node.right, constant))
+        {
+            node.left->Accept(*this);
+            BinaryByConstant(node.op, constant);
+            return;
+        }
+
+        // A constant has no side effects, so only the other operand needs evaluating.
+        if (node.op == AST::BinaryOp::MULTIPLY && IsReducibleConstant(node.op, *node.left, constant))
+        {
+            node.right->Accept(*this);
+            BinaryByConstant(node.op, constant);
+            return;
+        }
+
+        node.right->Accept(*this);
+
+        Asm::Operand right = PushTemporary();
+        Emit(Opcode::MOV, Reg(Register::EAX), right);
+
+        node.left->Accept(*this);
+        SimpleBinaryOnEax(node.op, right);
+
+        PopTemporary();
+    }
+
+    void X64CodeGenVisitor::SimpleBinaryOnEax(AST::BinaryOp op, Asm::Operand other)
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::ADD:
+            Emit(Opcode::ADD, other, Reg(Register::EAX));
+            break;
+        case AST::BinaryOp::SUBSTRACT:
+            Emit(Opcode::SUB, other, Reg(Register::EAX));
+            break;
+        case AST::BinaryOp::MULTIPLY:
+            Emit(Opcode::IMUL, other, Reg(Register::EAX));
+            break;
+        case AST::BinaryOp::DIVIDE:
+            Emit(Opcode::CDQ);
+            Emit(Opcode::IDIV, other);
+            break;
+        case AST::BinaryOp::MODULO:
+            Emit(Opcode::CDQ);
+            Emit(Opcode::IDIV, other);
+            Emit(Opcode::MOV, Reg(Register::EDX), Reg(Register::EAX));
+            break;
+
+        case AST::BinaryOp::BITWISE_AND:
+            Emit(Opcode::AND, other, Reg(Register::EAX));
+            break;
+        case AST::BinaryOp::BITWISE_XOR:
+            Emit(Opcode::XOR, other, Reg(Register::EAX));
+            break;
+        case AST::BinaryOp::BITWISE_OR:
+            Emit(Opcode::OR, other, Reg(Register::EAX));
+            break;
+
+        case AST::BinaryOp::BITWISE_SHIFT_LEFT:
+            Emit(Opcode::MOV, other, Reg(Register::ECX));
+            Emit(Opcode::SAL, Asm::ByteReg(Register::ECX), Reg(Register::EAX));
+            break;
+        case AST::BinaryOp::BITWISE_SHIFT_RIGHT:
+            Emit(Opcode::MOV, other, Reg(Register::ECX));
+            Emit(Opcode::SAR, Asm::ByteReg(Register::ECX), Reg(Register::EAX));
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    bool X64CodeGenVisitor::IsReducibleConstant(AST::BinaryOp op, AST::Expr& expr, int32_t& value) const
+    {
+        auto number = dynamic_cast<AST::IntegerNumberExpr*>(&expr);
+        if (number == nullptr)
+        {
+            return false;
+        }
+
+        value = number->GetValue();
+
+        switch (op)
+        {
+        case AST::BinaryOp::MULTIPLY:
+            return true;
+
+        // Division by a literal zero keeps its idivl and traps at run time.
+        case AST::BinaryOp::DIVIDE:
+        case AST::BinaryOp::MODULO:
+            return value != 0;
+
+        default:
+            return false;
+        }
+    }
+
+    void X64CodeGenVisitor::BinaryByConstant(AST::BinaryOp op, int32_t value)
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::MULTIPLY:
+            if (!EmitMultiplyByConstant(out, Register::EAX, value, Register::ECX))
+            {
+                Emit(Opcode::IMUL, Imm(value), Reg(Register::EAX));
+            }
+            break;
+        case AST::BinaryOp::DIVIDE:
+            EmitDivideByConstant(out, value);
+            break;
+        case AST::BinaryOp::MODULO:
+            EmitRemainderByConstant(out, value);
+            break;
+
+        default:
+            Unreachable("X64CodeGenVisitor::BinaryByConstant unreachable");
+            break;
+        }
+
+        AddStatistic("codegen", "operations by constants strength-reduced", 1);
+    }
+
+    bool X64CodeGenVisitor::IsComparison(AST::BinaryOp op) const
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::EQUAL:
+        case AST::BinaryOp::NOT_EQUAL:
+        case AST::BinaryOp::GREATER:
+        case AST::BinaryOp::GREATER_EQUAL:
+        case AST::BinaryOp::LESS:
+        case AST::BinaryOp::LESS_EQUAL:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    Asm::Cond X64CodeGenVisitor::ComparisonToCond(AST::BinaryOp op) const
+    {
+        switch (op)
+        {
+        case AST::BinaryOp::EQUAL:         return Asm::Cond::E;
+        case AST::BinaryOp::NOT_EQUAL:     return Asm::Cond::NE;
+        case AST::BinaryOp::GREATER:       return Asm::Cond::G;
+        case AST::BinaryOp::GREATER_EQUAL: return Asm::Cond::GE;
+        case AST::BinaryOp::LESS:          return Asm::Cond::L;
+        case AST::BinaryOp::LESS_EQUAL:    return Asm::Cond::LE;
+
+        default:
+            Unreachable("ComparisonToCond unreachable");
+            return Asm::Cond::E;
+        }
+    }
+
+    bool X64CodeGenVisitor::NeedsBranches(AST::Expr& expr) const
+    {
+        if (auto binary = dynamic_cast<AST::BinaryOpExpr*>(&expr))
+        {
+            return binary->op == AST::BinaryOp::LOGIC_AND || binary->op == AST::BinaryOp::LOGIC_OR;
+        }
+
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr))
+        {
+            return unary->op == AST::UnaryOp::NOT && NeedsBranches(*unary->expr);
+        }
+
+        return false;
+    }
+
+    Asm::Cond X64CodeGenVisitor::EmitFlags(AST::Expr& expr)
+    {
+        if (auto binary = dynamic_cast<AST::BinaryOpExpr*>(&expr); binary != nullptr && IsComparison(binary->op))
+        {
+            auto number = dynamic_cast<AST::IntegerNumberExpr*>(binary->right.get());
+
+            if (number != nullptr)
+            {
+                binary->left->Accept(*this);
+                Emit(Opcode::CMP, Imm(number->GetValue()), Reg(Register::EAX));
+            }
+            else
+            {
+                binary->right->Accept(*this);
+
+                Asm::Operand right = PushTemporary();
+                Emit(Opcode::MOV, Reg(Register::EAX), right);
+
+                binary->left->Accept(*this);
+                Emit(Opcode::CMP, right, Reg(Register::EAX));
+
+                PopTemporary();
+            }
+
+            return ComparisonToCond(binary->op);
+        }
+
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr); unary != nullptr && unary->op == AST::UnaryOp::NOT)
+        {
+            return Asm::InvertCond(EmitFlags(*unary->expr));
+        }
+
+        expr.Accept(*this);
+        Emit(Opcode::CMP, Imm(0), Reg(Register::EAX));
+        return Asm::Cond::NE;
+    }
+
+    void X64CodeGenVisitor::EmitBranch(AST::Expr& expr, bool jumpIfTrue, const std::string& target)
+    {
+        if (auto binary = dynamic_cast<AST::BinaryOpExpr*>(&expr);
+            binary != nullptr && (binary->op == AST::BinaryOp::LOGIC_AND || binary->op == AST::BinaryOp::LOGIC_OR))
+        {
+            bool isAnd = binary->op == AST::BinaryOp::LOGIC_AND;
+
+            if (jumpIfTrue != isAnd)
+            {
+                EmitBranch(*binary->left, jumpIfTrue, target);
+                EmitBranch(*binary->right, jumpIfTrue, target);
+            }
+            else
+            {
+                std::string skip = GenerateUniqueLabel();
+
+                EmitBranch(*binary->left, !jumpIfTrue, skip);
+                EmitBranch(*binary->right, jumpIfTrue, target);
+                Emit(Opcode::LABEL, skip);
+            }
+            return;
+        }
+
+        if (auto unary = dynamic_cast<AST::UnaryOpExpr*>(&expr); unary != nullptr && unary->op == AST::UnaryOp::NOT)
+        {
+            EmitBranch(*unary->expr, !jumpIfTrue, target);
+            return;
+        }
+
+        if (auto number = dynamic_cast<AST::IntegerNumberExpr*>(&expr))
+        {
+            if ((number->GetValue() != 0) == jumpIfTrue)
+            {
+                Emit(Opcode::JMP, target);
+            }
+            return;
+        }
+
+        Asm::Cond cond = EmitFlags(expr);
+        EmitJump(jumpIfTrue ? cond : Asm::InvertCond(cond), target);
+    }
+
+    void X64CodeGenVisitor::MaterializeCondition(AST::Expr& expr)
+    {
+        if (!NeedsBranches(expr))
+        {
+            EmitSet(EmitFlags(expr));
+            Emit(Opcode::MOVZB, Asm::ByteReg(Register::EAX), Reg(Register::EAX));
+            return;
+        }
+
+        std::string labelFalse = GenerateUniqueLabel();
+        std::string labelEnd = GenerateUniqueLabel();
+
+        EmitBranch(expr, false, labelFalse);
+        Emit(Opcode::MOV, Imm(1), Reg(Register::EAX));
+        Emit(Opcode::JMP, labelEnd);
+
+        Emit(Opcode::LABEL, labelFalse);
+        Emit(Opcode::MOV, Imm(0), Reg(Register::EAX));
+
+        Emit(Opcode::LABEL, labelEnd);
+    }
+
+    void X64CodeGenVisitor::VisitAssignExpr(AST::AssignExpr& node)
+    {
+        Asm::Operand var = Mem(Register::EBP, GetVarOffset(node.target));
+
+        int32_t constant = 0;
+
+        if (node.op != AST::AssignOp::SIMPLE_ASSIGN
+            && IsReducibleConstant(AssignOpToBinaryOp(node.op), *node.expr, constant))
+        {
+            Emit(Opcode::MOV, var, Reg(Register::EAX));
+            BinaryByConstant(AssignOpToBinaryOp(node.op), constant);
+            Emit(Opcode::MOV, Reg(Register::EAX), var);
+            return;
+        }
+
+        node.expr->Accept(*this);
+
+        if (node.op != AST::AssignOp::SIMPLE_ASSIGN)
+        {
+            Asm::Operand right = PushTemporary();
+            Emit(Opcode::MOV, Reg(Register::EAX), right);
+
+            Emit(Opcode::MOV, var, Reg(Register::EAX));
+            SimpleBinaryOnEax(AssignOpToBinaryOp(node.op), right);
+
+            PopTemporary();
+        }
+
+        Emit(Opcode::MOV, Reg(Register::EAX), var);
+    }
+
+    AST::BinaryOp X64CodeGenVisitor::AssignOpToBinaryOp(AST::AssignOp op) const
+    {
+        switch (op)
+        {
+        case AST::AssignOp::ADD_ASSIGN:       return AST::BinaryOp::ADD;
+        case AST::AssignOp::SUBSTRACT_ASSIGN: return AST::BinaryOp::SUBSTRACT;
+        case AST::AssignOp::MULTIPLY_ASSIGN:  return AST::BinaryOp::MULTIPLY;
+        case AST::AssignOp::DIVIDE_ASSIGN:    return AST::BinaryOp::DIVIDE;
+        case AST::AssignOp::MODULO_ASSIGN:    return AST::BinaryOp::MODULO;
+
+        case AST::AssignOp::BITWISE_OR_ASSIGN:  return AST::BinaryOp::BITWISE_OR;
+        case AST::AssignOp::BITWISE_XOR_ASSIGN: return AST::BinaryOp::BITWISE_XOR;
+        case AST::AssignOp::BITWISE_AND_ASSIGN: return AST::BinaryOp::BITWISE_AND;
+
+        case AST::AssignOp::BITWISE_SHIFT_LEFT_ASSIGN:  return AST::BinaryOp::BITWISE_SHIFT_LEFT;
+        case AST::AssignOp::BITWISE_SHIFT_RIGHT_ASSIGN: return AST::BinaryOp::BITWISE_SHIFT_RIGHT;
+
+        default:
+            Unreachable("AssignToBinaryOp unreachable");
+            return AST::BinaryOp::DIVIDE;
+        }
+    }
+
+    std::string X64CodeGenVisitor::GenerateUniqueLabel()
+    {
+        return ".L" + functionName + "_" + std::to_string(labelCount++);
+    }
+
+    bool X64CodeGenVisitor::UsesRegister(size_t from, Asm::Register reg) const
+    {
+        for (size_t i = from; i < out.size(); i++)
+        {
+            Asm::Effects effects = Asm::GetEffects(out[i]);
+
+            if ((effects.reads | effects.writes) & Asm::MaskOf(reg))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool X64CodeGenVisitor::HasCalls(size_t from) const
+    {
+        for (size_t i = from; i < out.size(); i++)
+        {
+            if (out[i].op == Opcode::CALL)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    int X64CodeGenVisitor::GetSlotOffset(size_t slot) const
+    {
+        return FrameLayout::GetSlotOffset(slot);
+    }
+
+    int X64CodeGenVisitor::GetVarOffset(std::unique_ptr<AST::Expr>& node) const
+    {
+        // SemanticVisitor guarantees that assignment targets are resolved variables.
+        AST::VarExpr* var = dynamic_cast<AST::VarExpr*>(node.get());
+        if (var == nullptr)
+        {
+            Unreachable("GetVarOffset on a non-variable expression");
+            return 0;
+        }
+
+        return GetSlotOffset(static_cast<size_t>(var->slot));
+    }
+
+    void X64CodeGenVisitor::VisitVarDeclStmt(AST::VarDeclStmt& node)
+    {
+        // The slot itself was reserved by the prologue, or lies in the red zone.
+        if (node.init != nullptr)
+        {
+            node.init->Accept(*this);
+            Emit(Opcode::MOV, Reg(Register::EAX), Mem(Register::EBP, GetSlotOffset(static_cast<size_t>(node.slot))));
+        }
+    }
+
+    void X64CodeGenVisitor::VisitExprStmt(AST::ExprStmt& node)
+    {
+        node.expr->Accept(*this);
+    }
+
+    void X64CodeGenVisitor::VisitVarExpr(AST::VarExpr& node)
+    {
+        Emit(Opcode::MOV, Mem(Register::EBP, GetSlotOffset(static_cast<size_t>(node.slot))), Reg(Register::EAX));
+    }
+
+} // namespace CComp
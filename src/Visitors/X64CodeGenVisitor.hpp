@@ -0,0 +1,95 @@
+#ifndef CCOMP_X64_CODE_GEN_VISITOR_HPP
+#define CCOMP_X64_CODE_GEN_VISITOR_HPP
+
+#include "../AST/Visitor.hpp"
+#include "../Asm/Asm.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace CComp
+{
+    // The x86-64 System V counterpart of CodeGenVisitor. Values are still computed in %eax,
+    // but operands waiting for the other side of a binary expression are kept in the
+    // extra registers rather than pushed, so the body never moves %rsp.
+    class X64CodeGenVisitor : public AST::Visitor
+    {
+    public:
+        X64CodeGenVisitor(std::vector<Asm::Instruction>& out, bool useRedZone = true);
+
+        // Generates functions in parallel, as CodeGenVisitor::Compile does.
+        void Compile(std::vector<std::unique_ptr<AST::Decl>>& ast, size_t jobs = 1);
+
+        bool HadError() const
+        { return hadError; }
+
+        virtual void VisitBasicType(AST::BasicType& node);
+        virtual void VisitTypeAndNameDecl(AST::TypeAndNameDecl& node);
+        virtual void VisitFunctionDecl(AST::FunctionDecl& node);
+        virtual void VisitIntegerNumberExpr(AST::IntegerNumberExpr& node);
+        virtual void VisitBlockStmt(AST::BlockStmt& node);
+        virtual void VisitReturnStmt(AST::ReturnStmt& node);
+        virtual void VisitUnaryOpExpr(AST::UnaryOpExpr& node);
+        virtual void VisitBinaryOpExpr(AST::BinaryOpExpr& node);
+        virtual void VisitVarDeclStmt(AST::VarDeclStmt& node);
+        virtual void VisitExprStmt(AST::ExprStmt& node);
+        virtual void VisitVarExpr(AST::VarExpr& node);
+        virtual void VisitAssignExpr(AST::AssignExpr& node);
+
+    private:
+        bool hadError = false;
+        std::vector<Asm::Instruction>& out;
+        bool useRedZone;
+
+        // Slots are addressed from %rbp while the body is generated and moved onto
+        // %rsp afterwards if the function ends up keeping them in the red zone.
+        int GetSlotOffset(size_t slot) const;
+        int GetVarOffset(std::unique_ptr<AST::Expr>& node) const;
+
+        // Whether code emitted since from touches reg; decides which callee-saved registers are saved.
+        bool UsesRegister(size_t from, Asm::Register reg) const;
+        bool HasCalls(size_t from) const;
+
+        void Emit(Asm::Opcode op, Asm::Operand a = Asm::Operand(), Asm::Operand b = Asm::Operand());
+        void Emit(Asm::Opcode op, const std::string& label);
+        void EmitJump(Asm::Cond cond, const std::string& label);
+        void EmitSet(Asm::Cond cond);
+
+        void MakeHeader();
+        void MakeFooter();
+
+        // Temporaries go to the next free register, and to slots past the locals once
+        // those run out. They are released in the reverse order.
+        size_t slotCount = 0;
+        size_t temporaryCount = 0;
+        size_t spillCount = 0;
+        Asm::Operand PushTemporary();
+        void PopTemporary();
+
+        void SimpleBinary(AST::BinaryOpExpr& node);
+        void SimpleBinaryOnEax(AST::BinaryOp op, Asm::Operand other);
+
+        bool IsComparison(AST::BinaryOp op) const;
+        Asm::Cond ComparisonToCond(AST::BinaryOp op) const;
+        bool NeedsBranches(AST::Expr& expr) const;
+        Asm::Cond EmitFlags(AST::Expr& expr);
+        void EmitBranch(AST::Expr& expr, bool jumpIfTrue, const std::string& target);
+        void MaterializeCondition(AST::Expr& expr);
+
+        bool IsReducibleConstant(AST::BinaryOp op, AST::Expr& expr, int32_t& value) const;
+        void BinaryByConstant(AST::BinaryOp op, int32_t value);
+
+        std::string returnLabel;
+        size_t returnJumps = 0;
+        bool terminated = false;
+
+        // Labels are numbered per function, as in CodeGenVisitor.
+        std::string functionName;
+        size_t labelCount = 0;
+        std::string GenerateUniqueLabel();
+
+        AST::BinaryOp AssignOpToBinaryOp(AST::AssignOp op) const;
+    }; // class X64CodeGenVisitor
+} // namespace CComp
+
+#endif // CCOMP_X64_CODE_GEN_VISITOR_HPP
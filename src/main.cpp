@@ -1,54 +1,593 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <functional>
 
+#include <unistd.h>
+
+#include "AllocationCounter.hpp"
 #include "ArgParser.hpp"
+#include "PassManager.hpp"
+#include "Reporter.hpp"
+#include "Server.hpp"
+#include "File/FileCache.hpp"
+#include "File/OutputBuffer.hpp"
 #include "File/Reader.hpp"
 
 #include "Scanner.hpp"
 #include "Parser.hpp"
 
+#include "Visitors/SemanticVisitor.hpp"
+#include "Visitors/ConstantFoldVisitor.hpp"
 #include "Visitors/CodeGenVisitor.hpp"
+#include "Visitors/X64CodeGenVisitor.hpp"
+#include "Visitors/IRGenVisitor.hpp"
+#include "Visitors/BytecodeGenVisitor.hpp"
+#include "Visitors/DebugPrintVisitor.hpp"
+#include "Visitors/EvalVisitor.hpp"
 
-int main(int argc, char* argv[])
+#include "IR/Mem2Reg.hpp"
+#include "IR/Printer.hpp"
+#include "IR/ValueNumbering.hpp"
+#include "IR/Verifier.hpp"
+#include "Backend/X86Backend.hpp"
+#include "Asm/ElfWriter.hpp"
+#include "Asm/Encoder.hpp"
+#include "Asm/Jit.hpp"
+#include "Asm/Peephole.hpp"
+#include "Asm/Printer.hpp"
+#include "Bytecode/Interpreter.hpp"
+#include "Bytecode/Printer.hpp"
+
+#include "Statistics.hpp"
+#include "ThreadPool.hpp"
+#include "TimeReport.hpp"
+#include "Trace.hpp"
+#include "Unreachable.hpp"
+
+namespace
 {
-    CComp::ArgParser argParser(argc - 1, argv + 1);
+    using Program = std::vector<std::unique_ptr<CComp::AST::Decl>>;
 
-    std::filesystem::path sourceFilePath = argParser.GetSourceFilePath();
-    if (sourceFilePath.empty())
+    void PrintProgram(std::ostream& out, const Program& ast)
     {
-        std::cerr << "Error: no source file provided." << std::endl;
-        return 1;
+        CComp::DebugPrintVisitor printer(out);
+
+        for (const std::unique_ptr<CComp::AST::Decl>& decl : ast)
+        {
+            decl->Accept(printer);
+        }
     }
 
-    std::shared_ptr<CComp::File> file = CComp::ReadFile(sourceFilePath);
-    if (file == nullptr)
+    // Calls main repeat times and prints how long compiling and running took. False if
+    // the program could not be run; the caller reports why.
+    bool RunTimed(const std::function<bool(int32_t&)>& entry, std::ostream& log,
+                  std::chrono::steady_clock::time_point compileStart, size_t repeat, int32_t& res)
     {
-        std::cerr << "Error: could not read the source file." << std::endl;
-        return 1;
-    }
+        auto runStart = std::chrono::steady_clock::now();
 
-    CComp::Scanner scanner(argParser.GenerateScannerConfiguration(), file);
+        for (size_t i = 0; i < repeat; i++)
+        {
+            if (!entry(res))
+            {
+                return false;
+            }
+        }
 
-    /* 
-    while (true)
-    {
-        CComp::Token token = scanner.NextToken();
+        auto runEnd = std::chrono::steady_clock::now();
 
-        std::cout << static_cast<int>(token.type) << ": " << token.str << std::endl;
+        std::chrono::duration<double, std::milli> compileTime = runStart - compileStart;
+        std::chrono::duration<double, std::milli> runTime = runEnd - runStart;
 
-        if (token.type == CComp::TokenType::END_OF_FILE)
+        log << "Compile time: " << compileTime.count() << " ms" << std::endl;
+        log << "Run time: " << runTime.count() << " ms";
+        if (repeat > 1)
         {
-            break;
+            log << " (" << repeat << " runs, " << runTime.count() / static_cast<double>(repeat) << " ms each)";
         }
+        log << std::endl;
+
+        return true;
     }
-    */
+
+    // Compiles one source file as the options say, writing diagnostics and reports to log.
+    // Returns the exit code: the program's own when it was run.
+    int CompileFile(const CComp::ArgParser& argParser, const std::filesystem::path& sourceFilePath, std::ostream& log,
+                    std::chrono::steady_clock::time_point compileStart)
+    {
+        CComp::TraceSpan span("file", sourceFilePath.native());
+
+        std::shared_ptr<const CComp::File> file = CComp::ReadFile(sourceFilePath);
+        if (file == nullptr)
+        {
+            log << "Error: could not read the source file." << std::endl;
+            return 1;
+        }
+
+        CComp::Reporter reporter(log, argParser.GetDiagnosticsFormat(), argParser.GetErrorLimit());
+        CComp::SetReporter(&reporter);
+
+        CComp::Scanner scanner(argParser.GenerateScannerConfiguration(), file);
+
+        /* 
+        while (true)
+        {
+            CComp::Token token = scanner.NextToken();
+
+            std::cout << static_cast<int>(token.type) << ": " << token.str << std::endl;
+
+            if (token.type == CComp::TokenType::END_OF_FILE)
+            {
+                break;
+            }
+        }
+        */
     
-    CComp::Parser parser(scanner);
+        CComp::Parser parser(scanner);
+
+        CComp::PassInstrumentation instrumentation(argParser.GetPrintAfter(), argParser.ShouldTimePasses(), log);
+
+        // The timings are printed however this returns, as a failing pass is where they matter most,
+        // after the diagnostics that made it fail.
+        struct TimingsPrinter
+        {
+            const CComp::PassInstrumentation& instrumentation;
+            CComp::Reporter& reporter;
+            std::ostream& log;
+
+            ~TimingsPrinter()
+            {
+                if (instrumentation.ShouldTimePasses())
+                {
+                    reporter.Flush();
+                    instrumentation.PrintTimings(log);
+                }
+            }
+        } timingsPrinter{ instrumentation, reporter, log };
+
+        Program v;
+
+        CComp::PassManager<Program> astPasses(instrumentation, PrintProgram);
+
+        astPasses.AddPass("parse", [&](Program& ast)
+        {
+            ast = parser.Parse();
+            return !reporter.HadError();
+        });
+
+        astPasses.AddPass("sema", [](Program& ast)
+        {
+            CComp::SemanticVisitor sema;
+
+            sema.Analyze(ast);
+            return !sema.HadError();
+        });
+
+        if (argParser.ShouldFoldConstants())
+        {
+            astPasses.AddPass("constant-fold", [](Program& ast)
+            {
+                CComp::ConstantFoldVisitor folder;
+
+                folder.Fold(ast);
+
+                CComp::AddStatistic("constant-fold", "AST nodes removed", folder.GetRemovedNodeCount());
+                return true;
+            });
+        }
+
+        if (!astPasses.Run(v))
+        {
+            return 1;
+        }
+
+        if (argParser.ShouldEmitBytecode() || argParser.GetEngine() != CComp::Engine::NATIVE)
+        {
+            int32_t exitCode = 0;
+            bool ran = false;
+            std::string error;
+
+            CComp::Bytecode::Module module;
+
+            if (argParser.ShouldEmitBytecode() || argParser.GetEngine() == CComp::Engine::BYTECODE)
+            {
+                CComp::PassManager<CComp::Bytecode::Module> bytecodePasses(instrumentation, CComp::Bytecode::PrintModule);
+
+                bytecodePasses.AddPass("bytecode-gen", [&](CComp::Bytecode::Module& module)
+                {
+                    CComp::BytecodeGenVisitor bytecodeGen;
+
+                    module = bytecodeGen.Compile(v);
+                    return !bytecodeGen.HadError();
+                });
+
+                if (!bytecodePasses.Run(module))
+                {
+                    return 1;
+                }
+
+                if (argParser.ShouldEmitBytecode())
+                {
+                    CComp::Bytecode::PrintModule(std::cout, module);
+                }
+            }
+
+            switch (argParser.GetEngine())
+            {
+            case CComp::Engine::BYTECODE:
+            {
+                CComp::Bytecode::Interpreter interpreter(module);
+
+                ran = RunTimed([&](int32_t& res) { return interpreter.Run("main", res); }, log,
+                               compileStart, argParser.GetRepeatCount(), exitCode);
+                error = interpreter.GetError();
+                break;
+            }
+
+            case CComp::Engine::TREE:
+            {
+                CComp::EvalVisitor eval;
+
+                ran = RunTimed([&](int32_t& res) { return eval.Run(v, "main", res); }, log,
+                               compileStart, argParser.GetRepeatCount(), exitCode);
+                error = eval.GetError();
+                break;
+            }
+
+            case CComp::Engine::NATIVE:
+                ran = true;
+                break;
+            }
+
+            if (!ran)
+            {
+                log << "Error: " << error << "." << std::endl;
+                return 1;
+            }
+
+            return exitCode;
+        }
+
+        CComp::IR::Module module;
+
+        if (argParser.ShouldEmitIR() || argParser.GetBackend() == CComp::Backend::IR)
+        {
+            CComp::PassManager<CComp::IR::Module> irPasses(instrumentation, CComp::IR::PrintModule);
+
+            irPasses.AddPass("irgen", [&](CComp::IR::Module& module)
+            {
+                CComp::IRGenVisitor irGen;
+
+                module = irGen.Lower(v);
+                return true;
+            });
+
+            if (argParser.ShouldPromoteLocals())
+            {
+                irPasses.AddPass("mem2reg", [](CComp::IR::Module& module)
+                {
+                    size_t promoted = CComp::IR::PromoteLocals(module);
+
+                    CComp::AddStatistic("mem2reg", "slots promoted", static_cast<long long>(promoted));
+                    return true;
+                });
+            }
+
+            if (argParser.ShouldNumberValues())
+            {
+                irPasses.AddPass("value-numbering", [](CComp::IR::Module& module)
+                {
+                    size_t removed = CComp::IR::NumberValues(module);
+
+                    CComp::AddStatistic("value-numbering", "instructions removed", static_cast<long long>(removed));
+                    return true;
+                });
+            }
+
+            irPasses.AddPass("verify", [](CComp::IR::Module& module)
+            {
+                std::vector<std::string> irErrors = CComp::IR::VerifyModule(module);
+
+                for (const std::string& error : irErrors)
+                {
+                    CComp::Unreachable(error);
+                }
+
+                return irErrors.empty();
+            });
+
+            if (!irPasses.Run(module))
+            {
+                return 1;
+            }
+
+            if (argParser.ShouldEmitIR())
+            {
+                CComp::IR::PrintModule(std::cout, module);
+                return 0;
+            }
+        }
+
+        std::vector<CComp::Asm::Instruction> code;
+
+        CComp::PassManager<std::vector<CComp::Asm::Instruction>> asmPasses(instrumentation,
+            [&](std::ostream& out, const std::vector<CComp::Asm::Instruction>& code)
+            {
+                CComp::Asm::PrintInstructions(out, code, argParser.GetTarget());
+            });
+
+        asmPasses.AddPass("codegen", [&](std::vector<CComp::Asm::Instruction>& code)
+        {
+            if (argParser.GetBackend() == CComp::Backend::IR)
+            {
+                CComp::X86Backend backend(code);
+
+                backend.Compile(module);
+            }
+            else if (argParser.GetTarget() == CComp::Asm::Target::X86_64)
+            {
+                CComp::X64CodeGenVisitor vis(code, argParser.ShouldUseRedZone());
+
+                vis.Compile(v, argParser.GetCodegenThreadCount());
+            }
+            else
+            {
+                CComp::CodeGenVisitor vis(code, argParser.ShouldRunPeephole());
+
+                vis.Compile(v, argParser.GetCodegenThreadCount());
+            }
+
+            return true;
+        });
+
+        if (argParser.ShouldRunPeephole())
+        {
+            asmPasses.AddPass("peephole", [&](std::vector<CComp::Asm::Instruction>& code)
+            {
+                CComp::Asm::PeepholeOptimizer peephole(argParser.GetPeepholeWindow(), argParser.GetTarget());
+
+                peephole.Run(code);
 
-    auto v = parser.Parse();
+                for (size_t i = 0; i < static_cast<size_t>(CComp::Asm::PeepholePattern::COUNT); i++)
+                {
+                    CComp::Asm::PeepholePattern pattern = static_cast<CComp::Asm::PeepholePattern>(i);
 
-    CComp::CodeGenVisitor vis(std::cout);
+                    CComp::AddStatistic("peephole", CComp::Asm::PeepholePatternToString(pattern),
+                                        peephole.GetHitCount(pattern));
+                }
 
-    vis.Compile(v);
+                return true;
+            });
+        }
+
+        asmPasses.Run(code);
+
+        if (argParser.ShouldRun())
+        {
+            CComp::Asm::JitModule jit;
+
+            std::vector<std::string> loadErrors = jit.Load(CComp::Asm::Encode(code, argParser.GetTarget()));
+            if (!loadErrors.empty())
+            {
+                for (const std::string& error : loadErrors)
+                {
+                    log << "Error: " << error << "." << std::endl;
+                }
+
+                return 1;
+            }
+
+            // _start would exit the process, so main is called directly.
+            CComp::Asm::JitModule::Function entry = jit.GetFunction("main");
+            if (entry == nullptr)
+            {
+                log << "Error: no 'main' to run." << std::endl;
+                return 1;
+            }
+
+            int32_t exitCode = 0;
+
+            RunTimed([entry](int32_t& res) { res = entry(); return true; }, log, compileStart, argParser.GetRepeatCount(), exitCode);
+
+            return exitCode;
+        }
+
+        std::filesystem::path outputPath = argParser.GetOutputPath(sourceFilePath);
+
+        if (argParser.GetOutputKind() == CComp::OutputKind::ASSEMBLY && outputPath.empty())
+        {
+            // Whatever went through std::cout so far comes first.
+            std::cout.flush();
+
+            CComp::OutputBuffer output(STDOUT_FILENO);
+
+            CComp::Asm::PrintInstructions(output, code, argParser.GetTarget());
+
+            if (!output.Flush())
+            {
+                log << "Error: could not write the assembly." << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::ofstream output(outputPath, std::ios::binary);
+            if (!output)
+            {
+                log << "Error: could not open the output file." << std::endl;
+                return 1;
+            }
+
+            switch (argParser.GetOutputKind())
+            {
+            case CComp::OutputKind::ASSEMBLY:
+                CComp::Asm::PrintInstructions(output, code, argParser.GetTarget());
+                break;
+
+            case CComp::OutputKind::OBJECT:
+                CComp::Asm::WriteObjectFile(output, CComp::Asm::Encode(code, argParser.GetTarget()), argParser.GetTarget());
+                break;
+
+            case CComp::OutputKind::EXECUTABLE:
+            {
+                std::vector<std::string> linkErrors =
+                    CComp::Asm::WriteExecutable(output, CComp::Asm::Encode(code, argParser.GetTarget()), argParser.GetTarget());
+
+                output.close();
+
+                if (!linkErrors.empty())
+                {
+                    for (const std::string& error : linkErrors)
+                    {
+                        log << "Error: " << error << "." << std::endl;
+                    }
+
+                    std::filesystem::remove(outputPath);
+                    return 1;
+                }
+
+                std::filesystem::permissions(outputPath,
+                                             std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec
+                                                 | std::filesystem::perms::others_exec,
+                                             std::filesystem::perm_options::add);
+                break;
+            }
+            }
+        }
+
+        if (reporter.HadError())
+        {
+            return 1;
+        }
     
-    return 0;
+        return 0;
+    }
+
+    // Everything but --server and --client: compiles, and maybe runs, what the options say.
+    int Compile(const CComp::ArgParser& argParser)
+    {
+        if (!argParser.GetErrors().empty())
+        {
+            for (const std::string& error : argParser.GetErrors())
+            {
+                std::cerr << "Error: " << error << "." << std::endl;
+            }
+
+            return 1;
+        }
+
+        CComp::EnableTimeReport(argParser.GetTimeReportFormat() != CComp::TimeReportFormat::NONE);
+        CComp::EnableMemoryReport(argParser.ShouldReportMemory());
+
+        if (!argParser.GetTracePath().empty())
+        {
+            CComp::StartTrace();
+        }
+
+        auto compileStart = std::chrono::steady_clock::now();
+
+        const std::vector<std::filesystem::path>& sources = argParser.GetSourceFilePaths();
+        if (sources.empty())
+        {
+            std::cerr << "Error: no source file provided." << std::endl;
+            return 1;
+        }
+
+        int exitCode = 0;
+
+        if (sources.size() == 1)
+        {
+            exitCode = CompileFile(argParser, sources[0], std::cerr, compileStart);
+        }
+        else
+        {
+            // Each file's diagnostics are kept apart and written out in command line order.
+            std::vector<std::ostringstream> logs(sources.size());
+            std::vector<int> results(sources.size());
+
+            CComp::ParallelFor(sources.size(), argParser.GetJobCount(), [&](size_t i)
+            {
+                results[i] = CompileFile(argParser, sources[i], logs[i], compileStart);
+            });
+
+            size_t failed = 0;
+
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                std::cerr << logs[i].str();
+
+                if (results[i] != 0)
+                {
+                    std::cerr << "Error: could not compile '" << sources[i].string() << "'." << std::endl;
+                    failed++;
+                }
+            }
+
+            if (failed != 0)
+            {
+                std::cerr << failed << " of " << sources.size() << " files failed to compile." << std::endl;
+                exitCode = 1;
+            }
+        }
+
+        if (argParser.ShouldPrintStatistics())
+        {
+            CComp::PrintStatistics(std::cerr);
+        }
+
+        if (argParser.ShouldReportMemory())
+        {
+            CComp::PrintMemoryReport(std::cerr);
+        }
+
+        if (argParser.GetTimeReportFormat() != CComp::TimeReportFormat::NONE)
+        {
+            CComp::PrintTimeReport(std::cerr, argParser.GetTimeReportFormat());
+        }
+
+        if (!argParser.GetTracePath().empty())
+        {
+            if (!CComp::WriteTrace(argParser.GetTracePath()))
+            {
+                std::cerr << "Error: could not write the trace." << std::endl;
+                exitCode = 1;
+            }
+
+            CComp::StopTrace();
+        }
+
+        return exitCode;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    CComp::ArgParser argParser(argc - 1, argv + 1);
+
+    if (argParser.GetErrors().empty() && argParser.ShouldServe())
+    {
+        CComp::FileCache fileCache;
+        CComp::SetFileCache(&fileCache);
+
+        return CComp::RunServer(argParser.GetSocketPath(), [](const std::vector<std::string>& args)
+        {
+            CComp::ArgParser request(args);
+
+            if (request.ShouldServe() || request.ShouldForwardToServer() || request.ShouldRun())
+            {
+                std::cerr << "Error: the compile server does not take '--server', '--client' or '--run'." << std::endl;
+                return 1;
+            }
+
+            return Compile(request);
+        });
+    }
+
+    if (argParser.GetErrors().empty() && argParser.ShouldForwardToServer())
+    {
+        return CComp::RunClient(argParser.GetSocketPath(), argParser.GetForwardedArgs());
+    }
+
+    return Compile(argParser);
 }